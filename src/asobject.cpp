@@ -36,6 +36,7 @@
 #include "scripting/toplevel/XML.h"
 #include "scripting/toplevel/XMLList.h"
 #include "scripting/toplevel/Error.h"
+#include "scripting/toplevel/JSON.h"
 #include "scripting/flash/system/flashsystem.h"
 #include "scripting/flash/net/flashnet.h"
 #include "scripting/flash/display/DisplayObject.h"
@@ -531,43 +532,41 @@ void ASObject::call_toString(asAtom &ret)
 	ASATOM_DECREF(o);
 }
 
-tiny_string ASObject::call_toJSON(bool& ok,std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter)
+bool ASObject::call_toJSON(std::string& out, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter)
 {
-	tiny_string res;
-	ok = false;
 	multiname toJSONName(nullptr);
 	toJSONName.name_type=multiname::NAME_STRING;
-	toJSONName.name_s_id=getSystemState()->getUniqueStringId("toJSON");
+	toJSONName.name_s_id=BUILTIN_STRINGS::STRING_TOJSON;
 	toJSONName.ns.emplace_back(getSystemState(),BUILTIN_STRINGS::EMPTY,NAMESPACE);
 	toJSONName.ns.emplace_back(getSystemState(),BUILTIN_STRINGS::STRING_AS3NS,NAMESPACE);
 	toJSONName.isAttribute = false;
 	if (!ASObject::hasPropertyByMultiname(toJSONName, true, true,getInstanceWorker()))
-		return res;
+		return false;
 
 	asAtom o=asAtomHandler::invalidAtom;
 	getVariableByMultiname(o,toJSONName,SKIP_IMPL,getInstanceWorker());
 	if (!asAtomHandler::isFunction(o))
 	{
 		ASATOM_DECREF(o);
-		return res;
+		return false;
 	}
 	asAtom v=asAtomHandler::fromObject(this);
 	asAtom ret=asAtomHandler::invalidAtom;
 	asAtomHandler::callFunction(o,getInstanceWorker(), ret,v,nullptr,0,false);
 	ASATOM_DECREF(o);
 	if (getInstanceWorker()->currentCallContext && getInstanceWorker()->currentCallContext->exceptionthrown)
-		return res;
+		return false;
 	if (asAtomHandler::isString(ret))
 	{
-		res += "\"";
-		res += asAtomHandler::toString(ret,getInstanceWorker());
-		res += "\"";
+		tiny_string s = asAtomHandler::toString(ret,getInstanceWorker());
+		out += '\"';
+		out.append(s.raw_buf(),s.numBytes());
+		out += '\"';
 	}
 	else 
-		res = asAtomHandler::toObject(ret,getInstanceWorker())->toJSON(path,replacer,spaces,filter);
+		asAtomHandler::toObject(ret,getInstanceWorker())->toJSON(out,path,replacer,spaces,filter);
 	ASATOM_DECREF(ret);
-	ok = true;
-	return res;
+	return true;
 }
 
 bool ASObject::isPrimitive() const
@@ -2469,9 +2468,9 @@ unsigned int ASObject::numVariables() const
 	return Variables.size();
 }
 
-void ASObject::serializeDynamicProperties(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t> traitsMap, ASWorker* wrk, bool usedynamicPropertyWriter, bool forSharedObject)
+void ASObject::serializeDynamicProperties(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk, bool usedynamicPropertyWriter, bool forSharedObject)
 {
 	if (usedynamicPropertyWriter && 
 			!out->getSystemState()->static_ObjectEncoding_dynamicPropertyWriter.isNull() &&
@@ -2507,9 +2506,9 @@ void ASObject::serializeDynamicProperties(ByteArray* out, std::map<tiny_string,
 		Variables.serialize(out, stringMap, objMap, traitsMap,forSharedObject,wrk);
 }
 
-void variables_map::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap, bool forsharedobject, ASWorker* wrk)
+void variables_map::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, bool forsharedobject, ASWorker* wrk)
 {
 	bool amf0 = out->getObjectEncoding() == OBJECT_ENCODING::AMF0;
 	//Pairs of name, value
@@ -2536,9 +2535,9 @@ void variables_map::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& s
 		out->writeStringVR(stringMap, "");
 }
 
-void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk)
+void ASObject::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk)
 {
 	bool amf0 = out->getObjectEncoding() == OBJECT_ENCODING::AMF0;
 	if (amf0)
@@ -2567,18 +2566,7 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 
 	//Check if an alias is registered
 	ApplicationDomain* appdomain = wrk->rootClip->applicationDomain.getPtr();
-	auto aliasIt=appdomain->aliasMap.begin();
-	const auto aliasEnd=appdomain->aliasMap.end();
-	//Linear search for alias
-	tiny_string alias;
-	for(;aliasIt!=aliasEnd;++aliasIt)
-	{
-		if(aliasIt->second==type)
-		{
-			alias=aliasIt->first;
-			break;
-		}
-	}
+	tiny_string alias=appdomain->getClassAlias(type);
 	bool serializeTraits = alias.empty()==false;
 
 	if(type->isSubClass(InterfaceClass<IExternalizable>::getClass(getSystemState())))
@@ -2742,45 +2730,37 @@ ASObject *ASObject::describeType(ASWorker* wrk) const
 	return XML::createFromNode(wrk,root);
 }
 
-tiny_string ASObject::toJSON(std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter)
+static void writeJSONMemberName(std::string& out, SystemState* sys, uint32_t nameId, const tiny_string& spaces)
 {
-	bool ok;
-	tiny_string res = call_toJSON(ok,path,replacer,spaces,filter);
-	if (ok)
-		return res;
+	if (!spaces.empty())
+	{
+		out += '\n';
+		out.append(spaces.raw_buf(),spaces.numBytes());
+	}
+	out += '\"';
+	tiny_string name = sys->getStringFromUniqueId(nameId);
+	out.append(name.raw_buf(),name.numBytes());
+	out += "\":";
+	if (!spaces.empty())
+		out += ' ';
+}
+void ASObject::toJSON(std::string& out, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter)
+{
+	if (call_toJSON(out,path,replacer,spaces,filter))
+		return;
 
-	tiny_string newline = (spaces.empty() ? "" : "\n");
 	if (this->isPrimitive())
 	{
-		switch(this->type)
+		asAtom a = asAtomHandler::fromObject(this);
+		if (!JSON::writePrimitive(out,a,getInstanceWorker(),false))
 		{
-			case T_STRING:
-			{
-				res = this->toString().toQuotedString();
-				break;
-			}
-			case T_UNDEFINED:
-				res += "null";
-				break;
-			case T_NUMBER:
-			case T_INTEGER:
-			case T_UINTEGER:
-			{
-				tiny_string s = this->toString();
-				if (s == "Infinity" || s == "-Infinity" || s == "NaN")
-					res += "null";
-				else
-					res += s;
-				break;
-			}
-			default:
-				res += this->toString();
-				break;
+			tiny_string s = this->toString();
+			out.append(s.raw_buf(),s.numBytes());
 		}
 	}
 	else
 	{
-		res += "{";
+		out += '{';
 		
 		// 
 		std::vector<uint32_t> tmp;
@@ -2796,6 +2776,8 @@ tiny_string ASObject::toJSON(std::vector<ASObject *> &path, asAtom replacer, con
 		bool bfirst = true;
 		bool bObjectVars = true;
 		path.push_back(this);
+		tiny_string subspaces = spaces+spaces;
+		tiny_string closingspaces = spaces.substr_bytes(0,spaces.numBytes()/2);
 		auto tmpIt = tmp.begin();
 		while (tmpIt != tmp.end())
 		{
@@ -2820,87 +2802,71 @@ tiny_string ASObject::toJSON(std::vector<ASObject *> &path, asAtom replacer, con
 				continue;
 			if(varIt->second.ns.hasEmptyName() && (asAtomHandler::isValid(varIt->second.getter) || asAtomHandler::isValid(varIt->second.var)))
 			{
-				ASObject* v = nullptr;
-				bool newobj = false;
+				asAtom value = asAtomHandler::invalidAtom;
 				if (asAtomHandler::isValid(varIt->second.var))
 				{
-					asAtom tmp = varIt->second.var;
-					newobj = !asAtomHandler::isObject(varIt->second.var); // variable is not a pointer to an ASObject, so toObject() will create a temporary ASObject that has to be decreffed after usage
-					v = asAtomHandler::toObject(tmp,getInstanceWorker());
+					value = varIt->second.var;
+					ASATOM_INCREF(value);
 				}
 				else if (asAtomHandler::isValid(varIt->second.getter))
 				{
 					asAtom t=asAtomHandler::fromObject(this);
-					asAtom res=asAtomHandler::invalidAtom;
-					asAtomHandler::callFunction(varIt->second.getter,getInstanceWorker(),res,t,NULL,0,false);
-					newobj = !asAtomHandler::isObject(res); // result is not a pointer to an ASObject, so toObject() will create a temporary ASObject that has to be decreffed after usage
-					asAtom tmp = res;
-					v=asAtomHandler::toObject(tmp,getInstanceWorker());
+					asAtomHandler::callFunction(varIt->second.getter,getInstanceWorker(),value,t,NULL,0,false);
 				}
-				if(v && v->getObjectType() != T_UNDEFINED && varIt->second.isenumerable)
+				if(asAtomHandler::isValid(value) && !asAtomHandler::isUndefined(value) && varIt->second.isenumerable)
 				{
 					// check for cylic reference
-					if (v->getObjectType() != T_UNDEFINED &&
-						v->getObjectType() != T_NULL &&
-						v->getObjectType() != T_BOOLEAN &&
-						std::find(path.begin(),path.end(), v) != path.end())
+					if (asAtomHandler::isObject(value) &&
+						!asAtomHandler::isNull(value) &&
+						!asAtomHandler::isBool(value) &&
+						std::find(path.begin(),path.end(), asAtomHandler::getObjectNoCheck(value)) != path.end())
 					{
+						ASATOM_DECREF(value);
 						createError<TypeError>(getInstanceWorker(), kJSONCyclicStructure);
-						return res;
+						return;
 					}
 					if (asAtomHandler::isValid(replacer))
 					{
 						if (!bfirst)
-							res += ",";
-						res += newline+spaces;
-						res += "\"";
-						res += getSystemState()->getStringFromUniqueId(varIt->first);
-						res += "\"";
-						res += ":";
-						if (!spaces.empty())
-							res += " ";
+							out += ',';
+						writeJSONMemberName(out,getSystemState(),varIt->first,spaces);
 						asAtom params[2];
 						
 						params[0] = asAtomHandler::fromStringID(varIt->first);
-						params[1] = asAtomHandler::fromObject(v);
+						params[1] = value;
 						ASATOM_INCREF(params[1]);
 						asAtom funcret=asAtomHandler::invalidAtom;
 						asAtomHandler::callFunction(replacer,getInstanceWorker(),funcret,asAtomHandler::nullAtom, params, 2,true);
 						if (asAtomHandler::isValid(funcret))
 						{
-							res += asAtomHandler::toString(funcret,getInstanceWorker());
+							tiny_string s = asAtomHandler::toString(funcret,getInstanceWorker());
+							out.append(s.raw_buf(),s.numBytes());
 							ASATOM_DECREF(funcret);
 						}
 						else
-							res += v->toJSON(path,replacer,spaces+spaces,filter);
+							JSON::writeAtom(out,value,path,replacer,subspaces,filter,getInstanceWorker());
 						bfirst = false;
 					}
 					else if (filter.empty() || filter.find(tiny_string(" ")+getSystemState()->getStringFromUniqueId(varIt->first)+" ") != tiny_string::npos)
 					{
 						if (!bfirst)
-							res += ",";
-						res += newline+spaces;
-						res += "\"";
-						res += getSystemState()->getStringFromUniqueId(varIt->first);
-						res += "\"";
-						res += ":";
-						if (!spaces.empty())
-							res += " ";
-						res += v->toJSON(path,replacer,spaces+spaces,filter);
+							out += ',';
+						writeJSONMemberName(out,getSystemState(),varIt->first,spaces);
+						JSON::writeAtom(out,value,path,replacer,subspaces,filter,getInstanceWorker());
 						bfirst = false;
 					}
 				}
-
-				if (newobj)
-					v->decRef();
-				if (!bfirst)
-					res += newline+spaces.substr_bytes(0,spaces.numBytes()/2);
+				ASATOM_DECREF(value);
+				if (!bfirst && !spaces.empty())
+				{
+					out += '\n';
+					out.append(closingspaces.raw_buf(),closingspaces.numBytes());
+				}
 			}
 		}
-		res += "}";
+		out += '}';
 		path.pop_back();
 	}
-	return res;
 }
 
 bool ASObject::hasprop_prototype()
@@ -3107,10 +3073,7 @@ multiname* asAtomHandler::getVariableByMultiname(asAtom& a, asAtom& ret, const m
 void asAtomHandler::getVariableByInteger(asAtom& a, asAtom &ret, int index, ASWorker* wrk)
 {
 	if (asAtomHandler::is<Vector>(a))
-	{
 		asAtomHandler::as<Vector>(a)->getVariableByIntegerDirect(ret,index,wrk);
-		ASATOM_INCREF(ret);
-	}
 	else if (asAtomHandler::isObject(a))
 		asAtomHandler::getObjectNoCheck(a)->getVariableByInteger(ret,index,GET_VARIABLE_OPTION::NONE,wrk);
 	
@@ -3662,6 +3625,13 @@ bool asAtomHandler::add(asAtom& a, asAtom &v2, ASWorker* wrk, bool forceint)
 	}
 	else if(isString(a) || isString(v2))
 	{
+		if (!forceint && (a.uintval&0x7) == ATOM_STRINGPTR)
+		{
+			// appending to a string object, this may avoid copying the string
+			LOG_CALL("add string " << toDebugString(a) << '+' << toDebugString(v2));
+			a.uintval = (LIGHTSPARK_ATOM_VALTYPE)(ASString::concatenate(wrk,getObjectNoCheck(a)->as<ASString>(),toString(v2,wrk)))|ATOM_STRINGPTR;
+			return true;
+		}
 		tiny_string sa = toString(a,wrk);
 		sa += toString(v2,wrk);
 		LOG_CALL("add " << toString(a,wrk) << '+' << toString(v2,wrk));
@@ -3784,6 +3754,15 @@ void asAtomHandler::addreplace(asAtom& ret, ASWorker* wrk, asAtom& v1, asAtom &v
 	}
 	else if(isString(v1) || isString(v2))
 	{
+		if (!forceint && (v1.uintval&0x7) == ATOM_STRINGPTR)
+		{
+			// appending to a string object, this may avoid copying the string
+			LOG_CALL("add replace string " << toDebugString(v1) << '+' << toDebugString(v2));
+			ASString* res = ASString::concatenate(wrk,getObjectNoCheck(v1)->as<ASString>(),toString(v2,wrk));
+			ASATOM_DECREF(ret);
+			ret.uintval = (LIGHTSPARK_ATOM_VALTYPE)(res)|ATOM_STRINGPTR;
+			return;
+		}
 		tiny_string sa = toString(v1,wrk);
 		sa += toString(v2,wrk);
 		LOG_CALL("add replace " << toString(v1,wrk) << '+' << toString(v2,wrk));
@@ -3874,7 +3853,7 @@ void asAtomHandler::addreplace(asAtom& ret, ASWorker* wrk, asAtom& v1, asAtom &v
 	}
 }
 
-void asAtomHandler::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap, std::map<const ASObject*, uint32_t>& objMap, std::map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk, asAtom& a)
+void asAtomHandler::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap, std::unordered_map<const ASObject*, uint32_t>& objMap, std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk, asAtom& a)
 {
 	switch (a.uintval&0x7)
 	{
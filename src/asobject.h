@@ -568,9 +568,9 @@ public:
 	static FORCE_INLINE void add_i(asAtom& a,ASWorker* wrk,asAtom& v2);
 	static FORCE_INLINE void subtract_i(asAtom& a,ASWorker* wrk,asAtom& v2);
 	static FORCE_INLINE void multiply_i(asAtom& a,ASWorker* wrk,asAtom& v2);
-	static void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-						  std::map<const ASObject*, uint32_t>& objMap,
-						  std::map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk,
+	static void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+						  std::unordered_map<const ASObject*, uint32_t>& objMap,
+						  std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk,
 						  asAtom& a);
 	template<class T> static bool is(asAtom& a);
 	template<class T> static T* as(asAtom& a) 
@@ -892,9 +892,9 @@ public:
 	int getNextEnumerable(unsigned int i);
 	~variables_map();
 	void check() const;
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap, bool forsharedobject, ASWorker* wrk);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, bool forsharedobject, ASWorker* wrk);
 	void dumpVariables();
 	void destroyContents();
 	void prepareShutdown();
@@ -1063,9 +1063,9 @@ protected:
 	}
 public:
 	ASObject(ASWorker* wrk, Class_base* c,SWFOBJECT_TYPE t = T_OBJECT,CLASS_SUBTYPE subtype = SUBTYPE_NOT_SET);
-	void serializeDynamicProperties(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t> traitsMap, ASWorker* wrk, bool usedynamicPropertyWriter=true, bool forSharedObject = false);
+	void serializeDynamicProperties(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk, bool usedynamicPropertyWriter=true, bool forSharedObject = false);
 #ifndef NDEBUG
 	//Stuff only used in debugging
 	bool initialized:1;
@@ -1325,7 +1325,8 @@ public:
 	void call_valueOf(asAtom &ret);
 	bool has_toString();
 	void call_toString(asAtom &ret);
-	tiny_string call_toJSON(bool &ok, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces, const tiny_string &filter);
+	// appends the result of the "toJSON" AS-function to out, returns false if there is no such function
+	bool call_toJSON(std::string& out, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces, const tiny_string &filter);
 
 	/* Helper function for calling getClass()->getQualifiedClassName() */
 	virtual tiny_string getClassName() const;
@@ -1370,13 +1371,14 @@ public:
 
 	  The various maps are used to implement reference type of the AMF3 spec
 	*/
-	virtual void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap, ASWorker*wrk);
+	virtual void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker*wrk);
 
 	virtual ASObject *describeType(ASWorker* wrk) const;
 
-	virtual tiny_string toJSON(std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter);
+	// appends the JSON representation of this object to out
+	virtual void toJSON(std::string& out, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter);
 	/* returns true if the current object is of type T */
 	template<class T> bool is() const { 
 		LOG(LOG_INFO,"dynamic cast:"<<this->getClassName());
@@ -20,11 +20,13 @@
 #include "backends/builtindecoder.h"
 #include "scripting/flash/net/flashnet.h"
 #include "swf.h"
+#include "scripting/toplevel/Array.h"
 
 using namespace lightspark;
 
 BuiltinStreamDecoder::BuiltinStreamDecoder(std::istream& _s, NetStream* _ns, uint32_t _buffertime):
-	stream(_s),prevSize(0),decodedAudioBytes(0),decodedVideoFrames(0),decodedTime(0),frameRate(0.0),netstream(_ns),headerbuf(nullptr),headerLen(0),buffertime(_buffertime)
+	stream(_s),prevSize(0),decodedAudioBytes(0),decodedVideoFrames(0),decodedTime(0),frameRate(0.0),netstream(_ns),headerbuf(nullptr),headerLen(0),buffertime(_buffertime),
+	firstTagOffset(0),lastTagTime(0),pendingSeek(-1)
 {
 	STREAM_TYPE t=classifyStream(stream);
 	if(t==FLV_STREAM)
@@ -32,6 +34,7 @@ BuiltinStreamDecoder::BuiltinStreamDecoder(std::istream& _s, NetStream* _ns, uin
 		FLV_HEADER h(stream);
 		valid=h.isValid();
 		hasvideo=h.hasVideo();
+		firstTagOffset=h.skipAmount();
 	}
 	else
 		valid=false;
@@ -62,6 +65,8 @@ BuiltinStreamDecoder::STREAM_TYPE BuiltinStreamDecoder::classifyStream(std::istr
 
 bool BuiltinStreamDecoder::decodeNextFrame()
 {
+	applyPendingSeek();
+	std::streamoff tagOffset=stream.tellg();
 	UI32_FLV PreviousTagSize;
 	stream >> PreviousTagSize;
 	// It seems that Adobe simply ignores invalid values for PreviousTagSize
@@ -76,6 +81,7 @@ bool BuiltinStreamDecoder::decodeNextFrame()
 		{
 			AudioDataTag tag(stream);
 			prevSize=tag.getTotalLen();
+			lastTagTime=tag.getTimestamp();
 			if (tag.packetLen == 0)
 				return false;
 			if (tag.isHeader() && tag.SoundFormat == AAC)
@@ -143,6 +149,9 @@ bool BuiltinStreamDecoder::decodeNextFrame()
 		{
 			VideoDataTag tag(stream);
 			prevSize=tag.getTotalLen();
+			lastTagTime=tag.getTimestamp();
+			if(tag.isKeyframe() && !tag.isHeader() && tagOffset!=-1)
+				keyframes.emplace(tag.getTimestamp(),tagOffset);
 			//If the framerate is known give the right timing, otherwise use decodedTime from audio
 			uint32_t frameTime=(frameRate!=0.0)?(decodedVideoFrames*1000/frameRate):decodedTime;
 
@@ -199,6 +208,9 @@ bool BuiltinStreamDecoder::decodeNextFrame()
 			prevSize=tag.getTotalLen();
 			if (tag.methodName == "onMetaData")
 			{
+				for (auto it = tag.dataobjectlist.begin(); it != tag.dataobjectlist.end(); it++)
+					indexKeyframesFromMetadata(asAtomHandler::getObject(*it));
+
 				// set framerate from metadata, if available
 				multiname m(nullptr);
 				m.name_type=multiname::NAME_STRING;
@@ -230,8 +242,90 @@ bool BuiltinStreamDecoder::decodeNextFrame()
 	return true;
 }
 
+void BuiltinStreamDecoder::indexKeyframesFromMetadata(ASObject* o)
+{
+	// many encoders store a "keyframes" object with the "filepositions" and "times" arrays,
+	// this allows seeking to parts of the stream that have not been demuxed yet
+	if (!o)
+		return;
+	multiname m(nullptr);
+	m.name_type=multiname::NAME_STRING;
+	m.name_s_id=getSys()->getUniqueStringId("keyframes");
+	m.ns.emplace_back(getSys(),BUILTIN_STRINGS::EMPTY,NAMESPACE);
+	m.isAttribute = false;
+	if (!o->hasPropertyByMultiname(m,true,false,o->getInstanceWorker()))
+		return;
+	asAtom v=asAtomHandler::invalidAtom;
+	o->getVariableByMultiname(v,m,GET_VARIABLE_OPTION::NONE,o->getInstanceWorker());
+	ASObject* kf = asAtomHandler::getObject(v);
+	asAtom positions=asAtomHandler::invalidAtom;
+	asAtom times=asAtomHandler::invalidAtom;
+	if (kf)
+	{
+		m.name_s_id=getSys()->getUniqueStringId("filepositions");
+		kf->getVariableByMultiname(positions,m,GET_VARIABLE_OPTION::NONE,kf->getInstanceWorker());
+		m.name_s_id=getSys()->getUniqueStringId("times");
+		kf->getVariableByMultiname(times,m,GET_VARIABLE_OPTION::NONE,kf->getInstanceWorker());
+	}
+	if (asAtomHandler::is<Array>(positions) && asAtomHandler::is<Array>(times))
+	{
+		Array* p = asAtomHandler::as<Array>(positions);
+		Array* t = asAtomHandler::as<Array>(times);
+		uint32_t count = std::min(p->size(),t->size());
+		for (uint32_t i = 0; i < count; i++)
+		{
+			// filepositions point to the tag itself, we index the PreviousTagSize field before it
+			number_t offset = asAtomHandler::toNumber(p->at(i))-4;
+			if (offset < firstTagOffset)
+				continue;
+			keyframes.emplace(asAtomHandler::toNumber(t->at(i))*1000,offset);
+		}
+	}
+	ASATOM_DECREF(positions);
+	ASATOM_DECREF(times);
+	ASATOM_DECREF(v);
+	LOG(LOG_INFO,"FLV keyframe index from metadata: "<<keyframes.size()<<" entries");
+}
+
+void BuiltinStreamDecoder::applyPendingSeek()
+{
+	number_t position;
+	{
+		Locker l(seekMutex);
+		position=pendingSeek;
+		pendingSeek=-1;
+	}
+	if (position < 0)
+		return;
+	std::streamoff offset=firstTagOffset;
+	uint32_t keyframeTime=0;
+	auto it=keyframes.upper_bound(position);
+	if (it!=keyframes.begin())
+	{
+		--it;
+		keyframeTime=it->first;
+		offset=it->second;
+	}
+	std::streamoff current=stream.tellg();
+	// if the target lies beyond what has been indexed but ahead of the current position
+	// demuxing forward is cheaper than going back to the last known keyframe
+	if (current!=-1 && keyframeTime <= lastTagTime && lastTagTime <= position)
+	{
+		LOG(LOG_INFO,"FLV seek to "<<position<<"ms: continuing from "<<lastTagTime<<"ms");
+		return;
+	}
+	LOG(LOG_INFO,"FLV seek to "<<position<<"ms: keyframe at "<<keyframeTime<<"ms offset "<<offset);
+	stream.clear();
+	stream.seekg(offset);
+	lastTagTime=keyframeTime;
+	decodedTime=keyframeTime;
+	decodedVideoFrames=frameRate!=0.0 ? keyframeTime*frameRate/1000 : 0;
+	if (audioDecoder && audioDecoder->getBytesPerMSec())
+		decodedAudioBytes=keyframeTime*audioDecoder->getBytesPerMSec();
+}
+
 void BuiltinStreamDecoder::jumpToPosition(number_t position)
 {
-	if (position != 0)
-		LOG(LOG_NOT_IMPLEMENTED,"jumpToPosition for BuiltinStreamDecoder");
+	Locker l(seekMutex);
+	pendingSeek=position;
 }
@@ -22,6 +22,7 @@
 
 #include "backends/decoder.h"
 #include "parsing/flv.h"
+#include "threading.h"
 
 namespace lightspark
 {
@@ -45,6 +46,18 @@ private:
 	uint8_t* headerbuf;
 	uint32_t headerLen;
 	uint32_t buffertime;
+	//Stream offset of the first PreviousTagSize field, right after the header
+	std::streamoff firstTagOffset;
+	//Timestamp of the last tag that has been demuxed
+	uint32_t lastTagTime;
+	//Maps the time of every keyframe seen so far (or announced by the onMetaData
+	//keyframes table) to the offset of the PreviousTagSize field preceding its tag
+	std::map<uint32_t, std::streamoff> keyframes;
+	//Seeks are requested from the VM thread and applied by the decoding thread
+	Mutex seekMutex;
+	number_t pendingSeek;
+	void indexKeyframesFromMetadata(ASObject* o);
+	void applyPendingSeek();
 public:
 	BuiltinStreamDecoder(std::istream& _s, NetStream* _ns, uint32_t _buffertime);
 	~BuiltinStreamDecoder();
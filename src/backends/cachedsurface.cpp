@@ -35,6 +35,7 @@
 #include "scripting/toplevel/Array.h"
 #include "parsing/tags.h"
 #include "backends/lsopengl.h"
+#include "backends/glyphatlas.h"
 #include "3rdparty/nanovg/src/nanovg.h"
 #include "3rdparty/nanovg/src/nanovg_gl.h"
 #include <algorithm>
@@ -335,10 +336,9 @@ void CachedSurface::Render(SystemState* sys,RenderContext& ctxt, const MATRIX* s
 		Vector2f offset(bounds.min.x-baseTransform.matrix.x0,bounds.min.y-baseTransform.matrix.y0);
 		Vector2f size = bounds.size();
 		
-		bool hasDirtyMatrix = baseTransform.matrix != state->cachedMatrix;
-		if (needsFilterRefresh || hasDirtyMatrix)
+		// the filter result only depends on the content and the scale/rotation of the surface, so it can be reused if only the translation has changed
+		if (needsFilterRefresh || !canReuseFilterResult(baseTransform.matrix,size.x,size.y))
 		{
-			state->cachedMatrix = hasDirtyMatrix ? baseTransform.matrix : state->cachedMatrix;
 			MATRIX m = baseTransform.matrix;
 			m.x0 = -offset.x;
 			m.y0 = -offset.y;
@@ -348,12 +348,16 @@ void CachedSurface::Render(SystemState* sys,RenderContext& ctxt, const MATRIX* s
 			this->renderFilters(sys,ctxt,size.x,size.y,m);
 			if (maskactive)
 				ctxt.activateMask();
+			cachedFilterMatrix = baseTransform.matrix;
+			cachedFilterOffset = offset;
+			cachedFilterWidth = size.x;
+			cachedFilterHeight = size.y;
 		}
 		if (cachedFilterTextureID != UINT32_MAX)
 		{
 			MATRIX m;
-			m.x0 = std::round(baseTransform.matrix.x0+offset.x);
-			m.y0 = std::round(baseTransform.matrix.y0+offset.y);
+			m.x0 = std::round(baseTransform.matrix.x0+cachedFilterOffset.x);
+			m.y0 = std::round(baseTransform.matrix.y0+cachedFilterOffset.y);
 			if (DisplayObject::isShaderBlendMode(state->blendmode))
 			{
 				assert (!sys->getRenderThread()->filterframebufferstack.empty());
@@ -386,7 +390,7 @@ void CachedSurface::Render(SystemState* sys,RenderContext& ctxt, const MATRIX* s
 			}
 			sys->getRenderThread()->setModelView(m);
 			sys->getRenderThread()->setupRenderingState(state->alpha,ctxt.transformStack().transform().colorTransform,state->smoothing,state->blendmode);
-			sys->getRenderThread()->renderTextureToFrameBuffer(cachedFilterTextureID,size.x,size.y,nullptr,nullptr,false,true,false);
+			sys->getRenderThread()->renderTextureToFrameBuffer(cachedFilterTextureID,cachedFilterWidth,cachedFilterHeight,nullptr,nullptr,false,true,false);
 			if (maskactive)
 			{
 				engineData->exec_glDisable_GL_STENCIL_TEST();
@@ -442,6 +446,8 @@ void CachedSurface::renderImpl(SystemState* sys,RenderContext& ctxt)
 			ColorTransformBase ct = ctxt.transformStack().transform().colorTransform;
 			nvgResetTransform(nvgctxt);
 			nvgBeginFrame(nvgctxt, sys->getRenderThread()->currentframebufferWidth, sys->getRenderThread()->currentframebufferHeight, 1.0);
+			if (!ctxt.isDrawingMask())
+				sys->getEngineData()->glyphAtlas->beginNanoVGFrame();
 			if (!ctxt.isMaskActive() && !ctxt.isDrawingMask())
 				nvgDeactivateClipping(nvgctxt);
 			switch (ctxt.transformStack().transform().blendmode)
@@ -518,6 +524,17 @@ void CachedSurface::renderImpl(SystemState* sys,RenderContext& ctxt)
 						it = tk->filltokens->tokens.begin();
 						if (tk->isGlyph)
 						{
+							if (renderneeded && !ctxt.isDrawingMask())
+							{
+								// render the pending path with its own fill color before the next glyph starts
+								if (instroke)
+									nvgStroke(nvgctxt);
+								if (infill)
+									nvgFill(nvgctxt);
+								renderneeded=false;
+								nvgClosePath(nvgctxt);
+								nvgBeginPath(nvgctxt);
+							}
 							RGBA color = tk->color;
 							float r,g,b,a;
 							ct.applyTransformation(color,r,g,b,a);
@@ -527,6 +544,14 @@ void CachedSurface::renderImpl(SystemState* sys,RenderContext& ctxt)
 							nvgResetTransform(nvgctxt);
 							nvgTransform(nvgctxt,basetransform[0],basetransform[1],basetransform[2],basetransform[3],basetransform[4],basetransform[5]);
 							nvgTransform(nvgctxt,tk->startMatrix.xx,tk->startMatrix.yx,tk->startMatrix.xy,tk->startMatrix.yy,tk->startMatrix.x0,tk->startMatrix.y0);
+							if (!ctxt.isDrawingMask())
+							{
+								float glyphtransform[6];
+								nvgCurrentTransform(nvgctxt,glyphtransform);
+								// use the rasterized glyph from the atlas instead of filling the vector path
+								if (sys->getEngineData()->glyphAtlas->drawNanoVGGlyph(nvgctxt,glyphtransform,tk->filltokens,r,g,b,a,state->smoothing != SMOOTH_NONE))
+									it = itend;
+							}
 						}
 						if (tk->next)
 							tk = tk->next;
@@ -765,7 +790,10 @@ void CachedSurface::renderImpl(SystemState* sys,RenderContext& ctxt)
 			}
 			nvgClosePath(nvgctxt);
 			if (!ctxt.isDrawingMask())
+			{
+				sys->getEngineData()->glyphAtlas->endNanoVGFrame(nvgctxt);
 				nvgEndFrame(nvgctxt);
+			}
 			sys->getEngineData()->exec_glStencilFunc_GL_ALWAYS();
 			sys->getEngineData()->exec_glActiveTexture_GL_TEXTURE0(SAMPLEPOSITION::SAMPLEPOS_STANDARD);
 			sys->getEngineData()->exec_glBlendFunc(BLEND_ONE,BLEND_ONE_MINUS_SRC_ALPHA);
@@ -820,6 +848,13 @@ void CachedSurface::renderImpl(SystemState* sys,RenderContext& ctxt)
 	});
 	sys->getEngineData()->exec_glDisable_GL_SCISSOR_TEST();
 }
+bool CachedSurface::canReuseFilterResult(const MATRIX& m, uint32_t w, uint32_t h) const
+{
+	return cachedFilterTextureID != UINT32_MAX
+			&& w == cachedFilterWidth && h == cachedFilterHeight
+			&& m.xx == cachedFilterMatrix.xx && m.yx == cachedFilterMatrix.yx
+			&& m.xy == cachedFilterMatrix.xy && m.yy == cachedFilterMatrix.yy;
+}
 void CachedSurface::renderFilters(SystemState* sys,RenderContext& ctxt, uint32_t w, uint32_t h, const MATRIX& m)
 {
 	// rendering of filters currently works as follows:
@@ -58,7 +58,6 @@ public:
 	float yscale;
 	ColorTransformBase colortransform;
 	MATRIX matrix;
-	MATRIX cachedMatrix;
 	tokensVector tokens;
 	std::vector<_R<CachedSurface>> childrenlist;
 	_NR<CachedSurface> mask;
@@ -93,8 +92,15 @@ private:
 	SurfaceState* state;
 	void renderImpl(SystemState* sys,RenderContext& ctxt);
 	void defaultRender(RenderContext& ctxt);
+	// render transform the filter result in cachedFilterTextureID was computed for
+	MATRIX cachedFilterMatrix;
+	// position of the filter result relative to the translation of cachedFilterMatrix
+	Vector2f cachedFilterOffset;
+	uint32_t cachedFilterWidth;
+	uint32_t cachedFilterHeight;
+	bool canReuseFilterResult(const MATRIX& m, uint32_t w, uint32_t h) const;
 public:
-	CachedSurface():state(nullptr),tex(nullptr),isChunkOwner(true),isValid(false),isInitialized(false),wasUpdated(false),cachedFilterTextureID(UINT32_MAX)
+	CachedSurface():state(nullptr),cachedFilterWidth(0),cachedFilterHeight(0),tex(nullptr),isChunkOwner(true),isValid(false),isInitialized(false),wasUpdated(false),cachedFilterTextureID(UINT32_MAX)
 	{
 	}
 	~CachedSurface();
@@ -85,7 +85,8 @@ Config::Config():
 	//DEFAULT SETTINGS
 	defaultCacheDirectory((string) g_get_user_cache_dir() + G_DIR_SEPARATOR_S + "lightspark"),
 	cacheDirectory(defaultCacheDirectory),cachePrefix("cache"),userDataDirectory((string)g_get_user_data_dir() + G_DIR_SEPARATOR_S + "lightspark"),
-	renderingEnabled(true)
+	renderingEnabled(true),videoCPUConversion(false),videoDecoderThreads(0),
+	stage3DSoftwareRendering(false),stage3DRenderThreads(0)
 {
 #ifdef _WIN32
 	const char* exePath = getExectuablePath();
@@ -205,6 +206,18 @@ void Config::handleEntry()
 	//Rendering
 	if(group == "rendering" && key == "enabled")
 		renderingEnabled = atoi(value.c_str());
+	//Video color conversion
+	else if(group == "video" && key == "cpuconversion")
+		videoCPUConversion = atoi(value.c_str());
+	//Video decoding threads
+	else if(group == "video" && key == "threads")
+		videoDecoderThreads = atoi(value.c_str());
+	//Software Stage3D rendering
+	else if(group == "stage3d" && key == "software")
+		stage3DSoftwareRendering = atoi(value.c_str());
+	//Software Stage3D rendering threads
+	else if(group == "stage3d" && key == "threads")
+		stage3DRenderThreads = atoi(value.c_str());
 	//Cache directory
 	else if(group == "cache" && key == "directory")
 		cacheDirectory = value;
@@ -52,6 +52,14 @@ namespace lightspark
 
 		//Specifies if rendering should be done
 		bool renderingEnabled;
+		//Specifies if decoded video frames are converted to RGB on the CPU instead of in the shader
+		bool videoCPUConversion;
+		//Number of threads used by each video decoder, 0 lets FFmpeg choose from the number of cores
+		int videoDecoderThreads;
+		//Specifies if Stage3D is rendered on the CPU instead of with OpenGL
+		bool stage3DSoftwareRendering;
+		//Number of threads used by the software Stage3D renderer, 0 uses one thread per core
+		int stage3DRenderThreads;
 		Config();
 		~Config();
 	public:
@@ -66,6 +74,10 @@ namespace lightspark
 		const std::string& getGnashPath() const { return gnashPath; }
 
 		bool isRenderingEnabled() const { return renderingEnabled; }
+		bool isVideoCPUConversionEnabled() const { return videoCPUConversion; }
+		int getVideoDecoderThreads() const { return videoDecoderThreads; }
+		bool isStage3DSoftwareRenderingEnabled() const { return stage3DSoftwareRendering; }
+		int getStage3DRenderThreads() const { return stage3DRenderThreads; }
 	};
 }
 
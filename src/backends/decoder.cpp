@@ -21,6 +21,7 @@
 #include <cassert>
 
 #include "backends/decoder.h"
+#include "backends/config.h"
 #include "platforms/fastpaths.h"
 #include "platforms/engineutils.h"
 #include "swf.h"
@@ -120,7 +121,7 @@ void VideoDecoder::clearFrameBuffer()
 	if (decodedframebuffer)
 		memset(decodedframebuffer,0,frameWidth*frameHeight*4);
 }
-VideoDecoder::VideoDecoder():decodedframebuffer(nullptr),frameRate(0),framesdecoded(0),framesdropped(0),frameWidth(0),frameHeight(0),lastframe(UINT32_MAX),currentframe(UINT32_MAX),fenceCount(0),resizeGLBuffers(false),markedForDeletion(false)
+VideoDecoder::VideoDecoder():decodedframebuffer(nullptr),frameRate(0),framesdecoded(0),framesdropped(0),decodeTime(0),frameWidth(0),frameHeight(0),lastframe(UINT32_MAX),currentframe(UINT32_MAX),fenceCount(0),resizeGLBuffers(false),markedForDeletion(false)
 {
 }
 
@@ -168,7 +169,7 @@ bool FFMpegVideoDecoder::fillDataAndCheckValidity()
 }
 
 FFMpegVideoDecoder::FFMpegVideoDecoder(LS_VIDEO_CODEC codecId, uint8_t* initdata, uint32_t datalen, double frameRateHint, DefineVideoStreamTag *tag):
-	ownedContext(true),curBuffer(0),codecContext(nullptr),streamingbuffers(FFMPEGVIDEODECODERBUFFERSIZE),embeddedbuffers(2),curBufferOffset(0),embeddedvideotag(tag)
+	ownedContext(true),cpuColorConversion(Config::getConfig()->isVideoCPUConversionEnabled()),curBuffer(0),codecContext(nullptr),streamingbuffers(FFMPEGVIDEODECODERBUFFERSIZE),embeddedbuffers(2),curBufferOffset(0),embeddedvideotag(tag)
 {
 	//The tag is the header, initialize decoding
 	switchCodec(codecId, initdata, datalen, frameRateHint);
@@ -253,6 +254,7 @@ void FFMpegVideoDecoder::switchCodec(LS_VIDEO_CODEC codecId, uint8_t *initdata,
 		codecContext->extradata=initdata;
 		codecContext->extradata_size=datalen;
 	}
+	setupThreading();
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(53,8,0)
 	if(avcodec_open2(codecContext, codec, nullptr)<0)
 #else
@@ -267,7 +269,7 @@ void FFMpegVideoDecoder::switchCodec(LS_VIDEO_CODEC codecId, uint8_t *initdata,
 }
 #if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 40, 101)
 FFMpegVideoDecoder::FFMpegVideoDecoder(AVCodecParameters* codecPar, double frameRateHint):
-	ownedContext(true),curBuffer(0),codecContext(nullptr),streamingbuffers(FFMPEGVIDEODECODERBUFFERSIZE),embeddedbuffers(2),curBufferOffset(0),embeddedvideotag(nullptr)
+	ownedContext(true),cpuColorConversion(Config::getConfig()->isVideoCPUConversionEnabled()),curBuffer(0),codecContext(nullptr),streamingbuffers(FFMPEGVIDEODECODERBUFFERSIZE),embeddedbuffers(2),curBufferOffset(0),embeddedvideotag(nullptr)
 {
 	status=INIT;
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(53,8,0)
@@ -296,6 +298,7 @@ FFMpegVideoDecoder::FFMpegVideoDecoder(AVCodecParameters* codecPar, double frame
 	}
 	avcodec_parameters_to_context(codecContext,codecPar);
 	const AVCodec* codec=avcodec_find_decoder(codecPar->codec_id);
+	setupThreading();
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(53,8,0)
 	if(avcodec_open2(codecContext, codec, nullptr)<0)
 #else
@@ -311,7 +314,7 @@ FFMpegVideoDecoder::FFMpegVideoDecoder(AVCodecParameters* codecPar, double frame
 }
 #else
 FFMpegVideoDecoder::FFMpegVideoDecoder(AVCodecContext* _c, double frameRateHint):
-	ownedContext(false),curBuffer(0),codecContext(_c),curBufferOffset(0),embeddedvideotag(nullptr)
+	ownedContext(false),cpuColorConversion(Config::getConfig()->isVideoCPUConversionEnabled()),curBuffer(0),codecContext(_c),curBufferOffset(0),embeddedvideotag(nullptr)
 {
 	frameIn=av_frame_alloc();
 	status=INIT;
@@ -346,9 +349,28 @@ FFMpegVideoDecoder::FFMpegVideoDecoder(AVCodecContext* _c, double frameRateHint)
 }
 #endif
 
+void FFMpegVideoDecoder::setupThreading()
+{
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57,106,102)
+	// Embedded video frames are decoded synchronously during upload and must be
+	// available immediately, so only streams may use frame threading
+	if (embeddedvideotag)
+	{
+		codecContext->thread_count=1;
+		return;
+	}
+	codecContext->thread_count=Config::getConfig()->getVideoDecoderThreads();
+	codecContext->thread_type=FF_THREAD_FRAME|FF_THREAD_SLICE;
+#else
+	codecContext->thread_count=1;
+#endif
+}
+
 FFMpegVideoDecoder::~FFMpegVideoDecoder()
 {
 	while(fenceCount);
+	if (framesdecoded && codecContext)
+		LOG(LOG_INFO,"VIDEO DEC: "<<frameWidth<<'x'<<frameHeight<<" decoded "<<framesdecoded<<" frames with "<<codecContext->thread_count<<" threads in "<<decodeTime/1000<<"ms, "<<(decodeTime/framesdecoded)<<"us per frame");
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(55,63,100)
 	avcodec_free_context(&codecContext);
 #else
@@ -374,9 +396,9 @@ void FFMpegVideoDecoder::setSize(uint32_t w, uint32_t h)
 		//As the size changed, reset the buffer
 		uint32_t bufferSize=frameWidth*frameHeight/**4*/;
 		if (embeddedvideotag)
-			embeddedbuffers.regen(YUVBufferGenerator(bufferSize,this->codecContext->pix_fmt==AV_PIX_FMT_YUVA420P, this->codecContext->pix_fmt!=AV_PIX_FMT_BGRA));
+			embeddedbuffers.regen(YUVBufferGenerator(bufferSize,this->codecContext->pix_fmt!=AV_PIX_FMT_BGRA));
 		else
-			streamingbuffers.regen(YUVBufferGenerator(bufferSize,this->codecContext->pix_fmt==AV_PIX_FMT_YUVA420P, this->codecContext->pix_fmt!=AV_PIX_FMT_BGRA));
+			streamingbuffers.regen(YUVBufferGenerator(bufferSize,this->codecContext->pix_fmt!=AV_PIX_FMT_BGRA));
 	}
 }
 
@@ -456,6 +478,9 @@ bool FFMpegVideoDecoder::decodeData(uint8_t* data, uint32_t datalen, uint32_t ti
 		return 0;
 	pkt->data=data;
 	pkt->size=datalen;
+	// with frame threading the decoder returns frames some packets later, so the time travels with the packet
+	pkt->pts=time;
+	gint64 start=g_get_monotonic_time();
 	int ret = avcodec_send_packet(codecContext, pkt);
 	while (ret == 0)
 	{
@@ -470,6 +495,7 @@ bool FFMpegVideoDecoder::decodeData(uint8_t* data, uint32_t datalen, uint32_t ti
 #else
 				av_free_packet(pkt);
 #endif
+				decodeTime+=g_get_monotonic_time()-start;
 				return false;
 			}
 		}
@@ -478,11 +504,12 @@ bool FFMpegVideoDecoder::decodeData(uint8_t* data, uint32_t datalen, uint32_t ti
 			if(status==INIT && fillDataAndCheckValidity())
 				status=VALID;
 	
-			assert(frameIn->pts==(int64_t)AV_NOPTS_VALUE || frameIn->pts==0);
-			if (time != UINT32_MAX)
-				copyFrameToBuffers(frameIn, time);
+			uint32_t frametime=frameIn->pts==(int64_t)AV_NOPTS_VALUE ? time : frameIn->pts;
+			if (frametime != UINT32_MAX)
+				copyFrameToBuffers(frameIn, frametime);
 		}
 	}
+	decodeTime+=g_get_monotonic_time()-start;
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57,12,100)
 	av_packet_unref(pkt);
 #else
@@ -524,6 +551,9 @@ bool FFMpegVideoDecoder::decodeData(uint8_t* data, uint32_t datalen, uint32_t ti
 bool FFMpegVideoDecoder::decodePacket(AVPacket* pkt, uint32_t time)
 {
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57,106,102)
+	// with frame threading the decoder returns frames some packets later, so the time travels with the packet
+	pkt->pts=time;
+	gint64 start=g_get_monotonic_time();
 	int ret = avcodec_send_packet(codecContext, pkt);
 	while (ret == 0)
 	{
@@ -533,6 +563,7 @@ bool FFMpegVideoDecoder::decodePacket(AVPacket* pkt, uint32_t time)
 			if (ret != AVERROR(EAGAIN))
 			{
 				LOG(LOG_INFO,"not decoded:"<<ret);
+				decodeTime+=g_get_monotonic_time()-start;
 				return false;
 			}
 		}
@@ -553,9 +584,10 @@ bool FFMpegVideoDecoder::decodePacket(AVPacket* pkt, uint32_t time)
 					LOG(LOG_NOT_IMPLEMENTED,"sending metadata from stream:"<<entry->key<<" "<<entry->value);
 				}
 			}
-			copyFrameToBuffers(frameIn, time);
+			copyFrameToBuffers(frameIn, frameIn->pts==(int64_t)AV_NOPTS_VALUE ? time : frameIn->pts);
 		}
 	}
+	decodeTime+=g_get_monotonic_time()-start;
 #else
 	int frameOk=0;
 
@@ -586,12 +618,28 @@ bool FFMpegVideoDecoder::decodePacket(AVPacket* pkt, uint32_t time)
 	return true;
 }
 
+void FFMpegVideoDecoder::flushDelayedFrames()
+{
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57,106,102)
+	if (embeddedvideotag || codecContext->thread_count==1)
+		return;
+	// enter draining mode and collect the frames still held by the decoding threads
+	if (avcodec_send_packet(codecContext, nullptr) < 0)
+		return;
+	while (avcodec_receive_frame(codecContext,frameIn) == 0)
+	{
+		if (frameIn->pts != (int64_t)AV_NOPTS_VALUE && frameIn->pts != UINT32_MAX)
+			copyFrameToBuffers(frameIn, frameIn->pts);
+	}
+	avcodec_flush_buffers(codecContext);
+#endif
+}
+
 void FFMpegVideoDecoder::copyFrameToBuffers(const AVFrame* frameIn, uint32_t time)
 {
 	YUVBuffer* curTail=nullptr;
 	curTail=embeddedvideotag ?  &embeddedbuffers.acquireLast() : &streamingbuffers.acquireLast();
 	//Only one thread may access the tail
-	int offset[3]={0,0,0};
 	// ffmpeg seems to decode GIFs in AV_PIX_FMT_BGRA format and puts all data in first channel
 	if (codecContext->pix_fmt==AV_PIX_FMT_BGRA)
 	{
@@ -610,23 +658,11 @@ void FFMpegVideoDecoder::copyFrameToBuffers(const AVFrame* frameIn, uint32_t tim
 	}
 	else
 	{
-		for(uint32_t y=0;y<frameHeight;y++)
-		{
-			memcpy(curTail->ch[0]+offset[0],frameIn->data[0]+(y*frameIn->linesize[0]),frameWidth);
-			if (codecContext->pix_fmt==AV_PIX_FMT_YUVA420P)
-				memcpy(curTail->ch[3]+offset[0],frameIn->data[3]+(y*frameIn->linesize[0]),frameWidth);
-			offset[0]+=frameWidth;
-		}
-		if (codecContext->pix_fmt!=AV_PIX_FMT_BGRA)
-		{
-			for(uint32_t y=0;y<frameHeight/2;y++)
-			{
-				memcpy(curTail->ch[1]+offset[1],frameIn->data[1]+(y*frameIn->linesize[1]),frameWidth/2);
-				memcpy(curTail->ch[2]+offset[2],frameIn->data[2]+(y*frameIn->linesize[2]),frameWidth/2);
-				offset[1]+=frameWidth/2;
-				offset[2]+=frameWidth/2;
-			}
-		}
+		// keep a reference to the decoded planes instead of copying them,
+		// the data is only copied if the decoder does not provide refcounted frames
+		av_frame_unref(curTail->frame);
+		if (av_frame_ref(curTail->frame, frameIn) < 0)
+			LOG(LOG_ERROR,"VIDEO DEC: unable to reference decoded frame");
 	}
 	curTail->time=time;
 	if (embeddedvideotag)
@@ -671,9 +707,15 @@ uint8_t* FFMpegVideoDecoder::upload(bool refresh)
 	{
 		memcpy(decodedframebuffer,cur->ch[0],frameWidth*frameHeight*4);
 	}
-	else
+	else if (cur->frame->data[0])
 	{
-		fastYUV420ChannelsToYUV0Buffer(cur->ch[0],cur->ch[1],cur->ch[2],decodedframebuffer,frameWidth,frameHeight);
+		const AVFrame* f=cur->frame;
+		if (cpuColorConversion)
+			fastYUV420ChannelsToBGRA(f->data[0],f->data[1],f->data[2],f->linesize[0],f->linesize[1],decodedframebuffer,frameWidth,frameHeight);
+		else if (uint32_t(f->linesize[0])==frameWidth && uint32_t(f->linesize[1])==frameWidth/2 && frameWidth%16==0)
+			fastYUV420ChannelsToYUV0Buffer(f->data[0],f->data[1],f->data[2],decodedframebuffer,frameWidth,frameHeight);
+		else
+			fastYUV420ChannelsToYUV0BufferStrided(f->data[0],f->data[1],f->data[2],f->linesize[0],f->linesize[1],decodedframebuffer,frameWidth,frameHeight);
 		if (codecContext->pix_fmt==AV_PIX_FMT_YUVA420P)
 		{
 			uint32_t texw= (frameWidth+15)&0xfffffff0;
@@ -682,7 +724,7 @@ uint8_t* FFMpegVideoDecoder::upload(bool refresh)
 				for(uint32_t j=0;j<frameWidth;j++)
 				{
 					uint32_t pixelCoordFull=i*texw+j;
-					decodedframebuffer[pixelCoordFull*4+3]=cur->ch[3][i*frameWidth+j];
+					decodedframebuffer[pixelCoordFull*4+3]=f->data[3][i*f->linesize[3]+j];
 				}
 			}
 		}
@@ -692,29 +734,11 @@ uint8_t* FFMpegVideoDecoder::upload(bool refresh)
 
 void FFMpegVideoDecoder::YUVBufferGenerator::init(YUVBuffer& buf) const
 {
-	if(buf.ch[0])
-	{
-		aligned_free(buf.ch[0]);
-		if (hasChannels)
-		{
-			aligned_free(buf.ch[1]);
-			aligned_free(buf.ch[2]);
-			if (buf.ch[3])
-				aligned_free(buf.ch[3]);
-		}
-	}
-	if (hasChannels)
-	{
-		aligned_malloc((void**)&buf.ch[0], 16, bufferSize);
-		aligned_malloc((void**)&buf.ch[1], 16, bufferSize/4);
-		aligned_malloc((void**)&buf.ch[2], 16, bufferSize/4);
-		if (hasAlpha)
-			aligned_malloc((void**)&buf.ch[3], 16, bufferSize);
-	}
-	else
-	{
+	buf.setDecodedData(nullptr);
+	// planar frames reference the buffers of the decoder, so only BGRA frames need their own memory
+	av_frame_unref(buf.frame);
+	if (!hasChannels)
 		aligned_malloc((void**)&buf.ch[0], 16, bufferSize*4);
-	}
 }
 #endif //ENABLE_LIBAVCODEC
 
@@ -124,6 +124,12 @@ public:
 	double frameRate;
 	uint32_t framesdecoded;
 	uint32_t framesdropped;
+	// total time spent in the codec, in microseconds
+	uint64_t decodeTime;
+	/*
+		Output the frames still held by the codec, called when the stream ends
+	*/
+	virtual void flushDelayedFrames() {}
 	/*
 		Useful to avoid destruction of the object while a pending upload is waiting
 	*/
@@ -184,12 +190,15 @@ private:
 	YUVBuffer(const YUVBuffer&); /* no impl */
 	YUVBuffer& operator=(const YUVBuffer&); /* no impl */
 	public:
+		// Only used for BGRA frames, planar frames are kept in frame
 		uint8_t* ch[4];
+		// Reference to the decoded frame, shares the buffers of the decoder
+		AVFrame* frame;
 		uint32_t time;
-		YUVBuffer():time(0){ch[0]=nullptr;ch[1]=nullptr;ch[2]=nullptr;ch[3]=nullptr;}
+		YUVBuffer():frame(nullptr),time(0){ch[0]=nullptr;ch[1]=nullptr;ch[2]=nullptr;ch[3]=nullptr;}
 		~YUVBuffer()
 		{
-			setDecodedData(nullptr);
+			cleanup();
 		}
 		void setDecodedData(uint8_t* data)
 		{
@@ -212,23 +221,27 @@ private:
 			ch[1]=nullptr;
 			ch[2]=nullptr;
 			ch[3]=nullptr;
+			frame=av_frame_alloc();
 		}
 		void cleanup()
 		{
 			setDecodedData(nullptr);
+			if(frame)
+				av_frame_free(&frame);
 		}
 	};
 	class YUVBufferGenerator
 	{
 	private:
 		uint32_t bufferSize;
-		bool hasAlpha;
 		bool hasChannels;
 	public:
-		YUVBufferGenerator(uint32_t b, bool _hasalpha, bool _haschannels):bufferSize(b),hasAlpha(_hasalpha),hasChannels(_haschannels){}
+		YUVBufferGenerator(uint32_t b, bool _haschannels):bufferSize(b),hasChannels(_haschannels){}
 		void init(YUVBuffer& buf) const;
 	};
 	bool ownedContext;
+	// Convert frames to BGRA during upload instead of leaving it to the shader
+	bool cpuColorConversion;
 	uint32_t curBuffer;
 	AVCodecContext* codecContext;
 	BlockingCircularQueue<YUVBuffer> streamingbuffers;
@@ -239,6 +252,7 @@ private:
 	bool fillDataAndCheckValidity();
 	uint32_t curBufferOffset;
 	DefineVideoStreamTag* embeddedvideotag;
+	void setupThreading();
 public:
 	FFMpegVideoDecoder(LS_VIDEO_CODEC codec, uint8_t* initdata, uint32_t datalen, double frameRateHint,DefineVideoStreamTag* tag=nullptr);
 	/*
@@ -259,6 +273,7 @@ public:
 	bool discardFrame() override;
 	uint32_t skipUntil(uint32_t time) override;
 	void skipAll() override;
+	void flushDelayedFrames() override;
 	void setFlushing() override
 	{
 		flushing=true;
@@ -40,6 +40,18 @@ void ShapesBuilder::clear()
 	strokeShapesMap.clear();
 }
 
+std::vector<ShapePathSegment>& ShapesBuilder::getStyleBucket(StyleBuckets& buckets, unsigned int style)
+{
+	// styles are usually appended in increasing order, so check the last bucket first
+	if (!buckets.empty() && buckets.back().first == style)
+		return buckets.back().second;
+	auto it = std::lower_bound(buckets.begin(), buckets.end(), style,
+		[](const StyleBuckets::value_type& b, unsigned int s) { return b.first < s; });
+	if (it == buckets.end() || it->first != style)
+		it = buckets.emplace(it, style, std::vector<ShapePathSegment>());
+	return it->second;
+}
+
 static void mmremove(multimap<uint64_t, int>& map, uint64_t pos, int idx)
 {
 	auto itpair = map.equal_range(pos);
@@ -134,7 +146,7 @@ void ShapesBuilder::endSubpathForStyles(unsigned fill0, unsigned fill1, unsigned
 	// 'natural' order of edges in file affects output of path reconstruction
 	if (fill0)
 	{
-		auto& segments = filledShapesMap[fill0];
+		auto& segments = getStyleBucket(filledShapesMap,fill0);
 		if (!formorphing || !segments.empty())
 		{
 			for (int i = currentSubpath.size()-1; i >= 0; --i) {
@@ -146,12 +158,12 @@ void ShapesBuilder::endSubpathForStyles(unsigned fill0, unsigned fill1, unsigned
 	}
 
 	if (fill1) {
-		auto& segments = filledShapesMap[fill1];
+		auto& segments = getStyleBucket(filledShapesMap,fill1);
 		segments.insert(segments.end(), currentSubpath.begin(), currentSubpath.end());
 	}
 
 	if (stroke && !fill0 && !fill1) {
-		auto& segments = strokeShapesMap[stroke];
+		auto& segments = getStyleBucket(strokeShapesMap,stroke);
 		segments.insert(segments.end(), currentSubpath.begin(), currentSubpath.end());
 	}
 
@@ -162,6 +174,9 @@ void ShapesBuilder::outputTokens(const std::list<FILLSTYLE> &styles, const std::
 {
 	assert(currentSubpath.empty());
 	auto it=filledShapesMap.begin();
+	// buckets are sorted by style index, so the style iterators only move forward
+	auto stylesIt=styles.begin();
+	unsigned int stylesIndex=1;
 	//For each color
 	for(;it!=filledShapesMap.end();++it)
 	{
@@ -171,9 +186,8 @@ void ShapesBuilder::outputTokens(const std::list<FILLSTYLE> &styles, const std::
 		if(!isGlyph)
 		{
 			//Find the style given the index
-			auto stylesIt=styles.begin();
 			assert(it->first);
-			for(unsigned int i=0;i<it->first-1;i++)
+			for(;stylesIndex<it->first;stylesIndex++)
 			{
 				++stylesIt;
 				assert(stylesIt!=styles.end());
@@ -255,23 +269,24 @@ void ShapesBuilder::outputTokens(const std::list<FILLSTYLE> &styles, const std::
 		if (!tokens.stroketokens)
 			tokens.stroketokens=_MR(new tokenListRef());
 		it=strokeShapesMap.begin();
+		auto linestylesIt=linestyles.begin();
+		unsigned int linestylesIndex=1;
 		//For each stroke
 		for(;it!=strokeShapesMap.end();++it)
 		{
 			joinOutlines(it->second);
 
 			//Find the style given the index
-			auto stylesIt=linestyles.begin();
 			assert(it->first);
-			for(unsigned int i=0;i<it->first-1;i++)
+			for(;linestylesIndex<it->first;linestylesIndex++)
 			{
-				++stylesIt;
-				assert(stylesIt!=linestyles.end());
+				++linestylesIt;
+				assert(linestylesIt!=linestyles.end());
 			}
 			//Set the line style
 			vector<ShapePathSegment>& segments = it->second;
 			tokens.stroketokens->tokens.push_back(GeomToken(SET_STROKE).uval);
-			tokens.stroketokens->tokens.push_back(GeomToken(*stylesIt).uval);
+			tokens.stroketokens->tokens.push_back(GeomToken(*linestylesIt).uval);
 			for (size_t j = 0; j < segments.size(); ++j)
 			{
 				ShapePathSegment segment = segments[j];
@@ -197,9 +197,13 @@ public:
 class ShapesBuilder
 {
 private:
+	// Path segments grouped by style index, kept sorted by style index
+	typedef std::vector< std::pair< unsigned int, std::vector<ShapePathSegment> > > StyleBuckets;
 	std::vector<ShapePathSegment> currentSubpath;
-	std::map< unsigned int, std::vector<ShapePathSegment> > filledShapesMap;
-	std::map< unsigned int, std::vector<ShapePathSegment> > strokeShapesMap;
+	StyleBuckets filledShapesMap;
+	StyleBuckets strokeShapesMap;
+
+	static std::vector<ShapePathSegment>& getStyleBucket(StyleBuckets& buckets, unsigned int style);
 
 	static bool isOutlineEmpty(const std::vector<ShapePathSegment>& outline);
 	static floatVec makeVertex(const Vector2f& v) 
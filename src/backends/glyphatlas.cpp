@@ -0,0 +1,390 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include <cmath>
+#include <cstring>
+
+#include "backends/glyphatlas.h"
+#include "logger.h"
+#include "3rdparty/nanovg/src/nanovg.h"
+
+using namespace lightspark;
+using namespace std;
+
+GlyphAtlas::GlyphAtlas():currentpage(0),inNanoVGFrame(false),resetPending(false)
+{
+	scratchSurface = cairo_image_surface_create(CAIRO_FORMAT_A8, 1, 1);
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+	// the nanoVG images are deleted together with the nanoVG context
+	for (auto it = pages.begin(); it != pages.end(); it++)
+	{
+		cairo_surface_destroy((*it).surface);
+		delete[] (*it).data;
+	}
+	cairo_surface_destroy(scratchSurface);
+}
+
+uint32_t GlyphAtlas::quantizeScale(float scale)
+{
+	// only keep the upper 12 bits of the mantissa, so that tiny differences in the scaling don't create new glyphs
+	uint32_t bits;
+	memcpy(&bits,&scale,sizeof(bits));
+	return (bits + 0x400) & 0xfffff800;
+}
+
+bool GlyphAtlas::getScales(float xx, float yx, float xy, float yy, float& xscale, float& yscale)
+{
+	// rotated or skewed glyphs are not cached
+	float maxscale = max(fabs(xx),fabs(yy));
+	if (maxscale == 0 || fabs(yx) > maxscale*0.0001 || fabs(xy) > maxscale*0.0001)
+		return false;
+	if (xx == 0 || yy == 0)
+		return false;
+	xscale = xx;
+	yscale = yy;
+	return true;
+}
+
+void GlyphAtlas::splitPosition(double pos, int32_t& pixel, uint8_t& phase)
+{
+	// pos = pixel + phase/GLYPHATLAS_SUBPIXELSTEPS, with the fraction rounded to the nearest step
+	double p = floor(pos);
+	int32_t step = round((pos-p)*GLYPHATLAS_SUBPIXELSTEPS);
+	if (step == GLYPHATLAS_SUBPIXELSTEPS)
+	{
+		p += 1;
+		step = 0;
+	}
+	pixel = p;
+	phase = step;
+}
+
+void GlyphAtlas::appendPath(cairo_t* cr, const tokenListRef* tokens)
+{
+	auto it = tokens->tokens.cbegin();
+	while (it != tokens->tokens.cend())
+	{
+		GeomToken p(*it,false);
+		switch(p.type)
+		{
+			case MOVE:
+			{
+				GeomToken p1(*(++it),false);
+				cairo_move_to(cr, p1.vec.x, p1.vec.y);
+				break;
+			}
+			case STRAIGHT:
+			{
+				GeomToken p1(*(++it),false);
+				cairo_line_to(cr, p1.vec.x, p1.vec.y);
+				break;
+			}
+			case CURVE_QUADRATIC:
+			{
+				GeomToken p1(*(++it),false);
+				GeomToken p2(*(++it),false);
+				double start_x, start_y;
+				cairo_get_current_point(cr, &start_x, &start_y);
+				cairo_curve_to(cr,
+							   p1.vec.x*(2.0/3.0) + start_x*(1.0/3.0), p1.vec.y*(2.0/3.0) + start_y*(1.0/3.0),
+							   p1.vec.x*(2.0/3.0) + p2.vec.x*(1.0/3.0), p1.vec.y*(2.0/3.0) + p2.vec.y*(1.0/3.0),
+							   p2.vec.x, p2.vec.y);
+				break;
+			}
+			case CURVE_CUBIC:
+			{
+				GeomToken p1(*(++it),false);
+				GeomToken p2(*(++it),false);
+				GeomToken p3(*(++it),false);
+				cairo_curve_to(cr, p1.vec.x, p1.vec.y, p2.vec.x, p2.vec.y, p3.vec.x, p3.vec.y);
+				break;
+			}
+			case SET_FILL:
+			case SET_STROKE:
+				++it;
+				break;
+			case FILL_TRANSFORM_TEXTURE:
+				it+=5;
+				break;
+			default:
+				break;
+		}
+		++it;
+	}
+}
+
+bool GlyphAtlas::allocate(int32_t width, int32_t height, uint32_t& page, int32_t& x, int32_t& y)
+{
+	while (true)
+	{
+		if (currentpage < pages.size())
+		{
+			// simple shelf packing, glyphs of one font and size have similar heights
+			atlasPage& p = pages[currentpage];
+			if (p.shelfx+width > GLYPHATLAS_PAGESIZE)
+			{
+				p.shelfy += p.shelfheight;
+				p.shelfx = 0;
+				p.shelfheight = 0;
+			}
+			if (p.shelfy+height <= GLYPHATLAS_PAGESIZE)
+			{
+				page = currentpage;
+				x = p.shelfx;
+				y = p.shelfy;
+				p.shelfx += width;
+				p.shelfheight = max(p.shelfheight,height);
+				return true;
+			}
+			currentpage++;
+			continue;
+		}
+		if (pages.size() >= GLYPHATLAS_MAXPAGES)
+			return false;
+		atlasPage p;
+		int32_t stride = cairo_format_stride_for_width(CAIRO_FORMAT_A8, GLYPHATLAS_PAGESIZE);
+		p.data = new uint8_t[stride*GLYPHATLAS_PAGESIZE];
+		memset(p.data,0,stride*GLYPHATLAS_PAGESIZE);
+		p.surface = cairo_image_surface_create_for_data(p.data, CAIRO_FORMAT_A8, GLYPHATLAS_PAGESIZE, GLYPHATLAS_PAGESIZE, stride);
+		p.shelfx = 0;
+		p.shelfy = 0;
+		p.shelfheight = 0;
+		p.nanoVGImage = -1;
+		p.dirtytop = 0;
+		p.dirtybottom = GLYPHATLAS_PAGESIZE;
+		pages.push_back(p);
+	}
+}
+
+void GlyphAtlas::reset()
+{
+	LOG(LOG_INFO,"glyph atlas full, clearing "<<glyphs.size()<<" glyphs");
+	glyphs.clear();
+	int32_t stride = cairo_format_stride_for_width(CAIRO_FORMAT_A8, GLYPHATLAS_PAGESIZE);
+	for (auto it = pages.begin(); it != pages.end(); it++)
+	{
+		cairo_surface_flush((*it).surface);
+		memset((*it).data,0,stride*GLYPHATLAS_PAGESIZE);
+		cairo_surface_mark_dirty((*it).surface);
+		(*it).shelfx = 0;
+		(*it).shelfy = 0;
+		(*it).shelfheight = 0;
+		(*it).dirtytop = 0;
+		(*it).dirtybottom = GLYPHATLAS_PAGESIZE;
+	}
+	currentpage = 0;
+	resetPending = false;
+}
+
+const GlyphAtlas::glyphEntry* GlyphAtlas::getGlyph_nolock(const _NR<tokenListRef>& tokens, float xscale, float yscale, uint8_t xphase, uint8_t yphase, bool antialias)
+{
+	glyphKey key;
+	key.tokens = tokens.getPtr();
+	key.xscale = quantizeScale(xscale);
+	key.yscale = quantizeScale(yscale);
+	key.xphase = xphase;
+	key.yphase = yphase;
+	key.antialias = antialias;
+	auto it = glyphs.find(key);
+	if (it != glyphs.end())
+		return &it->second;
+
+	float sx,sy;
+	memcpy(&sx,&key.xscale,sizeof(sx));
+	memcpy(&sy,&key.yscale,sizeof(sy));
+	double fx = double(xphase)/GLYPHATLAS_SUBPIXELSTEPS;
+	double fy = double(yphase)/GLYPHATLAS_SUBPIXELSTEPS;
+	glyphEntry entry;
+	entry.tokens = tokens;
+	entry.page = 0;
+	entry.x = 0;
+	entry.y = 0;
+	entry.width = 0;
+	entry.height = 0;
+	entry.originx = 0;
+	entry.originy = 0;
+
+	cairo_t* cr = cairo_create(scratchSurface);
+	cairo_scale(cr, sx, sy);
+	appendPath(cr, tokens.getPtr());
+	double x1,y1,x2,y2;
+	cairo_fill_extents(cr, &x1, &y1, &x2, &y2);
+	cairo_destroy(cr);
+	if (x2 > x1 && y2 > y1)
+	{
+		// one pixel border to avoid bleeding of neighbouring glyphs
+		int32_t left = floor(x1*sx+fx)-1;
+		int32_t top = floor(y1*sy+fy)-1;
+		int32_t right = ceil(x2*sx+fx)+1;
+		int32_t bottom = ceil(y2*sy+fy)+1;
+		if (right-left > GLYPHATLAS_MAXGLYPHSIZE || bottom-top > GLYPHATLAS_MAXGLYPHSIZE)
+			return nullptr;
+		entry.width = right-left;
+		entry.height = bottom-top;
+		entry.originx = -left;
+		entry.originy = -top;
+		if (!allocate(entry.width, entry.height, entry.page, entry.x, entry.y))
+		{
+			if (inNanoVGFrame)
+			{
+				// glyphs of the current frame are still referencing the pages, so the glyph is rendered as vector path
+				resetPending = true;
+				return nullptr;
+			}
+			reset();
+			if (!allocate(entry.width, entry.height, entry.page, entry.x, entry.y))
+				return nullptr;
+		}
+		atlasPage& p = pages[entry.page];
+		cr = cairo_create(p.surface);
+		cairo_rectangle(cr, entry.x, entry.y, entry.width, entry.height);
+		cairo_clip(cr);
+		cairo_translate(cr, entry.x+entry.originx+fx, entry.y+entry.originy+fy);
+		cairo_scale(cr, sx, sy);
+		cairo_set_antialias(cr, antialias ? CAIRO_ANTIALIAS_DEFAULT : CAIRO_ANTIALIAS_NONE);
+		cairo_set_fill_rule(cr, CAIRO_FILL_RULE_EVEN_ODD);
+		cairo_set_source_rgba(cr, 0, 0, 0, 1);
+		appendPath(cr, tokens.getPtr());
+		cairo_fill(cr);
+		cairo_destroy(cr);
+		cairo_surface_flush(p.surface);
+		p.dirtytop = min(p.dirtytop,entry.y);
+		p.dirtybottom = max(p.dirtybottom,entry.y+entry.height);
+	}
+	return &glyphs.insert(make_pair(key,entry)).first->second;
+}
+
+void GlyphAtlas::uploadPage_nolock(NVGcontext* nvgctxt, atlasPage& p)
+{
+	if (p.nanoVGImage == -1 || p.dirtybottom <= p.dirtytop)
+		return;
+	int32_t stride = cairo_format_stride_for_width(CAIRO_FORMAT_A8, GLYPHATLAS_PAGESIZE);
+	if (uploadBuffer.empty())
+		uploadBuffer.resize(GLYPHATLAS_PAGESIZE*GLYPHATLAS_PAGESIZE*4);
+	// nanoVG only supports RGBA images, so the coverage is stored as alpha of a white pixel and the color is applied as tint
+	// only the changed rows are converted and uploaded
+	for (int32_t y = p.dirtytop; y < p.dirtybottom; y++)
+	{
+		const uint8_t* src = p.data+y*stride;
+		uint8_t* dst = uploadBuffer.data()+y*GLYPHATLAS_PAGESIZE*4;
+		for (int32_t x = 0; x < GLYPHATLAS_PAGESIZE; x++)
+		{
+			dst[x*4  ] = 0xff;
+			dst[x*4+1] = 0xff;
+			dst[x*4+2] = 0xff;
+			dst[x*4+3] = src[x];
+		}
+	}
+	NVGparams* params = nvgInternalParams(nvgctxt);
+	params->renderUpdateTexture(params->userPtr, p.nanoVGImage, 0, p.dirtytop, GLYPHATLAS_PAGESIZE, p.dirtybottom-p.dirtytop, uploadBuffer.data());
+	p.dirtytop = GLYPHATLAS_PAGESIZE;
+	p.dirtybottom = 0;
+}
+
+void GlyphAtlas::beginNanoVGFrame()
+{
+	Locker l(mutex);
+	if (resetPending)
+		reset();
+	inNanoVGFrame = true;
+}
+
+void GlyphAtlas::endNanoVGFrame(NVGcontext* nvgctxt)
+{
+	Locker l(mutex);
+	// upload the glyphs added during this frame before nanoVG renders the queued quads
+	for (auto it = pages.begin(); it != pages.end(); it++)
+		uploadPage_nolock(nvgctxt, *it);
+	inNanoVGFrame = false;
+}
+
+bool GlyphAtlas::drawCairoGlyph(cairo_t* cr, const _NR<tokenListRef>& tokens, const RGBA& color, bool antialias)
+{
+	cairo_matrix_t m;
+	cairo_get_matrix(cr, &m);
+	float xscale,yscale;
+	if (!getScales(m.xx,m.yx,m.xy,m.yy,xscale,yscale) || xscale < 0 || yscale < 0)
+		return false;
+	int32_t px,py;
+	uint8_t xphase,yphase;
+	splitPosition(m.x0, px, xphase);
+	splitPosition(m.y0, py, yphase);
+	Locker l(mutex);
+	const glyphEntry* e = getGlyph_nolock(tokens, xscale, yscale, xphase, yphase, antialias);
+	if (!e)
+		return false;
+	if (e->width == 0)
+		return true;
+	atlasPage& p = pages[e->page];
+	double dx = px-e->originx;
+	double dy = py-e->originy;
+	cairo_save(cr);
+	cairo_identity_matrix(cr);
+	cairo_rectangle(cr, dx, dy, e->width, e->height);
+	cairo_clip(cr);
+	cairo_set_source_rgba(cr, color.rf(), color.gf(), color.bf(), color.af());
+	cairo_mask_surface(cr, p.surface, dx-e->x, dy-e->y);
+	cairo_restore(cr);
+	return true;
+}
+
+bool GlyphAtlas::drawNanoVGGlyph(NVGcontext* nvgctxt, const float* xform, const _NR<tokenListRef>& tokens, float r, float g, float b, float a, bool antialias)
+{
+	float xscale,yscale;
+	if (!getScales(xform[0],xform[1],xform[2],xform[3],xscale,yscale))
+		return false;
+	// on a flipped axis the texels run in the opposite direction, so the phase is taken from the mirrored position
+	int32_t px,py;
+	uint8_t xphase,yphase;
+	splitPosition(xscale < 0 ? -xform[4] : xform[4], px, xphase);
+	splitPosition(yscale < 0 ? -xform[5] : xform[5], py, yphase);
+	if (xscale < 0)
+		px = -px;
+	if (yscale < 0)
+		py = -py;
+	Locker l(mutex);
+	const glyphEntry* e = getGlyph_nolock(tokens, fabs(xscale), fabs(yscale), xphase, yphase, antialias);
+	if (!e)
+		return false;
+	if (e->width == 0)
+		return true;
+	atlasPage& p = pages[e->page];
+	if (p.nanoVGImage == -1)
+	{
+		// the content is uploaded at the end of the frame
+		p.nanoVGImage = nvgCreateImageRGBA(nvgctxt, GLYPHATLAS_PAGESIZE, GLYPHATLAS_PAGESIZE, NVG_IMAGE_NEAREST, nullptr);
+		p.dirtytop = 0;
+		p.dirtybottom = GLYPHATLAS_PAGESIZE;
+	}
+	nvgSave(nvgctxt);
+	nvgResetTransform(nvgctxt);
+	// keep the orientation of the current transformation (the framebuffer may be flipped), but map one texel to one pixel
+	nvgTransform(nvgctxt, xscale < 0 ? -1 : 1, 0, 0, yscale < 0 ? -1 : 1, px, py);
+	nvgBeginPath(nvgctxt);
+	nvgRect(nvgctxt, -e->originx, -e->originy, e->width, e->height);
+	NVGpaint pattern = nvgImagePattern(nvgctxt, -e->originx-e->x, -e->originy-e->y, GLYPHATLAS_PAGESIZE, GLYPHATLAS_PAGESIZE, 0, p.nanoVGImage, 1.0);
+	pattern.innerColor = pattern.outerColor = nvgRGBAf(r, g, b, a);
+	nvgFillPaint(nvgctxt, pattern);
+	nvgFill(nvgctxt);
+	nvgRestore(nvgctxt);
+	return true;
+}
@@ -0,0 +1,142 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef BACKENDS_GLYPHATLAS_H
+#define BACKENDS_GLYPHATLAS_H 1
+
+#include "compat.h"
+#include "threading.h"
+#include "backends/geometry.h"
+#include <cairo.h>
+#include <unordered_map>
+#include <vector>
+
+// width and height of a single atlas page in pixels
+#define GLYPHATLAS_PAGESIZE 512
+// when all pages are full, the pages are cleared and the glyphs are rasterized again on demand
+#define GLYPHATLAS_MAXPAGES 8
+// glyphs larger than this (in pixels) are always rendered as vector paths
+#define GLYPHATLAS_MAXGLYPHSIZE 128
+// glyphs are rasterized at this many horizontal and vertical subpixel positions, so that the glyph spacing stays even
+#define GLYPHATLAS_SUBPIXELSTEPS 4
+
+struct NVGcontext;
+
+namespace lightspark
+{
+
+/*
+ * Cache of rasterized glyphs of embedded fonts.
+ * Every glyph is rasterized only once for each (glyph shape, pixel scale, subpixel position, antialiasing) combination
+ * into an 8bit alpha page that is shared by all TextFields. The glyph shape is identified by the
+ * token list cached in the FontTag, so all TextFields using the same font at the same size share the glyphs.
+ * The atlas is used from the render thread (nanoVG) and from the cairo render jobs, so all access is locked.
+ */
+class GlyphAtlas
+{
+private:
+	struct glyphKey
+	{
+		const tokenListRef* tokens;
+		uint32_t xscale;// bit pattern of the quantized float scale
+		uint32_t yscale;
+		uint8_t xphase;// subpixel offset of the glyph origin in 1/GLYPHATLAS_SUBPIXELSTEPS pixels
+		uint8_t yphase;
+		bool antialias;
+		bool operator==(const glyphKey& r) const
+		{
+			return tokens==r.tokens && xscale==r.xscale && yscale==r.yscale && xphase==r.xphase && yphase==r.yphase && antialias==r.antialias;
+		}
+	};
+	struct glyphKeyHash
+	{
+		size_t operator()(const glyphKey& k) const
+		{
+			size_t h = std::hash<const void*>()(k.tokens);
+			h ^= (size_t(k.xscale)*0x9e3779b1u) + (size_t(k.yscale)<<1) + (size_t(k.xphase)<<4) + (size_t(k.yphase)<<8) + k.antialias;
+			return h;
+		}
+	};
+	struct glyphEntry
+	{
+		// keeps the tokens alive, so the key pointer can't be reused while the glyph is in the atlas
+		_NR<tokenListRef> tokens;
+		uint32_t page;
+		int32_t x;// position in page
+		int32_t y;
+		int32_t width;
+		int32_t height;
+		int32_t originx;// position of the glyph origin relative to the top left corner of the glyph bitmap
+		int32_t originy;
+	};
+	struct atlasPage
+	{
+		uint8_t* data;
+		cairo_surface_t* surface;
+		int32_t shelfx;
+		int32_t shelfy;
+		int32_t shelfheight;
+		int nanoVGImage;
+		// rows that have changed since the last upload to the nanoVG image
+		int32_t dirtytop;
+		int32_t dirtybottom;
+	};
+	Mutex mutex;
+	std::unordered_map<glyphKey,glyphEntry,glyphKeyHash> glyphs;
+	std::vector<atlasPage> pages;
+	cairo_surface_t* scratchSurface;
+	uint32_t currentpage;
+	// the glyph quads of a nanoVG frame are only drawn at the end of the frame,
+	// so the pages must not be cleared while a frame is active
+	bool inNanoVGFrame;
+	bool resetPending;
+	std::vector<uint8_t> uploadBuffer;
+	static uint32_t quantizeScale(float scale);
+	static bool getScales(float xx, float yx, float xy, float yy, float& xscale, float& yscale);
+	static void splitPosition(double pos, int32_t& pixel, uint8_t& phase);
+	bool allocate(int32_t width, int32_t height, uint32_t& page, int32_t& x, int32_t& y);
+	void reset();
+	const glyphEntry* getGlyph_nolock(const _NR<tokenListRef>& tokens, float xscale, float yscale, uint8_t xphase, uint8_t yphase, bool antialias);
+	void uploadPage_nolock(NVGcontext* nvgctxt, atlasPage& p);
+public:
+	GlyphAtlas();
+	~GlyphAtlas();
+	// adds the path described by the (glyph) tokens to the current path of cr
+	static void appendPath(cairo_t* cr, const tokenListRef* tokens);
+	/*
+	 * draws the glyph with the current matrix of cr
+	 * returns false if the glyph can't be taken from the atlas (rotated, skewed or too large), the caller has to render the vector path in that case
+	 */
+	bool drawCairoGlyph(cairo_t* cr, const _NR<tokenListRef>& tokens, const RGBA& color, bool antialias);
+	/*
+	 * must be called after nvgBeginFrame and before nvgEndFrame of every nanoVG frame that draws glyphs from the atlas,
+	 * the glyphs added during the frame are uploaded to the nanoVG images in endNanoVGFrame
+	 */
+	void beginNanoVGFrame();
+	void endNanoVGFrame(NVGcontext* nvgctxt);
+	/*
+	 * adds a textured quad for the glyph to the current nanoVG frame
+	 * xform is the nanoVG transformation of the glyph origin, the color is premultiplied by nanoVG
+	 * returns false if the glyph can't be taken from the atlas (this includes a full atlas, it is cleared at the start of the next frame)
+	 */
+	bool drawNanoVGGlyph(NVGcontext* nvgctxt, const float* xform, const _NR<tokenListRef>& tokens, float r, float g, float b, float a, bool antialias);
+};
+
+}
+#endif /* BACKENDS_GLYPHATLAS_H */
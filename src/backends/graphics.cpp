@@ -27,6 +27,7 @@
 #include "backends/cachedsurface.h"
 #include "backends/rendering.h"
 #include "backends/config.h"
+#include "backends/glyphatlas.h"
 #include "compat.h"
 #include "scripting/flash/geom/flashgeom.h"
 #include "scripting/flash/text/flashtext.h"
@@ -655,6 +656,29 @@ void CairoTokenRenderer::executeDraw(cairo_t* cr)
 		cairoPathFromTokens(cr, filltokens, state->scaling, false,getState()->isMask,xstart,ystart,this);
 	if (stroketokens)
 		cairoPathFromTokens(cr, stroketokens, state->scaling, false,getState()->isMask,xstart,ystart,this);
+	bool antialias = getState()->smoothing != SMOOTH_NONE;
+	bool isMask = getState()->isMask;
+	for (auto it = glyphs.begin(); it != glyphs.end(); it++)
+	{
+		cairo_save(cr);
+		cairo_identity_matrix(cr);
+		cairo_scale(cr, getState()->xscale, getState()->yscale);
+		cairo_scale(cr, state->scaling, state->scaling);
+		cairo_translate(cr, -xstart/state->scaling, -ystart/state->scaling);
+		cairo_matrix_t m;
+		cairo_matrix_init(&m, (*it).startMatrix.xx, (*it).startMatrix.yx, (*it).startMatrix.xy, (*it).startMatrix.yy, (*it).startMatrix.x0, (*it).startMatrix.y0);
+		cairo_transform(cr, &m);
+		cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+		if (isMask || !glyphAtlas || !glyphAtlas->drawCairoGlyph(cr, (*it).tokens, (*it).color, antialias))
+		{
+			// mask, rotated, skewed or very large glyph, render the vector path
+			cairo_set_fill_rule(cr, CAIRO_FILL_RULE_EVEN_ODD);
+			cairo_set_source_rgba(cr, (*it).color.rf(), (*it).color.gf(), (*it).color.bf(), isMask ? 1.0 : (*it).color.af());
+			GlyphAtlas::appendPath(cr, (*it).tokens.getPtr());
+			cairo_fill(cr);
+		}
+		cairo_restore(cr);
+	}
 }
 
 uint8_t* CairoRenderer::getPixelBuffer(bool *isBufferOwner, uint32_t* bufsize)
@@ -737,10 +761,25 @@ CairoTokenRenderer::CairoTokenRenderer(_NR<tokenListRef> _filltokens,_NR<tokenLi
 									   , number_t _xstart, number_t _ystart)
 	: CairoRenderer(_m,_x,_y,_w,_h,_xs,_ys,_ismask,_cacheAsBitmap,_scaling,_a
 					, _colortransform
-					,_smoothing,_blendmode),filltokens(_filltokens),stroketokens(_stroketokens),xstart(_xstart),ystart(_ystart)
+					,_smoothing,_blendmode),filltokens(_filltokens),stroketokens(_stroketokens),glyphAtlas(nullptr),xstart(_xstart),ystart(_ystart)
 {
 }
 
+void CairoTokenRenderer::addGlyphs(const tokensVector& tokens, GlyphAtlas* atlas)
+{
+	glyphAtlas = atlas;
+	for (const tokensVector* tk = &tokens; tk; tk = tk->next)
+	{
+		if (!tk->isGlyph || !tk->filltokens || tk->filltokens->tokens.empty())
+			continue;
+		glyphInstance g;
+		g.tokens = tk->filltokens;
+		g.startMatrix = tk->startMatrix;
+		g.color = tk->color;
+		glyphs.push_back(g);
+	}
+}
+
 void CairoRenderer::convertBitmapWithAlphaToCairo(std::vector<uint8_t, reporter_allocator<uint8_t>>& data, uint8_t* inData, uint32_t width,
 												  uint32_t height, size_t* dataSize, size_t* stride, bool frompng)
 {
@@ -1209,6 +1248,11 @@ void TextData::appendText(const char *text,bool firstlineonly,const FormatText*
 	else
 		CairoPangoRenderer::getBounds(*this,"", w, h);
 	
+	pushLines(t,firstlineonly,format);
+}
+
+void TextData::pushLines(tiny_string& t, bool firstlineonly, const FormatText* format)
+{
 	uint32_t index=0;
 	do
 	{
@@ -1217,6 +1261,7 @@ void TextData::appendText(const char *text,bool firstlineonly,const FormatText*
 			line.format = *format;
 		line.autosizeposition=0;
 		line.textwidth=UINT32_MAX;
+		line.height=0;
 		bool haslineterminator = t.getLine(index,line.text);
 		textlines.push_back(line);
 		if (haslineterminator && index==tiny_string::npos)
@@ -1227,12 +1272,56 @@ void TextData::appendText(const char *text,bool firstlineonly,const FormatText*
 				line.format = *format;
 			line.autosizeposition=0;
 			line.textwidth=UINT32_MAX;
+			line.height=0;
 			textlines.push_back(line);
 		}
 	}
 	while (index != tiny_string::npos && !firstlineonly);
 }
 
+void TextData::appendToText(const tiny_string& text)
+{
+	if (text.empty())
+		return;
+	if (textlines.empty())
+	{
+		tiny_string t = text;
+		pushLines(t,false,nullptr);
+		return;
+	}
+	// the appended text continues the last line (even if it is empty) and keeps its format
+	FormatText format = textlines.back().format;
+	tiny_string t = textlines.back().text + text;
+	textlines.pop_back();
+	pushLines(t,false,&format);
+}
+
+bool TextData::editLine(uint32_t charpos, uint32_t removecount, const tiny_string& insert)
+{
+	for (CharIterator it = insert.begin(); it != insert.end(); it++)
+	{
+		if (*it == '\n' || *it == '\r')
+			return false;
+	}
+	uint32_t textlen=0;
+	for (auto it = textlines.begin(); it != textlines.end(); it++)
+	{
+		// same line start as in getText(), where no \n is added before the first non-empty text
+		uint32_t linestart = textlen ? textlen+1 : 0;
+		uint32_t len = (*it).text.numChars();
+		if (charpos <= linestart+len)
+		{
+			if (charpos-linestart+removecount > len)
+				return false; // edit removes a line break
+			(*it).text.replace(charpos-linestart,removecount,insert);
+			(*it).textwidth=UINT32_MAX;
+			return true;
+		}
+		textlen = linestart+len;
+	}
+	return false;
+}
+
 void TextData::appendFormatText(const char *text, const FormatText& format, bool firstlineonly)
 {
 	appendText(text, firstlineonly, &format);
@@ -43,6 +43,7 @@ namespace lightspark
 class RenderThread;
 class SurfaceState;
 class DisplayObject;
+class GlyphAtlas;
 	
 struct RectF
 {
@@ -356,6 +357,17 @@ private:
 	*/
 	_NR<tokenListRef> filltokens;
 	_NR<tokenListRef> stroketokens;
+	/*
+	   The glyphs of embedded fonts to be drawn on top of the tokens
+	*/
+	struct glyphInstance
+	{
+		_NR<tokenListRef> tokens;
+		MATRIX startMatrix;
+		RGBA color;
+	};
+	std::vector<glyphInstance> glyphs;
+	GlyphAtlas* glyphAtlas;
 	/*
 	 * This is run by CairoRenderer::execute()
 	 */
@@ -391,6 +403,11 @@ CairoTokenRenderer(_NR<tokenListRef> _filltokens,_NR<tokenListRef> _stroketokens
 	   @param y The Y in local coordinates
 	*/
 	static bool hitTest(NullableRef<tokenListRef> tokens, float scaleFactor, const Vector2f& point);
+	/*
+	   Adds all glyphs of the tokensVector chain. The glyphs are composited from the glyph atlas,
+	   glyphs that can't be taken from the atlas are rendered as vector paths
+	*/
+	void addGlyphs(const tokensVector& tokens, GlyphAtlas* atlas);
 };
 
 struct FormatText
@@ -423,6 +440,7 @@ class DLL_PUBLIC TextData
 friend class CairoPangoRenderer;
 protected:
 	std::vector<textline> textlines;
+	void pushLines(tiny_string& t, bool firstlineonly, const FormatText* format);
 public:
 	/* the default values are from the spec for flash.text.TextField and flash.text.TextFormat */
 	TextData() : width(100), height(100),leading(0), textWidth(0), textHeight(0), font("Times New Roman"),fontID(UINT32_MAX), scrollH(0), scrollV(1), backgroundColor(0xFFFFFF),borderColor(0x000000),
@@ -459,6 +477,10 @@ public:
 	void setText(const char* text, bool firstlineonly=false);
 	void appendText(const char* text, bool firstlineonly=false, const FormatText* format = nullptr);
 	void appendFormatText(const char* text, const FormatText& format, bool firstlineonly=false);
+	// appends text as if it was concatenated to getText(), lines that have to be measured again have textwidth set to UINT32_MAX
+	void appendToText(const tiny_string& text);
+	// replaces removecount characters at charpos by insert, returns false if the edit is not limited to a single line
+	bool editLine(uint32_t charpos, uint32_t removecount, const tiny_string& insert);
 	void getTextSizes(const tiny_string& text, number_t& tw, number_t& th);
 	bool TextIsEqual(const std::vector<tiny_string>& lines) const;
 	uint32_t getLineCount() const { return textlines.size(); }
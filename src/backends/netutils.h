@@ -140,6 +140,8 @@ public:
 
 	//Wait until the downloader completes
 	void waitForTermination() { return cache->waitForTermination(); }
+	//Wait until more than offset bytes have been downloaded or the download has ended
+	void waitForData(size_t offset) { cache->waitForData(offset); }
 
 	_R<StreamCache> getCache() { return cache; }
 	//Gets the total length of the downloaded file (may change)
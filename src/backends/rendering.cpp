@@ -1250,6 +1250,11 @@ void RenderThread::coreRendering()
 		engineData->exec_glDeleteTextures(1,&id);
 		texturesToDelete.pop_front();
 	}
+	while (!programsToDelete.empty())
+	{
+		engineData->exec_glDeleteProgram(programsToDelete.front());
+		programsToDelete.pop_front();
+	}
 	handleGLErrors();
 }
 
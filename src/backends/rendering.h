@@ -102,6 +102,7 @@ private:
 	std::list<RenderDisplayObjectToBitmapContainer> displayobjectsToRender;
 
 	std::list<uint32_t> texturesToDelete;
+	std::list<uint32_t> programsToDelete;
 
 	struct DebugRect
 	{
@@ -213,6 +214,11 @@ public:
 		Locker l(mutexRendering);
 		texturesToDelete.push_back(textureID);
 	}
+	void addDeletedProgram(uint32_t programID)
+	{
+		Locker l(mutexRendering);
+		programsToDelete.push_back(programID);
+	}
 };
 
 RenderThread* getRenderThread();
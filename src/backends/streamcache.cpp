@@ -48,10 +48,10 @@ size_t StreamCache::markFinished(bool _failed)
 	return receivedLength;
 }
 
-void StreamCache::waitForData(size_t currentOffset)
+void StreamCache::waitForData(size_t currentOffset, const std::atomic<bool>* interrupted)
 {
 	stateMutex.lock();
-	while (receivedLength <= currentOffset && !terminated)
+	while (receivedLength <= currentOffset && !terminated && !(interrupted && *interrupted))
 	{
 		stateMutex.unlock();
 		sys->waitMainSignal();
@@ -60,6 +60,12 @@ void StreamCache::waitForData(size_t currentOffset)
 	stateMutex.unlock();
 }
 
+void StreamCache::wakeReaders()
+{
+	Locker locker(stateMutex);
+	sys->sendMainSignal();
+}
+
 void StreamCache::waitForTermination()
 {
 	stateMutex.lock();
@@ -192,11 +198,17 @@ void MemoryStreamCache::openForWriting()
 }
 
 MemoryStreamCache::Reader::Reader(_R<MemoryStreamCache> b) :
-	buffer(b), chunkIndex(0), chunkStartOffset(0)
+	buffer(b), interrupted(false), chunkIndex(0), chunkStartOffset(0)
 {
 	setg(nullptr, nullptr, nullptr);
 }
 
+void MemoryStreamCache::Reader::interrupt()
+{
+	interrupted = true;
+	buffer->wakeReaders();
+}
+
 /**
  * \brief Called by the streambuf API
  *
@@ -204,6 +216,8 @@ MemoryStreamCache::Reader::Reader(_R<MemoryStreamCache> b) :
  */
 int MemoryStreamCache::Reader::underflow()
 {
+	if (interrupted)
+		return EOF;
 	Locker locker(buffer->chunkListMutex);
 
 	// Wait until there is some data to be read or until terminated
@@ -213,8 +227,10 @@ int MemoryStreamCache::Reader::underflow()
 	if (!buffer->hasTerminated() && !hasMoreChunks && !lastChunkHasBytes)
 	{
 		locker.release();
-		buffer->waitForData(getOffset());
+		buffer->waitForData(getOffset(),&interrupted);
 		locker.acquire();
+		if (interrupted)
+			return EOF;
 	}
 
 	if (chunkIndex >= buffer->chunks.size())
@@ -492,14 +508,22 @@ std::streambuf *FileStreamCache::createReader()
 	return fbuf;
 }
 
-FileStreamCache::Reader::Reader(_R<FileStreamCache> b) : buffer(b)
+FileStreamCache::Reader::Reader(_R<FileStreamCache> b) : buffer(b), interrupted(false)
 {
 }
 
+void FileStreamCache::Reader::interrupt()
+{
+	interrupted = true;
+	buffer->wakeReaders();
+}
+
 int FileStreamCache::Reader::underflow()
 {
 	if (!buffer->hasTerminated())
-		buffer->waitForData(seekoff(0, ios_base::cur, ios_base::in));
+		buffer->waitForData(seekoff(0, ios_base::cur, ios_base::in),&interrupted);
+	if (interrupted)
+		return EOF;
 
 	return filebuf::underflow();
 }
@@ -511,7 +535,9 @@ streamsize FileStreamCache::Reader::xsgetn(char* s, streamsize n)
 	// If not enough data was available, wait for writer
 	while (read < n)
 	{
-		buffer->waitForData(seekoff(0, ios_base::cur, ios_base::in));
+		buffer->waitForData(seekoff(0, ios_base::cur, ios_base::in),&interrupted);
+		if (interrupted)
+			return read;
 
 		streamsize b = filebuf::xsgetn(s+read, n-read);
 
@@ -24,6 +24,7 @@
 #include <istream>
 #include <fstream>
 #include <cstdint>
+#include <atomic>
 #include "threading.h"
 #include "tiny_string.h"
 #include "smartrefs.h"
@@ -59,10 +60,6 @@ protected:
 	bool notifyLoader:1;
 	SystemState* sys;
 
-	// Wait until more than currentOffset bytes has been received
-	// or until terminated
-	void waitForData(size_t currentOffset);
-
 	// Derived class implements this to store received data
 	virtual void handleAppend(const unsigned char* buffer, size_t length)=0;
 
@@ -81,6 +78,12 @@ public:
 	// Wait until the writer calls markTerminated
 	void waitForTermination();
 
+	// Wait until more than currentOffset bytes has been received,
+	// until terminated or until the reader is interrupted
+	void waitForData(size_t currentOffset, const std::atomic<bool>* interrupted=nullptr);
+	// Wake up all readers waiting for data
+	void wakeReaders();
+
 	// Set the expected length of the stream.
 	// The default implementation does nothing, but the derived
 	// classes can allocate memory here.
@@ -102,6 +105,18 @@ public:
 	virtual void openForWriting() = 0;
 };
 
+/*
+ * Implemented by the streambufs returned by StreamCache::createReader().
+ * After interrupt() the reader doesn't wait for more data, blocked and
+ * future reads return end of file. Can be called from any thread.
+ */
+class DLL_PUBLIC InterruptibleReader
+{
+public:
+	virtual ~InterruptibleReader() {}
+	virtual void interrupt()=0;
+};
+
 class MemoryChunk;
 
 /*
@@ -109,9 +124,10 @@ class MemoryChunk;
  */
 class DLL_PUBLIC MemoryStreamCache : public StreamCache {
 private:
-	class DLL_LOCAL Reader : public std::streambuf {
+	class DLL_LOCAL Reader : public std::streambuf, public InterruptibleReader {
 	private:
 		_R<MemoryStreamCache> buffer;
+		std::atomic<bool> interrupted;
 		// The chunk that is currently being read
 		unsigned int chunkIndex;
 		// Offset at the start of current chunk
@@ -127,6 +143,7 @@ private:
 		std::streampos getOffset() const;
 	public:
 		Reader(_R<MemoryStreamCache> b);
+		void interrupt() override;
 	};
 
 	// Stream is stored into a sequence of memory chunks. The
@@ -168,13 +185,15 @@ private:
 	 * Extends filebuf to wait for writer thread to supply more
 	 * data when the end of temporary file is reached.
 	 */
-	class DLL_LOCAL Reader : public std::filebuf {
+	class DLL_LOCAL Reader : public std::filebuf, public InterruptibleReader {
 	private:
 		_R<FileStreamCache> buffer;
+		std::atomic<bool> interrupted;
 		int underflow() override;
 		std::streamsize xsgetn(char* s, std::streamsize n) override;
 	public:
 		Reader(_R<FileStreamCache> buffer);
+		void interrupt() override;
 	};
 
 	//Cache filename
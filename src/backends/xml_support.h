@@ -22,6 +22,7 @@
 
 #include "tiny_string.h"
 #include <3rdparty/pugixml/src/pugixml.hpp>
+#include <memory>
 namespace lightspark
 {
 
@@ -33,7 +34,8 @@ class XMLBase
 {
 protected:
 	//The parser will destroy the document and all the childs on destruction
-	pugi::xml_document xmldoc;
+	//The document is shared with all XML nodes that may still create objects from it
+	std::shared_ptr<pugi::xml_document> xmldoc;
 	// if parseresult is not null, this method will not throw an exception on invalid xml
 	const pugi::xml_node buildFromString(const tiny_string& str,
 										unsigned int xmlparsemode,
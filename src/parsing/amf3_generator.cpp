@@ -91,43 +91,48 @@ asAtom Amf3Deserializer::parseInteger() const
 	return asAtomHandler::fromInt((int32_t)tmp);
 }
 
-asAtom Amf3Deserializer::parseDouble() const
+number_t Amf3Deserializer::readDouble() const
 {
 	union
 	{
 		uint64_t dummy;
 		double val;
 	} tmp;
-	uint8_t* tmpPtr=reinterpret_cast<uint8_t*>(&tmp.dummy);
-
-	for(uint32_t i=0;i<8;i++)
+	uint32_t pos = input->getPosition();
+	if (pos+8 > input->getLength())
 	{
-		if(!input->readByte(tmpPtr[i]))
-			throw ParseException("Not enough data to parse double");
+		input->setPosition(input->getLength());
+		throw ParseException("Not enough data to parse double");
 	}
+	input->readBytes(pos,8,reinterpret_cast<uint8_t*>(&tmp.dummy));
+	input->setPosition(pos+8);
 	tmp.dummy=GINT64_FROM_BE(tmp.dummy);
-	
-	return asAtomHandler::fromNumber(input->getInstanceWorker(),tmp.val,false);
+	return tmp.val;
+}
+
+asAtom Amf3Deserializer::parseDouble() const
+{
+	return asAtomHandler::fromNumber(input->getInstanceWorker(),readDouble(),false);
 }
 
 asAtom Amf3Deserializer::parseDate() const
 {
-	union
-	{
-		uint64_t dummy;
-		double val;
-	} tmp;
-	uint8_t* tmpPtr=reinterpret_cast<uint8_t*>(&tmp.dummy);
+	number_t ms = readDouble();
+	Date* dt = Class<Date>::getInstanceS(input->getInstanceWorker());
+	dt->MakeDateFromMilliseconds((int64_t)ms);
+	return asAtomHandler::fromObject(dt);
+}
 
-	for(uint32_t i=0;i<8;i++)
+void Amf3Deserializer::readRawString(uint32_t length, std::string& ret) const
+{
+	uint32_t pos = input->getPosition();
+	if (length > input->getLength()-min(pos,input->getLength()))
 	{
-		if(!input->readByte(tmpPtr[i]))
-			throw ParseException("Not enough data to parse date");
+		input->setPosition(input->getLength());
+		throw ParseException("Not enough data to parse string");
 	}
-	tmp.dummy=GINT64_FROM_BE(tmp.dummy);
-	Date* dt = Class<Date>::getInstanceS(input->getInstanceWorker());
-	dt->MakeDateFromMilliseconds((int64_t)tmp.val);
-	return asAtomHandler::fromObject(dt);
+	ret.assign(reinterpret_cast<const char*>(input->getBufferNoCheck()+pos),length);
+	input->setPosition(pos+length);
 }
 
 tiny_string Amf3Deserializer::parseStringVR(std::vector<tiny_string>& stringMap) const
@@ -146,13 +151,7 @@ tiny_string Amf3Deserializer::parseStringVR(std::vector<tiny_string>& stringMap)
 
 	uint32_t strLen=strRef>>1;
 	string retStr;
-	for(uint32_t i=0;i<strLen;i++)
-	{
-		uint8_t c;
-		if(!input->readByte(c))
-			throw ParseException("Not enough data to parse string");
-		retStr.push_back(c);
-	}
+	readRawString(strLen,retStr);
 	//Add string to the map, if it's not the empty one
 	if(retStr.size())
 		stringMap.emplace_back(retStr);
@@ -267,6 +266,8 @@ asAtom Amf3Deserializer::parseVector(uint8_t marker, std::vector<tiny_string>& s
 
 	
 	int32_t count = vectorRef >> 1;
+	// each element takes at least 4 bytes, so don't trust count beyond the remaining input
+	ret->reserve(std::min(uint32_t(count),(input->getLength()-input->getPosition())/4));
 
 	for(int32_t i=0;i<count;i++)
 	{
@@ -277,8 +278,7 @@ asAtom Amf3Deserializer::parseVector(uint8_t marker, std::vector<tiny_string>& s
 				uint32_t value = 0;
 				if (!input->readUnsignedInt(value))
 					throw ParseException("Not enough data to parse AMF3 vector");
-				asAtom v=asAtomHandler::fromInt((int32_t)value);
-				ret->append(v);
+				ret->appendInt((int32_t)value);
 				break;
 			}
 			case vector_uint_marker:
@@ -286,14 +286,12 @@ asAtom Amf3Deserializer::parseVector(uint8_t marker, std::vector<tiny_string>& s
 				uint32_t value = 0;
 				if (!input->readUnsignedInt(value))
 					throw ParseException("Not enough data to parse AMF3 vector");
-				asAtom v=asAtomHandler::fromUInt(value);
-				ret->append(v);
+				ret->appendUInt(value);
 				break;
 			}
 			case vector_double_marker:
 			{
-				asAtom v = parseDouble();
-				ret->append(v);
+				ret->appendNumber(readDouble());
 				break;
 			}
 			case vector_object_marker:
@@ -331,9 +329,8 @@ asAtom Amf3Deserializer::parseDictionary(std::vector<tiny_string>& stringMap,
 	uint8_t weakkeys;
 	if (!input->readByte(weakkeys))
 		throw ParseException("Not enough data to parse AMF3 vector");
-	if (weakkeys)
-		LOG(LOG_NOT_IMPLEMENTED,"handling of weak keys in Dictionary");
 	Dictionary* ret=Class<Dictionary>::getInstanceS(input->getInstanceWorker());
+	ret->setWeakKeys(weakkeys);
 	//Add object to the map
 	objMap.push_back(asAtomHandler::fromObject(ret));
 
@@ -397,15 +394,15 @@ asAtom Amf3Deserializer::parseByteArray(std::vector<asAtom>& objMap) const
 	//Add object to the map
 	objMap.push_back(asAtomHandler::fromObject(ret));
 
-	int32_t count = bytearrayRef >> 1;
-
-	for(int32_t i=0;i<count;i++)
+	uint32_t count = bytearrayRef >> 1;
+	uint32_t pos = input->getPosition();
+	if (count > input->getLength()-min(pos,input->getLength()))
 	{
-		uint8_t b;
-		if (!input->readByte(b))
-			throw ParseException("Not enough data to parse AMF3 bytearray");
-		ret->writeByte(b);
+		input->setPosition(input->getLength());
+		throw ParseException("Not enough data to parse AMF3 bytearray");
 	}
+	ret->writeBytes(input->getBufferNoCheck()+pos,count);
+	input->setPosition(pos+count);
 	return asAtomHandler::fromObject(ret);
 }
 
@@ -457,52 +454,57 @@ asAtom Amf3Deserializer::parseObject(std::vector<tiny_string>& stringMap,
 		return ret;
 	}
 
-	TraitsRef traits(nullptr);
+	// traits are referenced by index, as traitsMap may grow while the values are parsed
+	uint32_t traitsIndex;
 	if((objRef&0x02)==0)
 	{
-		uint32_t traitsRef=objRef>>2;
-		if(traitsMap.size() <= traitsRef)
+		traitsIndex=objRef>>2;
+		if(traitsMap.size() <= traitsIndex)
 			throw ParseException("Invalid traits reference in AMF3 data");
-		traits=traitsMap[traitsRef];
 	}
 	else
 	{
+		TraitsRef traits(nullptr);
 		traits.dynamic = objRef&0x08;
 		uint32_t traitsCount=objRef>>4;
 		const tiny_string& className=parseStringVR(stringMap);
 		//Add the type to the traitsMap
 		for(uint32_t i=0;i<traitsCount;i++)
-			traits.traitsNames.emplace_back(parseStringVR(stringMap));
+			traits.traitsNameIds.push_back(input->getSystemState()->getUniqueStringId(parseStringVR(stringMap)));
 
 		ApplicationDomain* appdomain = input->getInstanceWorker()->rootClip->applicationDomain.getPtr();
 		const auto it=appdomain->aliasMap.find(className);
 		if(it!=appdomain->aliasMap.end())
 			traits.type=it->second.getPtr();
-		traitsMap.emplace_back(traits);
+		traitsIndex=traitsMap.size();
+		traitsMap.emplace_back(std::move(traits));
 	}
+	Class_base* type = traitsMap[traitsIndex].type;
+	bool dynamic = traitsMap[traitsIndex].dynamic;
+	uint32_t traitsCount = traitsMap[traitsIndex].traitsNameIds.size();
 
 	asAtom ret=asAtomHandler::invalidAtom;
-	if (traits.type)
-		traits.type->getInstance(input->getInstanceWorker(),ret,true, nullptr, 0);
+	if (type)
+		type->getInstance(input->getInstanceWorker(),ret,true, nullptr, 0);
 	else
 		ret =asAtomHandler::fromObject(new_asobject(input->getInstanceWorker()));
 	//Add object to the map
 	objMap.push_back(ret);
 
-	for(uint32_t i=0;i<traits.traitsNames.size();i++)
+	multiname name(nullptr);
+	name.name_type=multiname::NAME_STRING;
+	name.ns.push_back(nsNameAndKind(input->getSystemState(),"",NAMESPACE));
+	name.isAttribute=false;
+	for(uint32_t i=0;i<traitsCount;i++)
 	{
 		asAtom value=parseValue(stringMap, objMap, traitsMap);
 
-		multiname name(nullptr);
-		name.name_type=multiname::NAME_STRING;
-		name.name_s_id=input->getSystemState()->getUniqueStringId(traits.traitsNames[i]);
-		name.ns.push_back(nsNameAndKind(input->getSystemState(),"",NAMESPACE));
-		name.isAttribute=false;
-		asAtomHandler::getObject(ret)->setVariableByMultiname_intern(name,value,ASObject::CONST_ALLOWED,traits.type,nullptr,input->getInstanceWorker());
+		name.name_s_id=traitsMap[traitsIndex].traitsNameIds[i];
+		asAtomHandler::getObject(ret)->setVariableByMultiname_intern(name,value,ASObject::CONST_ALLOWED,type,nullptr,input->getInstanceWorker());
 	}
 
 	//Read dynamic name, value pairs
-	while(traits.dynamic)
+	while(dynamic)
 	{
 		const tiny_string& varName=parseStringVR(stringMap);
 		if(varName=="")
@@ -531,13 +533,7 @@ asAtom Amf3Deserializer::parseXML(std::vector<asAtom>& objMap, bool legacyXML) c
 
 	uint32_t strLen=xmlRef>>1;
 	string xmlStr;
-	for(uint32_t i=0;i<strLen;i++)
-	{
-		uint8_t c;
-		if(!input->readByte(c))
-			throw ParseException("Not enough data to parse string");
-		xmlStr.push_back(c);
-	}
+	readRawString(strLen,xmlStr);
 
 	ASObject *xmlObj;
 	if(legacyXML)
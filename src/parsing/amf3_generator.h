@@ -82,7 +82,8 @@ class TraitsRef
 {
 public:
 	Class_base* type;
-	std::vector<tiny_string> traitsNames;
+	// string ids of the sealed trait names, resolved once when the traits are first read
+	std::vector<uint32_t> traitsNameIds;
 	bool dynamic;
 	TraitsRef(Class_base* t):type(t),dynamic(false){}
 };
@@ -92,6 +93,8 @@ class Amf3Deserializer
 private:
 	ByteArray* input;
 	tiny_string parseStringVR(std::vector<tiny_string>& stringMap) const;
+	// reads length bytes from the input into a string without going through readByte for every byte
+	void readRawString(uint32_t length, std::string& ret) const;
 	
 	asAtom parseObject(std::vector<tiny_string>& stringMap,
 			std::vector<asAtom>& objMap,
@@ -110,6 +113,7 @@ private:
 			std::vector<asAtom>& objMap,
 			std::vector<TraitsRef>& traitsMap) const;
 	asAtom parseInteger() const;
+	number_t readDouble() const;
 	asAtom parseDouble() const;
 	asAtom parseDate() const;
 	asAtom parseXML(std::vector<asAtom>& objMap, bool legacyXML) const;
@@ -57,6 +57,7 @@ public:
 	VideoTag(std::istream& s);
 	uint32_t getDataSize() const { return dataSize; }
 	uint32_t getTotalLen() const { return totalLen; }
+	uint32_t getTimestamp() const { return timestamp; }
 };
 
 class ScriptDataTag: public VideoTag
@@ -85,6 +86,7 @@ public:
 	}
 	~VideoDataTag();
 	bool isHeader() const { return _isHeader; }
+	bool isKeyframe() const { return frameType==1; }
 };
 
 class AudioDataTag: public VideoTag
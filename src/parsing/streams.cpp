@@ -23,6 +23,9 @@
 #include "compat.h"
 #include "class.h"
 #include "toplevel/Error.h"
+#include "swf.h"
+#include "timer.h"
+#include "backends/streamcache.h"
 #include <cstdlib>
 #include <cstring>
 #include <assert.h>
@@ -50,7 +53,9 @@ int uncompressing_filter::underflow()
 
 	int available=fillBuffer();
 	setg(buffer,buffer,buffer+available);
-	
+	if(available==0)
+		return -1;
+
 	//Cast to unsigned, otherwise 0xff would become eof
 	return (unsigned char)buffer[0];
 }
@@ -209,6 +214,115 @@ int liblzma_filter::fillBuffer()
 	return sizeof(buffer) - strm.avail_out;
 }
 
+pipelined_filter::pipelined_filter(uncompressing_filter* d, lightspark::SystemState* sys):uncompressing_filter(d),
+	decoder(d),thread(nullptr),profile(nullptr),decoderDone(false),stopping(false),
+	readerWaitTime(0),decoderWaitTime(0),totalBytes(0)
+{
+	setg(buffer,buffer,buffer);
+	if(sys)
+	{
+		profile=sys->allocateProfiler(lightspark::RGB(0,200,200));
+		profile->setTag("Inflate");
+	}
+	thread=SDL_CreateThread(worker,"Inflate",this);
+	if(thread==nullptr)
+		throw lightspark::RunTimeException("Failed to create decompression thread");
+}
+
+pipelined_filter::~pipelined_filter()
+{
+	mutex.lock();
+	stopping=true;
+	bool running=!decoderDone;
+	chunkConsumed.signal();
+	mutex.unlock();
+	//The decompression thread may be blocked reading from a download that
+	//has not finished yet, interrupt the read so that the thread terminates
+	lightspark::InterruptibleReader* reader=dynamic_cast<lightspark::InterruptibleReader*>(decoder->getBackend());
+	if(running && reader)
+		reader->interrupt();
+	SDL_WaitThread(thread,nullptr);
+	LOG(LOG_INFO,"pipelined decompression: "<<totalBytes<<" bytes, parser waited "<<readerWaitTime<<"ms, decoder waited "<<decoderWaitTime<<"ms");
+	delete decoder;
+}
+
+int pipelined_filter::worker(void* d)
+{
+	static_cast<pipelined_filter*>(d)->decompress();
+	return 0;
+}
+
+void pipelined_filter::decompress()
+{
+	while(true)
+	{
+		std::vector<char> chunk(CHUNK_LENGTH);
+		std::streamsize len=0;
+		lightspark::Chronometer chronometer;
+		try
+		{
+			len=decoder->sgetn(chunk.data(),CHUNK_LENGTH);
+		}
+		catch(lightspark::LightsparkException& e)
+		{
+			lightspark::Locker l(mutex);
+			error=e.cause;
+			decoderDone=true;
+			chunkAvailable.signal();
+			return;
+		}
+		if(profile)
+			profile->accountTime(chronometer.checkpoint());
+		chunk.resize(len);
+
+		uint64_t start=compat_msectiming();
+		lightspark::Locker l(mutex);
+		while(chunks.size()>=MAX_CHUNKS && !stopping)
+			chunkConsumed.wait(mutex);
+		decoderWaitTime+=compat_msectiming()-start;
+		if(stopping)
+			return;
+		totalBytes+=len;
+		if(len)
+			chunks.push_back(std::move(chunk));
+		if(len<CHUNK_LENGTH)
+			decoderDone=true;
+		chunkAvailable.signal();
+		if(decoderDone)
+			return;
+	}
+}
+
+int pipelined_filter::underflow()
+{
+	assert(gptr()==egptr());
+	if(eof)
+		return -1;
+
+	consumed+=(gptr()-eback());
+
+	uint64_t start=compat_msectiming();
+	lightspark::Locker l(mutex);
+	while(chunks.empty() && !decoderDone)
+		chunkAvailable.wait(mutex);
+	readerWaitTime+=compat_msectiming()-start;
+	if(chunks.empty())
+	{
+		eof=true;
+		setg(buffer,buffer,buffer);
+		if(!error.empty())
+			throw lightspark::ParseException(error);
+		return -1;
+	}
+	current=std::move(chunks.front());
+	chunks.pop_front();
+	chunkConsumed.signal();
+	setg(current.data(),current.data(),current.data()+current.size());
+
+	//Cast to unsigned, otherwise 0xff would become eof
+	return (unsigned char)current[0];
+}
+
 void memorystream::handleError(const char* msg)
 {
 	lightspark::createError<lightspark::VerifyError>(lightspark::getWorker(),0,msg);
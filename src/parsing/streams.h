@@ -23,7 +23,9 @@
 #include "compat.h"
 #include "abctypes.h"
 #include "swftypes.h"
+#include "threading.h"
 #include <streambuf>
+#include <deque>
 #include <fstream>
 #include <cinttypes>
 #include <zlib.h>
@@ -51,6 +53,8 @@ protected:
 	virtual int fillBuffer()=0;
 public:
 	uncompressing_filter(std::streambuf* b);
+	// The stream the compressed data is read from
+	std::streambuf* getBackend() const { return backend; }
 };
 
 
@@ -80,6 +84,52 @@ public:
 	~liblzma_filter();
 };
 
+namespace lightspark
+{
+class SystemState;
+class ThreadProfile;
+}
+
+// Runs another uncompressing_filter on a dedicated thread and hands
+// the uncompressed data to the reader in large chunks through a
+// bounded queue, so that parsing of the first tags overlaps with the
+// decompression (and download) of the rest of the file.
+class pipelined_filter: public uncompressing_filter
+{
+private:
+	static const unsigned int CHUNK_LENGTH = 65536;
+	// Maximum number of decompressed chunks waiting for the reader
+	static const unsigned int MAX_CHUNKS = 16;
+
+	// The decoder that is driven by the decompression thread, owned
+	uncompressing_filter* decoder;
+	SDL_Thread* thread;
+	lightspark::ThreadProfile* profile;
+	lightspark::Mutex mutex;
+	lightspark::Cond chunkAvailable;
+	lightspark::Cond chunkConsumed;
+	// Chunks produced by the decompression thread, protected by mutex
+	std::deque<std::vector<char>> chunks;
+	// The chunk currently exposed as the get area
+	std::vector<char> current;
+	bool decoderDone;
+	bool stopping;
+	// Error raised by the decoder, rethrown on the reading thread
+	std::string error;
+	// Time spent waiting for each other, used for the summary trace
+	uint64_t readerWaitTime;
+	uint64_t decoderWaitTime;
+	uint64_t totalBytes;
+	static int worker(void* d);
+	void decompress();
+protected:
+	virtual int underflow();
+	virtual int fillBuffer() { return 0; }
+public:
+	pipelined_filter(uncompressing_filter* d, lightspark::SystemState* sys);
+	~pipelined_filter();
+};
+
 class bytes_buf:public std::streambuf
 {
 private:
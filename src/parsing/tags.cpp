@@ -1580,9 +1580,43 @@ DefineShapeTag::DefineShapeTag(RECORDHEADER h,int v,RootMovieClip* root):Diction
 DefineShapeTag::DefineShapeTag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DictionaryTag(h,root),Shapes(1),tokens(nullptr)
 {
 	LOG(LOG_TRACE,"DefineShapeTag");
-	in >> ShapeId >> ShapeBounds >> Shapes;
+	streampos start=in.tellg();
+	in >> ShapeId >> ShapeBounds;
+	readRawShapes(in,start);
+}
+
+void DefineShapeTag::readRawShapes(istream& in, streampos start)
+{
+	int len=Header.getLength()-(in.tellg()-start);
+	if (len <= 0)
+		return;
+	rawShapes.resize(len);
+	in.read((char*)rawShapes.data(),len);
+}
+
+void DefineShapeTag::parseShapes()
+{
+	if (rawShapes.empty())
+		return;
+	bytes_buf b(rawShapes.data(),rawShapes.size());
+	istream s(&b);
+	s.exceptions(istream::eofbit | istream::failbit | istream::badbit);
+	try
+	{
+		s >> Shapes;
+	}
+	catch(std::exception& e)
+	{
+		LOG(LOG_ERROR,"Invalid data for shape "<<ShapeId<<":"<<e.what());
+	}
+	rawShapes.clear();
+	rawShapes.shrink_to_fit();
 
-	if (root->applicationDomain->version < 8)
+	for (auto& s : Shapes.FillStyles.FillStyles)
+		resolveBitmapFill(s);
+	for (auto& s : Shapes.LineStyles.LineStyles2)
+		resolveBitmapFill(s.FillType);
+	if (Shapes.version == 1 && loadedFrom->version < 8)
 	{
 		for (auto& s : Shapes.FillStyles.FillStyles)
 		{
@@ -1594,6 +1628,31 @@ DefineShapeTag::DefineShapeTag(RECORDHEADER h, std::istream& in,RootMovieClip* r
 	}
 }
 
+void DefineShapeTag::resolveBitmapFill(FILLSTYLE& style)
+{
+	if (style.FillStyleType != REPEATING_BITMAP && style.FillStyleType != CLIPPED_BITMAP &&
+		style.FillStyleType != NON_SMOOTHED_REPEATING_BITMAP && style.FillStyleType != NON_SMOOTHED_CLIPPED_BITMAP)
+		return;
+	//The bitmap might be invalid, the style should not be used
+	style.bitmap.reset();
+	if (style.bitmapId == 65535)
+		return;
+	//Lookup the bitmap in the dictionary
+	try
+	{
+		const BitmapTag* b = dynamic_cast<const BitmapTag*>(loadedFrom->dictionaryLookup(style.bitmapId));
+		if(!b)
+			LOG(LOG_ERROR,"Invalid bitmap ID " << style.bitmapId);
+		else
+			style.bitmap = b->getBitmap();
+	}
+	catch(RunTimeException& e)
+	{
+		//Thrown if the bitmapId does not exists in dictionary
+		LOG(LOG_ERROR,"Exception in FillStyle parsing: " << e.what());
+	}
+}
+
 DefineShapeTag::~DefineShapeTag()
 {
 	if (tokens)
@@ -1607,6 +1666,7 @@ ASObject *DefineShapeTag::instance(Class_base *c)
 {
 	if (!tokens)
 	{
+		parseShapes();
 		tokens = new tokensVector();
 		for (auto it = Shapes.FillStyles.FillStyles.begin(); it != Shapes.FillStyles.FillStyles.end(); it++)
 		{
@@ -1638,25 +1698,30 @@ ASObject *DefineShapeTag::instance(Class_base *c)
 DefineShape2Tag::DefineShape2Tag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DefineShapeTag(h,2,root)
 {
 	LOG(LOG_TRACE,"DefineShape2Tag");
-	in >> ShapeId >> ShapeBounds >> Shapes;
+	streampos start=in.tellg();
+	in >> ShapeId >> ShapeBounds;
+	readRawShapes(in,start);
 }
 
 DefineShape3Tag::DefineShape3Tag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DefineShape2Tag(h,3,root)
 {
 	LOG(LOG_TRACE,"DefineShape3Tag");
-	in >> ShapeId >> ShapeBounds >> Shapes;
+	streampos start=in.tellg();
+	in >> ShapeId >> ShapeBounds;
+	readRawShapes(in,start);
 }
 
 DefineShape4Tag::DefineShape4Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root):DefineShape3Tag(h,4,root)
 {
 	LOG(LOG_TRACE,"DefineShape4Tag");
+	streampos start=in.tellg();
 	in >> ShapeId >> ShapeBounds >> EdgeBounds;
 	BitStream bs(in);
 	UB(5,bs);
 	UsesFillWindingRule=UB(1,bs);
 	UsesNonScalingStrokes=UB(1,bs);
 	UsesScalingStrokes=UB(1,bs);
-	in >> Shapes;
+	readRawShapes(in,start);
 }
 
 DefineMorphShapeTag::DefineMorphShapeTag(RECORDHEADER h, std::istream& in, RootMovieClip* root):DictionaryTag(h, root),
@@ -149,8 +149,13 @@ protected:
 	UI16_SWF ShapeId;
 	RECT ShapeBounds;
 	SHAPEWITHSTYLE Shapes;
+	// SHAPEWITHSTYLE data of the tag, only decoded on first instantiation
+	std::vector<uint8_t> rawShapes;
 	tokensVector* tokens;
 	DefineShapeTag(RECORDHEADER h,int v,RootMovieClip* root);
+	void readRawShapes(std::istream& in, std::streampos start);
+	void parseShapes();
+	void resolveBitmapFill(FILLSTYLE& style);
 public:
 	DefineShapeTag(RECORDHEADER h,std::istream& in, RootMovieClip* root);
 	~DefineShapeTag();
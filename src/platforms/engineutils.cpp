@@ -24,6 +24,7 @@
 #include "backends/rendering.h"
 #include "backends/lsopengl.h"
 #include "backends/audio.h"
+#include "backends/glyphatlas.h"
 #include <pango/pangocairo.h>
 #include "version.h"
 #include "abc.h"
@@ -69,7 +70,7 @@ SDL_Cursor* EngineData::arrowCursor = nullptr;
 SDL_Cursor* EngineData::ibeamCursor = nullptr;
 Semaphore EngineData::mainthread_initialized(0);
 EngineData::EngineData() : contextmenu(nullptr),contextmenurenderer(nullptr),sdleventtickjob(nullptr),incontextmenu(false),incontextmenupreparing(false),widget(nullptr),
-	nvgcontext(nullptr),
+	nvgcontext(nullptr),glyphAtlas(new GlyphAtlas()),
 	width(0), height(0),needrenderthread(true),supportPackedDepthStencil(false),hasExternalFontRenderer(false),
 	startInFullScreenMode(false),startscalefactor(1.0)
 {
@@ -92,6 +93,7 @@ EngineData::~EngineData()
 	if (nvgcontext)
 		nvgDeleteGL2(nvgcontext);
 #endif
+	delete glyphAtlas;
 }
 
 void EngineData::runInTrueMainThread(SystemState* sys, MainThreadCallback func)
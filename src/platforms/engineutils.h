@@ -57,6 +57,7 @@ class ITickJob;
 class ByteArray;
 class NativeMenuItem;
 class InteractiveObject;
+class GlyphAtlas;
 
 // this is only used for font rendering in PPAPI plugin
 class externalFontRenderer : public IDrawable
@@ -106,6 +107,8 @@ public:
 	bool incontextmenupreparing; // needed for PPAPI plugin only
 	SDL_Window* widget;
 	NVGcontext* nvgcontext;
+	// rasterized glyphs of embedded fonts, shared by all TextFields
+	GlyphAtlas* glyphAtlas;
 	static uint32_t userevent;
 	static SDL_Thread* mainLoopThread;
 	int x;
@@ -39,5 +39,35 @@ namespace lightspark
 */
 void fastYUV420ChannelsToYUV0Buffer(uint8_t* y, uint8_t* u, uint8_t* v, uint8_t* out, uint32_t width, uint32_t height);
 
+/**
+	Packing of YUV channels with arbitrary line sizes in a single buffer (YUVA)
+
+	@param y Planar Y buffer
+	@param u Planar U buffer
+	@param v Planar V buffer
+	@param ystride Line size of the Y buffer in bytes
+	@param uvstride Line size of the U and V buffers in bytes
+	@param out Destination YUV0 buffer, lines are 16 pixels aligned
+	@param width Frame width in pixels
+	@param height Frame height in pixels
+*/
+void fastYUV420ChannelsToYUV0BufferStrided(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint32_t ystride, uint32_t uvstride,
+		uint8_t* out, uint32_t width, uint32_t height);
+
+/**
+	Conversion of YUV channels (BT.601, limited range) to BGRA
+
+	@param y Planar Y buffer
+	@param u Planar U buffer
+	@param v Planar V buffer
+	@param ystride Line size of the Y buffer in bytes
+	@param uvstride Line size of the U and V buffers in bytes
+	@param out Destination BGRA buffer, lines are 16 pixels aligned
+	@param width Frame width in pixels
+	@param height Frame height in pixels
+*/
+void fastYUV420ChannelsToBGRA(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint32_t ystride, uint32_t uvstride,
+		uint8_t* out, uint32_t width, uint32_t height);
+
 };
 #endif /* PLATFORMS_FASTPATHS_H */
@@ -0,0 +1,133 @@
+/**************************************************************************
+  Lightspark, a free flash player implementation
+
+  Copyright (C) 2010-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **************************************************************************/
+
+#include "platforms/fastpaths.h"
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * YUV->RGB coefficients (BT.601, limited range) in 6 bit fixed point,
+ * the same matrix the fragment shader uses for video textures
+ */
+#define YUV_Y 75
+#define YUV_RV 102
+#define YUV_GU 25
+#define YUV_GV 52
+#define YUV_BU 129
+
+static inline uint8_t clampToByte(int32_t v)
+{
+	return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+#ifdef __SSE2__
+static inline __m128i loadChroma4(const uint8_t* p)
+{
+	int32_t v;
+	memcpy(&v,p,4);
+	__m128i c = _mm_cvtsi32_si128(v);
+	// every chroma sample covers two pixels
+	return _mm_unpacklo_epi8(c,c);
+}
+#endif
+
+void lightspark::fastYUV420ChannelsToYUV0BufferStrided(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint32_t ystride, uint32_t uvstride,
+		uint8_t* out, uint32_t width, uint32_t height)
+{
+	uint32_t texw= (width+15)&0xfffffff0;
+	for(uint32_t i=0;i<height;i++)
+	{
+		const uint8_t* yline=y+i*ystride;
+		const uint8_t* uline=u+(i/2)*uvstride;
+		const uint8_t* vline=v+(i/2)*uvstride;
+		uint8_t* outline=out+i*texw*4;
+		uint32_t j=0;
+#ifdef __SSE2__
+		const __m128i alpha = _mm_set1_epi8((char)0xff);
+		for(;j+8<=width;j+=8)
+		{
+			__m128i yv = _mm_loadl_epi64((const __m128i*)(yline+j));
+			__m128i uv = loadChroma4(uline+j/2);
+			__m128i vv = loadChroma4(vline+j/2);
+			__m128i yu = _mm_unpacklo_epi8(yv,uv);
+			__m128i va = _mm_unpacklo_epi8(vv,alpha);
+			_mm_storeu_si128((__m128i*)(outline+j*4),_mm_unpacklo_epi16(yu,va));
+			_mm_storeu_si128((__m128i*)(outline+j*4+16),_mm_unpackhi_epi16(yu,va));
+		}
+#endif
+		for(;j<width;j++)
+		{
+			outline[j*4+0]=yline[j];
+			outline[j*4+1]=uline[j/2];
+			outline[j*4+2]=vline[j/2];
+			outline[j*4+3]=0xff;
+		}
+	}
+}
+
+void lightspark::fastYUV420ChannelsToBGRA(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint32_t ystride, uint32_t uvstride,
+		uint8_t* out, uint32_t width, uint32_t height)
+{
+	uint32_t texw= (width+15)&0xfffffff0;
+	for(uint32_t i=0;i<height;i++)
+	{
+		const uint8_t* yline=y+i*ystride;
+		const uint8_t* uline=u+(i/2)*uvstride;
+		const uint8_t* vline=v+(i/2)*uvstride;
+		uint8_t* outline=out+i*texw*4;
+		uint32_t j=0;
+#ifdef __SSE2__
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i alpha = _mm_set1_epi8((char)0xff);
+		const __m128i yoffset = _mm_set1_epi16(16);
+		const __m128i uvoffset = _mm_set1_epi16(128);
+		for(;j+8<=width;j+=8)
+		{
+			__m128i yv = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(yline+j)),zero);
+			__m128i uv = _mm_unpacklo_epi8(loadChroma4(uline+j/2),zero);
+			__m128i vv = _mm_unpacklo_epi8(loadChroma4(vline+j/2),zero);
+			yv = _mm_mullo_epi16(_mm_sub_epi16(yv,yoffset),_mm_set1_epi16(YUV_Y));
+			uv = _mm_sub_epi16(uv,uvoffset);
+			vv = _mm_sub_epi16(vv,uvoffset);
+			__m128i r = _mm_adds_epi16(yv,_mm_mullo_epi16(vv,_mm_set1_epi16(YUV_RV)));
+			__m128i g = _mm_subs_epi16(_mm_subs_epi16(yv,_mm_mullo_epi16(uv,_mm_set1_epi16(YUV_GU))),_mm_mullo_epi16(vv,_mm_set1_epi16(YUV_GV)));
+			__m128i b = _mm_adds_epi16(yv,_mm_mullo_epi16(uv,_mm_set1_epi16(YUV_BU)));
+			r = _mm_packus_epi16(_mm_srai_epi16(r,6),zero);
+			g = _mm_packus_epi16(_mm_srai_epi16(g,6),zero);
+			b = _mm_packus_epi16(_mm_srai_epi16(b,6),zero);
+			__m128i bg = _mm_unpacklo_epi8(b,g);
+			__m128i ra = _mm_unpacklo_epi8(r,alpha);
+			_mm_storeu_si128((__m128i*)(outline+j*4),_mm_unpacklo_epi16(bg,ra));
+			_mm_storeu_si128((__m128i*)(outline+j*4+16),_mm_unpackhi_epi16(bg,ra));
+		}
+#endif
+		for(;j<width;j++)
+		{
+			int32_t yc=(yline[j]-16)*YUV_Y;
+			int32_t uc=uline[j/2]-128;
+			int32_t vc=vline[j/2]-128;
+			outline[j*4+0]=clampToByte((yc+YUV_BU*uc)>>6);
+			outline[j*4+1]=clampToByte((yc-YUV_GU*uc-YUV_GV*vc)>>6);
+			outline[j*4+2]=clampToByte((yc+YUV_RV*vc)>>6);
+			outline[j*4+3]=0xff;
+		}
+	}
+}
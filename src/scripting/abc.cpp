@@ -760,10 +760,11 @@ void ABCContext::dumpProfilingData(ostream& f) const
  * nextNamespaceBase is set to 2 since 0 is the empty namespace and 1 is the AS3 namespace
  */
 ABCVm::ABCVm(SystemState* s, MemoryAccount* m):m_sys(s),status(CREATED),isIdle(true),canFlushInvalidationQueue(true),shuttingdown(false),
-	events_queue(reporter_allocator<eventType>(m)),idleevents_queue(reporter_allocator<eventType>(m)),event_buffer(reporter_allocator<eventType>(m)),nextNamespaceBase(2),
-	vmDataMemory(m)
+	events_queue(reporter_allocator<eventType>(m)),idleevents_queue(reporter_allocator<eventType>(m)),event_buffer(reporter_allocator<eventType>(m)),waitingForEvents(false),
+	latencyProfile(nullptr),nextNamespaceBase(2),vmDataMemory(m)
 {
 	m_sys=s;
+	memset(eventLatency,0,sizeof(eventLatency));
 }
 
 void ABCVm::start()
@@ -796,9 +797,20 @@ void ABCVm::addDeletableObject(ASObject *obj)
 void ABCVm::finalize()
 {
 	//The event queue may be not empty if the VM has been been started
-	if(status==CREATED && !events_queue.empty())
+	if(status==CREATED && (!events_queue.empty() || !events_inbox.empty()))
 		LOG(LOG_ERROR, "Events queue is not empty as expected");
-	events_queue.clear();
+	// events may still have been added by other threads while the vm thread was stopping.
+	// They are not handled anymore, but the dispatchers have to release what they keep for them
+	drainEventInbox();
+	while(!events_queue.empty())
+	{
+		pair<_NR<EventDispatcher>,_R<Event>> e=events_queue.front();
+		events_queue.pop_front();
+		if(e.second->is<WaitableEvent>())
+			e.second->as<WaitableEvent>()->signal();
+		if(e.first)
+			e.first->afterHandleEvent(e.second.getPtr());
+	}
 }
 
 
@@ -831,9 +843,9 @@ void ABCVm::publicHandleEvent(EventDispatcher* dispatcher, _R<Event> event)
 {
 	event->getSystemState()->setInMouseEvent(event->is<MouseEvent>());
 	
-	if (event->type == "exitFrame")
+	if (event->getTypeId() == BUILTIN_STRINGS::STRING_EXITFRAME)
 		event->getSystemState()->setFramePhase(FramePhase::EXIT_FRAME);
-	if (dispatcher && dispatcher->is<DisplayObject>() && event->type == "enterFrame" && (
+	if (dispatcher && dispatcher->is<DisplayObject>() && event->getTypeId() == BUILTIN_STRINGS::STRING_ENTERFRAME && (
 				(dispatcher->is<RootMovieClip>() && dispatcher->as<RootMovieClip>()->isWaitingForParser()) || // RootMovieClip is not yet completely parsed
 				(dispatcher->as<DisplayObject>()->legacy && !dispatcher->as<DisplayObject>()->isOnStage()))) // it seems that enterFrame event is only executed for DisplayObjects that are on stage or added from ActionScript
 		return;
@@ -1184,6 +1196,13 @@ void ABCVm::handleEvent(std::pair<_NR<EventDispatcher>, _R<Event> > e)
 				ev->clip->constructionComplete(ev->_explicit);
 				break;
 			}
+			case BROADCAST_EVENT:
+			{
+				BroadcastEvent* ev=static_cast<BroadcastEvent*>(e.second.getPtr());
+				LOG(LOG_CALLS,"BroadcastEvent:"<<ev->event->type);
+				m_sys->dispatchBroadcastEvent(ev->event);
+				break;
+			}
 			case LOCALCONNECTIONEVENT:
 			{
 				LocalConnectionEvent* ev=static_cast<LocalConnectionEvent*>(e.second.getPtr());
@@ -1201,6 +1220,7 @@ void ABCVm::handleEvent(std::pair<_NR<EventDispatcher>, _R<Event> > e)
 				m_sys->resetParentList();
 				{
 					Locker l(event_queue_mutex);
+					drainEventInbox();
 					while (!idleevents_queue.empty())
 					{
 						events_queue.push_back(idleevents_queue.front());
@@ -1225,6 +1245,7 @@ void ABCVm::handleEvent(std::pair<_NR<EventDispatcher>, _R<Event> > e)
 			{
 				FlushEventBufferEvent* ev=static_cast<FlushEventBufferEvent*>(e.second.getPtr());
 				Locker l(event_queue_mutex);
+				drainEventInbox();
 				events_queue.insert(
 					ev->append ? events_queue.end() : events_queue.begin(),
 					ev->reverse ? event_buffer.rend().base() : event_buffer.begin(),
@@ -1327,7 +1348,34 @@ bool ABCVm::addEvent(_NR<EventDispatcher> obj ,_R<Event> ev, bool isGlobalMessag
 			obj->afterHandleEvent(ev.getPtr());
 		return true;
 	}
+	if (m_sys->showProfilingData)
+		ev->queuedTime=g_get_monotonic_time();
 
+	if(!ev->is<WaitableEvent>())
+	{
+		// fast path without locking, waitable events use the locked path
+		// to make sure they are signalled by signalEventWaiters() on shutdown
+		if(shuttingdown)
+		{
+			if (obj)
+				obj->afterHandleEvent(ev.getPtr());
+			return false;
+		}
+		if (!obj.isNull())
+			obj->onNewEvent(ev.getPtr());
+		RELEASE_WRITE(ev->queued,true);
+		events_inbox.push(pair<_NR<EventDispatcher>,_R<Event>>(obj, ev));
+		if (waitingForEvents.load())
+		{
+			Locker l(event_queue_mutex);
+			sem_event_cond.signal();
+		}
+		if (isGlobalMessage)
+		{
+			m_sys->addEventToBackgroundWorkers(obj,ev);
+		}
+		return true;
+	}
 
 	Locker l(event_queue_mutex);
 
@@ -1342,6 +1390,8 @@ bool ABCVm::addEvent(_NR<EventDispatcher> obj ,_R<Event> ev, bool isGlobalMessag
 	}
 	if (!obj.isNull())
 		obj->onNewEvent(ev.getPtr());
+	// keep the order of events added by the same thread
+	drainEventInbox();
 	events_queue.push_back(pair<_NR<EventDispatcher>,_R<Event>>(obj, ev));
 	RELEASE_WRITE(ev->queued,true);
 	sem_event_cond.signal();
@@ -1472,6 +1522,7 @@ void ABCVm::checkExternalCallEvent()
 	if (shuttingdown)
 		return;
 	event_queue_mutex.lock();
+	drainEventInbox();
 	if (events_queue.size() == 0)
 	{
 		event_queue_mutex.unlock();
@@ -1489,6 +1540,8 @@ void ABCVm::handleFrontEvent()
 	events_queue.pop_front();
 
 	event_queue_mutex.unlock();
+	if (e.second->queuedTime)
+		accountEventLatency(e.second.getPtr());
 	try
 	{
 		if (e.first)
@@ -1515,42 +1568,54 @@ void ABCVm::handleFrontEvent()
 	}
 	catch(LightsparkException& e)
 	{
-		LOG(LOG_ERROR,"Error in VM " << e.cause);
-		m_sys->setError(e.cause);
-		/* do not allow any more event to be enqueued */
-		signalEventWaiters();
+		handleUncaughtException(e);
 	}
 	catch(ASObject*& e)
 	{
-		ASWorker* wrk = e->getInstanceWorker();
-		if (!wrk->callStack.empty())
-		{
-			call_context* saved_cc = wrk->callStack.back();
-			wrk->callStack.pop_back();
-			wrk->decStack(saved_cc);
-		}
-		if(e->getClass())
-			LOG(LOG_ERROR,"Unhandled ActionScript exception in VM " << e->toString());
-		else
-			LOG(LOG_ERROR,"Unhandled ActionScript exception in VM (no type)");
-		if (e->is<ASError>())
-		{
-			LOG(LOG_ERROR,"Unhandled ActionScript exception in VM " << e->as<ASError>()->getStackTraceString());
-			if (m_sys->ignoreUnhandledExceptions)
-				return;
-			m_sys->setError(e->as<ASError>()->getStackTraceString());
-		}
-		else
-			m_sys->setError("Unhandled ActionScript exception");
-		if (!m_sys->isShuttingDown())
-		{
-			/* do not allow any more event to be enqueued */
-			shuttingdown = true;
-			signalEventWaiters();
-		}
+		handleUncaughtException(e);
 	}
 }
 
+bool ABCVm::handleUncaughtException(LightsparkException& e)
+{
+	LOG(LOG_ERROR,"Error in VM " << e.cause);
+	m_sys->setError(e.cause);
+	/* do not allow any more event to be enqueued */
+	signalEventWaiters();
+	return false;
+}
+
+bool ABCVm::handleUncaughtException(ASObject* e)
+{
+	ASWorker* wrk = e->getInstanceWorker();
+	if (!wrk->callStack.empty())
+	{
+		call_context* saved_cc = wrk->callStack.back();
+		wrk->callStack.pop_back();
+		wrk->decStack(saved_cc);
+	}
+	if(e->getClass())
+		LOG(LOG_ERROR,"Unhandled ActionScript exception in VM " << e->toString());
+	else
+		LOG(LOG_ERROR,"Unhandled ActionScript exception in VM (no type)");
+	if (e->is<ASError>())
+	{
+		LOG(LOG_ERROR,"Unhandled ActionScript exception in VM " << e->as<ASError>()->getStackTraceString());
+		if (m_sys->ignoreUnhandledExceptions)
+			return true;
+		m_sys->setError(e->as<ASError>()->getStackTraceString());
+	}
+	else
+		m_sys->setError("Unhandled ActionScript exception");
+	if (!m_sys->isShuttingDown())
+	{
+		/* do not allow any more event to be enqueued */
+		shuttingdown = true;
+		signalEventWaiters();
+	}
+	return false;
+}
+
 method_info* ABCContext::get_method(unsigned int m)
 {
 	if(m<method_count)
@@ -1790,6 +1855,11 @@ int ABCVm::Run(void* d)
 
 	ThreadProfile* profile=th->m_sys->allocateProfiler(RGB(0,200,0));
 	profile->setTag("VM");
+	if (th->m_sys->showProfilingData)
+	{
+		th->latencyProfile=th->m_sys->allocateProfiler(RGB(0,100,0));
+		th->latencyProfile->setTag("Event latency");
+	}
 	//When aborting execution remaining events should be handled
 	bool firstMissingEvents=true;
 
@@ -1808,8 +1878,17 @@ int ABCVm::Run(void* d)
 		th->deletableObjects.clear();
 		th->deletable_objects_mutex.unlock();
 		th->event_queue_mutex.lock();
+		th->drainEventInbox();
 		while(th->events_queue.empty() && !th->shuttingdown)
-			th->sem_event_cond.wait(th->event_queue_mutex);
+		{
+			// producers check waitingForEvents after adding to the inbox, so either they see
+			// that we are waiting and signal us, or we see their event here
+			th->waitingForEvents.store(true);
+			if(th->events_inbox.empty())
+				th->sem_event_cond.wait(th->event_queue_mutex);
+			th->waitingForEvents.store(false);
+			th->drainEventInbox();
+		}
 		if(th->shuttingdown)
 		{
 			//If the queue is empty stop immediately
@@ -1834,6 +1913,8 @@ int ABCVm::Run(void* d)
 		snapshotCount++;
 #endif
 	}
+	if (th->m_sys->showProfilingData)
+		th->dumpEventLatency();
 #ifdef LLVM_ENABLED
 	if(th->m_sys->useJit)
 	{
@@ -1847,6 +1928,28 @@ int ABCVm::Run(void* d)
 	return 0;
 }
 
+void ABCVm::accountEventLatency(Event* ev)
+{
+	int64_t latency=g_get_monotonic_time()-ev->queuedTime;
+	ev->queuedTime=0;
+	uint32_t bucket=0;
+	while(bucket < EVENT_LATENCY_BUCKETS-1 && latency >= (int64_t(1)<<bucket))
+		bucket++;
+	eventLatency[bucket]++;
+	if (latencyProfile)
+		latencyProfile->accountMaxTime(latency);
+}
+
+void ABCVm::dumpEventLatency()
+{
+	LOG(LOG_INFO,"event queue latency:");
+	for(uint32_t i=0;i<EVENT_LATENCY_BUCKETS;i++)
+	{
+		if(eventLatency[i])
+			LOG(LOG_INFO,"< "<<(uint64_t(1)<<i)<<"us: "<<eventLatency[i]);
+	}
+}
+
 /* This breaks the lock on all enqueued events to prevent deadlocking */
 void ABCVm::signalEventWaiters()
 {
@@ -549,11 +549,26 @@ private:
 	Mutex deletable_objects_mutex;
 
 	//Event handling
-	volatile bool shuttingdown;
+	// read without locking by addEvent
+	std::atomic<bool> shuttingdown;
 	typedef std::pair<_NR<EventDispatcher>,_R<Event>> eventType;
 	std::deque<eventType, reporter_allocator<eventType>> events_queue;
 	std::list<eventType, reporter_allocator<eventType>> idleevents_queue;
 	std::list<eventType, reporter_allocator<eventType>> event_buffer;
+	// events added by addEvent without taking event_queue_mutex,
+	// they are moved to the end of events_queue before events_queue is accessed
+	MPSCQueue<eventType> events_inbox;
+	// true while the vm thread waits on sem_event_cond, producers only have to signal it in that case
+	std::atomic<bool> waitingForEvents;
+	// event_queue_mutex has to be locked
+	void drainEventInbox() { events_inbox.popAll(events_queue); }
+	// histogram of the time between adding an event and handling it, bucket i counts latencies below 2^i microseconds
+	#define EVENT_LATENCY_BUCKETS 24
+	uint64_t eventLatency[EVENT_LATENCY_BUCKETS];
+	// plots the largest event latency of every tick, only allocated if profiling data is shown
+	ThreadProfile* latencyProfile;
+	void accountEventLatency(Event* ev);
+	void dumpEventLatency();
 	void handleEvent(std::pair<_NR<EventDispatcher>,_R<Event> > e);
 	void handleFrontEvent();
 	void signalEventWaiters();
@@ -1396,6 +1411,9 @@ public:
 	*/
 	void start() DLL_PUBLIC;
 	void finalize();
+	// logs an exception that was not caught by ActionScript code, returns false if the vm stops handling events
+	bool handleUncaughtException(LightsparkException& e);
+	bool handleUncaughtException(ASObject* e);
 	void registerClassesAVM1();
 	static int Run(void* d);
 	static void executeFunction(call_context* context);
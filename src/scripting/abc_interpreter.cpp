@@ -2806,6 +2806,12 @@ bool setupInstructionTwoArguments(preloadstate& state,int operator_start,int opc
 #endif
 	return hasoperands;
 }
+bool isNumericClass(SystemState* sys, Type* t)
+{
+	return t && (t == Class<Integer>::getRef(sys).getPtr()
+			|| t == Class<UInteger>::getRef(sys).getPtr()
+			|| t == Class<Number>::getRef(sys).getPtr());
+}
 bool checkmatchingLastObjtype(preloadstate& state, Type* resulttype, Class_base* requiredtype)
 {
 	if (requiredtype == resulttype || resulttype==Type::anyType || resulttype == Type::voidType)
@@ -5296,9 +5302,12 @@ void ABCVm::preloadFunction(SyntheticFunction* function, ASWorker* wrk)
 								{
 									TemplatedClass<Vector>* cls=state.operandlist[state.operandlist.size()-3].objtype->as<TemplatedClass<Vector>>();
 									Class_base* vectype = cls->getTypes().size() > 0 ? (Class_base*)cls->getTypes()[0] : nullptr;
-									if (checkmatchingLastObjtype(state,state.operandlist[state.operandlist.size()-1].objtype,vectype))
+									Type* valuetype = state.operandlist[state.operandlist.size()-1].objtype;
+									if (checkmatchingLastObjtype(state,valuetype,vectype)
+										|| (isNumericClass(function->getSystemState(),vectype) && isNumericClass(function->getSystemState(),valuetype)))
 									{
 										// use special fast setproperty without coercing for Vector
+										// (Vectors of int, uint and Number convert numeric values into their unboxed storage)
 										startopcode = ABC_OP_OPTIMZED_SETPROPERTY_INTEGER_VECTOR;
 									}
 								}
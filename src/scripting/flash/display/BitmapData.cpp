@@ -820,11 +820,9 @@ ASFUNCTIONBODY_ATOM(BitmapData,histogram)
 	{
 		Template<Vector>::getInstanceS(wrk,v,Class<Number>::getClass(wrk->getSystemState()),appdomain);
 		Vector *histogram = asAtomHandler::as<Vector>(v);
+		histogram->reserve(256);
 		for (int level=0; level<256; level++)
-		{
-			asAtom v = asAtomHandler::fromUInt(counts[channelOrder[j]][level]);
-			histogram->append(v);
-		}
+			histogram->appendNumber(counts[channelOrder[j]][level]);
 		asAtom v = asAtomHandler::fromObject(histogram);
 		result->append(v);
 	}
@@ -930,12 +928,10 @@ ASFUNCTIONBODY_ATOM(BitmapData,getVector)
 	Template<Vector>::getInstanceS(wrk,v,Class<UInteger>::getClass(wrk->getSystemState()),appdomain);
 	Vector *result = asAtomHandler::as<Vector>(v);
 	vector<uint32_t> pixelvec = th->pixels->getPixelVector(rect->getRect());
+	result->reserve(pixelvec.size());
 	vector<uint32_t>::const_iterator it;
 	for (it=pixelvec.begin(); it!=pixelvec.end(); ++it)
-	{
-		asAtom v = asAtomHandler::fromUInt(*it);
-		result->append(v);
-	}
+		result->appendUInt(*it);
 	ret = asAtomHandler::fromObject(result);
 }
 
@@ -1020,8 +1016,7 @@ ASFUNCTIONBODY_ATOM(BitmapData,setVector)
 				return;
 			}
 
-			asAtom v = inputVector->at(i);
-			uint32_t pixel = asAtomHandler::toUInt(v);
+			uint32_t pixel = inputVector->atUInt(i);
 			th->pixels->setPixel(x, y, pixel, th->transparent);
 			i++;
 		}
@@ -39,7 +39,6 @@ private:
 	//Avoid cycles by not using automatic references
 	//Bitmap will take care of removing itself when needed
 	std::set<Bitmap*> users;
-	void notifyUsers();
 public:
 	BitmapData(ASWorker* wrk,Class_base* c);
 	BitmapData(ASWorker* wrk,Class_base* c, _R<BitmapContainer> b);
@@ -55,6 +54,7 @@ public:
 	void addUser(Bitmap* b, bool startupload=true);
 	void removeUser(Bitmap* b);
 	void checkForUpload();
+	void notifyUsers();
 	/*
 	 * Utility method to draw a DisplayObject on the surface
 	 */
@@ -620,20 +620,16 @@ void Graphics::pathToTokens(_NR<Vector> commands, _NR<Vector> data,
 	if (winding != "evenOdd")
 		LOG(LOG_NOT_IMPLEMENTED, "Only event-odd winding implemented in Graphics.drawPath");
 
-	asAtom zero = asAtomHandler::fromInt(0);
-
 	int k = 0;
 	for (unsigned int i=0; i<commands->size(); i++)
 	{
-		asAtom c = commands->at(i);
-		switch (asAtomHandler::toInt(c))
+		int32_t c = commands->atInt(i);
+		switch (c)
 		{
 			case GRAPHICSPATH_COMMANDTYPE::MOVE_TO:
 			{
-				asAtom ax = data->at(k++, zero);
-				asAtom ay = data->at(k++, zero);
-				number_t x = asAtomHandler::toNumber(ax)*TWIPS_FACTOR;
-				number_t y = asAtomHandler::toNumber(ay)*TWIPS_FACTOR;
+				number_t x = data->atNumber(k++, 0)*TWIPS_FACTOR;
+				number_t y = data->atNumber(k++, 0)*TWIPS_FACTOR;
 				tokens.filltokens->tokens.emplace_back(GeomToken(MOVE).uval);
 				tokens.filltokens->tokens.emplace_back(GeomToken(Vector2(x, y)).uval);
 				updateTokenBounds(x,y);
@@ -642,10 +638,8 @@ void Graphics::pathToTokens(_NR<Vector> commands, _NR<Vector> data,
 
 			case GRAPHICSPATH_COMMANDTYPE::LINE_TO:
 			{
-				asAtom ax = data->at(k++, zero);
-				asAtom ay = data->at(k++, zero);
-				number_t x = asAtomHandler::toNumber(ax)*TWIPS_FACTOR;
-				number_t y = asAtomHandler::toNumber(ay)*TWIPS_FACTOR;
+				number_t x = data->atNumber(k++, 0)*TWIPS_FACTOR;
+				number_t y = data->atNumber(k++, 0)*TWIPS_FACTOR;
 				tokens.filltokens->tokens.emplace_back(GeomToken(STRAIGHT).uval);
 				tokens.filltokens->tokens.emplace_back(GeomToken(Vector2(x, y)).uval);
 				updateTokenBounds(x,y);
@@ -654,14 +648,10 @@ void Graphics::pathToTokens(_NR<Vector> commands, _NR<Vector> data,
 
 			case GRAPHICSPATH_COMMANDTYPE::CURVE_TO:
 			{
-				asAtom acx = data->at(k++, zero);
-				asAtom acy = data->at(k++, zero);
-				number_t cx = asAtomHandler::toNumber(acx)*TWIPS_FACTOR;
-				number_t cy = asAtomHandler::toNumber(acy)*TWIPS_FACTOR;
-				asAtom ax = data->at(k++, zero);
-				asAtom ay = data->at(k++, zero);
-				number_t x = asAtomHandler::toNumber(ax)*TWIPS_FACTOR;
-				number_t y = asAtomHandler::toNumber(ay)*TWIPS_FACTOR;
+				number_t cx = data->atNumber(k++, 0)*TWIPS_FACTOR;
+				number_t cy = data->atNumber(k++, 0)*TWIPS_FACTOR;
+				number_t x = data->atNumber(k++, 0)*TWIPS_FACTOR;
+				number_t y = data->atNumber(k++, 0)*TWIPS_FACTOR;
 				tokens.filltokens->tokens.emplace_back(GeomToken(CURVE_QUADRATIC).uval);
 				tokens.filltokens->tokens.emplace_back(GeomToken(Vector2(cx, cy)).uval);
 				tokens.filltokens->tokens.emplace_back(GeomToken(Vector2(x, y)).uval);
@@ -673,10 +663,8 @@ void Graphics::pathToTokens(_NR<Vector> commands, _NR<Vector> data,
 			case GRAPHICSPATH_COMMANDTYPE::WIDE_MOVE_TO:
 			{
 				k+=2;
-				asAtom ax = data->at(k++, zero);
-				asAtom ay = data->at(k++, zero);
-				number_t x = asAtomHandler::toNumber(ax)*TWIPS_FACTOR;
-				number_t y = asAtomHandler::toNumber(ay)*TWIPS_FACTOR;
+				number_t x = data->atNumber(k++, 0)*TWIPS_FACTOR;
+				number_t y = data->atNumber(k++, 0)*TWIPS_FACTOR;
 				tokens.filltokens->tokens.emplace_back(GeomToken(MOVE).uval);
 				tokens.filltokens->tokens.emplace_back(GeomToken(Vector2(x, y)).uval);
 				updateTokenBounds(x,y);
@@ -686,10 +674,8 @@ void Graphics::pathToTokens(_NR<Vector> commands, _NR<Vector> data,
 			case GRAPHICSPATH_COMMANDTYPE::WIDE_LINE_TO:
 			{
 				k+=2;
-				asAtom ax = data->at(k++, zero);
-				asAtom ay = data->at(k++, zero);
-				number_t x = asAtomHandler::toNumber(ax)*TWIPS_FACTOR;
-				number_t y = asAtomHandler::toNumber(ay)*TWIPS_FACTOR;
+				number_t x = data->atNumber(k++, 0)*TWIPS_FACTOR;
+				number_t y = data->atNumber(k++, 0)*TWIPS_FACTOR;
 				tokens.filltokens->tokens.emplace_back(GeomToken(STRAIGHT).uval);
 				tokens.filltokens->tokens.emplace_back(GeomToken(Vector2(x, y)).uval);
 				updateTokenBounds(x,y);
@@ -698,18 +684,12 @@ void Graphics::pathToTokens(_NR<Vector> commands, _NR<Vector> data,
 
 			case GRAPHICSPATH_COMMANDTYPE::CUBIC_CURVE_TO:
 			{
-				asAtom ac1x = data->at(k++, zero);
-				asAtom ac1y = data->at(k++, zero);
-				asAtom ac2x = data->at(k++, zero);
-				asAtom ac2y = data->at(k++, zero);
-				number_t c1x = asAtomHandler::toNumber(ac1x)*TWIPS_FACTOR;
-				number_t c1y = asAtomHandler::toNumber(ac1y)*TWIPS_FACTOR;
-				number_t c2x = asAtomHandler::toNumber(ac2x)*TWIPS_FACTOR;
-				number_t c2y = asAtomHandler::toNumber(ac2y)*TWIPS_FACTOR;
-				asAtom ax = data->at(k++, zero);
-				asAtom ay = data->at(k++, zero);
-				number_t x = asAtomHandler::toNumber(ax)*TWIPS_FACTOR;
-				number_t y = asAtomHandler::toNumber(ay)*TWIPS_FACTOR;
+				number_t c1x = data->atNumber(k++, 0)*TWIPS_FACTOR;
+				number_t c1y = data->atNumber(k++, 0)*TWIPS_FACTOR;
+				number_t c2x = data->atNumber(k++, 0)*TWIPS_FACTOR;
+				number_t c2y = data->atNumber(k++, 0)*TWIPS_FACTOR;
+				number_t x = data->atNumber(k++, 0)*TWIPS_FACTOR;
+				number_t y = data->atNumber(k++, 0)*TWIPS_FACTOR;
 				tokens.filltokens->tokens.emplace_back(GeomToken(CURVE_CUBIC).uval);
 				tokens.filltokens->tokens.emplace_back(GeomToken(Vector2(c1x, c1y)).uval);
 				tokens.filltokens->tokens.emplace_back(GeomToken(Vector2(c2x, c2y)).uval);
@@ -722,7 +702,7 @@ void Graphics::pathToTokens(_NR<Vector> commands, _NR<Vector> data,
 
 			case GRAPHICSPATH_COMMANDTYPE::NO_OP:
 			default:
-				LOG(LOG_NOT_IMPLEMENTED,"pathToTokens:"<<asAtomHandler::toInt(c));
+				LOG(LOG_NOT_IMPLEMENTED,"pathToTokens:"<<c);
 				break;
 		}
 	}
@@ -1036,22 +1016,15 @@ void Graphics::drawTrianglesToTokens(_NR<Vector> vertices, _NR<Vector> indices,
 			if (indices.isNull())
 				vertex=3*i+j;
 			else
-			{
-				asAtom a =indices->at(3*i+j);
-				vertex=asAtomHandler::toInt(a);
-			}
+				vertex=indices->atInt(3*i+j);
 
-			asAtom ax = vertices->at(2*vertex);
-			x[j]=asAtomHandler::toNumber(ax)*TWIPS_FACTOR;
-			asAtom ay = vertices->at(2*vertex+1);
-			y[j]=asAtomHandler::toNumber(ay)*TWIPS_FACTOR;
+			x[j]=vertices->atNumber(2*vertex)*TWIPS_FACTOR;
+			y[j]=vertices->atNumber(2*vertex+1)*TWIPS_FACTOR;
 
 			if (has_uvt)
 			{
-				asAtom au = uvtData->at(vertex*uvtElemSize);
-				u[j]=asAtomHandler::toNumber(au)*texturewidth*TWIPS_FACTOR;
-				asAtom av = uvtData->at(vertex*uvtElemSize+1);
-				v[j]=asAtomHandler::toNumber(av)*textureheight*TWIPS_FACTOR;
+				u[j]=uvtData->atNumber(vertex*uvtElemSize)*texturewidth*TWIPS_FACTOR;
+				v[j]=uvtData->atNumber(vertex*uvtElemSize+1)*textureheight*TWIPS_FACTOR;
 			}
 		}
 		
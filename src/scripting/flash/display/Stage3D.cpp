@@ -116,7 +116,7 @@ ASFUNCTIONBODY_ATOM(Stage3D,requestContext3D)
 	
 	th->context3D = _MR(Class<Context3D>::getInstanceS(wrk));
 	th->context3D->addStoredMember();
-	th->context3D->init(th);
+	th->context3D->init(th,context3DRenderMode=="software");
 }
 ASFUNCTIONBODY_ATOM(Stage3D,requestContext3DMatchingProfiles)
 {
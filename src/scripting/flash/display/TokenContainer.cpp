@@ -327,12 +327,14 @@ IDrawable* TokenContainer::invalidate(SMOOTH_MODE smoothing, bool fromgraphics,
 		owner->setNeedsTextureRecalculation();
 		renderWithNanoVG=false;
 	}
-	IDrawable* ret = new CairoTokenRenderer(tokens.filltokens,tokens.stroketokens,matrix
+	// glyphs of embedded fonts are not drawn as tokens but composited from the glyph atlas
+	CairoTokenRenderer* ret = new CairoTokenRenderer(tokens.isGlyph ? NullRef : tokens.filltokens,tokens.stroketokens,matrix
 				, x, y, ceil(width), ceil(height)
 				, matrix.getScaleX(), matrix.getScaleY()
 				, isMask, owner->cacheAsBitmap
 				, scaling,owner->getConcatenatedAlpha()
 				, ct, smoothing ? SMOOTH_ANTIALIAS : SMOOTH_NONE,owner->getBlendMode(), regpointx, regpointy);
+	ret->addGlyphs(tokens,owner->getSystemState()->getEngineData()->glyphAtlas);
 	ret->getState()->renderWithNanoVG = renderWithNanoVG;
 	return ret;
 }
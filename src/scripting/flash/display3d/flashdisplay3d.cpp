@@ -30,6 +30,8 @@
 #include "backends/rendering_context.h"
 #include "platforms/engineutils.h"
 #include "scripting/flash/display3d/agalconverter.h"
+#include "scripting/flash/display3d/softwarerenderer3d.h"
+#include "backends/config.h"
 #include "scripting/abc.h"
 
 SamplerRegister SamplerRegister::parse (uint64_t v, bool isVertexProgram)
@@ -56,7 +58,7 @@ lightspark::tiny_string SamplerRegister::toGLSL ()
 	return str;
 }
 
-void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
+void Context3D::handleRenderAction(EngineData* engineData, renderaction& action, const std::vector<float>& data)
 {
 	switch (action.action)
 	{
@@ -88,13 +90,21 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 			//action.udata3 = backBufferHeight
 			configureBackBufferIntern(action.udata1,action.udata2,action.udata3,0);
 			configureBackBufferIntern(action.udata1,action.udata2,action.udata3,1);
+			invalidateSamplerCache();
 			break;
 		case RENDER_SETPROGRAM:
 		{
 			//action.dataobject = Program3D
 			Program3D* p = action.dataobject->as<Program3D>();
 			currentprogram = p;
-			engineData->exec_glUseProgram(p->gpu_program);
+			if (boundprogram == p->gpu_program)
+				stateChangesElided++;
+			else
+			{
+				engineData->exec_glUseProgram(p->gpu_program);
+				boundprogram = p->gpu_program;
+				stateChangesSubmitted++;
+			}
 			break;
 		}
 		case RENDER_UPLOADPROGRAM:
@@ -106,6 +116,35 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 			int stat;
 			Program3D* p = action.dataobject->as<Program3D>();
 			//LOG(LOG_INFO,"uploadProgram:"<<p<<" "<<p->gpu_program);
+			if (p->programhash)
+			{
+				if (p->linkedhash == p->programhash && p->gpu_program != UINT32_MAX)
+				{
+					// uploaded again with the same bytecode, the linked program is still valid
+					p->vertexprogram = "";
+					p->fragmentprogram = "";
+					setPositionScale(engineData);
+					break;
+				}
+				auto it = linkedPrograms.find(p->programhash);
+				if (it != linkedPrograms.end())
+				{
+					releaseProgram(engineData,p);
+					it->second.refcount++;
+					p->gpu_program = it->second.gpu_program;
+					p->linkedhash = p->programhash;
+					linkCacheHits++;
+					p->resetRegisterIDs();
+					p->vertexprogram = "";
+					p->fragmentprogram = "";
+					setPositionScale(engineData);
+					break;
+				}
+			}
+			// a shared program can't be relinked, and a program that will be shared has to be created from scratch
+			if (p->linkedhash || p->programhash)
+				releaseProgram(engineData,p);
+			bool cacheable = p->programhash && !p->vertexprogram.empty() && !p->fragmentprogram.empty();
 			uint32_t f= UINT32_MAX;
 			uint32_t g= UINT32_MAX;
 			if (p->gpu_program == UINT32_MAX)
@@ -167,16 +206,17 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 					LOG(LOG_INFO,"program link " << str);
 					throw RunTimeException("Could not link program");
 				}
-				for (auto it = p->samplerState.begin();it != p->samplerState.end(); it++)
-					it->program_sampler_id = UINT32_MAX;
-				for (auto it = p->vertexregistermap.begin();it != p->vertexregistermap.end(); it++)
-					it->program_register_id = UINT32_MAX;
-				for (auto it = p->fragmentregistermap.begin();it != p->fragmentregistermap.end(); it++)
-					it->program_register_id = UINT32_MAX;
-				for (auto it = p->vertexattributes.begin();it != p->vertexattributes.end(); it++)
-					it->program_register_id = UINT32_MAX;
-				for (auto it = p->fragmentattributes.begin();it != p->fragmentattributes.end(); it++)
-					it->program_register_id = UINT32_MAX;
+				p->resetRegisterIDs();
+				uploadedConstantSerial.erase(p->gpu_program);
+				if (cacheable)
+				{
+					linkedProgram lp;
+					lp.gpu_program = p->gpu_program;
+					lp.refcount = 1;
+					linkedPrograms[p->programhash] = lp;
+					p->linkedhash = p->programhash;
+					linkCacheMisses++;
+				}
 			}
 			p->vertexprogram = "";
 			p->fragmentprogram = "";
@@ -186,6 +226,7 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 		case RENDER_RENDERTOBACKBUFFER:
 			if (renderingToTexture)
 			{
+				invalidateSamplerCache();
 				engineData->exec_glBindTexture_GL_TEXTURE_2D(backframebufferIDcurrent);
 				engineData->exec_glBindFramebuffer_GL_FRAMEBUFFER(backframebuffer[currentactionvector]);
 				engineData->exec_glViewport(0,0,this->backBufferWidth,this->backBufferHeight);
@@ -200,6 +241,8 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 					engineData->exec_glDisable_GL_STENCIL_TEST();
 				}
 			}
+			if (vcposdata[1] != 1.0)
+				positionscaleserial = ++constantserial;
 			vcposdata[1] = 1.0;
 			setPositionScale(engineData);
 			renderingToTexture = false;
@@ -261,6 +304,9 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 			}
 			engineData->exec_glViewport(0,0,action.udata2,action.udata3);
 			engineData->exec_glBindTexture_GL_TEXTURE_2D(0);
+			invalidateSamplerCache();
+			if (vcposdata[1] != -1.0)
+				positionscaleserial = ++constantserial;
 			vcposdata[1] = -1.0;
 			setPositionScale(engineData);
 			engineData->exec_glFrontFace(true);
@@ -272,8 +318,8 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 			//action.dataobject = Program3D
 			Program3D* p = action.dataobject->as<Program3D>();
 			engineData->exec_glUseProgram(0);
-			engineData->exec_glDeleteProgram(p->gpu_program);
-			p->gpu_program = UINT32_MAX;
+			boundprogram = 0;
+			releaseProgram(engineData,p);
 			break;
 		}
 		case RENDER_SETVERTEXBUFFER:
@@ -313,6 +359,7 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 				{
 					engineData->exec_glGenBuffers(1,&buffer->bufferID);
 					action.udata3 = buffer->bufferID;
+					boundindexbuffer = UINT32_MAX;
 					if (!buffer->data.empty())
 					{
 						engineData->exec_glBindBuffer_GL_ELEMENT_ARRAY_BUFFER(buffer->bufferID);
@@ -323,19 +370,44 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 					}
 				}
 			}
+			for (uint32_t i = 0; i < CONTEXT3D_TRACKED_ATTRIBUTES; i++)
+				boundattributes[i].used = false;
 			if (currentprogram)
 			{
-				setPositionScale(engineData);
+				if (boundprogram != currentprogram->gpu_program)
+				{
+					engineData->exec_glUseProgram(currentprogram->gpu_program);
+					boundprogram = currentprogram->gpu_program;
+					stateChangesSubmitted++;
+				}
+				// the uniforms are stored in the gpu program, so only the constants changed since its last draw are uploaded
+				uint64_t& uploadedserial = uploadedConstantSerial[currentprogram->gpu_program];
+				if (uploadedserial < positionscaleserial)
+				{
+					setPositionScale(engineData);
+					stateChangesSubmitted++;
+				}
+				else
+					stateChangesElided++;
 				setSamplers(engineData);
-				setRegisters(engineData,currentprogram->vertexregistermap,vertexConstants,true);
-				setRegisters(engineData,currentprogram->fragmentregistermap,fragmentConstants,false);
+				setRegisters(engineData,currentprogram->vertexregistermap,vertexConstants,true,uploadedserial);
+				setRegisters(engineData,currentprogram->fragmentregistermap,fragmentConstants,false,uploadedserial);
+				uploadedserial = constantserial;
 				setAttribs(engineData,currentprogram->vertexattributes);
 				setAttribs(engineData,currentprogram->fragmentattributes);
 			}
+			disableUnusedAttribs(engineData,false);
 			engineData->exec_glBindBuffer_GL_ARRAY_BUFFER(0);
 
 			uint32_t count = action.udata2;
-			engineData->exec_glBindBuffer_GL_ELEMENT_ARRAY_BUFFER(action.udata3);
+			if (boundindexbuffer == action.udata3)
+				stateChangesElided++;
+			else
+			{
+				engineData->exec_glBindBuffer_GL_ELEMENT_ARRAY_BUFFER(action.udata3);
+				boundindexbuffer = action.udata3;
+				stateChangesSubmitted++;
+			}
 			engineData->exec_glDrawElements_GL_TRIANGLES_GL_UNSIGNED_SHORT(count,(void*)(action.udata1*sizeof(uint16_t)));
 			if (currentprogram)
 			{
@@ -359,6 +431,7 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 			if (buffer->bufferID == UINT32_MAX)
 				engineData->exec_glGenBuffers(1,&(buffer->bufferID));
 			engineData->exec_glBindBuffer_GL_ELEMENT_ARRAY_BUFFER(buffer->bufferID);
+			boundindexbuffer = buffer->bufferID;
 			if (buffer->bufferUsage == "dynamicDraw")
 				engineData->exec_glBufferData_GL_ELEMENT_ARRAY_BUFFER_GL_DYNAMIC_DRAW(buffer->data.size()*sizeof(uint16_t),buffer->data.data());
 			else
@@ -371,11 +444,13 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 			IndexBuffer3D* buffer = action.dataobject->as<IndexBuffer3D>();
 			if (buffer && buffer->bufferID != UINT32_MAX)
 				engineData->exec_glDeleteBuffers(1,&buffer->bufferID);
+			invalidateBufferCache();
 			break;
 		}
 		case RENDER_DELETEBUFFER:
 			//action.udata1 = bufferID
 			engineData->exec_glDeleteBuffers(1,&action.udata1);
+			invalidateBufferCache();
 			break;
 		case RENDER_SETPROGRAMCONSTANTS_FROM_MATRIX:
 		{
@@ -383,22 +458,27 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 			//action.udata2 = 1, if vertex constants, 0 if fragment constants
 			//action.udata3 = 1, if transposed
 			//action.fdata = matrix (4*4)
+			constantserial++;
 			for (uint32_t i = 0; i < 4 && i < CONTEXT3D_PROGRAM_REGISTERS-action.udata1; i++ )
 			{
-				float* data = action.udata2 ? vertexConstants[i+action.udata1].data : fragmentConstants[i+action.udata1].data;
+				float* reg = action.udata2 ? vertexConstants[i+action.udata1].data : fragmentConstants[i+action.udata1].data;
+				if (action.udata2)
+					vertexConstantSerial[i+action.udata1] = constantserial;
+				else
+					fragmentConstantSerial[i+action.udata1] = constantserial;
 				if (action.udata3)
 				{
-					data[0] = action.fdata[i];
-					data[1] = action.fdata[i+4];
-					data[2] = action.fdata[i+8];
-					data[3] = action.fdata[i+12];
+					reg[0] = action.fdata[i];
+					reg[1] = action.fdata[i+4];
+					reg[2] = action.fdata[i+8];
+					reg[3] = action.fdata[i+12];
 				}
 				else
 				{
-					data[0] = action.fdata[i*4];
-					data[1] = action.fdata[i*4+1];
-					data[2] = action.fdata[i*4+2];
-					data[3] = action.fdata[i*4+3];
+					reg[0] = action.fdata[i*4];
+					reg[1] = action.fdata[i*4+1];
+					reg[2] = action.fdata[i*4+2];
+					reg[3] = action.fdata[i*4+3];
 				}
 			}
 			break;
@@ -408,14 +488,20 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 			//action.udata1 = firstRegister
 			//action.udata2 = 1, if vertex constants, 0 if fragment constants
 			//action.udata3 = numRegisters
-			//action.fdata = vector list (4*numRegisters)
+			//action.dataoffset = vector list (4*numRegisters)
+			const float* values = data.data()+action.dataoffset;
+			constantserial++;
 			for (uint32_t i = 0; i < action.udata3 && i < CONTEXT3D_PROGRAM_REGISTERS-action.udata1; i++ )
 			{
-				float* data = action.udata2 ? vertexConstants[i+action.udata1].data : fragmentConstants[i+action.udata1].data;
-				data[0] = action.fdata[i*4];
-				data[1] = action.fdata[i*4+1];
-				data[2] = action.fdata[i*4+2];
-				data[3] = action.fdata[i*4+3];
+				float* reg = action.udata2 ? vertexConstants[i+action.udata1].data : fragmentConstants[i+action.udata1].data;
+				if (action.udata2)
+					vertexConstantSerial[i+action.udata1] = constantserial;
+				else
+					fragmentConstantSerial[i+action.udata1] = constantserial;
+				reg[0] = values[i*4];
+				reg[1] = values[i*4+1];
+				reg[2] = values[i*4+2];
+				reg[3] = values[i*4+3];
 			}
 			break;
 		}
@@ -431,6 +517,8 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 				//LOG(LOG_INFO,"RENDER_SETTEXTUREAT remove:"<<action.udata1<<" "<<currentprogram->gpu_program);
 				engineData->exec_glActiveTexture_GL_TEXTURE0(action.udata1);
 				engineData->exec_glBindTexture_GL_TEXTURE_2D(0);
+				if (action.udata1 < CONTEXT3D_SAMPLER_COUNT)
+					boundsamplers[action.udata1].textureID = UINT32_MAX;
 			}
 			else
 			{
@@ -518,7 +606,10 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 			//action.udata3 = depthRenderBuffer
 			//action.fdata[0] = stencilRenderBuffer
 			if (action.udata1 != UINT32_MAX)
+			{
 				engineData->exec_glDeleteTextures(1, &action.udata1);
+				invalidateSamplerCache();
+			}
 			if (action.udata2 != UINT32_MAX)
 				engineData->exec_glDeleteFramebuffers(1,&action.udata2);
 			uint32_t stencilRenderBuffer=action.fdata[0];
@@ -555,6 +646,7 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 			VertexBuffer3D* buffer = action.dataobject->as<VertexBuffer3D>();
 			if (buffer && buffer->bufferID != UINT32_MAX)
 				engineData->exec_glDeleteBuffers(1,&buffer->bufferID);
+			invalidateBufferCache();
 			break;
 		}
 		case RENDER_SETSTENCILREFERENCEVALUE:
@@ -571,11 +663,33 @@ void Context3D::handleRenderAction(EngineData* engineData, renderaction& action)
 			break;
 	}
 }
-void Context3D::setRegisters(EngineData* engineData,std::vector<RegisterMapEntry>& registermap,constantregister* constants, bool isVertex)
+void Context3D::setRegisters(EngineData* engineData,std::vector<RegisterMapEntry>& registermap,constantregister* constants, bool isVertex, uint64_t uploadedserial)
 {
+	const uint64_t* serials = isVertex ? vertexConstantSerial : fragmentConstantSerial;
+	// the AGAL converter declares every directly addressed register as a uniform of its own,
+	// the locations of different uniforms are not consecutive, so contiguous registers can't be uploaded with a single glUniform4fv
 	auto it = registermap.begin();
 	while (it != registermap.end())
 	{
+		if (it->program_register_id != UINT32_MAX)
+		{
+			// skip registers that haven't changed since they were uploaded to this program
+			uint32_t regcount = 1;
+			if (it->usage == RegisterUsage::MATRIX_4_4)
+				regcount = 4;
+			else if (it->usage == RegisterUsage::VECTOR_4_ARRAY)
+				regcount = CONTEXT3D_PROGRAM_REGISTERS-it->number;
+			bool changed = false;
+			for (uint32_t i = it->number; i < it->number+regcount && i < CONTEXT3D_PROGRAM_REGISTERS && !changed; i++)
+				changed = serials[i] > uploadedserial;
+			if (!changed)
+			{
+				stateChangesElided++;
+				it++;
+				continue;
+			}
+		}
+		stateChangesSubmitted++;
 		switch (it->usage)
 		{
 			case RegisterUsage::VECTOR_4:
@@ -645,7 +759,29 @@ void Context3D::setAttribs(EngineData *engineData,std::vector<RegisterMapEntry>&
 			{
 				it->program_register_id = engineData->exec_glGetAttribLocation(currentprogram->gpu_program,it->name.raw_buf());
 			}
-			if (it->program_register_id != UINT32_MAX)
+			if (it->program_register_id < CONTEXT3D_TRACKED_ATTRIBUTES)
+			{
+				// the attribute arrays stay enabled between draw calls and are only changed if the buffer layout differs
+				const attribregister& a = attribs[it->number];
+				boundAttribute& b = boundattributes[it->program_register_id];
+				b.used = true;
+				if (b.enabled && b.bufferID == a.bufferID && b.data32PerVertex == a.data32PerVertex && b.offset == a.offset && b.format == a.format)
+					stateChangesElided++;
+				else
+				{
+					if (!b.enabled)
+						engineData->exec_glEnableVertexAttribArray(it->program_register_id);
+					engineData->exec_glBindBuffer_GL_ARRAY_BUFFER(a.bufferID);
+					engineData->exec_glVertexAttribPointer(it->program_register_id, a.data32PerVertex*sizeof(float), (const void*)(size_t)(a.offset*4),a.format);
+					b.enabled = true;
+					b.bufferID = a.bufferID;
+					b.data32PerVertex = a.data32PerVertex;
+					b.offset = a.offset;
+					b.format = a.format;
+					stateChangesSubmitted++;
+				}
+			}
+			else if (it->program_register_id != UINT32_MAX)
 			{
 				engineData->exec_glEnableVertexAttribArray(it->program_register_id);
 				engineData->exec_glBindBuffer_GL_ARRAY_BUFFER(attribs[it->number].bufferID);
@@ -660,11 +796,25 @@ void Context3D::resetAttribs(EngineData *engineData,std::vector<RegisterMapEntry
 	auto it = attributes.begin();
 	while (it != attributes.end())
 	{
-		if (attribs[it->number].bufferID != UINT32_MAX && it->program_register_id != UINT32_MAX)
+		// tracked attribute arrays are disabled by disableUnusedAttribs
+		if (attribs[it->number].bufferID != UINT32_MAX && it->program_register_id != UINT32_MAX && it->program_register_id >= CONTEXT3D_TRACKED_ATTRIBUTES)
 			engineData->exec_glDisableVertexAttribArray(it->program_register_id);
 		it++;
 	}
 }
+void Context3D::disableUnusedAttribs(EngineData* engineData, bool all)
+{
+	for (uint32_t i = 0; i < CONTEXT3D_TRACKED_ATTRIBUTES; i++)
+	{
+		boundAttribute& b = boundattributes[i];
+		if (b.enabled && (all || !b.used))
+		{
+			engineData->exec_glDisableVertexAttribArray(i);
+			b.enabled = false;
+			b.bufferID = UINT32_MAX;
+		}
+	}
+}
 
 void Context3D::setSamplers(EngineData *engineData)
 {
@@ -677,16 +827,41 @@ void Context3D::setSamplers(EngineData *engineData)
 			sprintf(buf,"sampler%d",currentprogram->samplerState[i].n);
 			sampid = engineData->exec_glGetUniformLocation(currentprogram->gpu_program,buf);
 		}
-		if (sampid != UINT32_MAX && samplers[currentprogram->samplerState[i].n] != UINT32_MAX)
+		if (sampid != UINT32_MAX && currentprogram->samplerState[i].n < CONTEXT3D_SAMPLER_COUNT && samplers[currentprogram->samplerState[i].n] != UINT32_MAX)
 		{
-			currentprogram->samplerState[i].program_sampler_id = sampid;
-			engineData->exec_glActiveTexture_GL_TEXTURE0(currentprogram->samplerState[i].n);
-			if (currentprogram->samplerState[i].d)
-				engineData->exec_glBindTexture_GL_TEXTURE_CUBE_MAP(samplers[currentprogram->samplerState[i].n]);
+			SamplerRegister& sr = currentprogram->samplerState[i];
+			// the texture unit of a sampler never changes, so it only has to be set once for the linked program
+			if (sr.program_sampler_id == UINT32_MAX)
+			{
+				sr.program_sampler_id = sampid;
+				engineData->exec_glUniform1i(sampid, sr.n);
+			}
+			uint32_t textureID = samplers[sr.n];
+			boundSampler& bs = boundsamplers[sr.n];
+			if (bs.textureID == textureID && bs.b == sr.b && bs.d == sr.d && bs.f == sr.f && bs.m == sr.m && bs.w == sr.w)
+			{
+				stateChangesElided++;
+				continue;
+			}
+			engineData->exec_glActiveTexture_GL_TEXTURE0(sr.n);
+			if (sr.d)
+				engineData->exec_glBindTexture_GL_TEXTURE_CUBE_MAP(textureID);
 			else
-				engineData->exec_glBindTexture_GL_TEXTURE_2D(samplers[currentprogram->samplerState[i].n]);
-			engineData->exec_glSetTexParameters(currentprogram->samplerState[i].b,currentprogram->samplerState[i].d,currentprogram->samplerState[i].f,currentprogram->samplerState[i].m,currentprogram->samplerState[i].w);
-			engineData->exec_glUniform1i(sampid, currentprogram->samplerState[i].n);
+				engineData->exec_glBindTexture_GL_TEXTURE_2D(textureID);
+			engineData->exec_glSetTexParameters(sr.b,sr.d,sr.f,sr.m,sr.w);
+			stateChangesSubmitted++;
+			// the parameters are stored in the texture, so other units using the same texture have to set them again
+			for (uint32_t j = 0; j < CONTEXT3D_SAMPLER_COUNT; j++)
+			{
+				if (boundsamplers[j].textureID == textureID)
+					boundsamplers[j].textureID = UINT32_MAX;
+			}
+			bs.textureID = textureID;
+			bs.b = sr.b;
+			bs.d = sr.d;
+			bs.f = sr.f;
+			bs.m = sr.m;
+			bs.w = sr.w;
 		}
 		else
 			LOG(LOG_ERROR,"sampler not found in program:"<<currentprogram->samplerState[i].n<<" "<<currentprogram->gpu_program<<" "<<sampid<<" "<<currentprogram);
@@ -703,9 +878,315 @@ void Context3D::setPositionScale(EngineData *engineData)
 	}
 }
 
+void Context3D::releaseProgram(EngineData* engineData, Program3D* p)
+{
+	if (p->gpu_program == UINT32_MAX)
+		return;
+	if (p->linkedhash)
+	{
+		auto it = linkedPrograms.find(p->linkedhash);
+		if (it != linkedPrograms.end() && --it->second.refcount == 0)
+		{
+			engineData->exec_glDeleteProgram(it->second.gpu_program);
+			uploadedConstantSerial.erase(it->second.gpu_program);
+			linkedPrograms.erase(it);
+		}
+		p->linkedhash = 0;
+	}
+	else
+	{
+		engineData->exec_glDeleteProgram(p->gpu_program);
+		uploadedConstantSerial.erase(p->gpu_program);
+	}
+	if (boundprogram == p->gpu_program)
+		boundprogram = UINT32_MAX;
+	p->gpu_program = UINT32_MAX;
+}
+
+void Context3D::handleSoftwareRenderAction(renderaction& action)
+{
+	SoftwareRenderer3D::renderState& state = softwarerenderer->getState();
+	switch (action.action)
+	{
+		case RENDER_CLEAR:
+			softwarerenderer->clear(action.fdata[0],action.fdata[1],action.fdata[2],action.fdata[3],action.fdata[4],action.udata1&0xff,action.udata2);
+			break;
+		case RENDER_CONFIGUREBACKBUFFER:
+			backBufferWidth=action.udata2;
+			backBufferHeight=action.udata3;
+			softwarerenderer->configureBackBuffer(action.udata2,action.udata3,action.udata1);
+			renderingToTexture = false;
+			break;
+		case RENDER_SETPROGRAM:
+			currentprogram = action.dataobject->as<Program3D>();
+			break;
+		case RENDER_UPLOADPROGRAM:
+		{
+			Program3D* p = action.dataobject->as<Program3D>();
+			if (p->gpu_program == UINT32_MAX)
+				p->gpu_program = softwarerenderer->createProgram();
+			softwarerenderer->uploadProgram(p->gpu_program,p->vertexbytecode,p->fragmentbytecode);
+			p->vertexbytecode.clear();
+			p->fragmentbytecode.clear();
+			p->vertexprogram = "";
+			p->fragmentprogram = "";
+			break;
+		}
+		case RENDER_DELETEPROGRAM:
+		{
+			Program3D* p = action.dataobject->as<Program3D>();
+			if (p->gpu_program != UINT32_MAX)
+				softwarerenderer->deleteProgram(p->gpu_program);
+			p->gpu_program = UINT32_MAX;
+			break;
+		}
+		case RENDER_RENDERTOBACKBUFFER:
+			softwarerenderer->setRenderTarget(UINT32_MAX,false);
+			renderingToTexture = false;
+			break;
+		case RENDER_TOTEXTURE:
+		{
+			TextureBase* tex = action.dataobject->as<TextureBase>();
+			if (tex->textureID == UINT32_MAX)
+				loadSoftwareTexture(tex,UINT32_MAX,UINT32_MAX);
+			enableDepthAndStencilTextureBuffer = action.udata1;
+			softwarerenderer->setRenderTarget(tex->textureID,action.udata1);
+			renderingToTexture = true;
+			break;
+		}
+		case RENDER_SETVERTEXBUFFER:
+			if (action.udata2 == UINT32_MAX)
+			{
+				VertexBuffer3D* buffer = action.dataobject->as<VertexBuffer3D>();
+				if (buffer->bufferID == UINT32_MAX)
+				{
+					buffer->bufferID = softwarerenderer->createBuffer();
+					softwarerenderer->uploadVertexBuffer(buffer->bufferID,buffer->data.data(),buffer->numVertices*buffer->data32PerVertex);
+				}
+				action.udata2 = buffer->bufferID;
+			}
+			handleRenderAction(nullptr,action,actiondata[currentactionvector]);
+			break;
+		case RENDER_DRAWTRIANGLES:
+		{
+			if (action.udata3 == UINT32_MAX)
+			{
+				IndexBuffer3D* buffer = action.dataobject->as<IndexBuffer3D>();
+				if (buffer->bufferID == UINT32_MAX)
+				{
+					buffer->bufferID = softwarerenderer->createBuffer();
+					softwarerenderer->uploadIndexBuffer(buffer->bufferID,buffer->data.data(),buffer->data.size());
+				}
+				action.udata3 = buffer->bufferID;
+			}
+			if (!currentprogram || currentprogram->gpu_program == UINT32_MAX)
+				break;
+			softwareSampler s[CONTEXT3D_SAMPLER_COUNT];
+			for (uint32_t i = 0; i < CONTEXT3D_SAMPLER_COUNT; i++)
+			{
+				s[i].texture = samplers[i] == UINT32_MAX ? nullptr : softwarerenderer->getTexture(samplers[i]);
+				s[i].overridden = false;
+			}
+			// the sampler state of the program contains the flags of the tex instructions, possibly changed by setSamplerStateAt
+			for (auto it = currentprogram->samplerState.begin(); it != currentprogram->samplerState.end(); it++)
+			{
+				if (it->n >= CONTEXT3D_SAMPLER_COUNT)
+					continue;
+				s[it->n].filter = it->f;
+				s[it->n].wrap = it->w;
+				s[it->n].overridden = true;
+			}
+			softwarerenderer->drawTriangles(currentprogram->gpu_program,action.udata3,action.udata1,action.udata2,attribs,vertexConstants,fragmentConstants,s);
+			break;
+		}
+		case RENDER_CREATEINDEXBUFFER:
+		{
+			IndexBuffer3D* buffer = action.dataobject->as<IndexBuffer3D>();
+			if (buffer && buffer->bufferID == UINT32_MAX)
+				buffer->bufferID = softwarerenderer->createBuffer();
+			break;
+		}
+		case RENDER_UPLOADINDEXBUFFER:
+		{
+			IndexBuffer3D* buffer = action.dataobject->as<IndexBuffer3D>();
+			if (buffer->bufferID == UINT32_MAX)
+				buffer->bufferID = softwarerenderer->createBuffer();
+			softwarerenderer->uploadIndexBuffer(buffer->bufferID,buffer->data.data(),buffer->data.size());
+			break;
+		}
+		case RENDER_CREATEVERTEXBUFFER:
+		{
+			VertexBuffer3D* buffer = action.dataobject->as<VertexBuffer3D>();
+			if (buffer && buffer->bufferID == UINT32_MAX)
+				buffer->bufferID = softwarerenderer->createBuffer();
+			break;
+		}
+		case RENDER_UPLOADVERTEXBUFFER:
+		{
+			VertexBuffer3D* buffer = action.dataobject->as<VertexBuffer3D>();
+			if (buffer->bufferID == UINT32_MAX)
+				buffer->bufferID = softwarerenderer->createBuffer();
+			softwarerenderer->uploadVertexBuffer(buffer->bufferID,buffer->data.data(),buffer->numVertices*buffer->data32PerVertex);
+			break;
+		}
+		case RENDER_DELETEINDEXBUFFER:
+		{
+			IndexBuffer3D* buffer = action.dataobject->as<IndexBuffer3D>();
+			if (buffer && buffer->bufferID != UINT32_MAX)
+			{
+				softwarerenderer->deleteBuffer(buffer->bufferID);
+				buffer->bufferID = UINT32_MAX;
+			}
+			break;
+		}
+		case RENDER_DELETEVERTEXBUFFER:
+		{
+			VertexBuffer3D* buffer = action.dataobject->as<VertexBuffer3D>();
+			if (buffer && buffer->bufferID != UINT32_MAX)
+			{
+				softwarerenderer->deleteBuffer(buffer->bufferID);
+				buffer->bufferID = UINT32_MAX;
+			}
+			break;
+		}
+		case RENDER_DELETEBUFFER:
+			softwarerenderer->deleteBuffer(action.udata1);
+			break;
+		case RENDER_SETPROGRAMCONSTANTS_FROM_MATRIX:
+		case RENDER_SETPROGRAMCONSTANTS_FROM_VECTOR:
+		case RENDER_SETSAMPLERSTATE:
+			// these only change the state of the Context3D
+			handleRenderAction(nullptr,action,actiondata[currentactionvector]);
+			break;
+		case RENDER_SETTEXTUREAT:
+			if (action.udata2==UINT32_MAX)
+				action.udata2=currenttextureid;
+			samplers[action.udata1] = action.udata3 ? UINT32_MAX : action.udata2;
+			break;
+		case RENDER_SETBLENDFACTORS:
+			state.blendsrc = (BLEND_FACTOR)action.udata1;
+			state.blenddst = (BLEND_FACTOR)action.udata2;
+			break;
+		case RENDER_SETDEPTHTEST:
+			state.depthmask = action.udata1;
+			state.depthfunction = (DEPTHSTENCIL_FUNCTION)action.udata2;
+			currentdepthfunction = (DEPTHSTENCIL_FUNCTION)action.udata2;
+			break;
+		case RENDER_SETCULLING:
+			state.cullface = (TRIANGLE_FACE)action.udata1;
+			currentcullface = (TRIANGLE_FACE)action.udata1;
+			break;
+		case RENDER_GENERATETEXTURE:
+			if (!action.dataobject.isNull())
+			{
+				TextureBase* tex = action.dataobject->as<TextureBase>();
+				if (tex->textureID == UINT32_MAX)
+					loadSoftwareTexture(tex,UINT32_MAX,UINT32_MAX);
+				currenttextureid=tex->textureID;
+			}
+			break;
+		case RENDER_LOADTEXTURE:
+			loadSoftwareTexture(action.dataobject->as<TextureBase>(),action.udata1,0);
+			break;
+		case RENDER_LOADCUBETEXTURE:
+			loadSoftwareTexture(action.dataobject->as<TextureBase>(),action.udata1,action.udata2);
+			break;
+		case RENDER_SETSCISSORRECTANGLE:
+			state.scissorenabled = action.udata1;
+			for (uint32_t i = 0; i < 4; i++)
+				state.scissor[i] = action.fdata[i];
+			break;
+		case RENDER_SETCOLORMASK:
+			state.colormask = action.udata1&0x0f;
+			break;
+		case RENDER_DELETETEXTURE:
+			if (action.udata1 != UINT32_MAX)
+				softwarerenderer->deleteTexture(action.udata1);
+			break;
+		case RENDER_SETSTENCILREFERENCEVALUE:
+			state.stencilwritemask = action.udata1&0xff;
+			state.stencilreadmask = (action.udata1>>8)&0xff;
+			state.stencilref = (action.udata1>>16)&0xff;
+			state.stencilfunction = DEPTHSTENCIL_FUNCTION(action.udata2);
+			break;
+		case RENDER_SETSTENCILACTIONS:
+		{
+			TRIANGLE_FACE face = TRIANGLE_FACE(action.udata1);
+			state.stencilfunction = DEPTHSTENCIL_FUNCTION(action.udata2);
+			for (uint32_t i = 0; i < 2; i++)
+			{
+				// index 0 is the front face, 1 the back face
+				if (face == FACE_NONE || (face == FACE_FRONT && i == 1) || (face == FACE_BACK && i == 0))
+					continue;
+				state.stencilfail[i] = DEPTHSTENCIL_OP(action.udata3&0xff);
+				state.depthfail[i] = DEPTHSTENCIL_OP((action.udata3>>8)&0xff);
+				state.stencilpass[i] = DEPTHSTENCIL_OP((action.udata3>>16)&0xff);
+			}
+			break;
+		}
+	}
+}
+
+void Context3D::loadSoftwareTexture(TextureBase* tex, uint32_t level, uint32_t side)
+{
+	bool cube = tex->is<CubeTexture>();
+	uint32_t levels = cube ? tex->as<CubeTexture>()->max_miplevel : tex->maxmiplevel+1;
+	if (tex->textureID == UINT32_MAX)
+		tex->textureID = softwarerenderer->createTexture(tex->width,tex->height,cube,levels);
+	TEXTUREFORMAT format = tex->compressedformat == UNCOMPRESSED ? tex->format : TEXTUREFORMAT::COMPRESSED;
+	if (level == UINT32_MAX)
+	{
+		for (uint32_t i = 0; i < tex->bitmaparray.size(); i++)
+		{
+			if (tex->bitmaparray[i].size() > 0)
+				softwarerenderer->uploadTexture(tex->textureID,i,tex->bitmaparray[i],format);
+			tex->bitmaparray[i].clear();
+		}
+	}
+	else
+	{
+		uint32_t i = cube ? levels*side+level : level;
+		if (i < tex->bitmaparray.size() && tex->bitmaparray[i].size() > 0)
+		{
+			softwarerenderer->uploadTexture(tex->textureID,i,tex->bitmaparray[i],format);
+			tex->bitmaparray[i].clear();
+		}
+	}
+}
+
+void Context3D::flushSoftware()
+{
+	auto it = texturestoupload.begin();
+	while (it != texturestoupload.end())
+	{
+		TextureBase* tex = (*it++).getPtr();
+		loadSoftwareTexture(tex,UINT32_MAX,UINT32_MAX);
+		tex->incRef();
+		getVm(tex->getSystemState())->addEvent(_MR(tex), _MR(Class<Event>::getInstanceS(tex->getInstanceWorker(),"textureReady")));
+	}
+	texturestoupload.clear();
+	std::vector<renderaction>& pending = actions[currentactionvector];
+	for (uint32_t i = 0; i < pending.size(); i++)
+		handleSoftwareRenderAction(pending[i]);
+	pending.clear();
+	actiondata[currentactionvector].clear();
+}
+
 void Context3D::disposeintern()
 {
 	Locker l(rendermutex);
+	if (translationCacheHits || translationCacheMisses || linkCacheHits || linkCacheMisses)
+		LOG(LOG_INFO,"Context3D program cache: translation hits:"<<translationCacheHits<<" misses:"<<translationCacheMisses<<" link hits:"<<linkCacheHits<<" misses:"<<linkCacheMisses);
+	translationCacheHits = translationCacheMisses = linkCacheHits = linkCacheMisses = 0;
+	if (stateChangesSubmitted || stateChangesElided)
+		LOG(LOG_INFO,"Context3D state changes: submitted:"<<stateChangesSubmitted<<" elided:"<<stateChangesElided);
+	stateChangesSubmitted = stateChangesElided = 0;
+	translatedPrograms.clear();
+	if (softwarerenderer)
+	{
+		delete softwarerenderer;
+		softwarerenderer = nullptr;
+	}
 	RenderThread* r = getSystemState()->getRenderThread();
 	if (r)
 	{
@@ -717,6 +1198,24 @@ void Context3D::disposeintern()
 	this->backframebufferID[0] = UINT32_MAX;
 	this->backframebufferID[1] = UINT32_MAX;
 	
+	// the gl programs are deleted by the render thread, shared programs only once
+	for (auto it = programlist.begin(); it != programlist.end(); it++)
+	{
+		Program3D* p = *it;
+		if (r && p->gpu_program != UINT32_MAX && !p->linkedhash)
+			r->addDeletedProgram(p->gpu_program);
+		p->gpu_program = UINT32_MAX;
+		p->linkedhash = 0;
+		p->resetRegisterIDs();
+	}
+	for (auto it = linkedPrograms.begin(); it != linkedPrograms.end(); it++)
+	{
+		if (r)
+			r->addDeletedProgram(it->second.gpu_program);
+	}
+	linkedPrograms.clear();
+	uploadedConstantSerial.clear();
+	boundprogram = UINT32_MAX;
 	while (!programlist.empty())
 	{
 		auto it = programlist.begin();
@@ -746,6 +1245,27 @@ void Context3D::disposeintern()
 bool Context3D::renderImpl(RenderContext &ctxt)
 {
 	Locker l(rendermutex);
+	if (softwarerenderer)
+	{
+		// the frame has already been rendered in present(), it only has to be uploaded for the stage
+		if (!swapbuffers)
+			return false;
+		swapbuffers = false;
+		uint32_t w,h;
+		const std::vector<uint8_t>& frame = softwarerenderer->getPresented(w,h);
+		if (frame.empty())
+			return false;
+		EngineData* engineData = getSystemState()->getEngineData();
+		if (backframebufferID[0] == UINT32_MAX)
+			engineData->exec_glGenTextures(1,&backframebufferID[0]);
+		engineData->exec_glBindTexture_GL_TEXTURE_2D(backframebufferID[0]);
+		engineData->exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_MIN_FILTER_GL_NEAREST();
+		engineData->exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_MAG_FILTER_GL_NEAREST();
+		engineData->exec_glTexImage2D_GL_TEXTURE_2D_GL_UNSIGNED_INT_8_8_8_8_HOST(0,w,h,0,frame.data());
+		engineData->exec_glBindTexture_GL_TEXTURE_2D(0);
+		backframebufferIDcurrent=backframebufferID[0];
+		return true;
+	}
 	auto it = texturestoupload.begin();
 	while (it != texturestoupload.end())
 	{
@@ -772,8 +1292,13 @@ bool Context3D::renderImpl(RenderContext &ctxt)
 		engineData->exec_glFramebufferTexture2D_GL_FRAMEBUFFER(backframebufferID[currentactionvector]);
 		engineData->exec_glViewport(0,0,this->backBufferWidth,this->backBufferHeight);
 	}
+	// the GL state may have been changed by the stage rendering since the last frame
+	resetStateCache();
 	if (currentprogram)
+	{
 		engineData->exec_glUseProgram(currentprogram->gpu_program);
+		boundprogram = currentprogram->gpu_program;
+	}
 	if (enableDepthAndStencilBackbuffer)
 	{
 		engineData->exec_glEnable_GL_DEPTH_TEST();
@@ -795,10 +1320,11 @@ bool Context3D::renderImpl(RenderContext &ctxt)
 	for (uint32_t i = 0; i < actions[1-currentactionvector].size(); i++)
 	{
 		renderaction& action = actions[1-currentactionvector][i];
-		handleRenderAction(engineData,action);
+		handleRenderAction(engineData,action,actiondata[1-currentactionvector]);
 	}
 
 	// cleanup for stage rendering
+	disableUnusedAttribs(engineData,true);
 	engineData->exec_glClearDepthf(1.0);
 	engineData->exec_glClearStencil(0);
 	engineData->exec_glStencilMask(0xff);
@@ -808,6 +1334,7 @@ bool Context3D::renderImpl(RenderContext &ctxt)
 	engineData->exec_glBindBuffer_GL_ELEMENT_ARRAY_BUFFER(0);
 	engineData->exec_glBindBuffer_GL_ARRAY_BUFFER(0);
 	engineData->exec_glUseProgram(0);
+	boundprogram = UINT32_MAX;
 	if (renderingToTexture)
 	{
 		engineData->exec_glBindFramebuffer_GL_FRAMEBUFFER(0);
@@ -818,6 +1345,7 @@ bool Context3D::renderImpl(RenderContext &ctxt)
 		renderingToTexture = false;
 	}
 	actions[1-currentactionvector].clear();
+	actiondata[1-currentactionvector].clear();
 	backframebufferIDcurrent=backframebufferID[currentactionvector];
 	swapbuffers = false;
 	return true;
@@ -826,6 +1354,7 @@ bool Context3D::renderImpl(RenderContext &ctxt)
 void Context3D::loadTexture(TextureBase *tex, uint32_t level)
 {
 	EngineData* engineData = getSystemState()->getEngineData();
+	invalidateSamplerCache();
 	bool newtex = tex->textureID == UINT32_MAX;
 	if (newtex)
 		engineData->exec_glGenTextures(1, &(tex->textureID));
@@ -856,6 +1385,7 @@ void Context3D::loadTexture(TextureBase *tex, uint32_t level)
 void Context3D::loadCubeTexture(CubeTexture *tex, uint32_t miplevel, uint32_t side)
 {
 	EngineData* engineData = getSystemState()->getEngineData();
+	invalidateSamplerCache();
 	if (tex->textureID == UINT32_MAX)
 		engineData->exec_glGenTextures(1, &(tex->textureID));
 	engineData->exec_glBindTexture_GL_TEXTURE_CUBE_MAP(tex->textureID);
@@ -900,13 +1430,21 @@ void Context3D::loadCubeTexture(CubeTexture *tex, uint32_t miplevel, uint32_t si
 	engineData->exec_glBindTexture_GL_TEXTURE_2D(0);
 }
 
-void Context3D::init(Stage3D* s)
+void Context3D::init(Stage3D* s, bool software)
 {
 	stage3D = s;
 	EngineData* engineData = getSystemState()->getEngineData();
-	driverInfo = engineData->driverInfoString;
-	maxBackBufferWidth = engineData->maxTextureSize;;
-	maxBackBufferHeight = engineData->maxTextureSize;;
+	if (software || Config::getConfig()->isStage3DSoftwareRenderingEnabled() || !engineData)
+	{
+		softwarerenderer = new SoftwareRenderer3D(getSystemState(),Config::getConfig()->getStage3DRenderThreads());
+		driverInfo = "Software";
+	}
+	else
+	{
+		driverInfo = engineData->driverInfoString;
+		maxBackBufferWidth = engineData->maxTextureSize;;
+		maxBackBufferHeight = engineData->maxTextureSize;;
+	}
 	
 	stage3D->incRef();
 	getVm(getSystemState())->addEvent(_MR(stage3D),_MR(Class<Event>::getInstanceS(getInstanceWorker(),"context3DCreate")));
@@ -964,6 +1502,8 @@ void Context3D::configureBackBufferIntern(bool enableDepthAndStencil, uint32_t w
 
 Context3D::Context3D(ASWorker* wrk, Class_base *c):EventDispatcher(wrk,c),samplers{UINT32_MAX,UINT32_MAX,UINT32_MAX,UINT32_MAX,UINT32_MAX,UINT32_MAX,UINT32_MAX,UINT32_MAX},currentactionvector(0)
   ,currentprogram(nullptr),currenttextureid(UINT32_MAX)
+  ,boundprogram(UINT32_MAX),boundindexbuffer(UINT32_MAX),constantserial(1),positionscaleserial(1),stateChangesSubmitted(0),stateChangesElided(0)
+  ,translationCacheHits(0),translationCacheMisses(0),linkCacheHits(0),linkCacheMisses(0),softwarerenderer(nullptr)
   ,renderingToTexture(false),enableDepthAndStencilBackbuffer(true),enableDepthAndStencilTextureBuffer(true),swapbuffers(false)
   ,currentcullface(TRIANGLE_FACE::FACE_NONE),currentdepthfunction(DEPTHSTENCIL_FUNCTION::DEPTHSTENCIL_LESS)
   ,currentstencilfunction(DEPTHSTENCIL_FUNCTION::DEPTHSTENCIL_ALWAYS), currentstencilref(0xff), currentstencilmask(0xff)
@@ -982,11 +1522,42 @@ Context3D::Context3D(ASWorker* wrk, Class_base *c):EventDispatcher(wrk,c),sample
 	backDepthRenderBuffer[1]=UINT32_MAX;
 	backStencilRenderBuffer[0]=UINT32_MAX;
 	backStencilRenderBuffer[1]=UINT32_MAX;
+	for (uint32_t i = 0; i < CONTEXT3D_PROGRAM_REGISTERS; i++)
+	{
+		vertexConstantSerial[i]=1;
+		fragmentConstantSerial[i]=1;
+	}
+	resetStateCache();
+}
+
+void Context3D::resetStateCache()
+{
+	invalidateSamplerCache();
+	invalidateBufferCache();
+	for (uint32_t i = 0; i < CONTEXT3D_TRACKED_ATTRIBUTES; i++)
+	{
+		boundattributes[i].enabled = false;
+		boundattributes[i].used = false;
+	}
+	boundprogram = UINT32_MAX;
+}
+void Context3D::invalidateSamplerCache()
+{
+	for (uint32_t i = 0; i < CONTEXT3D_SAMPLER_COUNT; i++)
+		boundsamplers[i].textureID = UINT32_MAX;
+}
+void Context3D::invalidateBufferCache()
+{
+	// buffer ids may be reused after deletion, so the attribute pointers have to be set again
+	boundindexbuffer = UINT32_MAX;
+	for (uint32_t i = 0; i < CONTEXT3D_TRACKED_ATTRIBUTES; i++)
+		boundattributes[i].bufferID = UINT32_MAX;
 }
 
 void Context3D::addAction(RENDER_ACTION type, ASObject *dataobject)
 {
-	if (!getSystemState()->getRenderThread()->isStarted())
+	// the software renderer executes the actions without the render thread
+	if (!softwarerenderer && !getSystemState()->getRenderThread()->isStarted())
 		return;
 	renderaction action;
 	action.action = type;
@@ -1000,8 +1571,18 @@ void Context3D::addAction(RENDER_ACTION type, ASObject *dataobject)
 
 void Context3D::addAction(renderaction action)
 {
-	if (!getSystemState()->getRenderThread() || !getSystemState()->getRenderThread()->isStarted())
+	if (!softwarerenderer && (!getSystemState()->getRenderThread() || !getSystemState()->getRenderThread()->isStarted()))
+		return;
+	actions[currentactionvector].push_back(action);
+}
+
+void Context3D::addAction(renderaction action, const float* data, uint32_t count)
+{
+	if (!softwarerenderer && (!getSystemState()->getRenderThread() || !getSystemState()->getRenderThread()->isStarted()))
 		return;
+	std::vector<float>& d = actiondata[currentactionvector];
+	action.dataoffset = d.size();
+	d.insert(d.end(),data,data+count);
 	actions[currentactionvector].push_back(action);
 }
 
@@ -1119,7 +1700,11 @@ ASFUNCTIONBODY_GETTER_SETTER(Context3D,maxBackBufferWidth)
 
 ASFUNCTIONBODY_ATOM(Context3D,getProfile)
 {
-	ret = asAtomHandler::fromStringID(wrk->getSystemState()->getEngineData()->context3dProfile);
+	EngineData* engineData = wrk->getSystemState()->getEngineData();
+	if (engineData)
+		ret = asAtomHandler::fromStringID(engineData->context3dProfile);
+	else
+		ret = asAtomHandler::fromString(wrk->getSystemState(),"baseline");
 }
 ASFUNCTIONBODY_ATOM(Context3D,supportsVideoTexture)
 {
@@ -1284,9 +1869,43 @@ ASFUNCTIONBODY_ATOM(Context3D,clear)
 
 ASFUNCTIONBODY_ATOM(Context3D,drawToBitmapData)
 {
-	LOG(LOG_NOT_IMPLEMENTED,"Context3D.drawToBitmapData does nothing");
+	Context3D* th = asAtomHandler::as<Context3D>(obj);
 	_NR<BitmapData> destination;
 	ARG_CHECK(ARG_UNPACK(destination));
+	if (destination.isNull())
+	{
+		createError<TypeError>(wrk,kNullArgumentError);
+		return;
+	}
+	if (!th->softwarerenderer)
+	{
+		LOG(LOG_NOT_IMPLEMENTED,"Context3D.drawToBitmapData is only available with the software renderer");
+		return;
+	}
+	if (destination->getBitmapContainer().isNull())
+	{
+		createError<ArgumentError>(wrk,2015,"Disposed BitmapData");
+		return;
+	}
+	Locker l(th->rendermutex);
+	th->flushSoftware();
+	uint32_t w,h;
+	const uint8_t* data = th->softwarerenderer->getBackBuffer(w,h);
+	_NR<BitmapContainer> pixels = destination->getBitmapContainer();
+	uint32_t dw = min(w,uint32_t(pixels->getWidth()));
+	uint32_t dh = min(h,uint32_t(pixels->getHeight()));
+	for (uint32_t y = 0; y < dh; y++)
+	{
+		for (uint32_t x = 0; x < dw; x++)
+		{
+			const uint8_t* p = data+(y*w+x)*4;
+			uint32_t color = uint32_t(p[0]) | uint32_t(p[1])<<8 | uint32_t(p[2])<<16 | uint32_t(p[3])<<24;
+			if (!destination->transparent)
+				color |= 0xff000000;
+			pixels->setPixel(x,y,color,true,true);
+		}
+	}
+	destination->notifyUsers();
 }
 
 ASFUNCTIONBODY_ATOM(Context3D,drawTriangles)
@@ -1520,12 +2139,12 @@ ASFUNCTIONBODY_ATOM(Context3D,setProgramConstantsFromVector)
 				createError<RangeError>(wrk,kOutOfRangeError,"Constant Register Out Of Bounds");
 				return;
 			}
+			float values[CONTEXT3D_PROGRAM_REGISTERS*4];
 			for (uint32_t i = 0; i < action.udata3*4; i++)
 			{
-				asAtom a = data->at(i);
-				action.fdata[i] = asAtomHandler::toNumber(a);
+				values[i] = data->atNumber(i);
 			}
-			th->addAction(action);
+			th->addAction(action,values,action.udata3*4);
 		}
 	}
 }
@@ -1653,11 +2272,22 @@ ASFUNCTIONBODY_ATOM(Context3D,present)
 {
 	Context3D* th = asAtomHandler::as<Context3D>(obj);
 	Locker l(th->rendermutex);
+	if (th->softwarerenderer)
+	{
+		th->flushSoftware();
+		th->softwarerenderer->present();
+		th->swapbuffers = true;
+		RenderThread* r = wrk->getSystemState()->getRenderThread();
+		if (r && r->isStarted())
+			r->draw(false);
+		return;
+	}
 	if (th->swapbuffers)
 	{
 		if (wrk->getSystemState()->getRenderThread()->isStarted() && !th->actions[th->currentactionvector].empty())
 			LOG(LOG_ERROR,"last frame has not been rendered yet, skipping frame:"<<th->actions[1-th->currentactionvector].size());
 		th->actions[th->currentactionvector].clear();
+		th->actiondata[th->currentactionvector].clear();
 	}
 	else
 	{
@@ -2109,8 +2739,7 @@ ASFUNCTIONBODY_ATOM(IndexBuffer3D,uploadFromVector)
 		th->data.resize(count+startOffset);
 	for (uint32_t i = 0; i< count; i++)
 	{
-		asAtom a = data->at(i);
-		th->data[startOffset+i] = asAtomHandler::toUInt(a);
+		th->data[startOffset+i] = data->atUInt(i);
 	}
 	th->context->addAction(RENDER_ACTION::RENDER_UPLOADINDEXBUFFER,th);
 	th->context->rendermutex.unlock();
@@ -2123,6 +2752,38 @@ void Program3D::sinit(Class_base *c)
 	c->setDeclaredMethodByQName("upload","",c->getSystemState()->getBuiltinFunction(upload),NORMAL_METHOD,true);
 }
 
+void Program3D::resetRegisterIDs()
+{
+	for (auto it = samplerState.begin();it != samplerState.end(); it++)
+		it->program_sampler_id = UINT32_MAX;
+	for (auto it = vertexregistermap.begin();it != vertexregistermap.end(); it++)
+		it->program_register_id = UINT32_MAX;
+	for (auto it = fragmentregistermap.begin();it != fragmentregistermap.end(); it++)
+		it->program_register_id = UINT32_MAX;
+	for (auto it = vertexattributes.begin();it != vertexattributes.end(); it++)
+		it->program_register_id = UINT32_MAX;
+	for (auto it = fragmentattributes.begin();it != fragmentattributes.end(); it++)
+		it->program_register_id = UINT32_MAX;
+	vcPositionScale = UINT32_MAX;
+}
+// FNV-1a hash over the AGAL bytecode of both programs
+static uint64_t hashProgramBytecode(ByteArray* vertexProgram, ByteArray* fragmentProgram)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	const uint8_t* buf = vertexProgram->getBufferNoCheck();
+	for (uint32_t i = 0; i < vertexProgram->getLength(); i++)
+		h = (h ^ buf[i]) * 0x100000001b3ULL;
+	buf = fragmentProgram->getBufferNoCheck();
+	for (uint32_t i = 0; i < fragmentProgram->getLength(); i++)
+		h = (h ^ buf[i]) * 0x100000001b3ULL;
+	// 0 marks uncached programs
+	return h ? h : 1;
+}
+static bool isSameBytecode(const std::vector<uint8_t>& cached, ByteArray* program)
+{
+	return cached.size() == program->getLength()
+			&& (cached.empty() || memcmp(cached.data(),program->getBufferNoCheck(),cached.size())==0);
+}
 ASFUNCTIONBODY_ATOM(Program3D,dispose)
 {
 	Program3D* th = asAtomHandler::as<Program3D>(obj);
@@ -2141,6 +2802,48 @@ ASFUNCTIONBODY_ATOM(Program3D,upload)
 	_NR<ByteArray> fragmentProgram;
 	ARG_CHECK(ARG_UNPACK(vertexProgram)(fragmentProgram));
 	th->context->rendermutex.lock();
+	th->programhash = 0;
+	uint64_t hash = 0;
+	if (th->context->softwarerenderer)
+	{
+		th->vertexbytecode.clear();
+		th->fragmentbytecode.clear();
+		if (!vertexProgram.isNull())
+			th->vertexbytecode.assign(vertexProgram->getBufferNoCheck(),vertexProgram->getBufferNoCheck()+vertexProgram->getLength());
+		if (!fragmentProgram.isNull())
+			th->fragmentbytecode.assign(fragmentProgram->getBufferNoCheck(),fragmentProgram->getBufferNoCheck()+fragmentProgram->getLength());
+	}
+	// only pairs of AGAL programs are cached, embedded GLSL shaders don't provide register maps
+	if (!vertexProgram.isNull() && !fragmentProgram.isNull()
+			&& vertexProgram->getLength() && vertexProgram->getBufferNoCheck()[0] == 0xA0
+			&& fragmentProgram->getLength() && fragmentProgram->getBufferNoCheck()[0] == 0xA0)
+	{
+		hash = hashProgramBytecode(vertexProgram.getPtr(),fragmentProgram.getPtr());
+		auto it = th->context->translatedPrograms.find(hash);
+		if (it != th->context->translatedPrograms.end())
+		{
+			Context3D::translatedProgram& tp = it->second;
+			if (isSameBytecode(tp.vertexbytecode,vertexProgram.getPtr()) && isSameBytecode(tp.fragmentbytecode,fragmentProgram.getPtr()))
+			{
+				th->vertexprogram = tp.vertexprogram;
+				th->fragmentprogram = tp.fragmentprogram;
+				th->samplerState = tp.samplerState;
+				th->vertexregistermap = tp.vertexregistermap;
+				th->vertexattributes = tp.vertexattributes;
+				th->fragmentregistermap = tp.fragmentregistermap;
+				th->fragmentattributes = tp.fragmentattributes;
+				th->programhash = hash;
+				th->context->translationCacheHits++;
+				th->context->addAction(RENDER_ACTION::RENDER_UPLOADPROGRAM,th);
+				th->context->rendermutex.unlock();
+				return;
+			}
+			// hash collision, the program is not cached
+			hash = 0;
+		}
+		else if (th->context->translatedPrograms.size() >= CONTEXT3D_PROGRAM_CACHESIZE)
+			hash = 0;
+	}
 	th->samplerState.clear();
 	RegisterMap vertexregistermap; // this is needed to keep track of the registers when creating the fragment program
 	if (!vertexProgram.isNull())
@@ -2153,6 +2856,21 @@ ASFUNCTIONBODY_ATOM(Program3D,upload)
 		th->fragmentprogram = AGALtoGLSL(fragmentProgram.getPtr(),false,th->samplerState,th->fragmentregistermap,th->fragmentattributes,vertexregistermap);
 		// LOG(LOG_INFO,"fragment shader:"<<th<<"\n"<<th->fragmentprogram);
 	}
+	if (hash && !th->vertexprogram.empty() && !th->fragmentprogram.empty())
+	{
+		Context3D::translatedProgram& tp = th->context->translatedPrograms[hash];
+		tp.vertexbytecode.assign(vertexProgram->getBufferNoCheck(),vertexProgram->getBufferNoCheck()+vertexProgram->getLength());
+		tp.fragmentbytecode.assign(fragmentProgram->getBufferNoCheck(),fragmentProgram->getBufferNoCheck()+fragmentProgram->getLength());
+		tp.vertexprogram = th->vertexprogram;
+		tp.fragmentprogram = th->fragmentprogram;
+		tp.samplerState = th->samplerState;
+		tp.vertexregistermap = th->vertexregistermap;
+		tp.vertexattributes = th->vertexattributes;
+		tp.fragmentregistermap = th->fragmentregistermap;
+		tp.fragmentattributes = th->fragmentattributes;
+		th->programhash = hash;
+		th->context->translationCacheMisses++;
+	}
 	th->context->addAction(RENDER_ACTION::RENDER_UPLOADPROGRAM,th);
 	th->context->rendermutex.unlock();
 }
@@ -2248,8 +2966,7 @@ ASFUNCTIONBODY_ATOM(VertexBuffer3D,uploadFromVector)
 		th->data.resize((numVertices+startVertex)* th->data32PerVertex);
 	for (uint32_t i = 0; i< numVertices* th->data32PerVertex; i++)
 	{
-		asAtom a = data->at(i);
-		th->data[startVertex*th->data32PerVertex+i] = asAtomHandler::toNumber(a);
+		th->data[startVertex*th->data32PerVertex+i] = data->atNumber(i);
 	}
 	th->context->addAction(RENDER_ACTION::RENDER_UPLOADVERTEXBUFFER,th);
 	th->context->rendermutex.unlock();
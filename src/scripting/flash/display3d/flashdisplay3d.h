@@ -25,6 +25,7 @@
 #include "scripting/flash/events/flashevents.h"
 #include "scripting/flash/display3d/flashdisplay3dtextures.h"
 #include <map>
+#include <unordered_map>
 
 enum RegisterType {
 	ATTRIBUTE = 0,
@@ -93,6 +94,10 @@ struct RegisterMapEntry
 #define CONTEXT3D_SAMPLER_COUNT 8
 #define CONTEXT3D_ATTRIBUTE_COUNT 8
 #define CONTEXT3D_PROGRAM_REGISTERS 128
+// maximum number of AGAL program pairs whose GLSL translation is cached per Context3D
+#define CONTEXT3D_PROGRAM_CACHESIZE 256
+// number of vertex attribute locations whose OpenGL state is tracked to skip redundant calls
+#define CONTEXT3D_TRACKED_ATTRIBUTES 16
 
 namespace lightspark
 {
@@ -101,6 +106,7 @@ class VertexBuffer3D;
 class Program3D;
 class Stage3D;
 class EngineData;
+class SoftwareRenderer3D;
 
 enum RENDER_ACTION { RENDER_CLEAR,RENDER_CONFIGUREBACKBUFFER,RENDER_RENDERTOBACKBUFFER,RENDER_TOTEXTURE,
 					 RENDER_SETPROGRAM,RENDER_UPLOADPROGRAM,RENDER_DELETEPROGRAM,
@@ -117,9 +123,10 @@ struct renderaction
 	uint32_t udata1;
 	uint32_t udata2;
 	uint32_t udata3;
-	float fdata[CONTEXT3D_PROGRAM_REGISTERS*4];
+	uint32_t dataoffset;// position of larger payloads (constant vectors) in the float data of the action list
+	float fdata[16];// small payloads, up to one 4x4 matrix
 	_NR<ASObject> dataobject;
-	renderaction():udata1(0),udata2(0),udata3(0),fdata{0} {}
+	renderaction():udata1(0),udata2(0),udata3(0),dataoffset(0),fdata{0} {}
 };
 struct constantregister
 {
@@ -137,8 +144,10 @@ struct attribregister
 class Context3D: public EventDispatcher
 {
 friend class Stage3D;
+friend class Program3D;
 private:
 	std::vector<renderaction> actions[2];
+	std::vector<float> actiondata[2];
 	std::vector<_NR<TextureBase>> texturestoupload;
 	constantregister vertexConstants[CONTEXT3D_PROGRAM_REGISTERS];
 	constantregister fragmentConstants[CONTEXT3D_PROGRAM_REGISTERS];
@@ -164,13 +173,81 @@ private:
 	DEPTHSTENCIL_FUNCTION currentstencilfunction;
 	uint32_t currentstencilref;
 	uint32_t currentstencilmask;
-	void handleRenderAction(EngineData *engineData, renderaction &action);
-	void setRegisters(EngineData *engineData, std::vector<RegisterMapEntry> &registermap, constantregister *constants, bool isVertex);
+	void handleRenderAction(EngineData *engineData, renderaction &action, const std::vector<float>& data);
+	void setRegisters(EngineData *engineData, std::vector<RegisterMapEntry> &registermap, constantregister *constants, bool isVertex, uint64_t uploadedserial);
 	void setAttribs(EngineData* engineData, std::vector<RegisterMapEntry> &attributes);
 	void resetAttribs(EngineData* engineData, std::vector<RegisterMapEntry> &attributes);
 	void setSamplers(EngineData* engineData);
 	void setPositionScale(EngineData *engineData);
+	// OpenGL state set by the last draw calls, used to skip redundant state changes
+	struct boundSampler
+	{
+		uint32_t textureID;
+		int32_t b;
+		int32_t d;
+		int32_t f;
+		int32_t m;
+		int32_t w;
+	};
+	struct boundAttribute
+	{
+		uint32_t bufferID;
+		uint32_t data32PerVertex;
+		uint32_t offset;
+		VERTEXBUFFER_FORMAT format;
+		bool enabled;
+		bool used;// used by the current draw call
+	};
+	boundSampler boundsamplers[CONTEXT3D_SAMPLER_COUNT];
+	boundAttribute boundattributes[CONTEXT3D_TRACKED_ATTRIBUTES];
+	uint32_t boundprogram;
+	uint32_t boundindexbuffer;
+	// every change of a constant register gets a new serial, so only registers changed since the last draw with a program are uploaded
+	uint64_t constantserial;
+	uint64_t positionscaleserial;
+	uint64_t vertexConstantSerial[CONTEXT3D_PROGRAM_REGISTERS];
+	uint64_t fragmentConstantSerial[CONTEXT3D_PROGRAM_REGISTERS];
+	// serial of the constants last uploaded to a gpu program
+	std::unordered_map<uint32_t,uint64_t> uploadedConstantSerial;
+	uint32_t stateChangesSubmitted;
+	uint32_t stateChangesElided;
+	void resetStateCache();
+	void disableUnusedAttribs(EngineData* engineData, bool all);
+	void invalidateSamplerCache();
+	void invalidateBufferCache();
 	unordered_set<Program3D*> programlist;
+	// GLSL translations of AGAL programs, keyed by the hash of the vertex and fragment bytecode
+	struct translatedProgram
+	{
+		std::vector<uint8_t> vertexbytecode;
+		std::vector<uint8_t> fragmentbytecode;
+		tiny_string vertexprogram;
+		tiny_string fragmentprogram;
+		std::vector<SamplerRegister> samplerState;
+		std::vector<RegisterMapEntry> vertexregistermap;
+		std::vector<RegisterMapEntry> vertexattributes;
+		std::vector<RegisterMapEntry> fragmentregistermap;
+		std::vector<RegisterMapEntry> fragmentattributes;
+	};
+	// linked gpu programs shared by all Program3D objects uploaded with the same bytecode
+	struct linkedProgram
+	{
+		uint32_t gpu_program;
+		uint32_t refcount;
+	};
+	std::unordered_map<uint64_t,translatedProgram> translatedPrograms;
+	std::unordered_map<uint64_t,linkedProgram> linkedPrograms;
+	uint32_t translationCacheHits;
+	uint32_t translationCacheMisses;
+	uint32_t linkCacheHits;
+	uint32_t linkCacheMisses;
+	void releaseProgram(EngineData *engineData, Program3D* p);
+	// CPU renderer used instead of OpenGL, nullptr if the OpenGL backend is used
+	SoftwareRenderer3D* softwarerenderer;
+	void handleSoftwareRenderAction(renderaction &action);
+	void loadSoftwareTexture(TextureBase* tex, uint32_t level, uint32_t side);
+	// executes all pending actions with the software renderer, has to be called with the rendermutex held
+	void flushSoftware();
 	unordered_set<TextureBase*> texturelist;
 	unordered_set<IndexBuffer3D*> indexbufferlist;
 	unordered_set<VertexBuffer3D*> vectorbufferlist;
@@ -181,7 +258,8 @@ protected:
 	bool renderImpl(RenderContext &ctxt);
 	void loadTexture(TextureBase* tex, uint32_t level);
 	void loadCubeTexture(CubeTexture* tex, uint32_t miplevel, uint32_t side);
-	void init(Stage3D* s);
+	// software forces the software renderer (Context3DRenderMode.SOFTWARE)
+	void init(Stage3D* s, bool software=false);
 	public:
 	Mutex rendermutex;
 	Context3D(ASWorker* wrk,Class_base* c);
@@ -193,6 +271,8 @@ protected:
 
 	void addAction(RENDER_ACTION type, ASObject* dataobject);
 	void addAction(renderaction action);
+	// the data is stored in the float data of the action list and is available at action.dataoffset
+	void addAction(renderaction action, const float* data, uint32_t count);
 	void addTextureToUpload(TextureBase* tex)
 	{
 		tex->incRef();
@@ -360,19 +440,25 @@ friend class Context3D;
 private:
 	Context3D* context;
 	uint32_t gpu_program;
+	uint64_t programhash;// hash of the uploaded bytecode, 0 if the program is not cached
+	uint64_t linkedhash;// hash of the shared gpu_program, 0 if gpu_program is owned by this program
 protected:
 	uint32_t vcPositionScale;
 	tiny_string vertexprogram;
 	tiny_string fragmentprogram;
+	// AGAL bytecode kept until it is decoded by the software renderer
+	std::vector<uint8_t> vertexbytecode;
+	std::vector<uint8_t> fragmentbytecode;
 	std::vector<SamplerRegister> samplerState;
 	std::vector<RegisterMapEntry> vertexregistermap;
 	std::vector<RegisterMapEntry> vertexattributes;
 	std::vector<RegisterMapEntry> fragmentregistermap;
 	std::vector<RegisterMapEntry> fragmentattributes;
 	bool disposed;
+	void resetRegisterIDs();
 public:
-	Program3D(ASWorker* wrk,Class_base* c):ASObject(wrk,c,T_OBJECT,SUBTYPE_PROGRAM3D),gpu_program(UINT32_MAX),vcPositionScale(UINT32_MAX),disposed(false){}
-	Program3D(ASWorker* wrk,Class_base* c,Context3D* _ct):ASObject(wrk,c,T_OBJECT,SUBTYPE_PROGRAM3D),context(_ct),gpu_program(UINT32_MAX),vcPositionScale(UINT32_MAX),disposed(false){}
+	Program3D(ASWorker* wrk,Class_base* c):ASObject(wrk,c,T_OBJECT,SUBTYPE_PROGRAM3D),gpu_program(UINT32_MAX),programhash(0),linkedhash(0),vcPositionScale(UINT32_MAX),disposed(false){}
+	Program3D(ASWorker* wrk,Class_base* c,Context3D* _ct):ASObject(wrk,c,T_OBJECT,SUBTYPE_PROGRAM3D),context(_ct),gpu_program(UINT32_MAX),programhash(0),linkedhash(0),vcPositionScale(UINT32_MAX),disposed(false){}
 	static void sinit(Class_base* c);
 	ASFUNCTION_ATOM(dispose);
 	ASFUNCTION_ATOM(upload);
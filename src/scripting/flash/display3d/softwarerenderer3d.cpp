@@ -0,0 +1,1116 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include "scripting/flash/display3d/softwarerenderer3d.h"
+#include "interfaces/threading.h"
+#include "threading.h"
+#include "logger.h"
+#include "swf.h"
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <SDL.h>
+
+using namespace lightspark;
+using namespace std;
+
+// minimum number of pixels covered by the bounding boxes of a draw call before the bands are rasterized in parallel
+#define SOFTWARE3D_PARALLEL_THRESHOLD 16384
+
+static const float zeroRegister[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+bool agalProgram::decode(const std::vector<uint8_t>& bytecode, bool vertex)
+{
+	code.clear();
+	isVertexProgram = vertex;
+	usesKill = false;
+	varyingcount = 0;
+	// magic byte, version, shader type id and shader type
+	if (bytecode.size() < 7 || bytecode[0] != 0xA0 || bytecode[5] != 0xA1)
+	{
+		LOG(LOG_ERROR,"software Stage3D: program is not valid AGAL bytecode");
+		return false;
+	}
+	if ((bytecode[6] == 0) != vertex)
+		LOG(LOG_ERROR,"software Stage3D: AGAL program has wrong shader type");
+	const uint8_t* p = bytecode.data()+7;
+	const uint8_t* end = bytecode.data()+bytecode.size();
+	while (p+24 <= end)
+	{
+		uint32_t opcode = uint32_t(p[0]) | uint32_t(p[1])<<8 | uint32_t(p[2])<<16 | uint32_t(p[3])<<24;
+		uint32_t dest = uint32_t(p[4]) | uint32_t(p[5])<<8 | uint32_t(p[6])<<16 | uint32_t(p[7])<<24;
+		uint64_t src[2];
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			src[i]=0;
+			for (uint32_t j = 0; j < 8; j++)
+				src[i] |= uint64_t(p[8+i*8+j])<<(j*8);
+		}
+		p += 24;
+		agalInstruction ins;
+		ins.opcode = opcode;
+		ins.desttype = (dest >> 24) & 0xF;
+		ins.destmask = (dest >> 16) & 0xF;
+		ins.destn = dest & 0xFFFF;
+		agalSource* s[2] = { &ins.src1, &ins.src2 };
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			s[i]->indirect = (src[i] >> 63) & 1;
+			s[i]->q = (src[i] >> 48) & 0x3;
+			s[i]->itype = (src[i] >> 40) & 0xF;
+			s[i]->type = (src[i] >> 32) & 0xF;
+			s[i]->swizzle = (src[i] >> 24) & 0xFF;
+			s[i]->o = (src[i] >> 16) & 0xFF;
+			s[i]->n = src[i] & 0xFFFF;
+		}
+		ins.samplerfilter = (src[1] >> 60) & 0xF;
+		ins.samplermipmap = (src[1] >> 56) & 0xF;
+		ins.samplerwrap = ((src[1] >> 52) & 0xF) ? 3 : 0;
+		ins.samplerdimension = (src[1] >> 44) & 0xF;
+		ins.samplern = src[1] & 0xFFFF;
+		if (opcode == 0x27)
+			usesKill = true;
+		if (vertex && ins.desttype == RegisterType::VARYING && opcode != 0x27 && ins.destn < SOFTWARE3D_VARYINGS)
+			varyingcount = max(varyingcount,uint32_t(ins.destn+1));
+		code.push_back(ins);
+	}
+	return true;
+}
+
+static inline const float* getRegister(uint32_t type, uint32_t n, const agalRegisters& r, const float (*constants)[4])
+{
+	switch (type)
+	{
+		case RegisterType::ATTRIBUTE:
+			return n < CONTEXT3D_ATTRIBUTE_COUNT ? r.attrib[n] : zeroRegister;
+		case RegisterType::CONSTANT:
+			return n < CONTEXT3D_PROGRAM_REGISTERS ? constants[n] : zeroRegister;
+		case RegisterType::TEMPORARY:
+			return n < SOFTWARE3D_TEMPORARIES ? r.temp[n] : zeroRegister;
+		case RegisterType::OUTPUT:
+			return r.output;
+		case RegisterType::VARYING:
+			return n < SOFTWARE3D_VARYINGS ? r.varying[n] : zeroRegister;
+		default:
+			return zeroRegister;
+	}
+}
+// reads the source register, offset is used for the rows of matrix operations
+static inline void readSource(const agalSource& s, uint32_t offset, const agalRegisters& r, const float (*constants)[4], float* res)
+{
+	uint32_t n = s.n;
+	if (s.indirect)
+		n = s.o + int32_t(getRegister(s.itype,s.n,r,constants)[s.q]);
+	const float* reg = getRegister(s.type,n+offset,r,constants);
+	res[0] = reg[s.swizzle & 3];
+	res[1] = reg[(s.swizzle >> 2) & 3];
+	res[2] = reg[(s.swizzle >> 4) & 3];
+	res[3] = reg[(s.swizzle >> 6) & 3];
+}
+static inline float blendFactor(BLEND_FACTOR f, uint32_t channel, const float* src, const float* dst)
+{
+	switch (f)
+	{
+		case BLEND_ONE: return 1.0;
+		case BLEND_ZERO: return 0.0;
+		case BLEND_SRC_ALPHA: return src[3];
+		case BLEND_SRC_COLOR: return src[channel];
+		case BLEND_DST_ALPHA: return dst[3];
+		case BLEND_DST_COLOR: return dst[channel];
+		case BLEND_ONE_MINUS_SRC_ALPHA: return 1.0-src[3];
+		case BLEND_ONE_MINUS_SRC_COLOR: return 1.0-src[channel];
+		case BLEND_ONE_MINUS_DST_ALPHA: return 1.0-dst[3];
+		case BLEND_ONE_MINUS_DST_COLOR: return 1.0-dst[channel];
+	}
+	return 1.0;
+}
+template<class T>
+static inline bool compareFunction(DEPTHSTENCIL_FUNCTION f, T a, T b)
+{
+	switch (f)
+	{
+		case DEPTHSTENCIL_ALWAYS: return true;
+		case DEPTHSTENCIL_EQUAL: return a == b;
+		case DEPTHSTENCIL_GREATER: return a > b;
+		case DEPTHSTENCIL_GREATER_EQUAL: return a >= b;
+		case DEPTHSTENCIL_LESS: return a < b;
+		case DEPTHSTENCIL_LESS_EQUAL: return a <= b;
+		case DEPTHSTENCIL_NEVER: return false;
+		case DEPTHSTENCIL_NOT_EQUAL: return a != b;
+	}
+	return true;
+}
+static inline uint8_t stencilOp(DEPTHSTENCIL_OP op, uint8_t value, uint8_t ref)
+{
+	switch (op)
+	{
+		case DEPTHSTENCIL_KEEP: return value;
+		case DEPTHSTENCIL_ZERO: return 0;
+		case DEPTHSTENCIL_REPLACE: return ref;
+		case DEPTHSTENCIL_INCR: return value == 0xff ? value : value+1;
+		case DEPTHSTENCIL_INCR_WRAP: return value+1;
+		case DEPTHSTENCIL_DECR: return value == 0 ? value : value-1;
+		case DEPTHSTENCIL_DECR_WRAP: return value-1;
+		case DEPTHSTENCIL_INVERT: return ~value;
+	}
+	return value;
+}
+
+static void fetchTexel(const softwareTexture* tex, const std::vector<uint8_t>& data, int32_t x, int32_t y, float* res)
+{
+	uint32_t pos = uint32_t(y)*tex->width+uint32_t(x);
+	switch (tex->format)
+	{
+		case TEXTUREFORMAT::BGRA:
+			if ((pos+1)*4 > data.size())
+				break;
+			res[0] = data[pos*4+2]/255.0;
+			res[1] = data[pos*4+1]/255.0;
+			res[2] = data[pos*4  ]/255.0;
+			res[3] = data[pos*4+3]/255.0;
+			return;
+		case TEXTUREFORMAT::BGR:
+			if ((pos+1)*3 > data.size())
+				break;
+			res[0] = data[pos*3+2]/255.0;
+			res[1] = data[pos*3+1]/255.0;
+			res[2] = data[pos*3  ]/255.0;
+			res[3] = 1.0;
+			return;
+		default:
+			break;
+	}
+	res[0] = res[1] = res[2] = res[3] = 0.0;
+}
+static inline int32_t wrapCoordinate(int32_t c, int32_t size, bool repeat)
+{
+	if (repeat)
+	{
+		c %= size;
+		return c < 0 ? c+size : c;
+	}
+	return c < 0 ? 0 : (c >= size ? size-1 : c);
+}
+static void sampleTexture(const softwareSampler& sampler, const agalInstruction& ins, const float* coords, float* res)
+{
+	const softwareTexture* tex = sampler.texture;
+	if (!tex || !tex->width || !tex->height)
+	{
+		res[0] = res[1] = res[2] = res[3] = 0.0;
+		return;
+	}
+	int32_t filter = sampler.overridden ? sampler.filter : ins.samplerfilter;
+	int32_t wrap = sampler.overridden ? sampler.wrap : ins.samplerwrap;
+	float u = coords[0];
+	float v = coords[1];
+	uint32_t side = 0;
+	if (tex->cube)
+	{
+		// select the side by the major axis of the direction, like OpenGL cube maps
+		float ax = fabsf(coords[0]), ay = fabsf(coords[1]), az = fabsf(coords[2]);
+		float sc, tc, ma;
+		if (ax >= ay && ax >= az)
+		{
+			side = coords[0] >= 0 ? 0 : 1;
+			sc = coords[0] >= 0 ? -coords[2] : coords[2];
+			tc = -coords[1];
+			ma = ax;
+		}
+		else if (ay >= az)
+		{
+			side = coords[1] >= 0 ? 2 : 3;
+			sc = coords[0];
+			tc = coords[1] >= 0 ? coords[2] : -coords[2];
+			ma = ay;
+		}
+		else
+		{
+			side = coords[2] >= 0 ? 4 : 5;
+			sc = coords[2] >= 0 ? coords[0] : -coords[0];
+			tc = -coords[1];
+			ma = az;
+		}
+		if (ma == 0)
+			ma = 1;
+		u = (sc/ma+1.0)*0.5;
+		v = (tc/ma+1.0)*0.5;
+		wrap = 0;
+	}
+	// mip levels would need screen space derivatives, so level 0 is always sampled
+	uint32_t index = side*tex->levels;
+	if (index >= tex->data.size())
+	{
+		res[0] = res[1] = res[2] = res[3] = 0.0;
+		return;
+	}
+	const std::vector<uint8_t>& data = tex->data[index];
+	int32_t w = tex->width;
+	int32_t h = tex->height;
+	if (filter == 0)
+	{
+		int32_t x = wrapCoordinate(int32_t(floorf(u*w)),w,wrap&1);
+		int32_t y = wrapCoordinate(int32_t(floorf(v*h)),h,wrap&2);
+		fetchTexel(tex,data,x,y,res);
+		return;
+	}
+	float fx = u*w-0.5;
+	float fy = v*h-0.5;
+	int32_t x0 = int32_t(floorf(fx));
+	int32_t y0 = int32_t(floorf(fy));
+	float ax = fx-x0;
+	float ay = fy-y0;
+	float t00[4], t10[4], t01[4], t11[4];
+	fetchTexel(tex,data,wrapCoordinate(x0  ,w,wrap&1),wrapCoordinate(y0  ,h,wrap&2),t00);
+	fetchTexel(tex,data,wrapCoordinate(x0+1,w,wrap&1),wrapCoordinate(y0  ,h,wrap&2),t10);
+	fetchTexel(tex,data,wrapCoordinate(x0  ,w,wrap&1),wrapCoordinate(y0+1,h,wrap&2),t01);
+	fetchTexel(tex,data,wrapCoordinate(x0+1,w,wrap&1),wrapCoordinate(y0+1,h,wrap&2),t11);
+	for (uint32_t i = 0; i < 4; i++)
+		res[i] = (t00[i]*(1-ax)+t10[i]*ax)*(1-ay) + (t01[i]*(1-ax)+t11[i]*ax)*ay;
+}
+
+// executes the program, returns false if the fragment was killed
+static bool executeProgram(const agalProgram& p, agalRegisters& r, const float (*constants)[4], const softwareSampler* samplers)
+{
+	// state of nested AGAL2 conditionals
+	bool condition[16];
+	bool active[16];
+	uint32_t depth = 0;
+	bool running = true;
+	for (auto it = p.code.begin(); it != p.code.end(); it++)
+	{
+		const agalInstruction& ins = *it;
+		float a[4], b[4], res[4];
+		switch (ins.opcode)
+		{
+			case 0x1c: // ife
+			case 0x1d: // ine
+			case 0x1e: // ifg
+			case 0x1f: // ifl
+			{
+				readSource(ins.src1,0,r,constants,a);
+				readSource(ins.src2,0,r,constants,b);
+				bool c;
+				if (ins.opcode == 0x1c)
+					c = a[0] == b[0];
+				else if (ins.opcode == 0x1d)
+					c = a[0] != b[0];
+				else if (ins.opcode == 0x1e)
+					c = a[0] > b[0];
+				else
+					c = a[0] < b[0];
+				if (depth < 16)
+				{
+					active[depth] = running;
+					condition[depth] = c;
+				}
+				depth++;
+				running = running && c;
+				continue;
+			}
+			case 0x20: // els
+				if (depth && depth <= 16)
+					running = active[depth-1] && !condition[depth-1];
+				continue;
+			case 0x21: // eif
+				if (depth)
+				{
+					depth--;
+					if (depth < 16)
+						running = active[depth];
+				}
+				continue;
+			default:
+				break;
+		}
+		if (!running)
+			continue;
+		uint32_t mask = ins.destmask;
+		readSource(ins.src1,0,r,constants,a);
+		switch (ins.opcode)
+		{
+			case 0x00: // mov
+				for (uint32_t i = 0; i < 4; i++) res[i] = a[i];
+				break;
+			case 0x01: // add
+				readSource(ins.src2,0,r,constants,b);
+				for (uint32_t i = 0; i < 4; i++) res[i] = a[i]+b[i];
+				break;
+			case 0x02: // sub
+				readSource(ins.src2,0,r,constants,b);
+				for (uint32_t i = 0; i < 4; i++) res[i] = a[i]-b[i];
+				break;
+			case 0x03: // mul
+				readSource(ins.src2,0,r,constants,b);
+				for (uint32_t i = 0; i < 4; i++) res[i] = a[i]*b[i];
+				break;
+			case 0x04: // div
+				readSource(ins.src2,0,r,constants,b);
+				for (uint32_t i = 0; i < 4; i++) res[i] = a[i]/b[i];
+				break;
+			case 0x05: // rcp
+				for (uint32_t i = 0; i < 4; i++) res[i] = 1.0/a[i];
+				break;
+			case 0x06: // min
+				readSource(ins.src2,0,r,constants,b);
+				for (uint32_t i = 0; i < 4; i++) res[i] = min(a[i],b[i]);
+				break;
+			case 0x07: // max
+				readSource(ins.src2,0,r,constants,b);
+				for (uint32_t i = 0; i < 4; i++) res[i] = max(a[i],b[i]);
+				break;
+			case 0x08: // frc
+				for (uint32_t i = 0; i < 4; i++) res[i] = a[i]-floorf(a[i]);
+				break;
+			case 0x09: // sqt
+				for (uint32_t i = 0; i < 4; i++) res[i] = sqrtf(a[i]);
+				break;
+			case 0x0A: // rsq
+				for (uint32_t i = 0; i < 4; i++) res[i] = 1.0/sqrtf(a[i]);
+				break;
+			case 0x0B: // pow
+				readSource(ins.src2,0,r,constants,b);
+				for (uint32_t i = 0; i < 4; i++) res[i] = powf(a[i],b[i]);
+				break;
+			case 0x0C: // log
+				for (uint32_t i = 0; i < 4; i++) res[i] = log2f(a[i]);
+				break;
+			case 0x0D: // exp
+				for (uint32_t i = 0; i < 4; i++) res[i] = exp2f(a[i]);
+				break;
+			case 0x0E: // nrm
+			{
+				float l = sqrtf(a[0]*a[0]+a[1]*a[1]+a[2]*a[2]);
+				float f = l != 0 ? 1.0/l : 0.0;
+				res[0] = a[0]*f;
+				res[1] = a[1]*f;
+				res[2] = a[2]*f;
+				res[3] = 0.0;
+				mask &= 7;
+				break;
+			}
+			case 0x0F: // sin
+				for (uint32_t i = 0; i < 4; i++) res[i] = sinf(a[i]);
+				break;
+			case 0x10: // cos
+				for (uint32_t i = 0; i < 4; i++) res[i] = cosf(a[i]);
+				break;
+			case 0x11: // crs
+				readSource(ins.src2,0,r,constants,b);
+				res[0] = a[1]*b[2]-a[2]*b[1];
+				res[1] = a[2]*b[0]-a[0]*b[2];
+				res[2] = a[0]*b[1]-a[1]*b[0];
+				res[3] = 0.0;
+				mask &= 7;
+				break;
+			case 0x12: // dp3
+				readSource(ins.src2,0,r,constants,b);
+				res[0] = res[1] = res[2] = res[3] = a[0]*b[0]+a[1]*b[1]+a[2]*b[2];
+				break;
+			case 0x13: // dp4
+				readSource(ins.src2,0,r,constants,b);
+				res[0] = res[1] = res[2] = res[3] = a[0]*b[0]+a[1]*b[1]+a[2]*b[2]+a[3]*b[3];
+				break;
+			case 0x14: // abs
+				for (uint32_t i = 0; i < 4; i++) res[i] = fabsf(a[i]);
+				break;
+			case 0x15: // neg
+				for (uint32_t i = 0; i < 4; i++) res[i] = -a[i];
+				break;
+			case 0x16: // sat
+				for (uint32_t i = 0; i < 4; i++) res[i] = a[i] < 0 ? 0 : (a[i] > 1 ? 1 : a[i]);
+				break;
+			case 0x17: // m33
+			case 0x18: // m44
+			case 0x19: // m34
+			{
+				uint32_t rows = ins.opcode == 0x18 ? 4 : 3;
+				uint32_t columns = ins.opcode == 0x17 ? 3 : 4;
+				res[3] = 0.0;
+				for (uint32_t i = 0; i < rows; i++)
+				{
+					readSource(ins.src2,i,r,constants,b);
+					res[i] = 0.0;
+					for (uint32_t j = 0; j < columns; j++)
+						res[i] += a[j]*b[j];
+				}
+				if (rows == 3)
+					mask &= 7;
+				break;
+			}
+			case 0x1a: // ddx
+			case 0x1b: // ddy
+				// derivatives are not available when shading single pixels
+				res[0] = res[1] = res[2] = res[3] = 0.0;
+				break;
+			case 0x27: // kil
+				if (a[0] < 0 || a[1] < 0 || a[2] < 0 || a[3] < 0)
+					return false;
+				continue;
+			case 0x28: // tex
+				sampleTexture(samplers[ins.samplern % CONTEXT3D_SAMPLER_COUNT],ins,a,res);
+				break;
+			case 0x29: // sge
+				readSource(ins.src2,0,r,constants,b);
+				for (uint32_t i = 0; i < 4; i++) res[i] = a[i] >= b[i] ? 1.0 : 0.0;
+				break;
+			case 0x2A: // slt
+				readSource(ins.src2,0,r,constants,b);
+				for (uint32_t i = 0; i < 4; i++) res[i] = a[i] < b[i] ? 1.0 : 0.0;
+				break;
+			case 0x2C: // seq
+				readSource(ins.src2,0,r,constants,b);
+				for (uint32_t i = 0; i < 4; i++) res[i] = a[i] == b[i] ? 1.0 : 0.0;
+				break;
+			case 0x2D: // sne
+				readSource(ins.src2,0,r,constants,b);
+				for (uint32_t i = 0; i < 4; i++) res[i] = a[i] != b[i] ? 1.0 : 0.0;
+				break;
+			default:
+				continue;
+		}
+		float* dest;
+		switch (ins.desttype)
+		{
+			case RegisterType::TEMPORARY:
+				if (ins.destn >= SOFTWARE3D_TEMPORARIES)
+					continue;
+				dest = r.temp[ins.destn];
+				break;
+			case RegisterType::VARYING:
+				if (ins.destn >= SOFTWARE3D_VARYINGS)
+					continue;
+				dest = r.varying[ins.destn];
+				break;
+			case RegisterType::OUTPUT:
+				dest = r.output;
+				break;
+			default:
+				continue;
+		}
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			if (mask & (1<<i))
+				dest[i] = res[i];
+		}
+	}
+	return true;
+}
+
+// shared by the caller of drawTriangles and the band jobs, the jobs may outlive the draw call when the thread pool is stopped
+struct SoftwareRenderer3D::bandState
+{
+	SoftwareRenderer3D* renderer;
+	const drawCall* call;
+	std::atomic<int32_t> nextband;
+	int32_t bandcount;
+	Mutex mutex;
+	// set by the caller after it has rasterized the remaining bands, jobs starting later don't touch the draw call
+	bool closed;
+	// number of jobs that have started rasterizing
+	uint32_t started;
+	Semaphore done;
+	bandState(SoftwareRenderer3D* r, const drawCall* c, int32_t count)
+		:renderer(r),call(c),nextband(0),bandcount(count),closed(false),started(0),done(0) {}
+	void run()
+	{
+		int32_t band;
+		while ((band = nextband.fetch_add(1)) < bandcount)
+			renderer->rasterizeBand(*call,band*SOFTWARE3D_BANDHEIGHT,min(int32_t(renderer->targetheight),(band+1)*SOFTWARE3D_BANDHEIGHT));
+	}
+};
+
+class SoftwareRenderer3D::bandJob: public IThreadJob
+{
+private:
+	std::shared_ptr<bandState> state;
+public:
+	bandJob(const std::shared_ptr<bandState>& s):state(s) {}
+	void execute() override
+	{
+		{
+			Locker l(state->mutex);
+			if (state->closed)
+				return;
+			state->started++;
+		}
+		state->run();
+		state->done.signal();
+	}
+	void jobFence() override
+	{
+		// the thread pool skips the fence of jobs it drops at shutdown, so the job owns itself
+		delete this;
+	}
+};
+
+SoftwareRenderer3D::SoftwareRenderer3D(SystemState* s, uint32_t threads)
+	:sys(s),threadcount(threads),nextid(1)
+	,backbufferwidth(0),backbufferheight(0),backbufferdepthstencil(false)
+	,target(nullptr),targetdepth(nullptr),targetstencil(nullptr),targetwidth(0),targetheight(0)
+	,presentedwidth(0),presentedheight(0)
+{
+	if (threadcount == 0)
+		threadcount = max(1,SDL_GetCPUCount());
+	state.blendsrc = BLEND_ONE;
+	state.blenddst = BLEND_ZERO;
+	state.depthmask = true;
+	state.depthfunction = DEPTHSTENCIL_LESS;
+	state.stencilfunction = DEPTHSTENCIL_ALWAYS;
+	state.stencilref = 0;
+	state.stencilreadmask = 0xff;
+	state.stencilwritemask = 0xff;
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		state.stencilfail[i] = DEPTHSTENCIL_KEEP;
+		state.depthfail[i] = DEPTHSTENCIL_KEEP;
+		state.stencilpass[i] = DEPTHSTENCIL_KEEP;
+	}
+	state.cullface = FACE_NONE;
+	state.colormask = 0xf;
+	state.scissorenabled = false;
+	memset(state.scissor,0,sizeof(state.scissor));
+}
+
+void SoftwareRenderer3D::uploadVertexBuffer(uint32_t id, const float* data, uint32_t count)
+{
+	vertexbuffers[id].assign(data,data+count);
+}
+void SoftwareRenderer3D::uploadIndexBuffer(uint32_t id, const uint16_t* data, uint32_t count)
+{
+	indexbuffers[id].assign(data,data+count);
+}
+void SoftwareRenderer3D::deleteBuffer(uint32_t id)
+{
+	vertexbuffers.erase(id);
+	indexbuffers.erase(id);
+}
+
+uint32_t SoftwareRenderer3D::createTexture(uint32_t width, uint32_t height, bool cube, uint32_t levels)
+{
+	uint32_t id = nextid++;
+	softwareTexture& tex = textures[id];
+	tex.width = width;
+	tex.height = height;
+	tex.cube = cube;
+	tex.levels = max(levels,1U);
+	tex.format = TEXTUREFORMAT::BGRA;
+	tex.data.resize(cube ? tex.levels*6 : tex.levels);
+	return id;
+}
+void SoftwareRenderer3D::uploadTexture(uint32_t id, uint32_t index, std::vector<uint8_t>& data, TEXTUREFORMAT format)
+{
+	auto it = textures.find(id);
+	if (it == textures.end())
+		return;
+	if (format != TEXTUREFORMAT::BGRA && format != TEXTUREFORMAT::BGR)
+		LOG(LOG_NOT_IMPLEMENTED,"software Stage3D: texture format "<<(uint32_t)format);
+	it->second.format = format;
+	if (it->second.data.size() <= index)
+		it->second.data.resize(index+1);
+	it->second.data[index].swap(data);
+}
+void SoftwareRenderer3D::deleteTexture(uint32_t id)
+{
+	auto it = textures.find(id);
+	if (it == textures.end())
+		return;
+	if (!it->second.data.empty() && target == it->second.data[0].data())
+		setBackBufferAsTarget();
+	textures.erase(it);
+}
+const softwareTexture* SoftwareRenderer3D::getTexture(uint32_t id) const
+{
+	auto it = textures.find(id);
+	return it == textures.end() ? nullptr : &it->second;
+}
+
+void SoftwareRenderer3D::uploadProgram(uint32_t id, const std::vector<uint8_t>& vertexbytecode, const std::vector<uint8_t>& fragmentbytecode)
+{
+	std::pair<agalProgram,agalProgram>& p = programs[id];
+	p.first.decode(vertexbytecode,true);
+	p.second.decode(fragmentbytecode,false);
+}
+void SoftwareRenderer3D::deleteProgram(uint32_t id)
+{
+	programs.erase(id);
+}
+
+void SoftwareRenderer3D::configureBackBuffer(uint32_t width, uint32_t height, bool enableDepthAndStencil)
+{
+	backbufferwidth = width;
+	backbufferheight = height;
+	backbufferdepthstencil = enableDepthAndStencil;
+	backbuffer.assign(width*height*4,0);
+	if (enableDepthAndStencil)
+	{
+		backbufferdepth.assign(width*height,1.0);
+		backbufferstencil.assign(width*height,0);
+	}
+	else
+	{
+		backbufferdepth.clear();
+		backbufferstencil.clear();
+	}
+	setBackBufferAsTarget();
+}
+void SoftwareRenderer3D::setBackBufferAsTarget()
+{
+	target = backbuffer.empty() ? nullptr : backbuffer.data();
+	targetdepth = backbufferdepth.empty() ? nullptr : backbufferdepth.data();
+	targetstencil = backbufferstencil.empty() ? nullptr : backbufferstencil.data();
+	targetwidth = backbufferwidth;
+	targetheight = backbufferheight;
+}
+void SoftwareRenderer3D::setRenderTarget(uint32_t id, bool enableDepthAndStencil)
+{
+	if (id == UINT32_MAX)
+	{
+		setBackBufferAsTarget();
+		return;
+	}
+	auto it = textures.find(id);
+	if (it == textures.end() || it->second.cube)
+	{
+		if (it != textures.end())
+			LOG(LOG_NOT_IMPLEMENTED,"software Stage3D: rendering to cube textures");
+		target = nullptr;
+		return;
+	}
+	softwareTexture& tex = it->second;
+	// the rendered texture is always stored as BGRA in level 0
+	if (tex.format != TEXTUREFORMAT::BGRA || tex.data[0].size() != tex.width*tex.height*4)
+	{
+		tex.format = TEXTUREFORMAT::BGRA;
+		tex.data[0].assign(tex.width*tex.height*4,0);
+	}
+	target = tex.data[0].data();
+	targetwidth = tex.width;
+	targetheight = tex.height;
+	if (enableDepthAndStencil)
+	{
+		texturedepth.assign(tex.width*tex.height,1.0);
+		texturestencil.assign(tex.width*tex.height,0);
+		targetdepth = texturedepth.data();
+		targetstencil = texturestencil.data();
+	}
+	else
+	{
+		targetdepth = nullptr;
+		targetstencil = nullptr;
+	}
+}
+
+void SoftwareRenderer3D::clear(float red, float green, float blue, float alpha, float depth, uint8_t stencil, uint32_t mask)
+{
+	if (!target)
+		return;
+	uint32_t count = targetwidth*targetheight;
+	if (mask & CLEARMASK::COLOR)
+	{
+		uint8_t c[4];
+		c[0] = uint8_t(max(0.0f,min(1.0f,blue))*255.0+0.5);
+		c[1] = uint8_t(max(0.0f,min(1.0f,green))*255.0+0.5);
+		c[2] = uint8_t(max(0.0f,min(1.0f,red))*255.0+0.5);
+		c[3] = uint8_t(max(0.0f,min(1.0f,alpha))*255.0+0.5);
+		for (uint32_t i = 0; i < count; i++)
+			memcpy(target+i*4,c,4);
+	}
+	if ((mask & CLEARMASK::DEPTH) && targetdepth)
+	{
+		for (uint32_t i = 0; i < count; i++)
+			targetdepth[i] = depth;
+	}
+	if ((mask & CLEARMASK::STENCIL) && targetstencil)
+		memset(targetstencil,stencil,count);
+}
+
+void SoftwareRenderer3D::addScreenTriangle(drawCall& call, const transformedVertex* v0, const transformedVertex* v1, const transformedVertex* v2)
+{
+	screenTriangle tri;
+	const transformedVertex* v[3] = { v0, v1, v2 };
+	float ndcx[3], ndcy[3];
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		tri.v[i] = v[i];
+		tri.invw[i] = 1.0/v[i]->pos[3];
+		ndcx[i] = v[i]->pos[0]*tri.invw[i];
+		ndcy[i] = v[i]->pos[1]*tri.invw[i];
+		tri.x[i] = (ndcx[i]+1.0)*0.5*targetwidth;
+		// the top row of the target is stored first
+		tri.y[i] = (1.0-ndcy[i])*0.5*targetheight;
+		tri.z[i] = v[i]->pos[2]*tri.invw[i];
+	}
+	// Stage3D front faces are clockwise in normalized device coordinates, the OpenGL renderer
+	// uses glFrontFace(GL_CW) (and GL_CCW only when y is flipped for rendering to a texture)
+	float area = (ndcx[1]-ndcx[0])*(ndcy[2]-ndcy[0])-(ndcx[2]-ndcx[0])*(ndcy[1]-ndcy[0]);
+	if (area == 0 || std::isnan(area))
+		return;
+	tri.backface = area > 0;
+	switch (state.cullface)
+	{
+		case FACE_FRONT_AND_BACK:
+			return;
+		case FACE_FRONT:
+			if (!tri.backface)
+				return;
+			break;
+		case FACE_BACK:
+			if (tri.backface)
+				return;
+			break;
+		default:
+			break;
+	}
+	float miny = min(tri.y[0],min(tri.y[1],tri.y[2]));
+	float maxy = max(tri.y[0],max(tri.y[1],tri.y[2]));
+	tri.miny = max(0,int32_t(floorf(miny)));
+	tri.maxy = min(int32_t(targetheight)-1,int32_t(ceilf(maxy)));
+	if (tri.miny > tri.maxy)
+		return;
+	call.triangles.push_back(tri);
+}
+
+void SoftwareRenderer3D::clipAndSetupTriangle(drawCall& call, const transformedVertex* v0, const transformedVertex* v1, const transformedVertex* v2, std::deque<transformedVertex>& clipped)
+{
+	// fast path for triangles completely inside the near and far planes
+	const transformedVertex* v[3] = { v0, v1, v2 };
+	bool inside = true;
+	for (uint32_t i = 0; i < 3 && inside; i++)
+		inside = v[i]->pos[3] > 1e-5 && v[i]->pos[2] >= 0 && v[i]->pos[2] <= v[i]->pos[3];
+	if (inside)
+	{
+		addScreenTriangle(call,v0,v1,v2);
+		return;
+	}
+	// clip against w > epsilon, z >= 0 and z <= w (Stage3D uses a depth range of 0 to 1)
+	std::vector<transformedVertex> poly = { *v0, *v1, *v2 };
+	std::vector<transformedVertex> out;
+	for (uint32_t plane = 0; plane < 3 && !poly.empty(); plane++)
+	{
+		out.clear();
+		for (uint32_t i = 0; i < poly.size(); i++)
+		{
+			const transformedVertex& a = poly[i];
+			const transformedVertex& b = poly[(i+1)%poly.size()];
+			float da, db;
+			switch (plane)
+			{
+				case 0: da = a.pos[3]-1e-5; db = b.pos[3]-1e-5; break;
+				case 1: da = a.pos[2]; db = b.pos[2]; break;
+				default: da = a.pos[3]-a.pos[2]; db = b.pos[3]-b.pos[2]; break;
+			}
+			if (da >= 0)
+				out.push_back(a);
+			if ((da >= 0) != (db >= 0))
+			{
+				float t = da/(da-db);
+				transformedVertex n;
+				for (uint32_t j = 0; j < 4; j++)
+					n.pos[j] = a.pos[j]+(b.pos[j]-a.pos[j])*t;
+				for (uint32_t k = 0; k < call.varyingcount; k++)
+				{
+					for (uint32_t j = 0; j < 4; j++)
+						n.varying[k][j] = a.varying[k][j]+(b.varying[k][j]-a.varying[k][j])*t;
+				}
+				out.push_back(n);
+			}
+		}
+		poly.swap(out);
+	}
+	if (poly.size() < 3)
+		return;
+	// the clipped vertices are stored in a deque, so the pointers of earlier triangles stay valid
+	size_t first = clipped.size();
+	for (auto it = poly.begin(); it != poly.end(); it++)
+		clipped.push_back(*it);
+	for (size_t i = 1; i+1 < poly.size(); i++)
+		addScreenTriangle(call,&clipped[first],&clipped[first+i],&clipped[first+i+1]);
+}
+
+bool SoftwareRenderer3D::stencilDepthTest(const screenTriangle& tri, uint32_t pos, float depth)
+{
+	if (!targetdepth)
+		return true;
+	uint32_t face = tri.backface ? 1 : 0;
+	uint8_t& stencil = targetstencil[pos];
+	uint8_t newstencil;
+	bool pass = compareFunction<uint8_t>(state.stencilfunction,state.stencilref & state.stencilreadmask,stencil & state.stencilreadmask);
+	if (!pass)
+		newstencil = stencilOp(state.stencilfail[face],stencil,state.stencilref);
+	else
+	{
+		pass = compareFunction<float>(state.depthfunction,depth,targetdepth[pos]);
+		if (pass)
+		{
+			newstencil = stencilOp(state.stencilpass[face],stencil,state.stencilref);
+			if (state.depthmask)
+				targetdepth[pos] = depth;
+		}
+		else
+			newstencil = stencilOp(state.depthfail[face],stencil,state.stencilref);
+	}
+	stencil = (stencil & ~state.stencilwritemask) | (newstencil & state.stencilwritemask);
+	return pass;
+}
+
+void SoftwareRenderer3D::shadePixel(const drawCall& call, const screenTriangle& tri, int32_t x, int32_t y, float l0, float l1, float l2, agalRegisters& regs)
+{
+	uint32_t pos = uint32_t(y)*targetwidth+uint32_t(x);
+	float depth = l0*tri.z[0]+l1*tri.z[1]+l2*tri.z[2];
+	// without kil the depth and stencil tests can be done before shading
+	bool earlytest = !call.fragmentprogram->usesKill;
+	if (earlytest && !stencilDepthTest(tri,pos,depth))
+		return;
+	// perspective correct interpolation of the varyings
+	float w0 = l0*tri.invw[0];
+	float w1 = l1*tri.invw[1];
+	float w2 = l2*tri.invw[2];
+	float f = 1.0/(w0+w1+w2);
+	w0 *= f;
+	w1 *= f;
+	w2 *= f;
+	for (uint32_t k = 0; k < call.varyingcount; k++)
+	{
+		for (uint32_t j = 0; j < 4; j++)
+			regs.varying[k][j] = tri.v[0]->varying[k][j]*w0+tri.v[1]->varying[k][j]*w1+tri.v[2]->varying[k][j]*w2;
+	}
+	regs.output[0] = regs.output[1] = regs.output[2] = regs.output[3] = 0.0;
+	if (!executeProgram(*call.fragmentprogram,regs,call.fragmentConstants,call.samplers))
+		return;
+	if (!earlytest && !stencilDepthTest(tri,pos,depth))
+		return;
+	uint8_t* pixel = target+pos*4;
+	float src[4], dst[4];
+	for (uint32_t i = 0; i < 4; i++)
+		src[i] = regs.output[i] < 0 ? 0 : (regs.output[i] > 1 ? 1 : regs.output[i]);
+	dst[0] = pixel[2]/255.0;
+	dst[1] = pixel[1]/255.0;
+	dst[2] = pixel[0]/255.0;
+	dst[3] = pixel[3]/255.0;
+	bool noblend = state.blendsrc == BLEND_ONE && state.blenddst == BLEND_ZERO;
+	static const uint32_t byteorder[4] = { 2, 1, 0, 3 };
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		if (!(state.colormask & (1<<i)))
+			continue;
+		float c = noblend ? src[i] : src[i]*blendFactor(state.blendsrc,i,src,dst)+dst[i]*blendFactor(state.blenddst,i,src,dst);
+		c = c < 0 ? 0 : (c > 1 ? 1 : c);
+		pixel[byteorder[i]] = uint8_t(c*255.0+0.5);
+	}
+}
+
+void SoftwareRenderer3D::rasterizeBand(const drawCall& call, int32_t bandstart, int32_t bandend)
+{
+	agalRegisters regs;
+	memset(&regs,0,sizeof(regs));
+	int32_t clipminx = 0;
+	int32_t clipmaxx = targetwidth;
+	int32_t clipminy = bandstart;
+	int32_t clipmaxy = bandend;
+	if (state.scissorenabled)
+	{
+		clipminx = max(clipminx,state.scissor[0]);
+		clipmaxx = min(clipmaxx,state.scissor[0]+state.scissor[2]);
+		clipminy = max(clipminy,state.scissor[1]);
+		clipmaxy = min(clipmaxy,state.scissor[1]+state.scissor[3]);
+	}
+	if (clipminx >= clipmaxx || clipminy >= clipmaxy)
+		return;
+	for (auto it = call.triangles.begin(); it != call.triangles.end(); it++)
+	{
+		const screenTriangle& tri = *it;
+		if (tri.maxy < clipminy || tri.miny >= clipmaxy)
+			continue;
+		// orient the edges so that inside pixels have positive edge functions
+		float x0 = tri.x[0], y0 = tri.y[0];
+		float x1 = tri.x[1], y1 = tri.y[1];
+		float x2 = tri.x[2], y2 = tri.y[2];
+		float area = (x1-x0)*(y2-y0)-(x2-x0)*(y1-y0);
+		float sign = area < 0 ? -1.0 : 1.0;
+		area *= sign;
+		// edge i is opposite to vertex i
+		float ea[3] = { (y1-y2)*sign, (y2-y0)*sign, (y0-y1)*sign };
+		float eb[3] = { (x2-x1)*sign, (x0-x2)*sign, (x1-x0)*sign };
+		float ec[3] = { (x1*y2-x2*y1)*sign, (x2*y0-x0*y2)*sign, (x0*y1-x1*y0)*sign };
+		// top-left fill rule, so pixels on shared edges are only drawn once
+		bool topleft[3];
+		for (uint32_t i = 0; i < 3; i++)
+			topleft[i] = ea[i] > 0 || (ea[i] == 0 && eb[i] < 0);
+		int32_t minx = max(clipminx,int32_t(floorf(min(x0,min(x1,x2)))));
+		int32_t maxx = min(clipmaxx-1,int32_t(ceilf(max(x0,max(x1,x2)))));
+		int32_t miny = max(clipminy,tri.miny);
+		int32_t maxy = min(clipmaxy-1,tri.maxy);
+		float invarea = 1.0/area;
+		for (int32_t y = miny; y <= maxy; y++)
+		{
+			float py = y+0.5;
+			for (int32_t x = minx; x <= maxx; x++)
+			{
+				float px = x+0.5;
+				float e[3];
+				bool inside = true;
+				for (uint32_t i = 0; i < 3 && inside; i++)
+				{
+					e[i] = ea[i]*px+eb[i]*py+ec[i];
+					inside = e[i] > 0 || (e[i] == 0 && topleft[i]);
+				}
+				if (inside)
+					shadePixel(call,tri,x,y,e[0]*invarea,e[1]*invarea,e[2]*invarea,regs);
+			}
+		}
+	}
+}
+
+bool SoftwareRenderer3D::drawTriangles(uint32_t programid, uint32_t indexbufferid, uint32_t firstindex, uint32_t count, const attribregister* attribs,
+									   const constantregister* vertexConstants, const constantregister* fragmentConstants, const softwareSampler* samplers)
+{
+	auto itprog = programs.find(programid);
+	auto itindex = indexbuffers.find(indexbufferid);
+	if (!target || itprog == programs.end() || itindex == indexbuffers.end())
+		return false;
+	const agalProgram& vertexprogram = itprog->second.first;
+	const std::vector<uint16_t>& indices = itindex->second;
+	if (firstindex >= indices.size())
+		return false;
+	count = min(count,uint32_t(indices.size())-firstindex);
+	count -= count%3;
+
+	softwareAttribute attributes[CONTEXT3D_ATTRIBUTE_COUNT];
+	uint32_t vertexcount = UINT32_MAX;
+	for (uint32_t i = 0; i < CONTEXT3D_ATTRIBUTE_COUNT; i++)
+	{
+		attributes[i].buffer = nullptr;
+		if (attribs[i].bufferID == UINT32_MAX)
+			continue;
+		auto it = vertexbuffers.find(attribs[i].bufferID);
+		if (it == vertexbuffers.end() || attribs[i].data32PerVertex == 0)
+			continue;
+		attributes[i].buffer = &it->second;
+		attributes[i].offset = attribs[i].offset;
+		attributes[i].data32PerVertex = attribs[i].data32PerVertex;
+		attributes[i].format = attribs[i].format;
+		vertexcount = min(vertexcount,uint32_t(it->second.size())/attribs[i].data32PerVertex);
+	}
+	if (vertexcount == UINT32_MAX)
+		vertexcount = 0;
+
+	drawCall call;
+	call.fragmentprogram = &itprog->second.second;
+	call.fragmentConstants = (const float (*)[4])fragmentConstants;
+	call.samplers = samplers;
+	call.varyingcount = vertexprogram.varyingcount;
+
+	// run the vertex program once for every referenced vertex
+	std::vector<transformedVertex> vertices;
+	std::vector<int32_t> slots(vertexcount,-1);
+	agalRegisters regs;
+	memset(&regs,0,sizeof(regs));
+	for (uint32_t i = firstindex; i < firstindex+count; i++)
+	{
+		uint32_t index = indices[i];
+		if (index >= vertexcount || slots[index] != -1)
+			continue;
+		for (uint32_t a = 0; a < CONTEXT3D_ATTRIBUTE_COUNT; a++)
+		{
+			float* reg = regs.attrib[a];
+			reg[0] = reg[1] = reg[2] = 0.0;
+			reg[3] = 1.0;
+			const softwareAttribute& attr = attributes[a];
+			if (!attr.buffer)
+				continue;
+			uint32_t pos = index*attr.data32PerVertex+attr.offset;
+			const std::vector<float>& data = *attr.buffer;
+			if (attr.format == VERTEXBUFFER_FORMAT::BYTES_4)
+			{
+				if (pos >= data.size())
+					continue;
+				const uint8_t* bytes = (const uint8_t*)&data[pos];
+				for (uint32_t j = 0; j < 4; j++)
+					reg[j] = bytes[j]/255.0;
+			}
+			else
+			{
+				uint32_t components = uint32_t(attr.format);
+				for (uint32_t j = 0; j < components && pos+j < data.size(); j++)
+					reg[j] = data[pos+j];
+			}
+		}
+		regs.output[0] = regs.output[1] = regs.output[2] = 0.0;
+		regs.output[3] = 1.0;
+		executeProgram(vertexprogram,regs,(const float (*)[4])vertexConstants,samplers);
+		transformedVertex v;
+		memcpy(v.pos,regs.output,sizeof(v.pos));
+		memcpy(v.varying,regs.varying,sizeof(v.varying));
+		slots[index] = vertices.size();
+		vertices.push_back(v);
+	}
+
+	std::deque<transformedVertex> clipped;
+	for (uint32_t i = firstindex; i+2 < firstindex+count; i+=3)
+	{
+		uint32_t i0 = indices[i], i1 = indices[i+1], i2 = indices[i+2];
+		if (i0 >= vertexcount || i1 >= vertexcount || i2 >= vertexcount)
+			continue;
+		clipAndSetupTriangle(call,&vertices[slots[i0]],&vertices[slots[i1]],&vertices[slots[i2]],clipped);
+	}
+	if (call.triangles.empty())
+		return true;
+
+	int32_t bandcount = (targetheight+SOFTWARE3D_BANDHEIGHT-1)/SOFTWARE3D_BANDHEIGHT;
+	uint64_t pixels = 0;
+	for (auto it = call.triangles.begin(); it != call.triangles.end(); it++)
+	{
+		float w = max(it->x[0],max(it->x[1],it->x[2]))-min(it->x[0],min(it->x[1],it->x[2]));
+		pixels += uint64_t(min(w,float(targetwidth)))*(it->maxy-it->miny+1);
+	}
+	std::shared_ptr<bandState> bands = std::make_shared<bandState>(this,&call,bandcount);
+	uint32_t jobcount = min(threadcount,uint32_t(bandcount))-1;
+	if (pixels < SOFTWARE3D_PARALLEL_THRESHOLD || !sys)
+		jobcount = 0;
+	if (jobcount == 0)
+	{
+		bands->run();
+		return true;
+	}
+	// the bands don't overlap, so every pixel is written by only one thread in the order of the triangles
+	for (uint32_t i = 0; i < jobcount; i++)
+		sys->addJob(new bandJob(bands));
+	// the caller rasterizes all bands that were not claimed by a job,
+	// so only the jobs that have actually started have to be waited for
+	bands->run();
+	uint32_t started;
+	{
+		Locker l(bands->mutex);
+		bands->closed = true;
+		started = bands->started;
+	}
+	for (uint32_t i = 0; i < started; i++)
+		bands->done.wait();
+	return true;
+}
+
+void SoftwareRenderer3D::present()
+{
+	presentedwidth = backbufferwidth;
+	presentedheight = backbufferheight;
+	presented.resize(backbuffer.size());
+	uint32_t stride = backbufferwidth*4;
+	for (uint32_t y = 0; y < backbufferheight; y++)
+		memcpy(presented.data()+(backbufferheight-1-y)*stride,backbuffer.data()+y*stride,stride);
+}
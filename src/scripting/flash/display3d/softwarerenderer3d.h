@@ -0,0 +1,237 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef SCRIPTING_FLASH_DISPLAY3D_SOFTWARERENDERER3D_H
+#define SCRIPTING_FLASH_DISPLAY3D_SOFTWARERENDERER3D_H 1
+
+#include "compat.h"
+#include "swftypes.h"
+#include "scripting/flash/display3d/flashdisplay3d.h"
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+// height of the horizontal bands of the render target that are rasterized in parallel
+#define SOFTWARE3D_BANDHEIGHT 32
+// AGAL2 allows up to 26 temporaries and 10 varyings
+#define SOFTWARE3D_TEMPORARIES 26
+#define SOFTWARE3D_VARYINGS 10
+
+namespace lightspark
+{
+class SystemState;
+
+struct agalSource
+{
+	uint16_t n;
+	uint16_t o;// offset for indirect addressing
+	uint8_t type;
+	uint8_t itype;// type of the index register for indirect addressing
+	uint8_t q;// component of the index register
+	uint8_t swizzle;
+	bool indirect;
+};
+struct agalInstruction
+{
+	uint32_t opcode;
+	uint16_t destn;
+	uint8_t desttype;
+	uint8_t destmask;
+	agalSource src1;
+	agalSource src2;
+	// sampler of a tex instruction
+	uint16_t samplern;
+	uint8_t samplerdimension;
+	uint8_t samplerfilter;
+	uint8_t samplermipmap;
+	uint8_t samplerwrap;
+};
+// decoded AGAL program that is executed by the interpreter
+struct agalProgram
+{
+	std::vector<agalInstruction> code;
+	bool isVertexProgram;
+	bool usesKill;
+	uint32_t varyingcount;// number of varyings written by a vertex program
+	bool decode(const std::vector<uint8_t>& bytecode, bool vertex);
+};
+struct agalRegisters
+{
+	float temp[SOFTWARE3D_TEMPORARIES][4];
+	float varying[SOFTWARE3D_VARYINGS][4];
+	float attrib[CONTEXT3D_ATTRIBUTE_COUNT][4];
+	float output[4];
+};
+struct softwareTexture
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t levels;// number of mip levels per side
+	bool cube;
+	TEXTUREFORMAT format;
+	// level data in premultiplied BGRA, cube sides are stored as side*levels+level
+	std::vector<std::vector<uint8_t>> data;
+};
+struct softwareSampler
+{
+	const softwareTexture* texture;
+	int32_t filter;
+	int32_t wrap;
+	bool overridden;// filter and wrap are set by setSamplerStateAt instead of the tex instruction
+};
+struct softwareAttribute
+{
+	const std::vector<float>* buffer;
+	uint32_t offset;
+	uint32_t data32PerVertex;
+	VERTEXBUFFER_FORMAT format;
+};
+
+/*
+ * CPU implementation of the Context3D draw path.
+ * Buffers, textures and programs are identified by ids handed out by the renderer, so the Context3D
+ * can use the same action list as for the OpenGL backend. AGAL programs are interpreted, triangles are
+ * rasterized with depth and stencil testing into horizontal bands that are processed by several threads.
+ * All methods have to be called with the rendermutex of the Context3D held.
+ */
+class SoftwareRenderer3D
+{
+public:
+	struct renderState
+	{
+		BLEND_FACTOR blendsrc;
+		BLEND_FACTOR blenddst;
+		bool depthmask;
+		DEPTHSTENCIL_FUNCTION depthfunction;
+		DEPTHSTENCIL_FUNCTION stencilfunction;
+		uint8_t stencilref;
+		uint8_t stencilreadmask;
+		uint8_t stencilwritemask;
+		// index 0 is used for front faces, index 1 for back faces
+		DEPTHSTENCIL_OP stencilfail[2];
+		DEPTHSTENCIL_OP depthfail[2];
+		DEPTHSTENCIL_OP stencilpass[2];
+		TRIANGLE_FACE cullface;
+		uint32_t colormask;// red | green<<1 | blue<<2 | alpha<<3
+		bool scissorenabled;
+		int32_t scissor[4];// x,y,width,height
+	};
+private:
+	struct transformedVertex
+	{
+		float pos[4];
+		float varying[SOFTWARE3D_VARYINGS][4];
+	};
+	struct screenTriangle
+	{
+		float x[3];
+		float y[3];
+		float z[3];
+		float invw[3];
+		int32_t miny;
+		int32_t maxy;
+		bool backface;
+		const transformedVertex* v[3];
+	};
+	struct drawCall
+	{
+		const agalProgram* fragmentprogram;
+		const float (*fragmentConstants)[4];
+		const softwareSampler* samplers;
+		uint32_t varyingcount;
+		std::vector<screenTriangle> triangles;
+	};
+	struct bandState;
+	class bandJob;
+	SystemState* sys;
+	uint32_t threadcount;
+	uint32_t nextid;
+	std::unordered_map<uint32_t,std::vector<float>> vertexbuffers;
+	std::unordered_map<uint32_t,std::vector<uint16_t>> indexbuffers;
+	std::unordered_map<uint32_t,softwareTexture> textures;
+	std::unordered_map<uint32_t,std::pair<agalProgram,agalProgram>> programs;
+	renderState state;
+	// back buffer in premultiplied BGRA, top row first
+	uint32_t backbufferwidth;
+	uint32_t backbufferheight;
+	bool backbufferdepthstencil;
+	std::vector<uint8_t> backbuffer;
+	std::vector<float> backbufferdepth;
+	std::vector<uint8_t> backbufferstencil;
+	// depth and stencil buffers used when rendering to a texture
+	std::vector<float> texturedepth;
+	std::vector<uint8_t> texturestencil;
+	// current render target
+	uint8_t* target;
+	float* targetdepth;
+	uint8_t* targetstencil;
+	uint32_t targetwidth;
+	uint32_t targetheight;
+	// last presented frame, bottom row first for uploading to OpenGL
+	std::vector<uint8_t> presented;
+	uint32_t presentedwidth;
+	uint32_t presentedheight;
+	void setBackBufferAsTarget();
+	void clipAndSetupTriangle(drawCall& call, const transformedVertex* v0, const transformedVertex* v1, const transformedVertex* v2, std::deque<transformedVertex>& clipped);
+	void addScreenTriangle(drawCall& call, const transformedVertex* v0, const transformedVertex* v1, const transformedVertex* v2);
+	void rasterizeBand(const drawCall& call, int32_t bandstart, int32_t bandend);
+	void shadePixel(const drawCall& call, const screenTriangle& tri, int32_t x, int32_t y, float l0, float l1, float l2, agalRegisters& regs);
+	bool stencilDepthTest(const screenTriangle& tri, uint32_t pos, float depth);
+public:
+	// threads == 0 uses one thread per CPU
+	SoftwareRenderer3D(SystemState* s, uint32_t threads);
+	uint32_t createBuffer() { return nextid++; }
+	void uploadVertexBuffer(uint32_t id, const float* data, uint32_t count);
+	void uploadIndexBuffer(uint32_t id, const uint16_t* data, uint32_t count);
+	void deleteBuffer(uint32_t id);
+	uint32_t createTexture(uint32_t width, uint32_t height, bool cube, uint32_t levels);
+	// data has to be in the format of the TextureBase bitmaparray
+	void uploadTexture(uint32_t id, uint32_t index, std::vector<uint8_t>& data, TEXTUREFORMAT format);
+	void deleteTexture(uint32_t id);
+	const softwareTexture* getTexture(uint32_t id) const;
+	uint32_t createProgram() { return nextid++; }
+	void uploadProgram(uint32_t id, const std::vector<uint8_t>& vertexbytecode, const std::vector<uint8_t>& fragmentbytecode);
+	void deleteProgram(uint32_t id);
+
+	void configureBackBuffer(uint32_t width, uint32_t height, bool enableDepthAndStencil);
+	// id == UINT32_MAX renders to the back buffer
+	void setRenderTarget(uint32_t id, bool enableDepthAndStencil);
+	renderState& getState() { return state; }
+	void clear(float red, float green, float blue, float alpha, float depth, uint8_t stencil, uint32_t mask);
+	bool drawTriangles(uint32_t programid, uint32_t indexbufferid, uint32_t firstindex, uint32_t count, const attribregister* attribs,
+					   const constantregister* vertexConstants, const constantregister* fragmentConstants, const softwareSampler* samplers);
+	// copies the back buffer to the presented frame
+	void present();
+	const std::vector<uint8_t>& getPresented(uint32_t& width, uint32_t& height) const
+	{
+		width = presentedwidth;
+		height = presentedheight;
+		return presented;
+	}
+	// back buffer in premultiplied BGRA, top row first
+	const uint8_t* getBackBuffer(uint32_t& width, uint32_t& height) const
+	{
+		width = backbufferwidth;
+		height = backbufferheight;
+		return backbuffer.data();
+	}
+};
+
+}
+#endif /* SCRIPTING_FLASH_DISPLAY3D_SOFTWARERENDERER3D_H */
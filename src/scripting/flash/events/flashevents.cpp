@@ -70,8 +70,8 @@ void IEventDispatcher::linkTraits(Class_base* c)
 }
 
 Event::Event(ASWorker* wrk, Class_base* cb, const tiny_string& t, bool b, bool c, CLASS_SUBTYPE st):
-	ASObject(wrk,cb,T_OBJECT,st),bubbles(b),cancelable(c),defaultPrevented(false),propagationStopped(false),immediatePropagationStopped(false),queued(false),
-	eventPhase(0),type(t),target(asAtomHandler::invalidAtom),currentTarget()
+	ASObject(wrk,cb,T_OBJECT,st),bubbles(b),cancelable(c),defaultPrevented(false),propagationStopped(false),immediatePropagationStopped(false),queued(false),queuedTime(0),
+	eventPhase(0),type(t),target(asAtomHandler::invalidAtom),currentTarget(),typeId(UINT32_MAX)
 {
 }
 void Event::finalize()
@@ -163,6 +163,18 @@ ASFUNCTIONBODY_ATOM(Event,_constructor)
 
 	Event* th=asAtomHandler::as<Event>(obj);
 	ARG_CHECK(ARG_UNPACK(th->type)(th->bubbles, false)(th->cancelable, false));
+	RELEASE_WRITE(th->typeId,UINT32_MAX);
+}
+
+uint32_t Event::getTypeId()
+{
+	uint32_t id = ACQUIRE_READ(typeId);
+	if (id == UINT32_MAX)
+	{
+		id = getSystemState()->getUniqueStringId(type);
+		RELEASE_WRITE(typeId,id);
+	}
+	return id;
 }
 
 ASFUNCTIONBODY_GETTER(Event,currentTarget)
@@ -595,6 +607,7 @@ ASFUNCTIONBODY_ATOM(NativeWindowBoundsEvent,_constructor)
 {
 	NativeWindowBoundsEvent* th=asAtomHandler::as<NativeWindowBoundsEvent>(obj);
 	ARG_CHECK(ARG_UNPACK(th->type)(th->bubbles, false)(th->cancelable, false)(th->beforeBounds,NullRef)(th->afterBounds,NullRef));
+	RELEASE_WRITE(th->typeId,UINT32_MAX);
 
 }
 ASFUNCTIONBODY_ATOM(NativeWindowBoundsEvent,_toString)
@@ -663,7 +676,7 @@ bool EventDispatcher::countCylicMemberReferences(garbagecollectorstate& gcstate)
 	bool ret = ASObject::countCylicMemberReferences(gcstate);
 	for (auto it = handlers.begin(); it != handlers.end(); it++)
 	{
-		for (auto it2 = it->second.begin(); it2 != it->second.end(); it2++)
+		for (auto it2 = it->second->begin(); it2 != it->second->end(); it2++)
 			ret = asAtomHandler::getObjectNoCheck((*it2).f)->countAllCylicMemberReferences(gcstate) || ret;
 	}
 	return ret;
@@ -677,11 +690,12 @@ void EventDispatcher::prepareShutdown()
 	ASObject* t = asAtomHandler::getObject(forcedTarget);
 	if (t)
 		t->prepareShutdown();
-	auto it=handlers.begin();
-	while(it!=handlers.end())
+	// the lists may still be used by a running dispatch, so they are only detached here
+	std::unordered_map<uint32_t,listenerList> tmphandlers;
+	tmphandlers.swap(handlers);
+	for(auto it=tmphandlers.begin();it!=tmphandlers.end();it++)
 	{
-		auto it2 = it->second.begin();
-		while (it2 != it->second.end())
+		for (auto it2 = it->second->begin(); it2 != it->second->end(); it2++)
 		{
 			ASObject* f = asAtomHandler::getObject((*it2).f);
 			if (f)
@@ -689,25 +703,31 @@ void EventDispatcher::prepareShutdown()
 				f->prepareShutdown();
 				f->removeStoredMember();
 			}
-			it2 = it->second.erase(it2);
 		}
-		it++;
 	}
 }
 void EventDispatcher::clearEventListeners()
 {
-	auto it=handlers.begin();
-	while(it!=handlers.end())
+	std::unordered_map<uint32_t,listenerList> tmphandlers;
+	tmphandlers.swap(handlers);
+	for(auto it=tmphandlers.begin();it!=tmphandlers.end();it++)
 	{
-		auto it2 = it->second.begin();
-		while (it2 != it->second.end())
-		{
-			IFunction* f = asAtomHandler::as<IFunction>((*it2).f);
-			it2 = it->second.erase(it2);
-			f->removeStoredMember();
-		}
-		it = handlers.erase(it);
+		for (auto it2 = it->second->begin(); it2 != it->second->end(); it2++)
+			asAtomHandler::as<IFunction>((*it2).f)->removeStoredMember();
+	}
+}
+
+std::vector<listener>& EventDispatcher::getWritableListeners(uint32_t eventNameId)
+{
+	listenerList& listeners=handlers[eventNameId];
+	if(!listeners)
+		listeners=std::make_shared<std::vector<listener>>();
+	else if(listeners.use_count()>1)
+	{
+		// the list is currently used by a dispatch, so we modify a copy
+		listeners=std::make_shared<std::vector<listener>>(*listeners);
 	}
+	return *listeners;
 }
 
 
@@ -726,11 +746,10 @@ void EventDispatcher::sinit(Class_base* c)
 
 void EventDispatcher::dumpHandlers()
 {
-	std::map<tiny_string,list<listener> >::iterator it=handlers.begin();
-	for(;it!=handlers.end();++it)
+	for(auto it=handlers.begin();it!=handlers.end();++it)
 	{
-		for (auto it2 = it->second.begin();it2 != it->second.end(); it2++)
-			LOG(LOG_INFO, it->first<<":"<<asAtomHandler::toDebugString(it2->f));
+		for (auto it2 = it->second->begin();it2 != it->second->end(); it2++)
+			LOG(LOG_INFO, getSystemState()->getStringFromUniqueId(it->first)<<":"<<asAtomHandler::toDebugString(it2->f));
 	}
 }
 
@@ -751,12 +770,12 @@ ASFUNCTIONBODY_ATOM(EventDispatcher,addEventListener)
 	if(argslen>=5)
 		useWeakReference = asAtomHandler::Boolean_concrete(args[4]);
 
-	const tiny_string& eventName=asAtomHandler::toString(args[0],wrk);
+	uint32_t eventNameId=asAtomHandler::toStringId(args[0],wrk);
 	if(wrk->isPrimordial // don't register frame listeners for background workers
-			&& th->is<DisplayObject>() && (eventName=="enterFrame"
-				|| eventName=="exitFrame"
-				|| eventName=="frameConstructed"
-				|| eventName=="render") )
+			&& th->is<DisplayObject>() && (eventNameId==BUILTIN_STRINGS::STRING_ENTERFRAME
+				|| eventNameId==BUILTIN_STRINGS::STRING_EXITFRAME
+				|| eventNameId==BUILTIN_STRINGS::STRING_FRAMECONSTRUCTED
+				|| eventNameId==BUILTIN_STRINGS::STRING_RENDER) )
 	{
 		th->getSystemState()->registerFrameListener(th->as<DisplayObject>());
 	}
@@ -764,10 +783,10 @@ ASFUNCTIONBODY_ATOM(EventDispatcher,addEventListener)
 	{
 		Locker l(th->handlersMutex);
 		//Search if any listener is already registered for the event
-		list<listener>& listeners=th->handlers[eventName];
+		std::vector<listener>& listeners=th->getWritableListeners(eventNameId);
 		const listener newListener(args[1], priority, useCapture, wrk);
 		//Ordered insertion
-		list<listener>::iterator insertionPoint=lower_bound(listeners.begin(),listeners.end(),newListener);
+		auto insertionPoint=lower_bound(listeners.begin(),listeners.end(),newListener);
 		IFunction* newfunc = asAtomHandler::as<IFunction>(args[1]);
 		if (useWeakReference && !newfunc->inClass)
 			LOG(LOG_NOT_IMPLEMENTED,"EventDispatcher::addEventListener parameter useWeakReference is ignored");
@@ -783,14 +802,13 @@ ASFUNCTIONBODY_ATOM(EventDispatcher,addEventListener)
 		newfunc->addStoredMember();
 		listeners.insert(insertionPoint,newListener);
 	}
-	th->eventListenerAdded(eventName);
+	th->eventListenerAdded(th->getSystemState()->getStringFromUniqueId(eventNameId));
 }
 
 ASFUNCTIONBODY_ATOM(EventDispatcher,_hasEventListener)
 {
 	EventDispatcher* th=asAtomHandler::as<EventDispatcher>(obj);
-	const tiny_string& eventName=asAtomHandler::toString(args[0],wrk);
-	asAtomHandler::setBool(ret,th->hasEventListener(eventName));
+	asAtomHandler::setBool(ret,th->hasEventListener(asAtomHandler::toStringId(args[0],wrk)));
 }
 
 ASFUNCTIONBODY_ATOM(EventDispatcher,removeEventListener)
@@ -802,7 +820,7 @@ ASFUNCTIONBODY_ATOM(EventDispatcher,removeEventListener)
 	if(!asAtomHandler::isString(args[0]) || !asAtomHandler::isFunction(args[1]))
 		throw RunTimeException("Type mismatch in EventDispatcher::removeEventListener");
 
-	const tiny_string& eventName=asAtomHandler::toString(args[0],wrk);
+	uint32_t eventNameId=asAtomHandler::toStringId(args[0],wrk);
 
 	bool useCapture=false;
 	if(argslen>=3)
@@ -810,7 +828,7 @@ ASFUNCTIONBODY_ATOM(EventDispatcher,removeEventListener)
 
 	{
 		Locker l(th->handlersMutex);
-		map<tiny_string, list<listener> >::iterator h=th->handlers.find(eventName);
+		auto h=th->handlers.find(eventNameId);
 		if(h==th->handlers.end())
 		{
 			LOG(LOG_CALLS,"Event not found");
@@ -818,25 +836,27 @@ ASFUNCTIONBODY_ATOM(EventDispatcher,removeEventListener)
 		}
 
 		const listener ls(args[1],0,useCapture,wrk);
-		std::list<listener>::iterator it=find(h->second.begin(),h->second.end(),ls);
-		if(it!=h->second.end())
+		auto it=find(h->second->begin(),h->second->end(),ls);
+		if(it!=h->second->end())
 		{
 			ASObject* listenerfunc = asAtomHandler::getObject(it->f);
 			assert(listenerfunc);
-			h->second.erase(it);
+			uint32_t index=it-h->second->begin();
+			std::vector<listener>& listeners=th->getWritableListeners(eventNameId);
+			listeners.erase(listeners.begin()+index);
 			listenerfunc->removeStoredMember();
 		}
-		if(h->second.empty()) //Remove the entry from the map
+		if(h->second->empty()) //Remove the entry from the map
 			th->handlers.erase(h);
 	}
 
 	// Only unregister the enterFrame listener _after_ the handlers have been erased.
-	if(th->is<DisplayObject>() && (eventName=="enterFrame"
-					|| eventName=="exitFrame"
-					|| eventName=="frameConstructed")
-				&& (!th->hasEventListener("enterFrame")
-					&& !th->hasEventListener("exitFrame")
-					&& !th->hasEventListener("frameConstructed")) )
+	if(th->is<DisplayObject>() && (eventNameId==BUILTIN_STRINGS::STRING_ENTERFRAME
+					|| eventNameId==BUILTIN_STRINGS::STRING_EXITFRAME
+					|| eventNameId==BUILTIN_STRINGS::STRING_FRAMECONSTRUCTED)
+				&& (!th->hasEventListener(BUILTIN_STRINGS::STRING_ENTERFRAME)
+					&& !th->hasEventListener(BUILTIN_STRINGS::STRING_EXITFRAME)
+					&& !th->hasEventListener(BUILTIN_STRINGS::STRING_FRAMECONSTRUCTED)) )
 	{
 		th->getSystemState()->unregisterFrameListener(th->as<DisplayObject>());
 	}
@@ -911,15 +931,19 @@ void EventDispatcher::handleEvent(_R<Event> e)
 	check();
 	e->check();
 	Locker l(handlersMutex);
-	map<tiny_string, list<listener> >::iterator h=handlers.find(e->type);
+	if(handlers.empty())
+		return;
+	auto h=handlers.find(e->getTypeId());
 	if(h==handlers.end())
 		return;
 
-	LOG(LOG_CALLS,"Handling event " << h->first<<" "<<e->getInstanceWorker());
+	LOG(LOG_CALLS,"Handling event " << e->type<<" "<<e->getInstanceWorker());
 
-	//Create a temporary copy of the listeners, as the list can be modified during the calls
-	vector<listener> tmpListener(h->second.begin(),h->second.end());
+	// keep a reference to the current listeners, as the list can be modified during the calls
+	// modifications are done on a copy of the list (see getWritableListeners)
+	listenerList listeners=h->second;
 	l.release();
+	const vector<listener>& tmpListener=*listeners;
 	// listeners may be removed during the call to a listener, so we have to incref them before the call
 	// TODO how to handle listeners that are removed during the call to a listener, should they really be executed anyway?
 	for(unsigned int i=0;i<tmpListener.size();i++)
@@ -946,10 +970,11 @@ void EventDispatcher::handleEvent(_R<Event> e)
 			continue;
 		}
 		asAtom arg0= asAtomHandler::fromObject(e.getPtr());
-		IFunction* func = asAtomHandler::as<IFunction>(tmpListener[i].f);
+		asAtom f = tmpListener[i].f;
+		IFunction* func = asAtomHandler::as<IFunction>(f);
 		asAtom v = asAtomHandler::isValid(func->closure_this) ? func->closure_this : asAtomHandler::fromObject(this);
 		asAtom ret=asAtomHandler::invalidAtom;
-		asAtomHandler::callFunction(tmpListener[i].f,tmpListener[i].worker,ret,v,&arg0,1,false);
+		asAtomHandler::callFunction(f,tmpListener[i].worker,ret,v,&arg0,1,false);
 		ASATOM_DECREF(ret);
 		//And now no more, f can also be deleted
 		ASATOM_DECREF(tmpListener[i].f);
@@ -959,12 +984,19 @@ void EventDispatcher::handleEvent(_R<Event> e)
 }
 
 bool EventDispatcher::hasEventListener(const tiny_string& eventName)
+{
+	{
+		Locker l(handlersMutex);
+		if(handlers.empty())
+			return false;
+	}
+	return hasEventListener(getSystemState()->getUniqueStringId(eventName));
+}
+
+bool EventDispatcher::hasEventListener(uint32_t eventNameId)
 {
 	Locker l(handlersMutex);
-	if(handlers.find(eventName)==handlers.end())
-		return false;
-	else
-		return true;
+	return handlers.find(eventNameId)!=handlers.end();
 }
 
 NetStatusEvent::NetStatusEvent(ASWorker* wrk, Class_base* c, const tiny_string& level, const tiny_string& code):Event(wrk,c, "netStatus"),statuscode(code)
@@ -1952,6 +1984,10 @@ RootConstructedEvent::RootConstructedEvent(_NR<DisplayObject> m, bool explicit_)
 {
 }
 
+BroadcastEvent::BroadcastEvent(_R<Event> e): Event(nullptr,nullptr,"BroadcastEvent"),event(e)
+{
+}
+
 TextInputEvent::TextInputEvent(_NR<InteractiveObject> m, const tiny_string& s) : Event(nullptr,nullptr, "TextInputEvent"),target(m),text(s)
 {
 }
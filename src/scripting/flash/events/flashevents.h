@@ -25,6 +25,9 @@
 #include "threading.h"
 #include "tiny_string.h"
 #include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
 #include <SDL2/SDL_keycode.h>
 #undef MOUSE_EVENT
 
@@ -34,7 +37,7 @@ namespace lightspark
 enum EVENT_TYPE { EVENT=0, BIND_CLASS, SHUTDOWN, SYNC, MOUSE_EVENT,
 	FUNCTION,FUNCTION_ASYNC, EXTERNAL_CALL, CONTEXT_INIT, INIT_FRAME,
 	FLUSH_INVALIDATION_QUEUE, FLUSH_EVENT_BUFFER, ADVANCE_FRAME, PARSE_RPC_MESSAGE,EXECUTE_FRAMESCRIPT,TEXTINPUT_EVENT,IDLE_EVENT,
-	AVM1INITACTION_EVENT,SET_LOADER_CONTENT_EVENT,ROOTCONSTRUCTEDEVENT, LOCALCONNECTIONEVENT,GETMOUSETARGET_EVENT };
+	AVM1INITACTION_EVENT,SET_LOADER_CONTENT_EVENT,ROOTCONSTRUCTEDEVENT, LOCALCONNECTIONEVENT,GETMOUSETARGET_EVENT, BROADCAST_EVENT };
 
 class ABCContext;
 class DictionaryTag;
@@ -67,14 +70,21 @@ public:
 	bool propagationStopped;
 	bool immediatePropagationStopped;
 	ACQUIRE_RELEASE_FLAG(queued); // indicates that this event was added to the event queue
+	int64_t queuedTime; // time the event was added to the event queue, only set if profiling data is shown
 	ASPROPERTY_GETTER(uint32_t,eventPhase);
 	ASPROPERTY_GETTER(tiny_string,type);
+	// returns the unique string id of type, it is looked up once and cached until type is changed
+	uint32_t getTypeId();
 	//Altough events may be recycled and sent to more than a handler, the target property is set before sending
 	//and the handling is serialized
 	ASPROPERTY_GETTER_ATOM(target);
 	ASPROPERTY_GETTER(_NR<ASObject>,currentTarget);
 	ASFUNCTION_ATOM(stopPropagation);
 	ASFUNCTION_ATOM(stopImmediatePropagation);
+protected:
+	// cached unique string id of type, UINT32_MAX if not yet computed
+	// events are handled in the vm thread but also checked from other threads, so it is accessed atomically
+	ACQUIRE_RELEASE_VARIABLE(uint32_t,typeId);
 private:
 	/*
 	 * To be implemented by each derived class to allow redispatching
@@ -331,6 +341,9 @@ public:
 	}
 	void resetClosure();
 };
+// listeners for one event type, sorted by priority.
+// The vector is shared with running dispatches and copied before it is modified
+typedef std::shared_ptr<std::vector<listener>> listenerList;
 
 class IEventDispatcher
 {
@@ -342,7 +355,10 @@ class EventDispatcher: public ASObject, public IEventDispatcher
 {
 private:
 	Mutex handlersMutex;
-	std::map<tiny_string,std::list<listener> > handlers;
+	// listeners by unique string id of the event type
+	std::unordered_map<uint32_t,listenerList> handlers;
+	// returns the listeners for eventNameId that can be modified, creates or copies the list if necessary
+	std::vector<listener>& getWritableListeners(uint32_t eventNameId);
 	/*
 	 * This will be used when a target is passed to EventDispatcher constructor
 	 */
@@ -364,6 +380,7 @@ public:
 	void handleEvent(_R<Event> e);
 	void dumpHandlers();
 	bool hasEventListener(const tiny_string& eventName);
+	bool hasEventListener(uint32_t eventNameId);
 	virtual void defaultEventBehavior(_R<Event> e) {}
 	virtual void afterExecution(_R<Event> e) {}
 	ASFUNCTION_ATOM(_constructor);
@@ -551,6 +568,16 @@ public:
 	RootConstructedEvent(_NR<DisplayObject> m, bool explicit_ = false);
 	EVENT_TYPE getEventType() const override { return ROOTCONSTRUCTEDEVENT; }
 };
+// dispatches event to all registered frame listeners (enterFrame, frameConstructed, exitFrame, render)
+class BroadcastEvent: public Event
+{
+friend class ABCVm;
+private:
+	_R<Event> event;
+public:
+	BroadcastEvent(_R<Event> e);
+	EVENT_TYPE getEventType() const override { return BROADCAST_EVENT; }
+};
 class LocalConnectionEvent: public Event
 {
 friend class SystemState;
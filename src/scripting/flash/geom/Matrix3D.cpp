@@ -259,10 +259,7 @@ ASFUNCTIONBODY_ATOM(Matrix3D,_constructor)
 	if (!v.isNull() && v->size()==4*4)
 	{
 		for (uint32_t i = 0; i < 4*4; i++)
-		{
-			asAtom a = v->at(i);
-			th->data[i] = asAtomHandler::toNumber(a);
-		}
+			th->data[i] = v->atNumber(i);
 	}
 }
 ASFUNCTIONBODY_ATOM(Matrix3D,clone)
@@ -518,15 +515,12 @@ ASFUNCTIONBODY_ATOM(Matrix3D,transformVectors)
 	uint32_t i = 0;
 	while (i + 3 <= vin->size())
 	{
-		number_t x = asAtomHandler::toNumber(vin->at(i));
-		number_t y = asAtomHandler::toNumber(vin->at(i+1));
-		number_t z = asAtomHandler::toNumber(vin->at(i+2));
-		asAtom xout = asAtomHandler::fromNumber(wrk, x * th->data[0] + y * th->data[4] + z * th->data[8] + th->data[12],false);
-		asAtom yout = asAtomHandler::fromNumber(wrk, x * th->data[1] + y * th->data[5] + z * th->data[9] + th->data[13],false);
-		asAtom zout = asAtomHandler::fromNumber(wrk, x * th->data[2] + y * th->data[6] + z * th->data[10] + th->data[14],false);
-		vout->set(i,xout);
-		vout->set(i+1,yout);
-		vout->set(i+2,zout);
+		number_t x = vin->atNumber(i);
+		number_t y = vin->atNumber(i+1);
+		number_t z = vin->atNumber(i+2);
+		vout->setNumber(i,x * th->data[0] + y * th->data[4] + z * th->data[8] + th->data[12]);
+		vout->setNumber(i+1,x * th->data[1] + y * th->data[5] + z * th->data[9] + th->data[13]);
+		vout->setNumber(i+2,x * th->data[2] + y * th->data[6] + z * th->data[10] + th->data[14]);
 		i += 3;
 	}
 }
@@ -829,10 +823,7 @@ ASFUNCTIONBODY_ATOM(Matrix3D,copyRawDataFrom)
 	if (transpose)
 		LOG(LOG_NOT_IMPLEMENTED, "Matrix3D.copyRawDataFrom ignores parameter 'transpose'");
 	for (uint32_t i = 0; i < vector->size()-index && i < 16; i++)
-	{
-		asAtom a = vector->at(index+i);
-		th->data[i] = asAtomHandler::toNumber(a);
-	}
+		th->data[i] = vector->atNumber(index+i);
 }
 
 ASFUNCTIONBODY_ATOM(Matrix3D,copyRawDataTo)
@@ -862,16 +853,12 @@ ASFUNCTIONBODY_ATOM(Matrix3D,copyRawDataTo)
 		src[14] = th->data[11];
 		src[15] = th->data[15];
 		for (uint32_t i = 0; i < vector->size()-index && i < 16; i++)
-		{
-			vector->set(index+i,asAtomHandler::fromNumber(wrk,src[i],false));
-		}
+			vector->setNumber(index+i,src[i]);
 	}
 	else
 	{
 		for (uint32_t i = 0; i < vector->size()-index && i < 16; i++)
-		{
-			vector->set(index+i,asAtomHandler::fromNumber(wrk,th->data[i],false));
-		}
+			vector->setNumber(index+i,th->data[i]);
 	}
 }
 
@@ -1052,11 +1039,9 @@ ASFUNCTIONBODY_ATOM(Matrix3D,_get_rawData)
 	ApplicationDomain* appdomain = wrk->rootClip->applicationDomain.getPtr();
 	Template<Vector>::getInstanceS(wrk,v,Class<Number>::getClass(wrk->getSystemState()),appdomain);
 	Vector *result = asAtomHandler::as<Vector>(v);
+	result->reserve(4*4);
 	for (uint32_t i = 0; i < 4*4; i++)
-	{
-		asAtom o = asAtomHandler::fromNumber(wrk,th->data[i],false);
-		result->append(o);
-	}
+		result->appendNumber(th->data[i]);
 	ret =asAtomHandler::fromObject(result);
 }
 ASFUNCTIONBODY_ATOM(Matrix3D,_set_rawData)
@@ -1066,10 +1051,7 @@ ASFUNCTIONBODY_ATOM(Matrix3D,_set_rawData)
 	ARG_CHECK(ARG_UNPACK(data));
 	// TODO handle not invertible argument
 	for (uint32_t i = 0; i < data->size(); i++)
-	{
-		asAtom a = data->at(i);
-		th->data[i] = asAtomHandler::toNumber(a);
-	}
+		th->data[i] = data->atNumber(i);
 }
 ASFUNCTIONBODY_ATOM(Matrix3D,_get_position)
 {
@@ -24,6 +24,7 @@
 #include "compat.h"
 #include <iostream>
 #include "backends/audio.h"
+#include "backends/config.h"
 #include "backends/rendering.h"
 #include "backends/cachedsurface.h"
 #include "backends/streamcache.h"
@@ -186,7 +187,8 @@ IDrawable *Video::invalidate(bool smoothing)
 											 , isMask, cacheAsBitmap
 											 , getScaleFactor(),getConcatenatedAlpha()
 											 , ct, smoothing ? SMOOTH_MODE::SMOOTH_ANTIALIAS:SMOOTH_MODE::SMOOTH_NONE,this->getBlendMode(),matrix);
-	res->getState()->isYUV=true;
+	// frames are either converted to RGB by the decoder or by the shader
+	res->getState()->isYUV=!Config::getConfig()->isVideoCPUConversionEnabled();
 	return res;
 }
 
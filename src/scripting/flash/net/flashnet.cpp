@@ -1327,7 +1327,7 @@ void NetStreamAppendBytesAction::sinit(Class_base* c)
 NetStream::NetStream(ASWorker* wrk, Class_base* c):EventDispatcher(wrk,c),tickStarted(false),paused(false),closed(true),
 	streamTime(0),frameRate(0),connection(),downloader(nullptr),videoDecoder(nullptr),
 	audioDecoder(nullptr),audioStream(nullptr),datagenerationfile(nullptr),datagenerationthreadstarted(false),client(NullRef),
-	oldVolume(-1.0),checkPolicyFile(false),rawAccessAllowed(false),framesdecoded(0),playbackBytesPerSecond(0),maxBytesPerSecond(0),datagenerationexpecttype(DATAGENERATION_HEADER),datagenerationbuffer(Class<ByteArray>::getInstanceS(wrk)),
+	oldVolume(-1.0),checkPolicyFile(false),rawAccessAllowed(false),framesdecoded(0),playbackBytesPerSecond(0),maxBytesPerSecond(0),prefetchTime(0),rebufferCount(0),datagenerationexpecttype(DATAGENERATION_HEADER),datagenerationbuffer(Class<ByteArray>::getInstanceS(wrk)),
 	streamDecoder(nullptr),
 	backBufferLength(0),backBufferTime(30),bufferLength(0),bufferTime(0.1),bufferTimeMax(0),
 	maxPauseBufferTime(0)
@@ -2046,6 +2046,10 @@ void NetStream::execute()
 	ThreadProfile* profile=getSystemState()->allocateProfiler(RGB(0,0,200));
 	profile->setTag("NetStream");
 	bool waitForFlush=true;
+	uint64_t playStartTime=compat_msectiming();
+	bool startupReported=false;
+	prefetchTime=bufferTime;
+	rebufferCount=0;
 	//We need to catch possible EOF and other error condition in the non reliable stream
 	try
 	{
@@ -2097,6 +2101,7 @@ void NetStream::execute()
 
 				LOG(LOG_INFO,"decoding failed:"<<s.tellg()<<" "<<this->getReceivedLength());
 				bufferfull = false;
+				updatePrefetchTime(s,compat_msectiming()-playStartTime);
 			}
 			else
 			{
@@ -2122,6 +2127,8 @@ void NetStream::execute()
 						{
 							bufferfull = false;
 							this->bufferLength=0;
+							rebufferCount++;
+							updatePrefetchTime(s,compat_msectiming()-playStartTime);
 							this->incRef();
 							getVm(getSystemState())->addEvent(_MR(this),_MR(Class<NetStatusEvent>::getInstanceS(getInstanceWorker(),"status", "NetStream.Buffer.Empty")));
 						}
@@ -2142,6 +2149,11 @@ void NetStream::execute()
 				audioStream=getSys()->audioManager->createStream(audioDecoder,streamDecoder->hasVideo(),this,-1,0,soundTransform ? soundTransform->volume : 1.0);
 			if(!tickStarted && isReady() && frameRate && ((framesdecoded / frameRate) >= this->bufferTime))
 			{
+				if (!startupReported)
+				{
+					startupReported=true;
+					LOG(LOG_INFO,"NetStream startup latency "<<compat_msectiming()-playStartTime<<"ms");
+				}
 				tickStarted=true;
 				paused=false;
 				this->incRef();
@@ -2152,6 +2164,17 @@ void NetStream::execute()
 				float localRenderRate=dmin(frameRate,24);
 				getSystemState()->setRenderRate(localRenderRate);
 			}
+			size_t prefetchend=0;
+			if (!bufferfull && !isPrefetchReady(s,prefetchend))
+			{
+				// wait for the download instead of blocking inside the demuxer,
+				// threadAbort() stops the download and ends the wait
+				profile->accountTime(chronometer.checkpoint());
+				downloader->waitForData(prefetchend-1);
+				if(threadAborting)
+					throw JobTerminationException();
+				continue;
+			}
 			if (!bufferfull && frameRate && ((framesdecoded / frameRate) >= this->bufferTime))
 			{
 				bufferfull = true;
@@ -2181,13 +2204,18 @@ void NetStream::execute()
 	{
 		LOG(LOG_ERROR, "Exception in reading: "<<e.what());
 	}
+	if (rebufferCount)
+		LOG(LOG_INFO,"NetStream rebuffered "<<rebufferCount<<" times, final prefetch "<<prefetchTime<<"s");
 	if(waitForFlush)
 	{
 		//Put the decoders in the flushing state and wait for the complete consumption of contents
 		if(audioDecoder)
 			audioDecoder->setFlushing();
 		if(videoDecoder)
+		{
+			videoDecoder->flushDelayedFrames();
 			videoDecoder->setFlushing();
+		}
 		
 		if(audioDecoder)
 			audioDecoder->waitFlushed();
@@ -2351,6 +2379,38 @@ uint32_t NetStream::getStreamTime()
 	return streamTime;
 }
 
+void NetStream::updatePrefetchTime(istream& s, uint64_t elapsedms)
+{
+	prefetchTime=bufferTime;
+	if (datagenerationfile || !downloader || elapsedms == 0 || playbackBytesPerSecond <= 0)
+		return;
+	number_t downloadBytesPerSecond=downloader->getReceivedLength()*1000.0/elapsedms;
+	if (downloadBytesPerSecond >= playbackBytesPerSecond)
+		return;
+	// buffer enough to play the remaining part without stalling again, limited to one minute
+	streamoff pos=s.tellg();
+	uint32_t total=downloader->getLength();
+	if (pos == -1 || total <= pos)
+		return;
+	number_t remaining=(total-pos)/playbackBytesPerSecond;
+	number_t needed=remaining*(1.0-downloadBytesPerSecond/playbackBytesPerSecond);
+	prefetchTime=dmin(dmax(needed,bufferTime),60);
+	LOG(LOG_INFO,"NetStream download "<<downloadBytesPerSecond<<"B/s slower than playback "<<playbackBytesPerSecond<<"B/s, prefetching "<<prefetchTime<<"s");
+}
+
+bool NetStream::isPrefetchReady(istream& s, size_t& prefetchend)
+{
+	if (datagenerationfile || !downloader || downloader->hasFinished() || downloader->hasFailed())
+		return true;
+	if (playbackBytesPerSecond <= 0)
+		return true;
+	streamoff pos=s.tellg();
+	if (pos == -1)
+		return true;
+	prefetchend=pos+prefetchTime*playbackBytesPerSecond;
+	return downloader->getReceivedLength() >= prefetchend;
+}
+
 uint32_t NetStream::getReceivedLength()
 {
 	assert(isReady());
@@ -2743,7 +2803,7 @@ ASFUNCTIONBODY_ATOM(lightspark,registerClassAlias)
 	ASATOM_INCREF(args[1]);
 	_R<Class_base> c=_MR(asAtomHandler::as<Class_base>(args[1]));
 	ApplicationDomain* appdomain = wrk->rootClip->applicationDomain.getPtr();
-	appdomain->aliasMap.insert(make_pair(arg0, c));
+	appdomain->registerClassAlias(arg0, c);
 }
 
 ASFUNCTIONBODY_ATOM(lightspark,getClassByAlias)
@@ -324,6 +324,12 @@ private:
 	uint32_t prevstreamtime;
 	number_t playbackBytesPerSecond;
 	number_t maxBytesPerSecond;
+	//Seconds of media that must be downloaded ahead of the decoder before playback resumes
+	//after the buffer ran empty, grows when the download is slower than the playback
+	number_t prefetchTime;
+	uint32_t rebufferCount;
+	void updatePrefetchTime(std::istream& s, uint64_t elapsedms);
+	bool isPrefetchReady(std::istream& s, size_t& prefetchend);
 
 	struct bytespertime {
 		uint64_t timestamp;
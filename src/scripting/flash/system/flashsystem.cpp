@@ -19,6 +19,7 @@
 
 #include "version.h"
 #include "scripting/flash/system/flashsystem.h"
+#include "scripting/toplevel/RegExp.h"
 #include "scripting/flash/utils/ByteArray.h"
 #include "scripting/flash/system/messagechannel.h"
 #include "scripting/flash/errors/flasherrors.h"
@@ -408,6 +409,7 @@ void ApplicationDomain::finalize()
 		it->second->decRef();
 	globalScopes.clear();
 	instantiatedTemplates.clear();
+	classAliasMap.clear();
 }
 
 void ApplicationDomain::prepareShutdown()
@@ -577,6 +579,25 @@ DictionaryTag* ApplicationDomain::dictionaryLookupByName(uint32_t nameID)
 	return nullptr;
 }
 
+void ApplicationDomain::registerClassAlias(const tiny_string& alias, _R<Class_base> c)
+{
+	if (!aliasMap.insert(make_pair(alias, c)).second)
+		return;
+	auto it = classAliasMap.find(c.getPtr());
+	if (it == classAliasMap.end())
+		classAliasMap.insert(make_pair(c.getPtr(),alias));
+	else if (alias < it->second)
+		it->second = alias;
+}
+
+tiny_string ApplicationDomain::getClassAlias(const Class_base* c) const
+{
+	auto it = classAliasMap.find(c);
+	if (it == classAliasMap.end())
+		return "";
+	return it->second;
+}
+
 void ApplicationDomain::registerEmbeddedFont(const tiny_string fontname, FontTag* tag)
 {
 	if (!fontname.empty())
@@ -1308,7 +1329,7 @@ ASWorker::ASWorker(SystemState* s):
 	giveAppPrivileges(false),started(false),inGarbageCollection(false),inShutdown(false),inFinalize(false),
 	stage(nullptr),
 	freelist(new asfreelist[asClassCount]),currentCallContext(nullptr),cur_recursion(0),isPrimordial(true),state("running"),
-	nativeExtensionCallCount(0)
+	nativeExtensionCallCount(0),regexpcache(nullptr),primitivesWithToJSON(-1)
 {
 	subtype = SUBTYPE_WORKER;
 	setSystemState(s);
@@ -1328,7 +1349,7 @@ ASWorker::ASWorker(Class_base* c):
 	giveAppPrivileges(false),started(false),inGarbageCollection(false),inShutdown(false),inFinalize(false),
 	stage(nullptr),
 	freelist(new asfreelist[asClassCount]),currentCallContext(nullptr),cur_recursion(0),isPrimordial(false),state("new"),
-	nativeExtensionCallCount(0)
+	nativeExtensionCallCount(0),regexpcache(nullptr),primitivesWithToJSON(-1)
 {
 	subtype = SUBTYPE_WORKER;
 	// TODO: it seems that AIR applications have a higher default value for max_recursion
@@ -1347,7 +1368,7 @@ ASWorker::ASWorker(ASWorker* wrk, Class_base* c):
 	giveAppPrivileges(false),started(false),inGarbageCollection(false),inShutdown(false),inFinalize(false),
 	stage(nullptr),
 	freelist(new asfreelist[asClassCount]),currentCallContext(nullptr),cur_recursion(0),isPrimordial(false),state("new"),
-	nativeExtensionCallCount(0)
+	nativeExtensionCallCount(0),regexpcache(nullptr),primitivesWithToJSON(-1)
 {
 	subtype = SUBTYPE_WORKER;
 	// TODO: it seems that AIR applications have a higher default value for max_recursion
@@ -1370,6 +1391,8 @@ void ASWorker::finalize()
 	if (!this->preparedforshutdown)
 		this->prepareShutdown();
 	protoypeMap.clear();
+	delete regexpcache;
+	regexpcache=nullptr;
 	// remove all references to freelists
 	for (auto it = constantrefs.begin(); it != constantrefs.end(); it++)
 	{
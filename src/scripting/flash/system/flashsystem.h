@@ -37,6 +37,7 @@ namespace lightspark
 class DefineScalingGridTag;
 class FontTag;
 class SecurityDomain;
+class regExpCache;
 struct call_context;
 
 class Capabilities: public ASObject
@@ -116,6 +117,11 @@ public:
 	 * Support for class aliases in AMF3 serialization
 	 */
 	std::map<tiny_string, _R<Class_base> > aliasMap;
+	// reverse lookup of aliasMap, contains the first alias (in aliasMap order) for every registered class
+	std::unordered_map<const Class_base*, tiny_string> classAliasMap;
+	void registerClassAlias(const tiny_string& alias, _R<Class_base> c);
+	// returns an empty string if no alias is registered for the class
+	tiny_string getClassAlias(const Class_base* c) const;
 	std::map<QName, Template_base*> templates;
 
 	uint32_t version;
@@ -471,6 +477,10 @@ public:
 	std::list<asAtom> nativeExtensionAtomlist;
 	std::list<uint8_t*> nativeExtensionStringlist;
 	uint32_t nativeExtensionCallCount;
+	// compiled regular expressions, created on first use
+	regExpCache* regexpcache;
+	// bitmask of the primitive types that have a toJSON method, -1 if JSON.stringify is not running
+	int32_t primitivesWithToJSON;
 };
 class WorkerDomain: public ASObject
 {
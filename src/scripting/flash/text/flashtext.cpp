@@ -375,7 +375,10 @@ ASFUNCTIONBODY_ATOM(TextField,_setWordWrap)
 	TextField* th=asAtomHandler::as<TextField>(obj);
 	bool WordWrap;
 	ARG_CHECK(ARG_UNPACK(WordWrap));
+	if (th->wordWrap == WordWrap)
+		return;
 	th->wordWrap = WordWrap;
+	th->updateSizes();
 	th->setSizeAndPositionFromAutoSize();
 	th->hasChanged=true;
 	th->setNeedsTextureRecalculation();
@@ -639,7 +642,14 @@ ASFUNCTIONBODY_ATOM(TextField, appendText)
 {
 	TextField* th=asAtomHandler::as<TextField>(obj);
 	assert_and_throw(argslen==1);
-	th->updateText(th->getText() + asAtomHandler::toString(args[0],wrk));
+	tiny_string newtext = asAtomHandler::toString(args[0],wrk);
+	if (newtext.empty())
+		return;
+	// only the last line and the appended lines have to be laid out again
+	th->linemutex->lock();
+	th->appendToText(newtext);
+	th->linemutex->unlock();
+	th->textUpdated(true);
 }
 
 ASFUNCTIONBODY_ATOM(TextField,_getTextFormat)
@@ -1265,9 +1275,30 @@ int32_t TextField::getMaxScrollV()
 	return 1;
 }
 
-void TextField::updateSizes()
+TextField::layoutSettings TextField::getLayoutSettings() const
+{
+	layoutSettings res;
+	res.embeddedFont = embeddedFont;
+	res.font = font;
+	res.fontSize = fontSize;
+	res.wrapwidth = wordWrap ? width : 0;
+	res.wordWrap = wordWrap;
+	res.isBold = isBold;
+	res.isItalic = isItalic;
+	res.isPassword = isPassword;
+	return res;
+}
+
+void TextField::updateSizes(bool onlychangedlines)
 {
 	Locker l(invalidatemutex);
+	layoutSettings currentlayout = getLayoutSettings();
+	if (!(currentlayout == lastlayout))
+	{
+		// font or wrapping changed since the lines were measured
+		onlychangedlines=false;
+		lastlayout = currentlayout;
+	}
 	uint32_t tw,th;
 	tw = 0;
 	th = 0;
@@ -1278,10 +1309,25 @@ void TextField::updateSizes()
 	number_t h=0;
 	linemutex->lock();
 	auto it = textlines.begin();
+	bool forcemeasure=false;
 	while (it != textlines.end())
 	{
+		if (onlychangedlines && !forcemeasure && (*it).textwidth != UINT32_MAX)
+		{
+			// line is unchanged since the last layout, use the stored metrics
+			w = (*it).textwidth;
+			h = (*it).height;
+			if (w>tw)
+				tw = w;
+			it++;
+			th+=h;
+			if (it != textlines.end())
+				th+=this->leading;
+			continue;
+		}
 		getTextSizes((*it).text,w,h);
 		(*it).textwidth=w;
+		(*it).height=h;
 		bool listchanged=false;
 		if (wordWrap && width > TEXTFIELD_PADDING*2 && uint32_t(w) > width-TEXTFIELD_PADDING*2)
 		{
@@ -1296,6 +1342,7 @@ void TextField::updateSizes()
 					if(w>tw)
 						tw = w;
 					(*it).textwidth=w;
+					(*it).height=h;
 					(*it).text = text.substr(0,c);
 					textline t;
 					t.autosizeposition=0;
@@ -1319,6 +1366,8 @@ void TextField::updateSizes()
 		}
 		else if (w>tw)
 			tw = w;
+		// a line inserted by wordwrap has to be measured again
+		forcemeasure=listchanged;
 		if (!listchanged)
 			it++;
 		th+=h;
@@ -1571,6 +1620,14 @@ void TextField::textInputChanged(const tiny_string &newtext)
 	if (this->type != ET_EDITABLE)
 		return;
 	linemutex->lock();
+	if (maxChars == 0 && !newtext.empty() && editLine(caretIndex,0,newtext))
+	{
+		// text was inserted into a single line, only that line has to be laid out again
+		caretIndex+= newtext.numChars();
+		linemutex->unlock();
+		textUpdated(true);
+		return;
+	}
 	tiny_string tmptext = getText();
 	linemutex->unlock();
 	
@@ -1609,7 +1666,7 @@ uint32_t TextField::getTagID() const
 	return tag ? tag->getId() : UINT32_MAX;
 }
 
-void TextField::textUpdated()
+void TextField::textUpdated(bool onlychangedlines)
 {
 	// Don't sync the bound variable if we're updating the binding.
 	if (!inUpdateVarBinding)
@@ -1619,9 +1676,25 @@ void TextField::textUpdated()
 	selectionBeginIndex = 0;
 	selectionEndIndex = 0;
 	linemutex->lock();
-	checkEmbeddedFont(this);
+	FontTag* oldfont = embeddedFont;
+	if (onlychangedlines && embeddedFont)
+	{
+		// only the lines that were not measured yet have changed
+		for (auto it = textlines.begin(); it != textlines.end(); it++)
+		{
+			if ((*it).textwidth == UINT32_MAX && !embeddedFont->hasGlyphs((*it).text))
+			{
+				checkEmbeddedFont(this);
+				break;
+			}
+		}
+	}
+	else
+		checkEmbeddedFont(this);
+	if (oldfont != embeddedFont)
+		onlychangedlines=false;
 	linemutex->unlock();
-	updateSizes();
+	updateSizes(onlychangedlines);
 	setSizeAndPositionFromAutoSize();
 	setNeedsTextureRecalculation();
 	hasChanged=true;
@@ -1659,7 +1732,14 @@ void TextField::defaultEventBehavior(_R<Event> e)
 			{
 				case AS3KEYCODE_BACKSPACE:
 					linemutex->lock();
-					if (!this->getText().empty() && caretIndex > 0)
+					if (caretIndex > 0 && editLine(caretIndex-1,1,""))
+					{
+						// the deleted character was inside a single line
+						caretIndex--;
+						linemutex->unlock();
+						textUpdated(true);
+					}
+					else if (!this->getText().empty() && caretIndex > 0)
 					{
 						caretIndex--;
 						tiny_string tmptext = getText();
@@ -92,6 +92,26 @@ private:
 		void parseTextAndFormating(const tiny_string& html, TextData *dest);
 	};
 	tokensVector tokens;
+	// the settings the stored line metrics were measured with, updateSizes(true) does a full layout if they have changed
+	struct layoutSettings
+	{
+		layoutSettings():embeddedFont(nullptr),fontSize(UINT32_MAX),wrapwidth(0),wordWrap(false),isBold(false),isItalic(false),isPassword(false) {}
+		FontTag* embeddedFont;
+		tiny_string font;
+		uint32_t fontSize;
+		uint32_t wrapwidth; // only used if wordWrap is set
+		bool wordWrap;
+		bool isBold;
+		bool isItalic;
+		bool isPassword;
+		bool operator==(const layoutSettings& r) const
+		{
+			return embeddedFont==r.embeddedFont && font==r.font && fontSize==r.fontSize && wrapwidth==r.wrapwidth &&
+					wordWrap==r.wordWrap && isBold==r.isBold && isItalic==r.isItalic && isPassword==r.isPassword;
+		}
+	};
+	layoutSettings lastlayout;
+	layoutSettings getLayoutSettings() const;
 public:
 	enum EDIT_TYPE { ET_READ_ONLY, ET_EDITABLE };
 	enum ANTI_ALIAS_TYPE { AA_NORMAL, AA_ADVANCED };
@@ -105,7 +125,8 @@ private:
 	void defaultEventBehavior(_R<Event> e) override;
 	void updateText(const tiny_string& new_text);
 	//Computes and changes (text)width and (text)height using Pango
-	void updateSizes();
+	//if onlychangedlines is set, only lines without stored metrics are measured
+	void updateSizes(bool onlychangedlines=false);
 	tiny_string toHtmlText();
 	tiny_string compactHTMLWhiteSpace(const tiny_string&);
 	void validateThickness(number_t oldValue);
@@ -114,7 +135,7 @@ private:
 	void validateScrollV(int32_t oldValue);
 	int32_t getMaxScrollH();
 	int32_t getMaxScrollV();
-	void textUpdated();
+	void textUpdated(bool onlychangedlines=false);
 	void setSizeAndPositionFromAutoSize(bool updatewidth=true);
 	void replaceText(unsigned int begin, unsigned int end, const tiny_string& newText);
 	EDIT_TYPE type;
@@ -565,9 +565,9 @@ uint32_t ByteArray::writeObject(ASObject* obj, ASWorker* wrk)
 	//Return the length of the serialized object
 
 	//TODO: support custom serialization
-	map<tiny_string, uint32_t> stringMap;
-	map<const ASObject*, uint32_t> objMap;
-	map<const Class_base*, uint32_t> traitsMap;
+	unordered_map<tiny_string, uint32_t> stringMap;
+	unordered_map<const ASObject*, uint32_t> objMap;
+	unordered_map<const Class_base*, uint32_t> traitsMap;
 	uint32_t oldPosition=position;
 	obj->serialize(this, stringMap, objMap,traitsMap,wrk);
 	return position-oldPosition;
@@ -577,9 +577,9 @@ uint32_t ByteArray::writeAtomObject(asAtom obj, ASWorker* wrk)
 	//Return the length of the serialized object
 
 	//TODO: support custom serialization
-	map<tiny_string, uint32_t> stringMap;
-	map<const ASObject*, uint32_t> objMap;
-	map<const Class_base*, uint32_t> traitsMap;
+	unordered_map<tiny_string, uint32_t> stringMap;
+	unordered_map<const ASObject*, uint32_t> objMap;
+	unordered_map<const Class_base*, uint32_t> traitsMap;
 	uint32_t oldPosition=position;
 	asAtomHandler::serialize(this,stringMap,objMap,traitsMap,wrk,obj);
 	return position-oldPosition;
@@ -607,9 +607,9 @@ void ByteArray::writeSharedObject(ASObject* obj, const tiny_string& name, ASWork
 	writeByte(0x00);
 	writeByte(0x03);// always store as AMF3
 
-	map<tiny_string, uint32_t> stringMap;
-	map<const ASObject*, uint32_t> objMap;
-	map<const Class_base*, uint32_t> traitsMap;
+	unordered_map<tiny_string, uint32_t> stringMap;
+	unordered_map<const ASObject*, uint32_t> objMap;
+	unordered_map<const Class_base*, uint32_t> traitsMap;
 	obj->serializeDynamicProperties(this, stringMap, objMap,traitsMap,wrk,true,true);
 	setPosition(sizepos);
 	writeUnsignedInt(GUINT32_TO_BE(getLength()-6));
@@ -1344,7 +1344,7 @@ void ByteArray::serializeDouble(number_t val)
 	
 }
 
-void ByteArray::writeStringVR(map<tiny_string, uint32_t>& stringMap, const tiny_string& s)
+void ByteArray::writeStringVR(unordered_map<tiny_string, uint32_t>& stringMap, const tiny_string& s)
 {
 	const uint32_t len=s.numBytes();
 	if(len >= 1<<28)
@@ -1395,7 +1395,7 @@ void ByteArray::writeStringAMF0(const tiny_string& s)
 	}
 }
 
-void ByteArray::writeXMLString(std::map<const ASObject*, uint32_t>& objMap,
+void ByteArray::writeXMLString(std::unordered_map<const ASObject*, uint32_t>& objMap,
 			       ASObject *xml,
 			       const tiny_string& xmlstr)
 {
@@ -1846,9 +1846,9 @@ ASFUNCTIONBODY_ATOM(ByteArray,_toJSON)
 	ret = asAtomHandler::fromString(wrk->getSystemState(),"ByteArray");
 }
 
-void ByteArray::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
+void ByteArray::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
 {
 	if (out->getObjectEncoding() == OBJECT_ENCODING::AMF0)
 	{
@@ -130,9 +130,9 @@ public:
 	uint32_t writeObject(ASObject* obj,ASWorker* wrk);
 	uint32_t writeAtomObject(asAtom obj,ASWorker* wrk);
 	void writeSharedObject(ASObject* obj, const tiny_string& name, ASWorker* wrk);
-	void writeStringVR(std::map<tiny_string, uint32_t>& stringMap, const tiny_string& s);
+	void writeStringVR(std::unordered_map<tiny_string, uint32_t>& stringMap, const tiny_string& s);
 	void writeStringAMF0(const tiny_string& s);
-	void writeXMLString(std::map<const ASObject*, uint32_t>& objMap, ASObject *xml, const tiny_string& s);
+	void writeXMLString(std::unordered_map<const ASObject*, uint32_t>& objMap, ASObject *xml, const tiny_string& s);
 	void writeU29(uint32_t val);
 	void serializeDouble(number_t val);
 
@@ -292,9 +292,9 @@ public:
 	void setVariableByMultiname_i(multiname& name, int32_t value,ASWorker* wrk) override;
 	bool hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype, ASWorker* wrk) override;
 
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
 };
 
 }
@@ -31,36 +31,40 @@ using namespace std;
 using namespace lightspark;
 
 Dictionary::Dictionary(ASWorker* wrk,Class_base* c):ASObject(wrk,c,T_OBJECT,SUBTYPE_DICTIONARY),
-	data(std::less<dictType::key_type>(), reporter_allocator<dictType::value_type>(c->memoryAccount)),weakkeys(false)
+	data(reporter_allocator<dictEntry>(c->memoryAccount)),
+	keyindex(0,std::hash<ASObject*>(),std::equal_to<ASObject*>(),reporter_allocator<keyIndexMap::value_type>(c->memoryAccount)),
+	freeslots(reporter_allocator<uint32_t>(c->memoryAccount)),
+	valuecomparedkeys(0),insertssinceweakpurge(0),weakkeys(false)
 {
 }
 
-void Dictionary::finalize()
+void Dictionary::clearData()
 {
-	auto it=data.begin();
-	while (it != data.end())
+	entryList tmp(data.get_allocator());
+	tmp.swap(data);
+	keyindex.clear();
+	freeslots.clear();
+	valuecomparedkeys=0;
+	insertssinceweakpurge=0;
+	for (auto it=tmp.begin(); it != tmp.end(); ++it)
 	{
-		ASObject* key = it->first;
-		ASObject* obj = asAtomHandler::getObject(it->second);
-		it = data.erase(it);
-		key->removeStoredMember();
+		if (!it->key)
+			continue;
+		ASObject* obj = asAtomHandler::getObject(it->value);
+		it->key->removeStoredMember();
 		if (obj)
 			obj->removeStoredMember();
 	}
 }
 
+void Dictionary::finalize()
+{
+	clearData();
+}
+
 bool Dictionary::destruct()
 {
-	auto it=data.begin();
-	while (it != data.end())
-	{
-		ASObject* key = it->first;
-		ASObject* obj = asAtomHandler::getObject(it->second);
-		it = data.erase(it);
-		key->removeStoredMember();
-		if (obj)
-			obj->removeStoredMember();
-	}
+	clearData();
 	weakkeys=false;
 	return destructIntern();
 }
@@ -71,8 +75,10 @@ void Dictionary::prepareShutdown()
 	ASObject::prepareShutdown();
 	for (auto it=data.begin() ; it != data.end(); ++it)
 	{
-		it->first->prepareShutdown();
-		ASObject* o = asAtomHandler::getObject(it->second);
+		if (!it->key)
+			continue;
+		it->key->prepareShutdown();
+		ASObject* o = asAtomHandler::getObject(it->value);
 		if (o)
 			o->prepareShutdown();
 	}
@@ -96,16 +102,96 @@ ASFUNCTIONBODY_ATOM(Dictionary,_toJSON)
 	ret = asAtomHandler::fromString(wrk->getSystemState(),"Dictionary");
 }
 
-Dictionary::dictType::iterator Dictionary::findKey(ASObject *o)
+bool Dictionary::isValueComparedKey(ASObject* o)
+{
+	switch (o->getObjectType())
+	{
+		case T_NULL:
+		case T_UNDEFINED:
+		case T_FUNCTION:
+			return true;
+		default:
+			break;
+	}
+	switch (o->getSubtype())
+	{
+		case SUBTYPE_XML:
+		case SUBTYPE_XMLLIST:
+		case SUBTYPE_DATE:
+			return true;
+		default:
+			return false;
+	}
+}
+
+uint32_t Dictionary::findKey(ASObject *o)
+{
+	auto it = keyindex.find(o);
+	if (it != keyindex.end())
+		return it->second;
+	// some objects are strictly equal to other instances, so we have to compare them one by one
+	if (valuecomparedkeys && isValueComparedKey(o))
+	{
+		for (uint32_t i=0; i < data.size(); i++)
+		{
+			ASObject* key = data[i].key;
+			if (key && isValueComparedKey(key) && key->isEqualStrict(o))
+				return i;
+		}
+	}
+	return UINT32_MAX;
+}
+
+void Dictionary::insertKey(ASObject* key, asAtom value)
 {
-	Dictionary::dictType::iterator it = data.begin();
-	for(; it!=data.end(); ++it)
+	if (weakkeys && ++insertssinceweakpurge > data.size()/2+16)
+		purgeWeakKeys();
+	key->incRef();
+	key->addStoredMember();
+	ASObject* obj = asAtomHandler::getObject(value);
+	if (obj)
+		obj->addStoredMember();
+	if (isValueComparedKey(key))
+		valuecomparedkeys++;
+	if (freeslots.empty())
+	{
+		keyindex[key]=data.size();
+		data.emplace_back(key,value);
+	}
+	else
 	{
-		if (it->first->isEqualStrict(o))
-			return it;
+		uint32_t index = freeslots.back();
+		freeslots.pop_back();
+		keyindex[key]=index;
+		data[index]=dictEntry(key,value);
 	}
+}
 
-	return data.end();
+void Dictionary::removeEntry(uint32_t index)
+{
+	ASObject* key = data[index].key;
+	ASObject* obj = asAtomHandler::getObject(data[index].value);
+	data[index].key=nullptr;
+	data[index].value=asAtomHandler::invalidAtom;
+	keyindex.erase(key);
+	freeslots.push_back(index);
+	if (isValueComparedKey(key))
+		valuecomparedkeys--;
+	if (obj)
+		obj->removeStoredMember();
+	key->removeStoredMember();
+}
+
+void Dictionary::purgeWeakKeys()
+{
+	insertssinceweakpurge=0;
+	if (!weakkeys)
+		return;
+	for (uint32_t i=0; i < data.size(); i++)
+	{
+		if (data[i].key && data[i].key->isLastRef())
+			removeEntry(i);
+	}
 }
 
 void Dictionary::setVariableByMultiname_i(multiname& name, int32_t value,ASWorker* wrk)
@@ -145,32 +231,26 @@ multiname *Dictionary::setVariableByMultiname(multiname& name, asAtom& o, CONST_
 				break;
 		}
 
-		Dictionary::dictType::iterator it=findKey(name.name_o);
-		if(it!=data.end())
+		uint32_t index=findKey(name.name_o);
+		if(index!=UINT32_MAX)
 		{
-			if (alreadyset && it->second.uintval == o.uintval)
+			dictEntry& entry = data[index];
+			if (alreadyset && entry.value.uintval == o.uintval)
 				*alreadyset=true;
 			else
 			{
-				asAtom oldvar = it->second;
-				ASObject* obj = asAtomHandler::getObject(oldvar);
-				if (obj)
-					obj->removeStoredMember();
-				it->second=o;
-				obj = asAtomHandler::getObject(o);
+				asAtom oldvar = entry.value;
+				entry.value=o;
+				ASObject* obj = asAtomHandler::getObject(o);
 				if (obj)
 					obj->addStoredMember();
+				obj = asAtomHandler::getObject(oldvar);
+				if (obj)
+					obj->removeStoredMember();
 			}
 		}
 		else
-		{
-			name.name_o->incRef();
-			name.name_o->addStoredMember();
-			ASObject* obj = asAtomHandler::getObject(o);
-			if (obj)
-				obj->addStoredMember();
-			data.insert(make_pair(name.name_o,o));
-		}
+			insertKey(name.name_o,o);
 	}
 	else
 	{
@@ -216,14 +296,10 @@ bool Dictionary::deleteVariableByMultiname(const multiname& name, ASWorker* wrk)
 				break;
 		}
 
-		Dictionary::dictType::iterator it=findKey(name.name_o);
-		if(it != data.end())
+		uint32_t index=findKey(name.name_o);
+		if(index != UINT32_MAX)
 		{
-			ASObject* obj = asAtomHandler::getObject(it->second);
-			if (obj)
-				obj->removeStoredMember();
-			data.erase(it);
-			name.name_o->removeStoredMember();
+			removeEntry(index);
 			return true;
 		}
 		return false;
@@ -271,17 +347,13 @@ GET_VARIABLE_RESULT Dictionary::getVariableByMultiname(asAtom& ret, const multin
 			}
 			bool islastref = name.name_o->isLastRef();
 
-			Dictionary::dictType::iterator it=findKey(name.name_o);
-			if(it != data.end())
+			uint32_t index=findKey(name.name_o);
+			if(index != UINT32_MAX)
 			{
-				ret = it->second;
+				ret = data[index].value;
+				ASATOM_INCREF(ret);
 				if (islastref && weakkeys)
-				{
-					name.name_o->removeStoredMember();
-					data.erase(it);
-				}
-				else
-					ASATOM_INCREF(ret);
+					removeEntry(index);
 				return GET_VARIABLE_RESULT::GETVAR_NORMAL;
 			}
 			else
@@ -339,8 +411,7 @@ bool Dictionary::hasPropertyByMultiname(const multiname& name, bool considerDyna
 			default:
 				break;
 		}
-		Dictionary::dictType::iterator it=findKey(name.name_o);
-		return it != data.end();
+		return findKey(name.name_o) != UINT32_MAX;
 	}
 	else
 	{
@@ -357,16 +428,21 @@ bool Dictionary::hasPropertyByMultiname(const multiname& name, bool considerDyna
 uint32_t Dictionary::nextNameIndex(uint32_t cur_index)
 {
 	assert_and_throw(implEnable);
-	if(cur_index<data.size())
+	if (cur_index==0)
+		purgeWeakKeys();
+	uint32_t s = data.size();
+	while (cur_index<s && !data[cur_index].key)
+		cur_index++;
+	if(cur_index<s)
 		return cur_index+1;
 	else
 	{
 		//Fall back on object properties
-		uint32_t ret=ASObject::nextNameIndex(cur_index-data.size());
+		uint32_t ret=ASObject::nextNameIndex(cur_index-s);
 		if(ret==0)
 			return 0;
 		else
-			return ret+data.size();
+			return ret+s;
 
 	}
 }
@@ -376,11 +452,14 @@ void Dictionary::nextName(asAtom& ret,uint32_t index)
 	assert_and_throw(implEnable);
 	if(index<=data.size())
 	{
-		auto it=data.begin();
-		for(unsigned int i=1;i<index;i++)
-			++it;
-		it->first->incRef();
-		ret = asAtomHandler::fromObject(it->first);
+		ASObject* key = data[index-1].key;
+		if (key)
+		{
+			key->incRef();
+			ret = asAtomHandler::fromObject(key);
+		}
+		else
+			asAtomHandler::setUndefined(ret);
 	}
 	else
 	{
@@ -394,12 +473,11 @@ void Dictionary::nextValue(asAtom& ret,uint32_t index)
 	assert_and_throw(implEnable);
 	if(index<=data.size())
 	{
-		auto it=data.begin();
-		for(unsigned int i=1;i<index;i++)
-			++it;
-
-		ASATOM_INCREF(it->second);
-		ret = it->second;
+		ret = data[index-1].value;
+		if (data[index-1].key)
+			ASATOM_INCREF(ret);
+		else
+			asAtomHandler::setUndefined(ret);
 	}
 	else
 	{
@@ -413,9 +491,11 @@ bool Dictionary::countCylicMemberReferences(garbagecollectorstate& gcstate)
 	bool ret = ASObject::countCylicMemberReferences(gcstate);
 	for (auto it = data.begin(); it != data.end(); it++)
 	{
-		ret = it->first->countAllCylicMemberReferences(gcstate) || ret;
-		if (asAtomHandler::isObject(it->second))
-			ret = asAtomHandler::getObjectNoCheck(it->second)->countAllCylicMemberReferences(gcstate) || ret;
+		if (!it->key)
+			continue;
+		ret = it->key->countAllCylicMemberReferences(gcstate) || ret;
+		if (asAtomHandler::isObject(it->value))
+			ret = asAtomHandler::getObjectNoCheck(it->value)->countAllCylicMemberReferences(gcstate) || ret;
 	}
 	return ret;
 }
@@ -424,13 +504,15 @@ tiny_string Dictionary::toString()
 {
 	std::stringstream retstr;
 	retstr << "{";
-	auto it=data.begin();
-	while(it != data.end())
+	bool first=true;
+	for (auto it=data.begin(); it != data.end(); ++it)
 	{
-		if(it != data.begin())
+		if (!it->key)
+			continue;
+		if(!first)
 			retstr << ", ";
-		retstr << "{" << it->first->toString() << ", " << asAtomHandler::toString(it->second,getInstanceWorker()) << "}";
-		++it;
+		first=false;
+		retstr << "{" << it->key->toString() << ", " << asAtomHandler::toString(it->value,getInstanceWorker()) << "}";
 	}
 	retstr << "}";
 
@@ -438,9 +520,9 @@ tiny_string Dictionary::toString()
 }
 
 
-void Dictionary::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
+void Dictionary::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
 {
 	if (out->getObjectEncoding() == OBJECT_ENCODING::AMF0)
 	{
@@ -470,7 +552,7 @@ void Dictionary::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stri
 		assert_and_throw(count<0x20000000);
 		uint32_t value = (count << 1) | 1;
 		out->writeU29(value);
-		out->writeByte(0x00); // TODO handle weak keys
+		out->writeByte(weakkeys ? 0x01 : 0x00);
 		
 		tmp = 0;
 		while ((tmp = nextNameIndex(tmp)) != 0)
@@ -22,6 +22,7 @@
 
 #include "compat.h"
 #include "swftypes.h"
+#include <unordered_map>
 
 
 namespace lightspark
@@ -31,12 +32,38 @@ class Dictionary: public ASObject
 {
 friend class ABCVm;
 private:
-	typedef std::map<ASObject*, asAtom> dictType;
-	dictType data;
-	dictType::iterator findKey(ASObject *);
+	struct dictEntry
+	{
+		ASObject* key; // nullptr for removed entries
+		asAtom value;
+		dictEntry(ASObject* k, asAtom v):key(k),value(v) {}
+	};
+	// entries never move, so that the indexes used for iteration stay stable even if a for..in loop is left early.
+	// the slots of removed entries are reused for new keys instead of compacting the list
+	typedef std::vector<dictEntry, reporter_allocator<dictEntry>> entryList;
+	typedef std::vector<uint32_t, reporter_allocator<uint32_t>> slotList;
+	typedef std::unordered_map<ASObject*, uint32_t, std::hash<ASObject*>, std::equal_to<ASObject*>,
+		reporter_allocator<std::pair<ASObject* const, uint32_t>>> keyIndexMap;
+	entryList data;
+	keyIndexMap keyindex;
+	// indexes of removed entries
+	slotList freeslots;
+	// number of keys that may be strictly equal to other objects than themselves (null, functions, dates, xml)
+	uint32_t valuecomparedkeys;
+	// number of insertions since weak keys were last checked
+	uint32_t insertssinceweakpurge;
 	bool weakkeys;
+	static bool isValueComparedKey(ASObject* o);
+	// returns the index into data or UINT32_MAX
+	uint32_t findKey(ASObject *);
+	void insertKey(ASObject* key, asAtom value);
+	void removeEntry(uint32_t index);
+	// removes all entries whose key is only referenced by this dictionary
+	void purgeWeakKeys();
+	void clearData();
 public:
 	Dictionary(ASWorker* wrk,Class_base* c);
+	void setWeakKeys(bool weak) { weakkeys = weak; }
 	void finalize() override;
 	bool destruct() override;
 	void prepareShutdown() override;
@@ -61,9 +88,9 @@ public:
 	void nextValue(asAtom &ret, uint32_t index) override;
 	bool countCylicMemberReferences(lightspark::garbagecollectorstate& gcstate) override;
 
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
 };
 
 }
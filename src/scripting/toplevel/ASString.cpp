@@ -33,30 +33,112 @@
 using namespace std;
 using namespace lightspark;
 
-ASString::ASString(ASWorker* wrk,Class_base* c):ASObject(wrk,c,T_STRING),hasId(true),datafilled(true)
+ASString::ASString(ASWorker* wrk,Class_base* c):ASObject(wrk,c,T_STRING),ropeleft(nullptr),ropenumbytes(0),ropenumchars(0),hasId(true),datafilled(true)
 {
 	stringId = BUILTIN_STRINGS::EMPTY;
 }
 
-ASString::ASString(ASWorker* wrk,Class_base* c,const string& s) : ASObject(wrk,c,T_STRING),data(s),hasId(false),datafilled(true)
+ASString::ASString(ASWorker* wrk,Class_base* c,const string& s) : ASObject(wrk,c,T_STRING),data(s),ropeleft(nullptr),ropenumbytes(0),ropenumchars(0),hasId(false),datafilled(true)
 {
 }
 
-ASString::ASString(ASWorker* wrk,Class_base* c,const tiny_string& s) : ASObject(wrk,c,T_STRING),data(s),hasId(false),datafilled(true)
+ASString::ASString(ASWorker* wrk,Class_base* c,const tiny_string& s) : ASObject(wrk,c,T_STRING),data(s),ropeleft(nullptr),ropenumbytes(0),ropenumchars(0),hasId(false),datafilled(true)
 {
 }
 
-ASString::ASString(ASWorker* wrk,Class_base* c,const char* s) : ASObject(wrk,c,T_STRING),data(s, /*copy:*/true),hasId(false),datafilled(true)
+ASString::ASString(ASWorker* wrk,Class_base* c,const char* s) : ASObject(wrk,c,T_STRING),data(s, /*copy:*/true),ropeleft(nullptr),ropenumbytes(0),ropenumchars(0),hasId(false),datafilled(true)
 {
 }
 
-ASString::ASString(ASWorker* wrk,Class_base* c,const char* s, uint32_t len) : ASObject(wrk,c,T_STRING)
+ASString::ASString(ASWorker* wrk,Class_base* c,const char* s, uint32_t len) : ASObject(wrk,c,T_STRING),ropeleft(nullptr),ropenumbytes(0),ropenumchars(0)
 {
 	data = std::string(s,len);
 	hasId = false;
 	datafilled=true;
 }
 
+void ASString::fillData()
+{
+	if (ropeleft)
+		flattenRope();
+	else
+		data = getSystemState()->getStringFromUniqueId(stringId);
+	datafilled = true;
+}
+
+void ASString::flattenRope()
+{
+	// collect the chain of concatenated parts without recursion, the chain may be very long
+	std::vector<ASString*> parts;
+	ASString* s = this;
+	while (s->ropeleft)
+	{
+		parts.push_back(s);
+		s = s->ropeleft;
+	}
+	const tiny_string& first = s->getData();
+	std::string buf;
+	buf.reserve(ropenumbytes);
+	buf.append(first.raw_buf(),first.numBytes());
+	for (auto it = parts.rbegin(); it != parts.rend(); it++)
+		buf.append((*it)->data.raw_buf(),(*it)->data.numBytes());
+	data = buf;
+	releaseRope();
+}
+
+void ASString::releaseRope()
+{
+	ASString* s = ropeleft;
+	ropeleft = nullptr;
+	ropenumbytes = 0;
+	ropenumchars = 0;
+	// detach the parts that are only referenced by this chain before releasing them to avoid deep recursion in destruct()
+	while (s)
+	{
+		ASString* next = nullptr;
+		if (s->isLastRef() && s->ropeleft)
+		{
+			next = s->ropeleft;
+			s->ropeleft = nullptr;
+		}
+		s->decRef();
+		s = next;
+	}
+}
+
+#define ROPE_MIN_BYTES 256
+#define ROPE_CHUNK_BYTES 512
+ASString* ASString::concatenate(ASWorker* wrk, ASString* left, const tiny_string& right)
+{
+	uint32_t leftbytes = left->ropeleft ? left->ropenumbytes : left->getData().numBytes();
+	if (right.empty() || leftbytes+right.numBytes() < ROPE_MIN_BYTES)
+	{
+		tiny_string res = left->getData();
+		res += right;
+		return abstract_s(wrk,res)->as<ASString>();
+	}
+	ASString* ret = Class<ASString>::getInstanceSNoArgs(wrk);
+	if (left->ropeleft && left->data.numBytes() < ROPE_CHUNK_BYTES)
+	{
+		// merge small appended parts, so the chain doesn't get one element for every single append
+		ret->ropeleft = left->ropeleft;
+		ret->data = left->data;
+		ret->data += right;
+	}
+	else
+	{
+		ret->ropeleft = left;
+		ret->data = right;
+	}
+	ret->ropeleft->incRef();
+	ret->ropenumbytes = leftbytes+right.numBytes();
+	ret->ropenumchars = left->numChars()+right.numChars();
+	ret->stringId = UINT32_MAX;
+	ret->hasId = false;
+	ret->datafilled = false;
+	return ret;
+}
+
 ASFUNCTIONBODY_ATOM(ASString,_constructor)
 {
 	ASString* th=asAtomHandler::as<ASString>(obj);
@@ -79,7 +161,7 @@ ASFUNCTIONBODY_ATOM(ASString,_getLength)
 	else if (asAtomHandler::isString(obj))
 	{
 		ASString* th = asAtomHandler::getObjectNoCheck(obj)->as<ASString>();
-		asAtomHandler::setInt(ret,wrk,int32_t(th->getData().numChars()));
+		asAtomHandler::setInt(ret,wrk,int32_t(th->numChars()));
 	}
 	else
 	{
@@ -148,58 +230,31 @@ ASFUNCTIONBODY_ATOM(ASString,search)
 		return;
 	}
 
-	int options=PCRE_UTF8|PCRE_NEWLINE_ANY|PCRE_NO_UTF8_CHECK;//|PCRE_JAVASCRIPT_COMPAT;
-	tiny_string restr;
+	std::shared_ptr<compiledRegExp> compiled;
+	const compiledRegExp* pcreRE;
 	if(asAtomHandler::is<RegExp>(args[0]))
-	{
-		RegExp* re=asAtomHandler::as<RegExp>(args[0]);
-		restr = re->source;
-		if(re->ignoreCase)
-			options|=PCRE_CASELESS;
-		if(re->extended)
-			options|=PCRE_EXTENDED;
-		if(re->multiline)
-			options|=PCRE_MULTILINE;
-		if(re->dotall)
-			options|=PCRE_DOTALL;
-	}
+		pcreRE = asAtomHandler::as<RegExp>(args[0])->compile(true);
 	else
 	{
-		restr = asAtomHandler::toString(args[0],wrk);
-	}
-
-	const char* error;
-	int errorOffset;
-	pcre* pcreRE=pcre_compile(restr.raw_buf(), options, &error, &errorOffset,nullptr);
-	if(error)
-	{
-		pcre_free(pcreRE);
-		asAtomHandler::setInt(ret,wrk,res);
-		return;
+		int options=PCRE_UTF8|PCRE_NEWLINE_ANY|PCRE_NO_UTF8_CHECK;//|PCRE_JAVASCRIPT_COMPAT;
+		compiled = regExpCache::get(wrk,asAtomHandler::toString(args[0],wrk),options);
+		pcreRE = compiled.get();
 	}
-	int capturingGroups;
-	int infoOk=pcre_fullinfo(pcreRE, nullptr, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-	if(infoOk!=0)
+	if(!pcreRE)
 	{
-		pcre_free(pcreRE);
 		asAtomHandler::setInt(ret,wrk,res);
 		return;
 	}
-	pcre_extra extra;
-	extra.match_limit_recursion=500;
-	extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
-	int ovector[(capturingGroups+1)*3];
+	int ovector[(pcreRE->capturingGroups+1)*3];
 	int offset=0;
 	//Global is not used in search
-	int rc=pcre_exec(pcreRE, &extra, data.raw_buf(), data.numBytes(), offset, PCRE_NO_UTF8_CHECK, ovector, (capturingGroups+1)*3);
+	int rc=pcreRE->exec(data, offset, ovector, 500);
 	if(rc<0)
 	{
 		//No matches or error
-		pcre_free(pcreRE);
 		asAtomHandler::setInt(ret,wrk,res);
 		return;
 	}
-	pcre_free(pcreRE);
 	res=ovector[0];
 	// pcre_exec returns byte position, so we have to convert it to character position 
 	tiny_string tmp = data.substr_bytes(0, res);
@@ -230,32 +285,34 @@ ASFUNCTIONBODY_ATOM(ASString,match)
 
 	if (re->global)
 	{
+		// only the matched substrings are needed, so no match arrays are created
 		Array *resarr = Class<Array>::getInstanceSNoArgs(wrk);
 		int prevLastIndex = 0;
 		re->lastIndex = 0;
-
-		while (true)
+		const compiledRegExp* pcreRE = re->compile(!data.isSinglebyte());
+		if (pcreRE)
 		{
-			ASObject *match = re->match(data);
-
-			if (match->is<Null>())
-				break;
-
-			if (re->lastIndex == prevLastIndex)
-				// ECMA-262 Section 15.5.4.10 says
-				// that we should increase
-				// re->lastIndex by one and repeat,
-				// but this is closer to the observed
-				// behaviour.
-				break;
-
-			prevLastIndex = re->lastIndex;
+			int ovector[(pcreRE->capturingGroups+1)*3];
+			while (true)
+			{
+				int rc=pcreRE->exec(data, re->lastIndex, ovector, pcreRE->capturingGroups > 500 ? 500 : 0);
+				if (rc<0)
+				{
+					re->lastIndex=0;
+					break;
+				}
+				re->lastIndex=ovector[1];
+				if (re->lastIndex == prevLastIndex)
+					// ECMA-262 Section 15.5.4.10 says
+					// that we should increase
+					// re->lastIndex by one and repeat,
+					// but this is closer to the observed
+					// behaviour.
+					break;
 
-			assert(match->is<Array>());
-			asAtom a = match->as<Array>()->at(0);
-			ASATOM_INCREF(a);
-			resarr->push(a);
-			match->decRef();
+				prevLastIndex = re->lastIndex;
+				resarr->push(asAtomHandler::fromObject(abstract_s(wrk, data.substr_bytes(ovector[0],ovector[1]-ovector[0]))));
+			}
 		}
 
 		// According to ECMA we should return Null if resarr
@@ -329,31 +386,20 @@ ASFUNCTIONBODY_ATOM(ASString,split)
 			return;
 		}
 
-		pcre* pcreRE = re->compile(!data.isSinglebyte());
+		const compiledRegExp* pcreRE = re->compile(!data.isSinglebyte());
 		if (!pcreRE)
 		{
 			ret = asAtomHandler::fromObject(res);
 			return;
 		}
-		int capturingGroups;
-		int infoOk=pcre_fullinfo(pcreRE, nullptr, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-		if(infoOk!=0)
-		{
-			pcre_free(pcreRE);
-			ret = asAtomHandler::fromObject(res);
-			return;
-		}
-		pcre_extra extra;
-		extra.match_limit_recursion=200;
-		extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
-		int ovector[(capturingGroups+1)*3];
+		int ovector[(pcreRE->capturingGroups+1)*3];
 		int offset=0;
 		unsigned int end;
 		uint32_t lastMatch = 0;
 		do
 		{
 			//offset is a byte offset that must point to the beginning of an utf8 character
-			int rc=pcre_exec(pcreRE, &extra, data.raw_buf(), data.numBytes(), offset, PCRE_NO_UTF8_CHECK, ovector, (capturingGroups+1)*3);
+			int rc=pcreRE->exec(data, offset, ovector, 200);
 			end=ovector[0];
 			if(rc<0)
 				break;
@@ -385,7 +431,6 @@ ASFUNCTIONBODY_ATOM(ASString,split)
 			ASObject* s=abstract_s(wrk,data.substr_bytes(lastMatch,data.numBytes()-lastMatch));
 			res->push(asAtomHandler::fromObject(s));
 		}
-		pcre_free(pcreRE);
 	}
 	else
 	{
@@ -486,7 +531,7 @@ ASFUNCTIONBODY_ATOM(ASString,substr)
 	else if (asAtomHandler::is<ASString>(obj))
 	{
 		ASString* th = asAtomHandler::as<ASString>(obj);
-		ret = asAtomHandler::fromObject(abstract_s(wrk,th->data.substr_bytes(th->getBytePosition(start),start+len >= numchars ? UINT32_MAX  : (th->getBytePosition(start+len)-th->getBytePosition(start)))));
+		ret = asAtomHandler::fromObject(abstract_s(wrk,th->getData().substr_bytes(th->getBytePosition(start),start+len >= numchars ? UINT32_MAX  : (th->getBytePosition(start+len)-th->getBytePosition(start)))));
 	}
 	else
 		ret = asAtomHandler::fromObject(abstract_s(wrk,asAtomHandler::toString(obj,wrk).substr(start,len)));
@@ -692,9 +737,9 @@ TRISTATE ASString::isLessAtom(asAtom& r)
 	return (a<b)?TTRUE:TFALSE;
 }
 
-void ASString::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
+void ASString::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
 {
 	if (out->getObjectEncoding() == OBJECT_ENCODING::AMF0)
 	{
@@ -713,6 +758,8 @@ string ASString::toDebugString() const
 	tiny_string ret;
 	if (!datafilled && hasId)
 		ret = std::string("\"") + std::string(getSystemState()->getStringFromUniqueId(stringId)) + "\"_id";
+	else if (ropeleft)
+		ret = std::string("\"...") + std::string(data) + "\"_concatenated";
 	else
 		ret = std::string("\"") + std::string(data) + "\"";
 #ifndef NDEBUG
@@ -991,40 +1038,31 @@ ASFUNCTIONBODY_ATOM(ASString,replace)
 	{
 		RegExp* re=asAtomHandler::as<RegExp>(args[0]);
 
-		pcre* pcreRE = re->compile(!data.isSinglebyte());
+		const compiledRegExp* pcreRE = re->compile(!data.isSinglebyte());
 		if (!pcreRE)
 		{
 			ret = asAtomHandler::fromObject(res);
 			return;
 		}
 
-		int capturingGroups;
-		int infoOk=pcre_fullinfo(pcreRE, nullptr, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-		if(infoOk!=0)
-		{
-			pcre_free(pcreRE);
-			ret = asAtomHandler::fromObject(res);
-			return;
-		}
-		pcre_extra extra;
-		extra.match_limit_recursion=200;
-		extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+		int capturingGroups=pcreRE->capturingGroups;
 		int ovector[(capturingGroups+1)*3];
+		// the result is assembled in a separate buffer while matching on the unmodified input
+		std::string out;
 		int offset=0;
-		int retDiff=0;
-		tiny_string prevsubstring = "";
+		int lastEnd=0;
+		bool matched=false;
 		do
 		{
 			tiny_string replaceWithTmp = replaceWith;
-			int rc=pcre_exec(pcreRE, &extra, res->getData().raw_buf(), res->getData().numBytes(), offset, PCRE_NO_UTF8_CHECK, ovector, (capturingGroups+1)*3);
+			int rc=pcreRE->exec(data, offset, ovector, 200);
 			if(rc<0)
 			{
 				//No matches or error
-				pcre_free(pcreRE);
-				ret = asAtomHandler::fromObject(res);
-				return;
+				break;
 			}
-			prevsubstring += res->getData().substr_bytes(offset,ovector[0]-offset);
+			matched=true;
+			out.append(data.raw_buf()+lastEnd,ovector[0]-lastEnd);
 			if(type==FUNC)
 			{
 				//Get the replace for this match
@@ -1032,15 +1070,15 @@ ASFUNCTIONBODY_ATOM(ASString,replace)
 				subargs.reserve(3+capturingGroups);
 
 				//we index on bytes, not on UTF-8 characters
-				subargs.push_back(asAtomHandler::fromObject(abstract_s(wrk,res->data.substr_bytes(ovector[0],ovector[1]-ovector[0]))));
+				subargs.push_back(asAtomHandler::fromObject(abstract_s(wrk,data.substr_bytes(ovector[0],ovector[1]-ovector[0]))));
 				for(int i=0;i<capturingGroups;i++)
 				{
 					if (ovector[i*2+2] >= 0)
-						subargs.push_back(asAtomHandler::fromObject(abstract_s(wrk,res->data.substr_bytes(ovector[i*2+2],ovector[i*2+3]-ovector[i*2+2]))));
+						subargs.push_back(asAtomHandler::fromObject(abstract_s(wrk,data.substr_bytes(ovector[i*2+2],ovector[i*2+3]-ovector[i*2+2]))));
 					else
 						subargs.push_back(asAtomHandler::undefinedAtom);
 				}
-				subargs.push_back(asAtomHandler::fromInt((int32_t)(ovector[0]-retDiff)));
+				subargs.push_back(asAtomHandler::fromInt((int32_t)ovector[0]));
 				subargs.push_back(asAtomHandler::fromObject(abstract_s(wrk,data)));
 				asAtom ret=asAtomHandler::invalidAtom;
 				asAtom obj = asAtomHandler::nullAtom;
@@ -1076,32 +1114,35 @@ ASFUNCTIONBODY_ATOM(ASString,replace)
 								replaceWithTmp.replace(ipos,1,"");
 								break;
 							case '&':
-								replaceWithTmp.replace(ipos-1,2,res->getData().substr_bytes(ovector[0], ovector[1]-ovector[0]));
+								replaceWithTmp.replace(ipos-1,2,data.substr_bytes(ovector[0], ovector[1]-ovector[0]));
 								break;
 							case '`':
-								replaceWithTmp.replace(ipos-1,2,prevsubstring);
+								replaceWithTmp.replace(ipos-1,2,data.substr_bytes(0, ovector[0]));
 								break;
 							case '\'':
-								replaceWithTmp.replace(ipos-1,2,res->getData().substr_bytes(ovector[1],res->getData().numBytes()-ovector[1]));
+								replaceWithTmp.replace(ipos-1,2,data.substr_bytes(ovector[1],data.numBytes()-ovector[1]));
 								break;
 						}
 						continue;
 					}
-					group = (i >= rc) ? "" : res->getData().substr_bytes(ovector[i*2], ovector[i*2+1]-ovector[i*2]);
+					group = (i >= rc) ? "" : data.substr_bytes(ovector[i*2], ovector[i*2+1]-ovector[i*2]);
 					replaceWithTmp.replace(pos, ipos-pos, group);
 				}
 			}
-			prevsubstring += res->getData().substr_bytes(ovector[0],ovector[1]-ovector[0]);
-			res->hasId = false;
-			res->getData().replace_bytes(ovector[0],ovector[1]-ovector[0],replaceWithTmp);
-			res->getData().checkValidUTF();
-			offset=ovector[0]+replaceWithTmp.numBytes();
+			out.append(replaceWithTmp.raw_buf(),replaceWithTmp.numBytes());
+			lastEnd=ovector[1];
+			offset=ovector[1];
 			if (ovector[0] == ovector[1])
 				offset+=1;
-			retDiff+=replaceWithTmp.numBytes()-(ovector[1]-ovector[0]);
 		}
-		while(re->global);
-		pcre_free(pcreRE);
+		while(re->global && offset <= (int)data.numBytes());
+		if (matched)
+		{
+			out.append(data.raw_buf()+lastEnd,data.numBytes()-lastEnd);
+			res->hasId = false;
+			res->getData() = tiny_string(out);
+			res->getData().checkValidUTF();
+		}
 	}
 	else
 	{
@@ -1125,8 +1166,9 @@ ASFUNCTIONBODY_ATOM(ASString,concat)
 	ASString* res=abstract_s(wrk,data)->as<ASString>();
 	for(unsigned int i=0;i<argslen;i++)
 	{
-		res->hasId = false;
-		res->getData()+=asAtomHandler::toString(args[i],wrk).raw_buf();
+		ASString* tmp = concatenate(wrk,res,asAtomHandler::toString(args[i],wrk));
+		res->decRef();
+		res = tmp;
 	}
 
 	ret = asAtomHandler::fromObject(res);
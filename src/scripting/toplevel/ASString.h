@@ -42,10 +42,16 @@ class ASString: public ASObject
 private:
 	number_t parseStringInfinite(const char *s, char **end) const;
 	tiny_string data;
-	
-	// stores the position of utf8-characters in the string
-	// speeds up direct access to characters by position
-	std::vector<uint32_t> charpositions;
+
+	// strings created by repeated concatenation are not copied immediately:
+	// the content is the content of ropeleft followed by data,
+	// it is flattened into data on first access
+	ASString* ropeleft;
+	uint32_t ropenumbytes;
+	uint32_t ropenumchars;
+	void fillData();
+	void flattenRope();
+	void releaseRope();
 public:
 	ASString(ASWorker* wrk,Class_base* c);
 	ASString(ASWorker* wrk,Class_base* c, const std::string& s);
@@ -58,18 +64,23 @@ public:
 	FORCE_INLINE tiny_string& getData()
 	{
 		if (!datafilled)
-		{
-			data = getSystemState()->getStringFromUniqueId(stringId);
-			datafilled = true;
-		}
+			fillData();
 		return data;
 	}
 	FORCE_INLINE bool isEmpty() const
 	{
 		if (hasId)
 			return stringId == BUILTIN_STRINGS::EMPTY || stringId == UINT32_MAX;
-		return data.empty();
+		return ropeleft == nullptr && data.empty();
 	}
+	// number of characters, doesn't flatten concatenated strings
+	FORCE_INLINE uint32_t numChars()
+	{
+		return ropeleft ? ropenumchars : getData().numChars();
+	}
+	// returns a new string containing left followed by right
+	// long strings are concatenated lazily, so that appending in a loop doesn't copy the whole string every time
+	static ASString* concatenate(ASWorker* wrk, ASString* left, const tiny_string& right);
 
 	static void sinit(Class_base* c);
 	ASFUNCTION_ATOM(_constructor);
@@ -103,18 +114,18 @@ public:
 
 	ASFUNCTION_ATOM(generator);
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
 	std::string toDebugString() const override;
 	static bool isEcmaSpace(uint32_t c);
 	static bool isEcmaLineTerminator(uint32_t c);
 	inline bool destruct() override
 	{
+		releaseRope();
 		data.clear(); 
 		hasId = false;
 		datafilled=false; 
-		charpositions.clear();
 		if (!destructIntern())
 		{
 			stringId = BUILTIN_STRINGS::EMPTY;
@@ -126,20 +137,10 @@ public:
 	}
 	inline uint32_t getBytePosition(uint32_t charpos)
 	{
+		getData();
 		if (charpos > data.numChars())
 			return UINT32_MAX;
-		if (data.isSinglebyte())
-			return charpos;
-		if (charpositions.empty())
-		{
-			charpositions.reserve(this->data.numChars());
-			for (auto it = data.begin(); it != data.end(); it++)
-			{
-				charpositions.push_back(it.ptr()-data.raw_buf());
-			}
-		}
-		return charpositions[charpos];
-		
+		return data.getBytePosition(charpos);
 	}
 };
 
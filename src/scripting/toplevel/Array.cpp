@@ -18,6 +18,7 @@
 **************************************************************************/
 
 #include "scripting/toplevel/Array.h"
+#include "scripting/toplevel/JSON.h"
 #include "scripting/abc.h"
 #include "scripting/argconv.h"
 #include "parsing/amf3_generator.h"
@@ -36,7 +37,7 @@
 using namespace std;
 using namespace lightspark;
 
-Array::Array(ASWorker* wrk, Class_base* c):ASObject(wrk,c,T_ARRAY),currentsize(0)
+Array::Array(ASWorker* wrk, Class_base* c):ASObject(wrk,c,T_ARRAY),currentsize(0),densecount(0)
 {
 }
 
@@ -54,6 +55,7 @@ void Array::finalize()
 	}
 	data_first.clear();
 	data_second.clear();
+	densecount=0;
 }
 
 bool Array::destruct()
@@ -70,6 +72,7 @@ bool Array::destruct()
 	}
 	data_first.clear();
 	data_second.clear();
+	densecount=0;
 	currentsize=0;
 	return destructIntern();
 }
@@ -90,6 +93,7 @@ void Array::prepareShutdown()
 		}
 	}
 	data_first.clear();
+	densecount=0;
 	for (auto it=data_second.begin() ; it != data_second.end();)
 	{
 		ASObject* o = asAtomHandler::getObject(it->second);
@@ -191,10 +195,7 @@ void Array::constructorImpl(asAtom* args, const unsigned int argslen)
 		}
 		LOG_CALL("Creating array of length " << size);
 		resize(size);
-		for (uint32_t i=0; i <size && i < ARRAY_SIZE_THRESHOLD; i++)
-		{
-			set(i,asAtomHandler::invalidAtom,false);
-		}
+		data_first.resize(min(size,uint32_t(ARRAY_SIZE_THRESHOLD)),asAtomHandler::invalidAtom);
 	}
 	else
 	{
@@ -225,6 +226,7 @@ ASFUNCTIONBODY_ATOM(Array,_concat)
 			ob->addStoredMember();
 		}
 	}
+	res->densecount=th->densecount;
 	auto it2=th->data_second.begin();
 	for(;it2 != th->data_second.end();++it2)
 	{
@@ -243,22 +245,20 @@ ASFUNCTIONBODY_ATOM(Array,_concat)
 		{
 			// Insert the contents of the array argument
 			uint64_t oldSize=res->currentsize;
-			uint64_t newSize=oldSize;
 			Array* otherArray=asAtomHandler::as<Array>(args[i]);
 			auto itother1=otherArray->data_first.begin();
 			for(;itother1!=otherArray->data_first.end(); ++itother1)
 			{
 				ASATOM_INCREF(*itother1);
 				res->push(*itother1);
-				newSize++;
 			}
+			res->resize(oldSize+otherArray->size());
 			auto itother2=otherArray->data_second.begin();
 			for(;itother2!=otherArray->data_second.end(); ++itother2)
 			{
 				asAtom a = itother2->second;
-				res->set(newSize+itother2->first, a,false);
+				res->set(oldSize+itother2->first, a,false);
 			}
-			res->resize(oldSize+otherArray->size());
 		}
 		else
 		{
@@ -298,20 +298,9 @@ ASFUNCTIONBODY_ATOM(Array,filter)
 	while (index < th->currentsize)
 	{
 		index++;
-		if (index <= ARRAY_SIZE_THRESHOLD)
-		{
-			asAtom& a =th->data_first.at(index-1);
-			if (asAtomHandler::isInvalid(a))
-				continue;
-			params[0] = a;
-		}
-		else
-		{
-			auto it=th->data_second.find(index-1);
-			if (it == th->data_second.end())
-				continue;
-			params[0] = it->second;
-		}
+		params[0] = th->getStored(index-1);
+		if (asAtomHandler::isInvalid(params[0]))
+			continue;
 
 		params[1] = asAtomHandler::fromUInt(index-1);
 		params[2] = asAtomHandler::fromObject(th);
@@ -369,20 +358,9 @@ ASFUNCTIONBODY_ATOM(Array, some)
 	while (index < th->currentsize)
 	{
 		index++;
-		if (index <= ARRAY_SIZE_THRESHOLD)
-		{
-			asAtom& a =th->data_first.at(index-1);
-			if (asAtomHandler::isInvalid(a))
-				continue;
-			params[0] = a;
-		}
-		else
-		{
-			auto it=th->data_second.find(index-1);
-			if (it == th->data_second.end())
-				continue;
-			params[0] = it->second;
-		}
+		params[0] = th->getStored(index-1);
+		if (asAtomHandler::isInvalid(params[0]))
+			continue;
 		params[1] = asAtomHandler::fromUInt(index-1);
 		params[2] = asAtomHandler::fromObject(th);
 
@@ -434,20 +412,9 @@ ASFUNCTIONBODY_ATOM(Array, every)
 	while (index < th->currentsize)
 	{
 		index++;
-		if (index <= ARRAY_SIZE_THRESHOLD)
-		{
-			asAtom& a =th->data_first.at(index-1);
-			if (asAtomHandler::isInvalid(a))
-				continue;
-			params[0] = a;
-		}
-		else
-		{
-			auto it=th->data_second.find(index-1);
-			if (it == th->data_second.end())
-				continue;
-			params[0] = it->second;
-		}
+		params[0] = th->getStored(index-1);
+		if (asAtomHandler::isInvalid(params[0]))
+			continue;
 		params[1] = asAtomHandler::fromUInt(index-1);
 		params[2] = asAtomHandler::fromObject(th);
 
@@ -522,22 +489,9 @@ ASFUNCTIONBODY_ATOM(Array,forEach)
 	while (index < s)
 	{
 		index++;
-		if (index <= ARRAY_SIZE_THRESHOLD)
-		{
-			asAtom& a =th->data_first.at(index-1);
-			if (asAtomHandler::isInvalid(a))
-				continue;
-			else
-				params[0] = a;
-		}
-		else
-		{
-			auto it=th->data_second.find(index-1);
-			if (it == th->data_second.end())
-				continue;
-			else
-				params[0]=it->second;
-		}
+		params[0] = th->getStored(index-1);
+		if (asAtomHandler::isInvalid(params[0]))
+			continue;
 		params[1] = asAtomHandler::fromUInt(index-1);
 		params[2] = asAtomHandler::fromObject(th);
 
@@ -571,6 +525,7 @@ ASFUNCTIONBODY_ATOM(Array, _reverse)
 		uint32_t size = th->size();
 		th->data_first.clear();
 		th->data_second.clear();
+		th->densecount=0;
 		auto it=tmp.begin();
 		for(;it != tmp.end();++it)
 		{
@@ -629,20 +584,9 @@ ASFUNCTIONBODY_ATOM(Array,lastIndexOf)
 	}
 	do
 	{
-		asAtom a=asAtomHandler::invalidAtom;
-		if ( i >= ARRAY_SIZE_THRESHOLD)
-		{
-			auto it = th->data_second.find(i);
-			if (it == th->data_second.end())
-				continue;
-			a = it->second;
-		}
-		else
-		{
-			a = th->data_first[i];
-			if (asAtomHandler::isInvalid(a))
-				continue;
-		}
+		asAtom a=th->getStored(i);
+		if (asAtomHandler::isInvalid(a))
+			continue;
 		if(asAtomHandler::isEqualStrict(a,wrk,arg0))
 		{
 			res=i;
@@ -691,27 +635,17 @@ ASFUNCTIONBODY_ATOM(Array,shift)
 		asAtomHandler::setUndefined(ret);
 		return;
 	}
-	if (th->data_first.size() > 0)
-		ret = th->data_first[0];
+	ret = th->getStored(0);
 	if (asAtomHandler::isInvalid(ret))
 		ret = asAtomHandler::undefinedAtom;
 	if (th->data_first.size() > 0)
-		th->data_first.erase(th->data_first.begin());
-
-	std::unordered_map<uint32_t,asAtom> tmp;
-	auto it=th->data_second.begin();
-	for (; it != th->data_second.end(); ++it )
 	{
-		if(it->first)
-		{
-			if (it->first == ARRAY_SIZE_THRESHOLD)
-				th->data_first[ARRAY_SIZE_THRESHOLD-1] = it->second;
-			else
-				tmp[it->first-1]=it->second;
-		}
+		if (asAtomHandler::isValid(th->data_first[0]))
+			th->densecount--;
+		th->data_first.erase(th->data_first.begin());
 	}
-	th->data_second.clear();
-	th->data_second.insert(tmp.begin(),tmp.end());
+	th->shiftSparseIndexes(1,-1);
+	th->densify();
 	th->resize(th->size()-1);
 	ASObject* o = asAtomHandler::getObject(ret);
 	if (o)
@@ -797,61 +731,44 @@ ASFUNCTIONBODY_ATOM(Array,splice)
 				res->set(i,a,false,false,false);
 		}
 		// delete items from current array (no need to decref/removemember, as they are added to the result)
-		for (int i = 0; i < deleteCount; i++)
-		{
-			if (i+startIndex < ARRAY_SIZE_THRESHOLD)
-			{
-				if ((uint32_t)startIndex <th->data_first.size())
-					th->data_first.erase(th->data_first.begin()+startIndex);
-			}
-			else
-			{
-				auto it = th->data_second.find(startIndex+i);
-				if (it != th->data_second.end())
-				{
-					th->data_second.erase(it);
-				}
-			}
-		}
-	}
-	// remember items in current array that have to be moved to new position
-	vector<asAtom> tmp = vector<asAtom>(totalSize- (startIndex+deleteCount));
-	for (uint32_t i = (uint32_t)startIndex+deleteCount; i < totalSize ; i++)
-	{
-		if (i < ARRAY_SIZE_THRESHOLD)
+		uint32_t firstsize = th->data_first.size();
+		if ((uint32_t)startIndex < firstsize)
 		{
-			if ((uint32_t)startIndex < th->data_first.size())
-			{
-				tmp[i-(startIndex+deleteCount)] = th->data_first[(uint32_t)startIndex];
-				th->data_first.erase(th->data_first.begin()+startIndex);
-			}
+			th->data_first.erase(th->data_first.begin()+startIndex,th->data_first.begin()+min((uint32_t)(startIndex+deleteCount),firstsize));
+			th->countDense();
 		}
-		else
+		if (!th->data_second.empty())
 		{
-			auto it = th->data_second.find(i);
-			if (it != th->data_second.end())
-			{
-				tmp[i-(startIndex+deleteCount)] = it->second;
-				th->data_second.erase(it);
-			}
+			for (int i = 0; i < deleteCount; i++)
+				th->data_second.erase(startIndex+i);
 		}
 	}
-	th->resize(startIndex,false);
+	uint32_t insertCount = argslen > 2 ? argslen-2 : 0;
+	// move items behind the deleted range to their new position
+	th->shiftSparseIndexes(startIndex+deleteCount,int64_t(insertCount)-deleteCount);
+	th->resize((totalSize-deleteCount)+insertCount,false);
 
-	
 	//Insert requested values starting at startIndex
-	for(unsigned int i=2;i<argslen;i++)
+	if ((uint32_t)startIndex <= th->data_first.size())
 	{
-		ASATOM_INCREF(args[i]);
-		th->push(args[i]);
+		th->data_first.insert(th->data_first.begin()+startIndex,args+2,args+2+insertCount);
+		th->densecount+=insertCount;
+		for(uint32_t i=0;i<insertCount;i++)
+		{
+			ASObject* o = asAtomHandler::getObject(args[i+2]);
+			if (o)
+			{
+				o->incRef();
+				o->addStoredMember();
+			}
+		}
 	}
-	// move remembered items to new position
-	th->resize((totalSize-deleteCount)+(argslen > 2 ? argslen-2 : 0));
-	for(uint32_t i=0;i<totalSize- (startIndex+deleteCount);i++)
+	else
 	{
-		if (asAtomHandler::isValid(tmp[i]))
-			th->set(startIndex+i+(argslen > 2 ? argslen-2 : 0),tmp[i],false,false,false);
+		for(uint32_t i=0;i<insertCount;i++)
+			th->set(startIndex+i,args[i+2],false);
 	}
+	th->densify();
 	ret =asAtomHandler::fromObject(res);
 }
 
@@ -960,22 +877,20 @@ ASFUNCTIONBODY_ATOM(Array,_pop)
 	if (size == 0)
 		return;
 	
-	if (size <= ARRAY_SIZE_THRESHOLD)
+	if (size <= th->data_first.size())
 	{
-		if (th->data_first.size() > 0)
+		ret = *th->data_first.rbegin();
+		th->data_first.pop_back();
+		if (asAtomHandler::isInvalid(ret))
+			asAtomHandler::setUndefined(ret);
+		else
 		{
-			ret = *th->data_first.rbegin();
-			th->data_first.pop_back();
-			if (asAtomHandler::isInvalid(ret))
-				asAtomHandler::setUndefined(ret);
-			else
+			th->densecount--;
+			ASObject* o = asAtomHandler::getObject(ret);
+			if (o)
 			{
-				ASObject* o = asAtomHandler::getObject(ret);
-				if (o)
-				{
-					o->incRef();// will be decreffed in removeStoreMember
-					o->removeStoredMember();
-				}
+				o->incRef();// will be decreffed in removeStoreMember
+				o->removeStoredMember();
 			}
 		}
 	}
@@ -1286,18 +1201,10 @@ ASFUNCTIONBODY_ATOM(Array,_sort)
 	else
 		sort(tmp.begin(),tmp.end(),sortComparatorDefault(wrk->getSystemState()->getSwfVersion() < 11, isNumeric,isCaseInsensitive,isDescending));
 
-	th->data_first.clear();
+	// sorted values are always contiguous, so they are all stored in the dense part
+	th->data_first.swap(tmp);
 	th->data_second.clear();
-	std::vector<asAtom>::iterator ittmp=tmp.begin();
-	int i = 0;
-	for(;ittmp != tmp.end();++ittmp)
-	{
-		if (i < ARRAY_SIZE_THRESHOLD)
-			th->data_first.push_back(*ittmp);
-		else
-			th->data_second[i] = *ittmp;
-		i++;
-	}
+	th->densecount=th->data_first.size();
 	ASATOM_INCREF(obj);
 	ret = obj;
 }
@@ -1459,22 +1366,20 @@ ASFUNCTIONBODY_ATOM(Array,sortOn)
 	
 	sort(tmp.begin(),tmp.end(),sortOnComparator(sortfields));
 
+	// sorted values are always contiguous, so they are all stored in the dense part
 	th->data_first.clear();
 	th->data_second.clear();
+	th->data_first.reserve(tmp.size());
 	std::vector<sorton_value>::iterator ittmp=tmp.begin();
-	uint32_t i = 0;
 	for(;ittmp != tmp.end();++ittmp)
 	{
-		if (i < ARRAY_SIZE_THRESHOLD)
-			th->data_first.push_back(ittmp->dataAtom);
-		else
-			th->data_second[i] = ittmp->dataAtom;
+		th->data_first.push_back(ittmp->dataAtom);
 		for (auto itsv = ittmp->sortvalues.begin(); itsv != ittmp->sortvalues.end(); itsv++)
 		{
 			ASATOM_DECREF(*itsv);
 		}
-		i++;
 	}
+	th->densecount=th->data_first.size();
 	// according to spec sortOn should return "nothing"(?), but it seems that the array is returned
 	ASATOM_INCREF(obj);
 	ret = obj;
@@ -1520,19 +1425,11 @@ ASFUNCTIONBODY_ATOM(Array,unshift)
 	if (argslen > 0)
 	{
 		th->resize(th->size()+argslen);
-		std::map<uint32_t,asAtom> tmp;
-		for (uint32_t i = 0; i< th->data_first.size(); i++)
-		{
-			tmp[i+argslen]=th->data_first[i];
-		}
-		for (auto it=th->data_second.begin(); it != th->data_second.end(); ++it )
-		{
-			tmp[it->first+argslen]=it->second;
-		}
-		
+		th->shiftSparseIndexes(0,argslen);
+		th->data_first.insert(th->data_first.begin(),args,args+argslen);
+		th->densecount+=argslen;
 		for(uint32_t i=0;i<argslen;i++)
 		{
-			tmp[i] = args[i];
 			ASObject* ob = asAtomHandler::getObject(args[i]);
 			if (ob)
 			{
@@ -1540,12 +1437,6 @@ ASFUNCTIONBODY_ATOM(Array,unshift)
 				ob->addStoredMember();
 			}
 		}
-		th->data_first.clear();
-		th->data_second.clear();
-		for (auto it=tmp.begin(); it != tmp.end(); ++it )
-		{
-			th->set(it->first,it->second,false,false,false);
-		}
 	}
 	asAtomHandler::setUInt(ret,wrk,(int32_t)th->size());
 }
@@ -1665,22 +1556,9 @@ ASFUNCTIONBODY_ATOM(Array,_map)
 	while (index < s)
 	{
 		index++;
-		if (index <= ARRAY_SIZE_THRESHOLD)
-		{
-			asAtom& a =th->data_first.at(index-1);
-			if(asAtomHandler::isValid(a))
-				params[0] = a;
-			else
-				params[0]=asAtomHandler::undefinedAtom;
-		}
-		else
-		{
-			auto it=th->data_second.find(index);
-			if(asAtomHandler::isValid(it->second))
-				params[0]=it->second;
-			else
-				params[0]=asAtomHandler::undefinedAtom;
-		}
+		params[0] = th->getStored(index-1);
+		if (asAtomHandler::isInvalid(params[0]))
+			params[0]=asAtomHandler::undefinedAtom;
 		params[1] = asAtomHandler::fromUInt(index-1);
 		params[2] = asAtomHandler::fromObject(th);
 		asAtom funcRet=asAtomHandler::invalidAtom;
@@ -1764,27 +1642,10 @@ ASFUNCTIONBODY_ATOM(Array,insertAt)
 	}
 	else
 	{
-		std::map<uint32_t,asAtom> tmp;
-		if (index < ARRAY_SIZE_THRESHOLD)
-			th->data_first.insert(th->data_first.begin()+index,o);
-		auto it=th->data_second.begin();
-		for (; it != th->data_second.end(); ++it )
-		{
-			tmp[it->first+(it->first >= (uint32_t)index ? 1 : 0)]=it->second;
-		}
-		if (th->data_first.size() > ARRAY_SIZE_THRESHOLD)
-		{
-			tmp[ARRAY_SIZE_THRESHOLD] = th->data_first[ARRAY_SIZE_THRESHOLD];
-			th->data_first.pop_back();
-		}
-		th->data_second.clear();
-		auto ittmp = tmp.begin();
-		while (ittmp != tmp.end())
-		{
-			th->set(ittmp->first,ittmp->second,false);
-			ittmp++;
-		}
+		th->shiftSparseIndexes(index,1);
 		th->currentsize++;
+		if ((uint32_t)index <= th->data_first.size())
+			th->data_first.insert(th->data_first.begin()+index,asAtomHandler::invalidAtom);
 		th->set(index,o,false);
 	}
 }
@@ -1799,15 +1660,12 @@ ASFUNCTIONBODY_ATOM(Array,removeAt)
 	if (index < 0)
 		index = 0;
 	asAtomHandler::setUndefined(ret);
-	if (index < ARRAY_SIZE_THRESHOLD)
+	if ((uint32_t)index < th->data_first.size())
 	{
-		if ((uint32_t)index < th->data_first.size())
-		{
-			ret = th->data_first[index];
-			if (asAtomHandler::isInvalid(ret))
-				asAtomHandler::setUndefined(ret);
-			th->data_first.erase(th->data_first.begin()+index);
-		}
+		ret = th->data_first[index];
+		if (asAtomHandler::isValid(ret))
+			th->densecount--;
+		th->data_first.erase(th->data_first.begin()+index);
 	}
 	else
 	{
@@ -1815,24 +1673,15 @@ ASFUNCTIONBODY_ATOM(Array,removeAt)
 		if(it != th->data_second.end())
 		{
 			ret = it->second;
-			if (asAtomHandler::isInvalid(ret))
-				asAtomHandler::setUndefined(ret);
 			th->data_second.erase(it);
 		}
 	}
+	if (asAtomHandler::isInvalid(ret))
+		asAtomHandler::setUndefined(ret);
 	if ((uint32_t)index < th->currentsize)
 		th->currentsize--;
-	std::map<uint32_t,asAtom> tmp;
-	auto it=th->data_second.begin();
-	for (; it != th->data_second.end(); ++it )
-	{
-		if (it->first == ARRAY_SIZE_THRESHOLD)
-			th->data_first[ARRAY_SIZE_THRESHOLD-1]=it->second;
-		else
-			tmp[it->first-(it->first > (uint32_t)index ? 1 : 0)]=it->second;
-	}
-	th->data_second.clear();
-	th->data_second.insert(tmp.begin(),tmp.end());
+	th->shiftSparseIndexes(index+1,-1);
+	th->densify();
 	ASObject* o = asAtomHandler::getObject(ret);
 	if (o)
 	{
@@ -1849,14 +1698,8 @@ int32_t Array::getVariableByMultiname_i(const multiname& name, ASWorker* wrk)
 
 	if(index<size())
 	{
-		if (index < ARRAY_SIZE_THRESHOLD)
-		{
-			return data_first.size() > index ? asAtomHandler::toInt(data_first.at(index)) : 0;
-		}
-		auto it = data_second.find(index);
-		if (it == data_second.end())
-			return 0;
-		return asAtomHandler::toInt(it->second);
+		asAtom a = getStored(index);
+		return asAtomHandler::isValid(a) ? asAtomHandler::toInt(a) : 0;
 	}
 
 	return ASObject::getVariableByMultiname_i(name,wrk);
@@ -1886,16 +1729,13 @@ GET_VARIABLE_RESULT Array::getVariableByMultiname(asAtom& ret, const multiname&
 		return GET_VARIABLE_RESULT::GETVAR_NORMAL;
 	}
 	
-	if (index < ARRAY_SIZE_THRESHOLD)
+	if (data_first.size() > index)
 	{
-		if (data_first.size() > index)
-		{
-			ret = data_first.at(index);
-			if (!(opt & NO_INCREF))
-				ASATOM_INCREF(ret);
-			if (asAtomHandler::isValid(ret))
-				return GET_VARIABLE_RESULT::GETVAR_NORMAL;
-		}
+		ret = data_first[index];
+		if (!(opt & NO_INCREF))
+			ASATOM_INCREF(ret);
+		if (asAtomHandler::isValid(ret))
+			return GET_VARIABLE_RESULT::GETVAR_NORMAL;
 	}
 	auto it = data_second.find(index);
 	if(it != data_second.end())
@@ -1932,16 +1772,13 @@ GET_VARIABLE_RESULT Array::getVariableByInteger(asAtom &ret, int index, GET_VARI
 	}
 	if (index >=0 && uint32_t(index) < size())
 	{
-		if (index < ARRAY_SIZE_THRESHOLD)
+		if (data_first.size() > uint32_t(index))
 		{
-			if (data_first.size() > uint32_t(index))
-			{
-				ret = data_first.at(index);
-				if (!(opt & NO_INCREF))
-					ASATOM_INCREF(ret);
-				if (asAtomHandler::isValid(ret))
-					return GET_VARIABLE_RESULT::GETVAR_NORMAL;
-			}
+			ret = data_first[index];
+			if (!(opt & NO_INCREF))
+				ASATOM_INCREF(ret);
+			if (asAtomHandler::isValid(ret))
+				return GET_VARIABLE_RESULT::GETVAR_NORMAL;
 		}
 		auto it = data_second.find(index);
 		if(it != data_second.end())
@@ -2000,12 +1837,7 @@ bool Array::hasPropertyByMultiname(const multiname& name, bool considerDynamic,
 	// Derived classes may be sealed!
 	if (getClass() && getClass()->isSealed)
 		return false;
-	if (index < ARRAY_SIZE_THRESHOLD)
-	{
-		return data_first.size() > index ? (asAtomHandler::isValid(data_first.at(index))) : false;
-	}
-	
-	return (data_second.find(index) != data_second.end());
+	return asAtomHandler::isValid(getStored(index));
 }
 
 bool Array::isValidMultiname(SystemState* sys, const multiname& name, uint32_t& index)
@@ -2116,6 +1948,8 @@ bool Array::deleteVariableByMultiname(const multiname& name, ASWorker* wrk)
 		ASObject* obj = asAtomHandler::getObject(data_first.at(index));
 		if (obj)
 			obj->removeStoredMember();
+		if (asAtomHandler::isValid(data_first[index]))
+			densecount--;
 		data_first[index]=asAtomHandler::invalidAtom;
 		return true;
 	}
@@ -2160,18 +1994,7 @@ tiny_string Array::toString_priv(bool localized)
 	string ret;
 	for(uint32_t i=0;i<size();i++)
 	{
-		asAtom sl=asAtomHandler::invalidAtom;
-		if (i < ARRAY_SIZE_THRESHOLD)
-		{
-			if (i < data_first.size())
-				sl = data_first[i];
-		}
-		else
-		{
-			auto it = data_second.find(i);
-			if(it != data_second.end())
-				sl = it->second;
-		}
+		asAtom sl=getStored(i);
 		if(asAtomHandler::isValid(sl) && !asAtomHandler::isNull(sl) && !asAtomHandler::isUndefined(sl))
 		{
 			if (localized)
@@ -2191,16 +2014,7 @@ void Array::nextValue(asAtom& ret,uint32_t index)
 	if(index<=size())
 	{
 		--index;
-		if (index < ARRAY_SIZE_THRESHOLD)
-			ret = data_first.at(index);
-		else
-		{
-			auto it = data_second.find(index);
-			if(it == data_second.end() || it->first != index)
-				asAtomHandler::setUndefined(ret);
-			else
-				ret = it->second;
-		}
+		ret = getStored(index);
 		if(asAtomHandler::isInvalid(ret))
 			asAtomHandler::setUndefined(ret);
 		else
@@ -2222,7 +2036,7 @@ uint32_t Array::nextNameIndex(uint32_t cur_index)
 	if(cur_index<s)
 	{
 		uint32_t firstsize = data_first.size();
-		while (cur_index < ARRAY_SIZE_THRESHOLD && cur_index<s && cur_index < firstsize && asAtomHandler::isInvalid(data_first.at(cur_index)))
+		while (cur_index<s && cur_index < firstsize && asAtomHandler::isInvalid(data_first.at(cur_index)))
 		{
 			cur_index++;
 		}
@@ -2262,18 +2076,7 @@ asAtom Array::at(unsigned int index)
 	if(size()<=index)
 		outofbounds(index);
 	
-	asAtom ret=asAtomHandler::invalidAtom;
-	if (index < ARRAY_SIZE_THRESHOLD)
-	{
-		if (index < data_first.size())
-			ret = data_first.at(index);
-	}
-	else
-	{
-		auto it = data_second.find(index);
-		if (it != data_second.end())
-			ret = it->second;
-	}
+	asAtom ret=getStored(index);
 	if(asAtomHandler::isValid(ret))
 	{
 		return ret;
@@ -2307,16 +2110,15 @@ void Array::resize(uint64_t n,bool removemember)
 	{
 		if (n < data_first.size())
 		{
-			if (removemember)
+			auto it1 = data_first.begin()+n;
+			while (it1 != data_first.end())
 			{
-				auto it1 = data_first.begin()+n;
-				while (it1 != data_first.end())
-				{
-					ASObject* o = asAtomHandler::getObject(*it1);
-					it1++;
-					if (o)
-						o->removeStoredMember();
-				}
+				if (asAtomHandler::isValid(*it1))
+					densecount--;
+				ASObject* o = asAtomHandler::getObject(*it1);
+				it1++;
+				if (removemember && o)
+					o->removeStoredMember();
 			}
 			data_first.resize(n);
 		}
@@ -2339,9 +2141,9 @@ void Array::resize(uint64_t n,bool removemember)
 	currentsize = n;
 }
 
-void Array::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
+void Array::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
 {
 	if (out->getObjectEncoding() == OBJECT_ENCODING::AMF0)
 	{
@@ -2368,56 +2170,41 @@ void Array::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap
 		serializeDynamicProperties(out, stringMap, objMap, traitsMap,wrk);
 		for(uint32_t i=0;i<denseCount;i++)
 		{
-			if (i < ARRAY_SIZE_THRESHOLD)
-			{
-				if (asAtomHandler::isInvalid(data_first.at(i)))
-					out->writeByte(null_marker);
-				else
-					asAtomHandler::serialize(out,stringMap, objMap, traitsMap,wrk,data_first.at(i));
-			}
+			asAtom a = getStored(i);
+			if (asAtomHandler::isInvalid(a))
+				out->writeByte(null_marker);
 			else
-			{
-				if (data_second.find(i) == data_second.end())
-					out->writeByte(null_marker);
-				else
-					asAtomHandler::serialize(out,stringMap, objMap, traitsMap,wrk,data_second.at(i));
-			}
+				asAtomHandler::serialize(out,stringMap, objMap, traitsMap,wrk,a);
 		}
 	}
 }
 
-tiny_string Array::toJSON(std::vector<ASObject *> &path, asAtom replacer, const tiny_string& spaces,const tiny_string& filter)
+void Array::toJSON(std::string& out, std::vector<ASObject *> &path, asAtom replacer, const tiny_string& spaces,const tiny_string& filter)
 {
-	bool ok;
-	tiny_string res = call_toJSON(ok,path,replacer,spaces,filter);
-	if (ok)
-		return res;
+	if (call_toJSON(out,path,replacer,spaces,filter))
+		return;
 	// check for cylic reference
 	if (std::find(path.begin(),path.end(), this) != path.end())
 	{
 		createError<TypeError>(getInstanceWorker(),kJSONCyclicStructure);
-		return res;
+		return;
 	}
 	
 	path.push_back(this);
-	res += "[";
+	out += '[';
 	bool bfirst = true;
-	tiny_string newline = (spaces.empty() ? "" : "\n");
 	uint32_t denseCount = currentsize;
 	asAtom closure = asAtomHandler::getClosureAtom(replacer,asAtomHandler::nullAtom);
 	
 	for (uint32_t i=0 ; i < denseCount; i++)
 	{
-		asAtom a=asAtomHandler::invalidAtom;
-		if ( i < ARRAY_SIZE_THRESHOLD)
-			a = data_first.at(i);
-		else
-		{
-			auto it = data_second.find(i);
-			if (it != data_second.end())
-				a = it->second;
-		}
-		tiny_string subres;
+		asAtom a=getStored(i);
+		// elements that produce no output are removed together with their separator
+		size_t mark = out.size();
+		if (!bfirst)
+			out += ',';
+		JSON::writeIndent(out,spaces);
+		size_t start = out.size();
 		if (asAtomHandler::isValid(replacer) && asAtomHandler::isValid(a))
 		{
 			asAtom params[2];
@@ -2428,107 +2215,154 @@ tiny_string Array::toJSON(std::vector<ASObject *> &path, asAtom replacer, const
 			asAtomHandler::callFunction(replacer,getInstanceWorker(),funcret,closure, params, 2,false);
 			if (asAtomHandler::isValid(funcret))
 			{
-				subres = asAtomHandler::toObject(funcret,getInstanceWorker())->toJSON(path,asAtomHandler::invalidAtom,spaces,filter);
+				JSON::writeAtom(out,funcret,path,asAtomHandler::invalidAtom,spaces,filter,getInstanceWorker());
 				ASATOM_DECREF(funcret);
 			}
 		}
+		else if (asAtomHandler::isInvalid(a))
+			out += "null";
+		else
+			JSON::writeAtom(out,a,path,replacer,spaces,filter,getInstanceWorker());
+		if (out.size() == start)
+			out.resize(mark);
 		else
-		{
-			asAtom tmp = a;
-			bool newobj = !asAtomHandler::isInvalid(a) && !asAtomHandler::isObject(a); // member is not a pointer to an ASObject, so toObject() will create a temporary ASObject that has to be decreffed after usage
-			ASObject* o = asAtomHandler::isInvalid(a) ? getSystemState()->getNullRef() : asAtomHandler::toObject(tmp,getInstanceWorker());
-			if (o)
-			{
-				subres = o->toJSON(path,replacer,spaces,filter);
-				if (newobj)
-					o->decRef();
-			}
-			else
-				continue;
-		}
-		if (!subres.empty())
-		{
-			if (!bfirst)
-				res += ",";
-			res += newline+spaces;
-			
 			bfirst = false;
-			res += subres;
-		}
 	}
 	if (!bfirst)
-		res += newline+spaces.substr_bytes(0,spaces.numBytes()/2);
-	res += "]";
+		JSON::writeIndent(out,spaces.substr_bytes(0,spaces.numBytes()/2));
+	out += ']';
 	path.pop_back();
-	return res;
-	
 }
 
 Array::~Array()
 {
 }
 
-bool Array::set(unsigned int index, asAtom& o, bool checkbounds, bool addref, bool addmember)
+bool Array::prepareDenseIndex(uint32_t index)
 {
-	bool ret = true;
-	if(index<currentsize)
+	uint32_t firstsize = data_first.size();
+	if (index < firstsize)
+		return true;
+	// the dense part only grows in small steps and as long as enough of its slots are used,
+	// so that sparse or strided writes don't allocate huge vectors of holes
+	if (index >= ARRAY_SIZE_THRESHOLD &&
+		(index > firstsize + firstsize/ARRAY_DENSE_GROWTH_DIVISOR
+		 || (uint64_t(densecount)+1)*ARRAY_DENSE_MIN_FILL_DIVISOR < uint64_t(index)+1))
+		return false;
+	data_first.resize(index+1,asAtomHandler::invalidAtom);
+	// move values that are now inside the dense part out of data_second
+	if (!data_second.empty())
 	{
-		if (index < ARRAY_SIZE_THRESHOLD)
+		if (data_second.size() < index+1-firstsize)
 		{
-			if (index < data_first.size())
+			for (auto it = data_second.begin(); it != data_second.end();)
 			{
-				if (data_first.at(index).uintval == o.uintval)
-					ret = false;
-				else
+				if (it->first <= index)
 				{
-					asAtom oldvar = data_first.at(index);
-					ASObject* obj = asAtomHandler::getObject(oldvar);
-					if (obj)
-						obj->removeStoredMember();
+					data_first[it->first] = it->second;
+					densecount++;
+					it = data_second.erase(it);
 				}
+				else
+					++it;
 			}
-			else
-				data_first.resize(index+1);
-			if (ret)
+		}
+		else
+		{
+			for (uint32_t i = firstsize; i <= index; i++)
 			{
-				ASObject* obj = asAtomHandler::getObject(o);
-				if (obj)
+				auto it = data_second.find(i);
+				if (it != data_second.end())
 				{
-					if (addref)
-						obj->incRef();
-					if (addmember)
-						obj->addStoredMember();
+					data_first[i] = it->second;
+					densecount++;
+					data_second.erase(it);
 				}
 			}
-			data_first[index]=o;
 		}
-		else
+		densify();
+	}
+	return true;
+}
+
+void Array::densify()
+{
+	while (!data_second.empty())
+	{
+		auto it = data_second.find(data_first.size());
+		if (it == data_second.end())
+			break;
+		data_first.push_back(it->second);
+		densecount++;
+		data_second.erase(it);
+	}
+}
+
+void Array::countDense()
+{
+	densecount=0;
+	for (auto it = data_first.begin(); it != data_first.end(); ++it)
+	{
+		if (asAtomHandler::isValid(*it))
+			densecount++;
+	}
+}
+
+void Array::shiftSparseIndexes(uint32_t start, int64_t delta)
+{
+	if (data_second.empty() || delta == 0)
+		return;
+	std::unordered_map<uint32_t,asAtom> tmp;
+	tmp.reserve(data_second.size());
+	for (auto it = data_second.begin(); it != data_second.end(); ++it)
+		tmp[it->first >= start ? uint32_t(int64_t(it->first)+delta) : it->first] = it->second;
+	data_second.swap(tmp);
+}
+
+bool Array::set(unsigned int index, asAtom& o, bool checkbounds, bool addref, bool addmember)
+{
+	bool ret = true;
+	if(index<currentsize)
+	{
+		asAtom* slot;
+		if (prepareDenseIndex(index))
 		{
-			if(data_second.find(index) != data_second.end())
+			slot = &data_first[index];
+			if (asAtomHandler::isInvalid(*slot) != asAtomHandler::isInvalid(o))
 			{
-				if (data_second[index].uintval == o.uintval)
-					ret = false;
+				if (asAtomHandler::isInvalid(o))
+					densecount--;
 				else
-				{
-					asAtom oldvar = data_second[index];
-					ASObject* obj = asAtomHandler::getObject(oldvar);
-					if (obj)
-						obj->removeStoredMember();
-				}
+					densecount++;
 			}
-			if (ret)
+		}
+		else
+		{
+			auto it = data_second.find(index);
+			if (it == data_second.end())
+				it = data_second.insert(make_pair(index,asAtomHandler::invalidAtom)).first;
+			slot = &it->second;
+		}
+		if (slot->uintval == o.uintval)
+			ret = false;
+		else
+		{
+			ASObject* obj = asAtomHandler::getObject(*slot);
+			if (obj)
+				obj->removeStoredMember();
+		}
+		if (ret)
+		{
+			ASObject* obj = asAtomHandler::getObject(o);
+			if (obj)
 			{
-				ASObject* obj = asAtomHandler::getObject(o);
-				if (obj)
-				{
-					if (addref)
-						obj->incRef();
-					if (addmember)
-						obj->addStoredMember();
-				}
+				if (addref)
+					obj->incRef();
+				if (addmember)
+					obj->addStoredMember();
 			}
-			data_second[index]=o;
 		}
+		*slot=o;
 	}
 	else if (checkbounds)
 		outofbounds(index);
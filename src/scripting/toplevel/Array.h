@@ -25,8 +25,12 @@
 
 namespace lightspark
 {
-// maximum index stored in vector
+// indexes below this are always stored in the vector
 #define ARRAY_SIZE_THRESHOLD 65536
+// beyond ARRAY_SIZE_THRESHOLD the vector may grow by 1/ARRAY_DENSE_GROWTH_DIVISOR of its size to store a new index
+#define ARRAY_DENSE_GROWTH_DIVISOR 8
+// beyond ARRAY_SIZE_THRESHOLD the vector only grows if at least 1/ARRAY_DENSE_MIN_FILL_DIVISOR of its slots are used
+#define ARRAY_DENSE_MIN_FILL_DIVISOR 4
 
 
 struct sorton_field
@@ -49,11 +53,22 @@ class Array: public ASObject
 friend class ABCVm;
 protected:
 	uint64_t currentsize;
-	// data is split into a vector for the first ARRAY_SIZE_THRESHOLD indexes, and a map for bigger indexes
+	// data is split into a vector for the dense part (indexes 0 to data_first.size()-1, holes are stored as invalid atoms)
+	// and a map for all indexes beyond the dense part
 	std::vector<asAtom> data_first;
 	std::unordered_map<uint32_t,asAtom> data_second;
+	// number of valid atoms in data_first
+	uint32_t densecount;
 	
 	void outofbounds(unsigned int index) const;
+	// returns true if index is stored in data_first, grows data_first if index is close enough to the dense part
+	bool prepareDenseIndex(uint32_t index);
+	// moves entries from data_second into data_first as long as they continue the dense part
+	void densify();
+	// adds delta to all indexes in data_second that are >= start
+	void shiftSparseIndexes(uint32_t start, int64_t delta);
+	// recomputes densecount after data_first was modified directly
+	void countDense();
 	~Array();
 private:
 	class sortComparatorDefault
@@ -130,19 +145,21 @@ public:
 	ASFUNCTION_ATOM(removeAt);
 
 	asAtom at(unsigned int index);
+	// returns the stored value at index or an invalid atom for holes, without incrementing the refcount
+	FORCE_INLINE asAtom getStored(uint32_t index) const
+	{
+		if (index < data_first.size())
+			return data_first[index];
+		auto it = data_second.find(index);
+		if (it != data_second.end())
+			return it->second;
+		return asAtomHandler::invalidAtom;
+	}
 	FORCE_INLINE void at_nocheck(asAtom& ret,unsigned int index)
 	{
-		if (index < ARRAY_SIZE_THRESHOLD)
-		{
-			if (index < data_first.size())
-				asAtomHandler::set(ret,data_first.at(index));
-		}
-		else
-		{
-			auto it = data_second.find(index);
-			if (it != data_second.end())
-				asAtomHandler::set(ret,it->second);
-		}
+		asAtom a = getStored(index);
+		if (asAtomHandler::isValid(a))
+			asAtomHandler::set(ret,a);
 		if (asAtomHandler::isInvalid(ret))
 			asAtomHandler::setUndefined(ret);
 	}
@@ -165,10 +182,10 @@ public:
 	void nextName(asAtom &ret, uint32_t index) override;
 	void nextValue(asAtom &ret, uint32_t index) override;
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
-	virtual tiny_string toJSON(std::vector<ASObject *> &path,asAtom replacer, const tiny_string &spaces,const tiny_string& filter) override;
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
+	void toJSON(std::string& out, std::vector<ASObject *> &path,asAtom replacer, const tiny_string &spaces,const tiny_string& filter) override;
 };
 
 
@@ -257,9 +257,9 @@ std::string IFunction::toDebugString() const
 #endif
 	return ret;
 }
-void IFunction::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
+void IFunction::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
 {
 	// according to avmplus functions are "serialized" as undefined
 	if (out->getObjectEncoding() == OBJECT_ENCODING::AMF0)
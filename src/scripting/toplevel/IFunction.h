@@ -116,9 +116,9 @@ public:
 	virtual multiname* callGetter(asAtom& ret, asAtom& target,ASWorker* wrk) =0;
 	virtual Class_base* getReturnType(bool opportunistic=false) =0;
 	std::string toDebugString() const override;
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
 };
 }
 
@@ -21,10 +21,17 @@
 #include "scripting/toplevel/JSON.h"
 #include "scripting/toplevel/Array.h"
 #include "scripting/toplevel/Integer.h"
+#include "scripting/toplevel/UInteger.h"
+#include "scripting/toplevel/Number.h"
+#include "scripting/toplevel/Boolean.h"
+#include "scripting/toplevel/ASString.h"
+#include "scripting/flash/system/flashsystem.h"
 
 using namespace std;
 using namespace lightspark;
 
+static int32_t findPrimitivesWithToJSON(ASWorker* wrk);
+
 JSON::JSON(ASWorker* wrk,Class_base* c):ASObject(wrk,c)
 {
 }
@@ -147,59 +154,345 @@ ASFUNCTIONBODY_ATOM(JSON,_stringify)
 				spaces = spaces.substr_bytes(0,10);
 		}
 	}
-	tiny_string res;
+	std::string res;
 	if (asAtomHandler::isObject(value))
-		res = asAtomHandler::getObjectNoCheck(value)->toJSON(path,replacer,spaces,filter);
+	{
+		// the prototypes of the primitive types are only searched for toJSON once per call
+		int32_t oldWithToJSON = wrk->primitivesWithToJSON;
+		wrk->primitivesWithToJSON = findPrimitivesWithToJSON(wrk);
+		try
+		{
+			asAtomHandler::getObjectNoCheck(value)->toJSON(res,path,replacer,spaces,filter);
+		}
+		catch(...)
+		{
+			wrk->primitivesWithToJSON = oldWithToJSON;
+			throw;
+		}
+		wrk->primitivesWithToJSON = oldWithToJSON;
+	}
 	else if (asAtomHandler::isUndefined(value))
 		res ="null";
 	else if(asAtomHandler::isString(value))
-		res = asAtomHandler::toString(value,wrk).toQuotedString();
+		writeQuotedString(res,asAtomHandler::toString(value,wrk));
 	else
-		res = asAtomHandler::toString(value,wrk);
-	ret = asAtomHandler::fromObject(abstract_s(wrk,res));
+	{
+		tiny_string s = asAtomHandler::toString(value,wrk);
+		res.append(s.raw_buf(),s.numBytes());
+	}
+	ret = asAtomHandler::fromObject(abstract_s(wrk,res.c_str(),res.size()));
+}
+
+void JSON::writeIndent(std::string& out, const tiny_string& spaces)
+{
+	if (spaces.empty())
+		return;
+	out += '\n';
+	out.append(spaces.raw_buf(),spaces.numBytes());
+}
+void JSON::writeQuotedString(std::string& out, const tiny_string& s)
+{
+	out += '\"';
+	const char* p = s.raw_buf();
+	const char* end = p+s.numBytes();
+	while (p < end)
+	{
+		// append runs of ASCII characters that don't need escaping at once
+		const char* start = p;
+		while (p < end && (uint8_t)*p >= 0x20 && (uint8_t)*p < 0x80 && *p != '\"' && *p != '\\')
+			p++;
+		out.append(start,p-start);
+		if (p >= end)
+			break;
+		switch (*p)
+		{
+			case '\b':
+				out += "\\b";
+				break;
+			case '\f':
+				out += "\\f";
+				break;
+			case '\n':
+				out += "\\n";
+				break;
+			case '\r':
+				out += "\\r";
+				break;
+			case '\t':
+				out += "\\t";
+				break;
+			case '\"':
+				out += "\\\"";
+				break;
+			case '\\':
+				out += "\\\\";
+				break;
+			default:
+			{
+				if ((uint8_t)*p < 0x20)
+				{
+					char hexstr[7];
+					sprintf(hexstr,"\\u%04x",(uint32_t)*p);
+					out += hexstr;
+					break;
+				}
+				// characters beyond latin-1 are escaped, all other characters are copied as UTF-8
+				const char* next = g_utf8_next_char(p);
+				uint32_t c = g_utf8_get_char(p);
+				if (c > 0xff)
+				{
+					char hexstr[16];
+					sprintf(hexstr,"\\u%04x",c);
+					out += hexstr;
+				}
+				else
+					out.append(p,next-p);
+				p = next;
+				continue;
+			}
+		}
+		p++;
+	}
+	out += '\"';
+}
+void JSON::writeNumber(std::string& out, number_t val)
+{
+	if (std::isnan(val) || std::isinf(val))
+	{
+		out += "null";
+		return;
+	}
+	// integral values are written directly, everything else uses the usual number formatting
+	if (val > -1e15 && val < 1e15 && val == (number_t)(int64_t)val)
+	{
+		char buf[24];
+		char* p = buf+sizeof(buf);
+		int64_t v = (int64_t)val;
+		uint64_t u = v < 0 ? -v : v;
+		do
+		{
+			*--p = '0'+(u%10);
+			u /= 10;
+		}
+		while (u);
+		if (v < 0)
+			*--p = '-';
+		out.append(p,buf+sizeof(buf)-p);
+		return;
+	}
+	tiny_string s = Number::toString(val);
+	out.append(s.raw_buf(),s.numBytes());
+}
+// bit of a primitive type in ASWorker::primitivesWithToJSON
+static int32_t primitiveToJSONBit(SWFOBJECT_TYPE t)
+{
+	switch (t)
+	{
+		case T_BOOLEAN:
+			return 1<<0;
+		case T_INTEGER:
+			return 1<<1;
+		case T_UINTEGER:
+			return 1<<2;
+		case T_NUMBER:
+			return 1<<3;
+		default:
+			return 1<<4;
+	}
+}
+static bool classHasToJSON(Class_base* c, multiname& toJSONName, ASWorker* wrk)
+{
+	// same lookup as ASObject::call_toJSON on the boxed value
+	if (c->borrowedVariables.findObjVar(wrk->getSystemState(),toJSONName,DECLARED_TRAIT))
+		return true;
+	Prototype* proto = c->getPrototype(wrk);
+	while(proto)
+	{
+		if(proto->getObj()->hasPropertyByMultiname(toJSONName,true,false,wrk))
+			return true;
+		proto=proto->prevPrototype.getPtr();
+	}
+	return false;
+}
+// returns the bitmask of all primitive types that have a toJSON method
+static int32_t findPrimitivesWithToJSON(ASWorker* wrk)
+{
+	SystemState* sys = wrk->getSystemState();
+	multiname toJSONName(nullptr);
+	toJSONName.name_type=multiname::NAME_STRING;
+	toJSONName.name_s_id=BUILTIN_STRINGS::STRING_TOJSON;
+	toJSONName.ns.emplace_back(sys,BUILTIN_STRINGS::EMPTY,NAMESPACE);
+	toJSONName.ns.emplace_back(sys,BUILTIN_STRINGS::STRING_AS3NS,NAMESPACE);
+	toJSONName.isAttribute = false;
+	int32_t res = 0;
+	if (classHasToJSON(Class<Boolean>::getClass(sys),toJSONName,wrk))
+		res |= primitiveToJSONBit(T_BOOLEAN);
+	if (classHasToJSON(Class<Integer>::getClass(sys),toJSONName,wrk))
+		res |= primitiveToJSONBit(T_INTEGER);
+	if (classHasToJSON(Class<UInteger>::getClass(sys),toJSONName,wrk))
+		res |= primitiveToJSONBit(T_UINTEGER);
+	if (classHasToJSON(Class<Number>::getClass(sys),toJSONName,wrk))
+		res |= primitiveToJSONBit(T_NUMBER);
+	if (classHasToJSON(Class<ASString>::getClass(sys),toJSONName,wrk))
+		res |= primitiveToJSONBit(T_STRING);
+	return res;
+}
+bool JSON::writePrimitive(std::string& out, asAtom a, ASWorker* wrk, bool checktoJSON)
+{
+	switch (asAtomHandler::getObjectType(a))
+	{
+		case T_NULL:
+		case T_UNDEFINED:
+			out += "null";
+			return true;
+		case T_BOOLEAN:
+		case T_INTEGER:
+		case T_UINTEGER:
+		case T_NUMBER:
+		case T_STRING:
+			break;
+		default:
+			return false;
+	}
+	if (checktoJSON)
+	{
+		// outside of JSON.stringify the prototypes have to be checked every time
+		int32_t withToJSON = wrk->primitivesWithToJSON;
+		if (withToJSON < 0)
+			withToJSON = findPrimitivesWithToJSON(wrk);
+		if (withToJSON & primitiveToJSONBit(asAtomHandler::getObjectType(a)))
+			return false;
+	}
+	switch (asAtomHandler::getObjectType(a))
+	{
+		case T_BOOLEAN:
+			out += asAtomHandler::toInt(a) ? "true" : "false";
+			break;
+		case T_INTEGER:
+			writeNumber(out,asAtomHandler::toInt(a));
+			break;
+		case T_UINTEGER:
+			writeNumber(out,asAtomHandler::toUInt(a));
+			break;
+		case T_NUMBER:
+			writeNumber(out,asAtomHandler::toNumber(a));
+			break;
+		default:
+			writeQuotedString(out,asAtomHandler::toString(a,wrk));
+			break;
+	}
+	return true;
+}
+void JSON::writeAtom(std::string& out, asAtom a, std::vector<ASObject*>& path, asAtom replacer, const tiny_string& spaces, const tiny_string& filter, ASWorker* wrk)
+{
+	if (writePrimitive(out,a,wrk))
+		return;
+	asAtom tmp = a;
+	bool newobj = !asAtomHandler::isObject(a); // value is not a pointer to an ASObject, so toObject() will create a temporary ASObject that has to be decreffed after usage
+	ASObject* o = asAtomHandler::toObject(tmp,wrk);
+	o->toJSON(out,path,replacer,spaces,filter);
+	if (newobj)
+		o->decRef();
+}
+
+static FORCE_INLINE bool isJSONWhitespace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+static FORCE_INLINE void skipJSONWhitespace(const char*& it, const char* end)
+{
+	while (it < end && isJSONWhitespace(*it))
+		it++;
+}
+static FORCE_INLINE bool isJSONNumberChar(char c)
+{
+	return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+static bool parseJSONNumber(const char* start, const char* end, number_t& num, bool& isinteger)
+{
+	// fast path for integers that can be represented exactly
+	const char* p = start;
+	bool negative = *p == '-';
+	if (negative)
+		p++;
+	if (p < end && end-p <= 15)
+	{
+		int64_t v = 0;
+		const char* d = p;
+		while (d < end && *d >= '0' && *d <= '9')
+			v = v*10 + (*d++ - '0');
+		if (d == end)
+		{
+			num = negative ? -(number_t)v : (number_t)v;
+			isinteger = !(negative && v == 0) && num >= INT32_MIN && num <= INT32_MAX;
+			return true;
+		}
+	}
+	isinteger = false;
+	std::string tmp(start,end-start);
+	char* numend = nullptr;
+	errno = 0;
+	num = g_ascii_strtod(tmp.c_str(), &numend);
+	if (numend != tmp.c_str()+tmp.size())
+		return false;
+	if (errno == ERANGE)
+	{
+		if (num == HUGE_VAL)
+			num = numeric_limits<double>::infinity();
+		else if (num == -HUGE_VAL)
+			num = -numeric_limits<double>::infinity();
+	}
+	else if (std::isinf(num) || std::isnan(num))
+		return false;
+	return true;
+}
+static FORCE_INLINE bool setJSONValue(asAtom& parent, multiname& key, asAtom v, ASWorker* wrk)
+{
+	if (asAtomHandler::isInvalid(parent))
+		parent = v;
+	else if (asAtomHandler::isObject(parent))
+		asAtomHandler::getObjectNoCheck(parent)->setVariableByMultiname(key,v,ASObject::CONST_NOT_ALLOWED,nullptr,wrk);
+	else
+	{
+		ASATOM_DECREF(v);
+		return false;
+	}
+	return true;
 }
 
 bool JSON::parseAll(const tiny_string &jsonstring, asAtom& parent , multiname& key, asAtom reviver, ASWorker* wrk)
 {
-	CharIterator it = jsonstring.begin();
-	while (it != jsonstring.end())
+	// JSON syntax only consists of ASCII characters, so the parser works directly on the UTF-8 bytes
+	const char* it = jsonstring.raw_buf();
+	const char* end = it+jsonstring.numBytes();
+	while (it < end)
 	{
 		if (asAtomHandler::isPrimitive(parent))
 			return false;
-		if (!parse(jsonstring, it, parent , key, reviver,wrk))
+		if (!parse(it, end, parent , key, reviver,wrk))
 			return false;
-		while (*it == ' ' ||
-			   *it == '\t' ||
-			   *it == '\n' ||
-			   *it == '\r'
-			   )
-			it++;
+		skipJSONWhitespace(it,end);
 	}
 	return true;
 }
-bool JSON::parse(const tiny_string &jsonstring, CharIterator& it, asAtom& parent , multiname& key, asAtom reviver, ASWorker* wrk)
+bool JSON::parse(const char*& it, const char* end, asAtom& parent , multiname& key, asAtom reviver, ASWorker* wrk)
 {
-	while (*it == ' ' ||
-		   *it == '\t' ||
-		   *it == '\n' ||
-		   *it == '\r'
-		   )
-		   it++;
-	if (it != jsonstring.end())
+	skipJSONWhitespace(it,end);
+	if (it < end)
 	{
 		char c = *it;
 		switch(c)
 		{
 			case '{':
-				if (!parseObject(jsonstring,it,parent,key, reviver,wrk))
+				if (!parseObject(it,end,parent,key, reviver,wrk))
 					return false;
 				break;
 			case '[': 
-				if (!parseArray(jsonstring,it,parent,key, reviver,wrk))
+				if (!parseArray(it,end,parent,key, reviver,wrk))
 					return false;
 				break;
 			case '"':
-				if (!parseString(jsonstring,it,parent,key,wrk))
+				if (!parseString(it,end,parent,key,wrk))
 					return false;
 				break;
 			case '0':
@@ -213,19 +506,19 @@ bool JSON::parse(const tiny_string &jsonstring, CharIterator& it, asAtom& parent
 			case '8':
 			case '9':
 			case '-':
-				if (!parseNumber(jsonstring,it,parent,key,wrk))
+				if (!parseNumber(it,end,parent,key,wrk))
 					return false;
 				break;
 			case 't':
-				if (!parseTrue(it,parent,key,wrk))
+				if (!parseLiteral(it,end,"true",asAtomHandler::trueAtom,parent,key,wrk))
 					return false;
 				break;
 			case 'f':
-				if (!parseFalse(it,parent,key,wrk))
+				if (!parseLiteral(it,end,"false",asAtomHandler::falseAtom,parent,key,wrk))
 					return false;
 				break;
 			case 'n':
-				if (!parseNull(it,parent,key,wrk))
+				if (!parseLiteral(it,end,"null",asAtomHandler::nullAtom,parent,key,wrk))
 					return false;
 				break;
 			default:
@@ -298,250 +591,125 @@ bool JSON::parse(const tiny_string &jsonstring, CharIterator& it, asAtom& parent
 	}
 	return true;
 }
-bool JSON::parseTrue(CharIterator& it, asAtom& parent, multiname &key, ASWorker* wrk)
-{
-	if (*it++ != 't')
-		return false;
-	if (*it++ != 'r')
-		return false;
-	if (*it++ != 'u')
-		return false;
-	if (*it++ != 'e')
-		return false;
-	if (asAtomHandler::isInvalid(parent))
-		parent = asAtomHandler::trueAtom;
-	else if (asAtomHandler::isObject(parent))
-	{
-		asAtom v = asAtomHandler::trueAtom;
-		asAtomHandler::getObjectNoCheck(parent)->setVariableByMultiname(key,v,ASObject::CONST_NOT_ALLOWED,nullptr,wrk);
-	}
-	else
-		return false;
-	return true;
-}
-bool JSON::parseFalse(CharIterator& it, asAtom& parent, multiname &key, ASWorker* wrk)
-{
-	if (*it++ != 'f')
-		return false;
-	if (*it++ != 'a')
-		return false;
-	if (*it++ != 'l')
-		return false;
-	if (*it++ != 's')
-		return false;
-	if (*it++ != 'e')
-		return false;
-	if (asAtomHandler::isInvalid(parent))
-		parent = asAtomHandler::falseAtom;
-	else if (asAtomHandler::isObject(parent))
-	{
-		asAtom v = asAtomHandler::falseAtom;
-		asAtomHandler::getObjectNoCheck(parent)->setVariableByMultiname(key,v,ASObject::CONST_NOT_ALLOWED,nullptr,wrk);
-	}
-	else
-		return false;
-	return true;
-}
-bool JSON::parseNull(CharIterator& it, asAtom& parent, multiname &key, ASWorker* wrk)
+bool JSON::parseLiteral(const char*& it, const char* end, const char* literal, asAtom value, asAtom& parent, multiname &key, ASWorker* wrk)
 {
-	if (*it++ != 'n')
-		return false;
-	if (*it++ != 'u')
-		return false;
-	if (*it++ != 'l')
+	size_t len = strlen(literal);
+	if (size_t(end-it) < len || strncmp(it,literal,len) != 0)
 		return false;
-	if (*it++ != 'l')
-		return false;
-	if (asAtomHandler::isInvalid(parent))
-		parent = asAtomHandler::nullAtom;
-	else if (asAtomHandler::isObject(parent))
-	{
-		asAtom v = asAtomHandler::nullAtom;
-		asAtomHandler::getObjectNoCheck(parent)->setVariableByMultiname(key,v,ASObject::CONST_NOT_ALLOWED,nullptr,wrk);
-	}
-	else
-		return false;
-	return true;
+	it += len;
+	return setJSONValue(parent,key,value,wrk);
 }
-bool JSON::parseString(const tiny_string& jsonstring, CharIterator& it, asAtom& parent, multiname &key, ASWorker* wrk, tiny_string* result)
+bool JSON::parseString(const char*& it, const char* end, asAtom& parent, multiname &key, ASWorker* wrk, tiny_string* result)
 {
 	it++; // ignore starting quotes
-	if (it == jsonstring.end())
+	if (it >= end)
 		return false;
 
-	tiny_string res;
+	std::string res;
 	bool done = false;
-	while (it!=jsonstring.end())
+	while (it < end)
 	{
+		// copy all bytes up to the next quote, backslash or control character at once
+		const char* start = it;
+		while (it < end && *it != '\"' && *it != '\\' && (uint8_t)*it >= 0x20)
+			it++;
+		res.append(start,it-start);
+		if (it >= end)
+			break;
 		if (*it == '\"')
 		{
 			it++;
 			done = true;
 			break;
 		}
-		else if(*it == '\\')
+		if ((uint8_t)*it < 0x20)
+			return false;
+		// escape sequence
+		it++;
+		if (it >= end)
+			break;
+		switch (*it)
 		{
-			it++;
-			if (it == jsonstring.end())
-				break;
-			if(*it == '\"')
+			case '\"':
 				res += '\"';
-			else if(*it == '\\')
+				break;
+			case '\\':
 				res += '\\';
-			else if(*it == '/')
+				break;
+			case '/':
 				res += '/';
-			else if(*it == 'b')
+				break;
+			case 'b':
 				res += '\b';
-			else if(*it == 'f')
+				break;
+			case 'f':
 				res += '\f';
-			else if(*it == 'n')
+				break;
+			case 'n':
 				res += '\n';
-			else if(*it == 'r')
+				break;
+			case 'r':
 				res += '\r';
-			else if(*it == 't')
+				break;
+			case 't':
 				res += '\t';
-			else if(*it == 'u')
+				break;
+			case 'u':
 			{
-				tiny_string strhex;
+				uint32_t hexnum = 0;
 				for (int i = 0; i < 4; i++)
 				{
 					it++;
-					if (it == jsonstring.end())
-						return false;
-					switch(*it)
-					{
-						case '0':
-						case '1':
-						case '2':
-						case '3':
-						case '4':
-						case '5':
-						case '6':
-						case '7':
-						case '8':
-						case '9':
-						case 'a':
-						case 'b':
-						case 'c':
-						case 'd':
-						case 'e':
-						case 'f':
-						case 'A':
-						case 'B':
-						case 'C':
-						case 'D':
-						case 'E':
-						case 'F':
-							strhex += *it;
-							break;
-						default:
-							return false;
-					}
-					if (it == jsonstring.end())
+					if (it >= end)
 						return false;
-				}
-				number_t hexnum;
-				if (Integer::fromStringFlashCompatible(strhex.raw_buf(),hexnum,16))
-				{
-					if (hexnum < 0x20 && hexnum != 0xf)
+					char c = *it;
+					if (c >= '0' && c <= '9')
+						hexnum = (hexnum<<4) | (c-'0');
+					else if (c >= 'a' && c <= 'f')
+						hexnum = (hexnum<<4) | (c-'a'+10);
+					else if (c >= 'A' && c <= 'F')
+						hexnum = (hexnum<<4) | (c-'A'+10);
+					else
 						return false;
-					res += tiny_string::fromChar(hexnum);
 				}
-				else
-					break;
+				if (hexnum < 0x20 && hexnum != 0xf)
+					return false;
+				tiny_string ch = tiny_string::fromChar(hexnum);
+				res.append(ch.raw_buf(),ch.numBytes());
+				break;
 			}
-			else
+			default:
 				return false;
 		}
-		else if (*it < 0x20)
-			return false;
-		else
-		{
-			res += *it;
-		}
 		it++;
 	}
 	if (!done)
 		return false;
 	
 	if (result)
-		*result =res;
+		*result = res;
 	else
-	{
-		if (asAtomHandler::isInvalid(parent))
-			parent = asAtomHandler::fromObject(abstract_s(wrk,res));
-		else if (asAtomHandler::isObject(parent))
-		{
-			asAtom v = asAtomHandler::fromObject(abstract_s(wrk,res));
-			asAtomHandler::getObjectNoCheck(parent)->setVariableByMultiname(key,v,ASObject::CONST_NOT_ALLOWED,nullptr,wrk);
-		}
-		else
-			return false;
-	}
+		return setJSONValue(parent,key,asAtomHandler::fromObject(abstract_s(wrk,res)),wrk);
 	return true;
 }
-bool JSON::parseNumber(const tiny_string &jsonstring, CharIterator& it, asAtom& parent, multiname &key, ASWorker* wrk)
+bool JSON::parseNumber(const char*& it, const char* end, asAtom& parent, multiname &key, ASWorker* wrk)
 {
-	tiny_string res;
-	bool done = false;
-	while (!done && it != jsonstring.end())
-	{
-		char c = *it;
-		switch(c)
-		{
-			case '0':
-			case '1':
-			case '2':
-			case '3':
-			case '4':
-			case '5':
-			case '6':
-			case '7':
-			case '8':
-			case '9':
-			case '-':
-			case '+':
-			case '.':
-			case 'E':
-			case 'e':
-				res += c;
-				it++;
-				break;
-			default:
-				done = true;
-				break;
-		}
-	}
-	ASObject* numstr = abstract_s(wrk,res);
-	number_t num = numstr->toNumber();
-	numstr->decRef();
-
-	if (std::isnan(num))
-		return false;
-
-	if (asAtomHandler::isInvalid(parent))
-		parent = asAtomHandler::fromNumber(wrk,num,false);
-	else if (asAtomHandler::isObject(parent))
-	{
-		asAtom v = asAtomHandler::fromNumber(wrk,num,false);
-		asAtomHandler::getObjectNoCheck(parent)->setVariableByMultiname(key,v,ASObject::CONST_NOT_ALLOWED,nullptr,wrk);
-	}
-	else
+	const char* start = it;
+	while (it < end && isJSONNumberChar(*it))
+		it++;
+	number_t num;
+	bool isinteger;
+	if (!parseJSONNumber(start,it,num,isinteger))
 		return false;
-	return true;
+	if (isinteger)
+		return setJSONValue(parent,key,asAtomHandler::fromInt((int32_t)num),wrk);
+	return setJSONValue(parent,key,asAtomHandler::fromNumber(wrk,num,false),wrk);
 }
-bool JSON::parseObject(const tiny_string &jsonstring, CharIterator& it, asAtom& parent, multiname &key, asAtom reviver, ASWorker* wrk)
+bool JSON::parseObject(const char*& it, const char* end, asAtom& parent, multiname &key, asAtom reviver, ASWorker* wrk)
 {
 	it++; // ignore '{' or ','
 	ASObject* subobj = new_asobject(wrk);
-	if (asAtomHandler::isInvalid(parent))
-		parent = asAtomHandler::fromObject(subobj);
-	else if (asAtomHandler::isObject(parent))
-	{
-		asAtom v = asAtomHandler::fromObject(subobj);
-		asAtomHandler::getObjectNoCheck(parent)->setVariableByMultiname(key,v,ASObject::CONST_NOT_ALLOWED,nullptr,wrk);
-	}
-	else
+	if (!setJSONValue(parent,key,asAtomHandler::fromObject(subobj),wrk))
 		return false;
 	multiname name(nullptr);
 	name.name_type=multiname::NAME_STRING;
@@ -552,14 +720,11 @@ bool JSON::parseObject(const tiny_string &jsonstring, CharIterator& it, asAtom&
 	bool needkey = true;
 	bool needvalue = false;
 
-	while (!done && it != jsonstring.end())
+	while (!done && it < end)
 	{
-		while (*it == ' ' ||
-			   *it == '\t' ||
-			   *it == '\n' ||
-			   *it == '\r'
-			   )
-			it++;
+		skipJSONWhitespace(it,end);
+		if (it >= end)
+			break;
 		char c = *it;
 		switch(c)
 		{
@@ -573,8 +738,9 @@ bool JSON::parseObject(const tiny_string &jsonstring, CharIterator& it, asAtom&
 				{
 					tiny_string keyname;
 					asAtom p = asAtomHandler::invalidAtom;
-					if (!parseString(jsonstring,it,p,name,wrk,&keyname))
+					if (!parseString(it,end,p,name,wrk,&keyname))
 						return false;
+					// keys are interned, so repeated keys in arrays of objects only create one string
 					name.name_s_id=wrk->getSystemState()->getUniqueStringId(keyname);
 					needkey = false;
 					needvalue = true;
@@ -591,7 +757,7 @@ bool JSON::parseObject(const tiny_string &jsonstring, CharIterator& it, asAtom&
 			{
 				it++;
 				asAtom p = asAtomHandler::fromObjectNoPrimitive(subobj);
-				if (!parse(jsonstring,it,p,name,reviver,wrk))
+				if (!parse(it,end,p,name,reviver,wrk))
 					return false;
 				needvalue = false;
 				break;
@@ -604,18 +770,11 @@ bool JSON::parseObject(const tiny_string &jsonstring, CharIterator& it, asAtom&
 	return done;
 }
 
-bool JSON::parseArray(const tiny_string &jsonstring, CharIterator& it, asAtom& parent, multiname &key, asAtom reviver, ASWorker* wrk)
+bool JSON::parseArray(const char*& it, const char* end, asAtom& parent, multiname &key, asAtom reviver, ASWorker* wrk)
 {
 	it++; // ignore '['
 	ASObject* subobj = Class<Array>::getInstanceSNoArgs(wrk);
-	if (asAtomHandler::isInvalid(parent))
-		parent = asAtomHandler::fromObject(subobj);
-	else if (asAtomHandler::isObject(parent))
-	{
-		asAtom v = asAtomHandler::fromObject(subobj);
-		asAtomHandler::getObjectNoCheck(parent)->setVariableByMultiname(key,v,ASObject::CONST_NOT_ALLOWED,nullptr,wrk);
-	}
-	else
+	if (!setJSONValue(parent,key,asAtomHandler::fromObject(subobj),wrk))
 		return false;
 	multiname name(nullptr);
 	name.name_type=multiname::NAME_UINT;
@@ -624,14 +783,11 @@ bool JSON::parseArray(const tiny_string &jsonstring, CharIterator& it, asAtom& p
 	name.isAttribute = false;
 	bool done = false;
 	bool needdata = false;
-	while (!done && it != jsonstring.end())
+	while (!done && it < end)
 	{
-		while (*it == ' ' ||
-			   *it == '\t' ||
-			   *it == '\n' ||
-			   *it == '\r'
-			   )
-			it++;
+		skipJSONWhitespace(it,end);
+		if (it >= end)
+			break;
 		char c = *it;
 		switch(c)
 		{
@@ -647,7 +803,7 @@ bool JSON::parseArray(const tiny_string &jsonstring, CharIterator& it, asAtom& p
 			default:
 			{
 				asAtom p = asAtomHandler::fromObjectNoPrimitive(subobj);
-				if (!parse(jsonstring,it,p,name, reviver,wrk))
+				if (!parse(it,end,p,name, reviver,wrk))
 					return false;
 				needdata = false;
 				break;
@@ -36,16 +36,22 @@ public:
 	ASFUNCTION_ATOM(_parse);
 	ASFUNCTION_ATOM(_stringify);
 	static bool doParse(asAtom& res,const tiny_string &jsonstring, asAtom reviver, ASWorker* wrk);
+
+	// helpers for the toJSON implementations, all of them append to the same output buffer
+	static void writeIndent(std::string& out, const tiny_string& spaces);
+	static void writeQuotedString(std::string& out, const tiny_string& s);
+	static void writeNumber(std::string& out, number_t val);
+	// appends a primitive value without boxing it, returns false if the value has to be serialized by toJSON()
+	static bool writePrimitive(std::string& out, asAtom a, ASWorker* wrk, bool checktoJSON=true);
+	static void writeAtom(std::string& out, asAtom a, std::vector<ASObject*>& path, asAtom replacer, const tiny_string& spaces, const tiny_string& filter, ASWorker* wrk);
 private:
 	static bool parseAll(const tiny_string &jsonstring, asAtom& parent , multiname &key, asAtom reviver, ASWorker* wrk);
-	static bool parse(const tiny_string &jsonstring, CharIterator& it, asAtom& parent, multiname &key, asAtom reviver, ASWorker* wrk);
-	static bool parseTrue(CharIterator& it, asAtom& parent, multiname &key, ASWorker* wrk);
-	static bool parseFalse(CharIterator& it, asAtom& parent, multiname &key, ASWorker* wrk);
-	static bool parseNull(CharIterator& it, asAtom& parent, multiname &key, ASWorker* wrk);
-	static bool parseString(const tiny_string &jsonstring, CharIterator& it, asAtom& parent, multiname &key, ASWorker* wrk, tiny_string *result = nullptr);
-	static bool parseNumber(const tiny_string &jsonstring, CharIterator& it, asAtom& parent, multiname &key, ASWorker* wrk);
-	static bool parseObject(const tiny_string &jsonstring, CharIterator& it, asAtom& parent, multiname &key, asAtom reviver, ASWorker* wrk);
-	static bool parseArray(const tiny_string &jsonstring, CharIterator& it, asAtom& parent, multiname &key, asAtom reviver, ASWorker* wrk);
+	static bool parse(const char*& it, const char* end, asAtom& parent, multiname &key, asAtom reviver, ASWorker* wrk);
+	static bool parseLiteral(const char*& it, const char* end, const char* literal, asAtom value, asAtom& parent, multiname &key, ASWorker* wrk);
+	static bool parseString(const char*& it, const char* end, asAtom& parent, multiname &key, ASWorker* wrk, tiny_string *result = nullptr);
+	static bool parseNumber(const char*& it, const char* end, asAtom& parent, multiname &key, ASWorker* wrk);
+	static bool parseObject(const char*& it, const char* end, asAtom& parent, multiname &key, asAtom reviver, ASWorker* wrk);
+	static bool parseArray(const char*& it, const char* end, asAtom& parent, multiname &key, asAtom reviver, ASWorker* wrk);
 };
 
 }
@@ -22,10 +22,99 @@
 #include "scripting/toplevel/Array.h"
 #include "scripting/toplevel/Null.h"
 #include "scripting/toplevel/Undefined.h"
+#include "scripting/flash/system/flashsystem.h"
 
 using namespace std;
 using namespace lightspark;
 
+compiledRegExp::compiledRegExp(pcre* _re):re(_re),study(nullptr),capturingGroups(0),namedGroups(0),namedSize(0),nameTable(nullptr)
+{
+	const char* error=nullptr;
+	study = pcre_study(re,0,&error);
+	if (error)
+		study = nullptr;
+	if (pcre_fullinfo(re, study, PCRE_INFO_CAPTURECOUNT, &capturingGroups) != 0)
+		capturingGroups=0;
+	//Get information about named capturing groups
+	if (pcre_fullinfo(re, study, PCRE_INFO_NAMECOUNT, &namedGroups) != 0)
+		namedGroups=0;
+	//Get information about the size of named entries
+	if (pcre_fullinfo(re, study, PCRE_INFO_NAMEENTRYSIZE, &namedSize) != 0)
+		namedSize=0;
+	if (pcre_fullinfo(re, study, PCRE_INFO_NAMETABLE, &nameTable) != 0)
+	{
+		nameTable=nullptr;
+		namedGroups=0;
+	}
+}
+
+compiledRegExp::~compiledRegExp()
+{
+	if (study)
+		pcre_free(study);
+	pcre_free(re);
+}
+
+int compiledRegExp::exec(const tiny_string& str, int offset, int* ovector, unsigned long recursionlimit) const
+{
+	pcre_extra extra;
+	if (study)
+		extra = *study;
+	else
+		extra.flags = 0;
+	if (recursionlimit)
+	{
+		extra.match_limit_recursion=recursionlimit;
+		extra.flags |= PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+	}
+	return pcre_exec(re, extra.flags ? &extra : nullptr, str.raw_buf(), str.numBytes(), offset, PCRE_NO_UTF8_CHECK, ovector, (capturingGroups+1)*3);
+}
+
+std::shared_ptr<compiledRegExp> regExpCache::get(const tiny_string& source, int options)
+{
+	std::string key(source.raw_buf(),source.numBytes());
+	key.append((const char*)&options,sizeof(options));
+	auto it = entryMap.find(key);
+	if (it != entryMap.end())
+	{
+		// move entry to the front of the LRU list
+		entries.splice(entries.begin(),entries,it->second);
+		return it->second->second;
+	}
+	const char * error=nullptr;
+	int errorOffset;
+	int errorcode;
+	pcre* pcreRE=pcre_compile2(source.raw_buf(), options,&errorcode,  &error, &errorOffset,nullptr);
+	if(error)
+	{
+//		if (errorcode == 64) // invalid pattern in javascript compatibility mode (we try again in normal mode to match flash behaviour)
+//		{
+//			options &= ~PCRE_JAVASCRIPT_COMPAT;
+//			pcreRE=pcre_compile2(source.raw_buf(), options,&errorcode,  &error, &errorOffset,NULL);
+//		}
+		if (pcreRE)
+			pcre_free(pcreRE);
+		return std::shared_ptr<compiledRegExp>();
+	}
+	std::shared_ptr<compiledRegExp> res = std::make_shared<compiledRegExp>(pcreRE);
+	entries.emplace_front(key,res);
+	entryMap[key]=entries.begin();
+	if (entries.size() > REGEXP_CACHE_SIZE)
+	{
+		// patterns still in use are kept alive by their shared pointers
+		entryMap.erase(entries.back().first);
+		entries.pop_back();
+	}
+	return res;
+}
+
+std::shared_ptr<compiledRegExp> regExpCache::get(ASWorker* wrk, const tiny_string& source, int options)
+{
+	if (!wrk->regexpcache)
+		wrk->regexpcache = new regExpCache();
+	return wrk->regexpcache->get(source,options);
+}
+
 RegExp::RegExp(ASWorker* wrk, Class_base* c):ASObject(wrk,c,T_OBJECT,SUBTYPE_REGEXP),dotall(false),global(false),ignoreCase(false),
 	extended(false),multiline(false),lastIndex(0)
 {
@@ -36,6 +125,19 @@ RegExp::RegExp(ASWorker* wrk,Class_base* c, const tiny_string& _re):ASObject(wrk
 {
 }
 
+bool RegExp::destruct()
+{
+	resetCompiled();
+	dotall=false;
+	global=false;
+	ignoreCase=false;
+	extended=false;
+	multiline=false;
+	lastIndex=0;
+	source.clear();
+	return destructIntern();
+}
+
 void RegExp::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_DYNAMIC_NOT_FINAL);
@@ -65,6 +167,7 @@ void RegExp::buildTraits(ASObject* o)
 ASFUNCTIONBODY_ATOM(RegExp,_constructor)
 {
 	RegExp* th=asAtomHandler::as<RegExp>(obj);
+	th->resetCompiled();
 	if(argslen > 0 && asAtomHandler::is<RegExp>(args[0]))
 	{
 		if(argslen > 1 && !asAtomHandler::is<Undefined>(args[1]))
@@ -152,62 +255,28 @@ ASFUNCTIONBODY_ATOM(RegExp,exec)
 
 ASObject *RegExp::match(const tiny_string& str)
 {
-	pcre* pcreRE = compile(!str.isSinglebyte());
+	const compiledRegExp* pcreRE = compile(!str.isSinglebyte());
 	if (!pcreRE)
 		return getSystemState()->getNullRef();
-	int capturingGroups;
-	int infoOk=pcre_fullinfo(pcreRE, nullptr, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return getSystemState()->getNullRef();
-	}
-	//Get information about named capturing groups
-	int namedGroups;
-	infoOk=pcre_fullinfo(pcreRE, nullptr, PCRE_INFO_NAMECOUNT, &namedGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return getSystemState()->getNullRef();
-	}
-	//Get information about the size of named entries
-	int namedSize;
-	infoOk=pcre_fullinfo(pcreRE, nullptr, PCRE_INFO_NAMEENTRYSIZE, &namedSize);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return getSystemState()->getNullRef();
-	}
+	int capturingGroups = pcreRE->capturingGroups;
 	struct nameEntry
 	{
 		uint16_t number;
 		char name[0];
 	};
-	char* entries;
-	infoOk=pcre_fullinfo(pcreRE, nullptr, PCRE_INFO_NAMETABLE, &entries);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		lastIndex=0;
-		return getSystemState()->getNullRef();
-	}
-	pcre_extra extra;
-	extra.match_limit_recursion=500;
-	extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+	char* entries = pcreRE->nameTable;
 	int ovector[(capturingGroups+1)*3];
 	int offset=global?lastIndex:0;
 	if(offset<0)
 	{
 		//beyond last match
-		pcre_free(pcreRE);
 		lastIndex=0;
 		return getSystemState()->getNullRef();
 	}
-	int rc=pcre_exec(pcreRE,capturingGroups > 500 ? &extra : nullptr, str.raw_buf(), str.numBytes(), offset, PCRE_NO_UTF8_CHECK, ovector, (capturingGroups+1)*3);
+	int rc=pcreRE->exec(str, offset, ovector, capturingGroups > 500 ? 500 : 0);
 	if(rc<0)
 	{
 		//No matches or error
-		pcre_free(pcreRE);
 		lastIndex=0;
 		return getSystemState()->getNullRef();
 	}
@@ -227,17 +296,16 @@ ASObject *RegExp::match(const tiny_string& str)
 	int index = tmp.numChars();
 
 	a->setVariableAtomByQName("index",nsNameAndKind(),asAtomHandler::fromInt(index),DYNAMIC_TRAIT);
-	for(int i=0;i<namedGroups;i++)
+	for(int i=0;i<pcreRE->namedGroups;i++)
 	{
 		nameEntry* entry=reinterpret_cast<nameEntry*>(entries);
 		uint16_t num=GINT16_FROM_BE(entry->number);
 		asAtom captured=a->at(num);
 		ASATOM_INCREF(captured);
 		a->setVariableAtomByQName(getSystemState()->getUniqueStringId(tiny_string(entry->name, true)),nsNameAndKind(BUILTIN_NAMESPACES::EMPTY_NS),captured,DYNAMIC_TRAIT);
-		entries+=namedSize;
+		entries+=pcreRE->namedSize;
 	}
 	lastIndex=ovector[1];
-	pcre_free(pcreRE);
 	return a;
 }
 
@@ -253,29 +321,17 @@ ASFUNCTIONBODY_ATOM(RegExp,test)
 	const tiny_string& arg0 = asAtomHandler::toString(args[0],wrk);
 	if (wrk->currentCallContext->exceptionthrown)
 		return;
-	pcre* pcreRE = th->compile(!arg0.isSinglebyte());
+	const compiledRegExp* pcreRE = th->compile(!arg0.isSinglebyte());
 	if (!pcreRE)
 	{
 		asAtomHandler::setNull(ret);
 		return;
 	}
-	int capturingGroups;
-	int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		asAtomHandler::setNull(ret);
-		return;
-	}
-	int ovector[(capturingGroups+1)*3];
+	int ovector[(pcreRE->capturingGroups+1)*3];
 	
 	int offset=(th->global)?th->lastIndex:0;
-	pcre_extra extra;
-	extra.match_limit_recursion=200;
-	extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
-	int rc = pcre_exec(pcreRE, &extra, arg0.raw_buf(), arg0.numBytes(), offset, PCRE_NO_UTF8_CHECK, ovector, (capturingGroups+1)*3);
+	int rc = pcreRE->exec(arg0, offset, ovector, 200);
 	bool res = (rc >= 0);
-	pcre_free(pcreRE);
 	asAtomHandler::setBool(ret,res);
 }
 
@@ -308,7 +364,7 @@ ASFUNCTIONBODY_ATOM(RegExp,_toString)
 	ret = asAtomHandler::fromObject(abstract_s(wrk,res));
 }
 
-pcre* RegExp::compile(bool isutf8)
+int RegExp::getOptions(bool isutf8) const
 {
 	int options = PCRE_NEWLINE_ANY | PCRE_NO_UTF8_CHECK;
 	if(isutf8)
@@ -321,20 +377,19 @@ pcre* RegExp::compile(bool isutf8)
 		options |= PCRE_MULTILINE;
 	if(dotall)
 		options|=PCRE_DOTALL;
+	return options;
+}
 
-	const char * error;
-	int errorOffset;
-	int errorcode;
-	pcre* pcreRE=pcre_compile2(source.raw_buf(), options,&errorcode,  &error, &errorOffset,nullptr);
-	if(error)
-	{
-//		if (errorcode == 64) // invalid pattern in javascript compatibility mode (we try again in normal mode to match flash behaviour)
-//		{
-//			options &= ~PCRE_JAVASCRIPT_COMPAT;
-//			pcreRE=pcre_compile2(source.raw_buf(), options,&errorcode,  &error, &errorOffset,NULL);
-//		}
-		if (error)
-			return nullptr;
-	}
-	return pcreRE;
+const compiledRegExp* RegExp::compile(bool isutf8)
+{
+	std::shared_ptr<compiledRegExp>& compiled = isutf8 ? compiledUTF8 : compiledSinglebyte;
+	if (!compiled)
+		compiled = regExpCache::get(getInstanceWorker(),source,getOptions(isutf8));
+	return compiled.get();
+}
+
+void RegExp::resetCompiled()
+{
+	compiledSinglebyte.reset();
+	compiledUTF8.reset();
 }
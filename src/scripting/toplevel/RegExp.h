@@ -22,16 +22,61 @@
 #include "compat.h"
 #include "asobject.h"
 #include "3rdparty/avmplus/pcre/pcre.h"
+#include <list>
+#include <memory>
+
+// maximum number of compiled patterns kept per worker
+#define REGEXP_CACHE_SIZE 64
 
 namespace lightspark
 {
 
+// a compiled pattern together with the pattern information needed for matching
+class compiledRegExp
+{
+public:
+	pcre* re;
+	pcre_extra* study;
+	int capturingGroups;
+	int namedGroups;
+	int namedSize;
+	char* nameTable;
+	compiledRegExp(pcre* _re);
+	// owns the pcre data, so it must not be copied
+	compiledRegExp(const compiledRegExp&) = delete;
+	compiledRegExp& operator=(const compiledRegExp&) = delete;
+	~compiledRegExp();
+	// returns the result of pcre_exec, ovector must have room for (capturingGroups+1)*3 entries
+	int exec(const tiny_string& str, int offset, int* ovector, unsigned long recursionlimit=0) const;
+};
+
+// LRU cache of compiled patterns keyed by source and pcre options, every worker has its own cache
+class regExpCache
+{
+private:
+	typedef std::pair<std::string,std::shared_ptr<compiledRegExp>> cacheEntry;
+	std::list<cacheEntry> entries;
+	std::unordered_map<std::string,std::list<cacheEntry>::iterator> entryMap;
+public:
+	// returns an empty pointer if the pattern can't be compiled
+	std::shared_ptr<compiledRegExp> get(const tiny_string& source, int options);
+	static std::shared_ptr<compiledRegExp> get(ASWorker* wrk, const tiny_string& source, int options);
+};
+
 class RegExp: public ASObject
 {
+private:
+	// patterns are compiled with different options for single byte and utf8 strings
+	std::shared_ptr<compiledRegExp> compiledSinglebyte;
+	std::shared_ptr<compiledRegExp> compiledUTF8;
 public:
 	RegExp(ASWorker* wrk,Class_base* c);
 	RegExp(ASWorker* wrk, Class_base* c, const tiny_string& _re);
-	pcre* compile(bool isutf8);
+	bool destruct() override;
+	int getOptions(bool isutf8) const;
+	// returns the compiled pattern, which is valid as long as this RegExp is not modified or destroyed
+	const compiledRegExp* compile(bool isutf8);
+	void resetCompiled();
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o);
 	ASObject *match(const tiny_string& str);
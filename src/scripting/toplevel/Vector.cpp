@@ -18,6 +18,7 @@
 **************************************************************************/
 
 #include "scripting/toplevel/Vector.h"
+#include "scripting/toplevel/JSON.h"
 #include "scripting/abc.h"
 #include "scripting/class.h"
 #include "parsing/amf3_generator.h"
@@ -104,8 +105,10 @@ void Vector::sinit(Class_base* c)
 	c->prototype->setVariableByQName("unshift",nsNameAndKind(c->getSystemState(),BUILTIN_STRINGS::STRING_AS3NS,NAMESPACE),c->getSystemState()->getBuiltinFunction(unshift),CONSTANT_TRAIT);
 }
 
-Vector::Vector(ASWorker* wrk, Class_base* c, Type *vtype):ASObject(wrk,c,T_OBJECT,SUBTYPE_VECTOR),vec_type(vtype),fixed(false),vec(reporter_allocator<asAtom>(c->memoryAccount))
+Vector::Vector(ASWorker* wrk, Class_base* c, Type *vtype):ASObject(wrk,c,T_OBJECT,SUBTYPE_VECTOR),vec_type(vtype),fixed(false),storage(STORAGE_ATOM),
+	vec(reporter_allocator<asAtom>(c->memoryAccount)),vec_int(reporter_allocator<int32_t>(c->memoryAccount)),vec_number(reporter_allocator<number_t>(c->memoryAccount))
 {
+	setStorage();
 }
 
 Vector::~Vector()
@@ -114,29 +117,17 @@ Vector::~Vector()
 
 bool Vector::destruct()
 {
-	for(unsigned int i=0;i<size();i++)
-	{
-		ASObject* obj = asAtomHandler::getObject(vec[i]);
-		vec[i]=asAtomHandler::invalidAtom;
-		if (obj)
-			obj->removeStoredMember();
-	}
-	vec.clear();
+	clearStorage();
 	vec_type=nullptr;
+	storage=STORAGE_ATOM;
 	return destructIntern();
 }
 
 void Vector::finalize()
 {
-	for(unsigned int i=0;i<size();i++)
-	{
-		ASObject* obj = asAtomHandler::getObject(vec[i]);
-		vec[i]=asAtomHandler::invalidAtom;
-		if (obj)
-			obj->removeStoredMember();
-	}
-	vec.clear();
+	clearStorage();
 	vec_type=nullptr;
+	storage=STORAGE_ATOM;
 }
 
 void Vector::prepareShutdown()
@@ -171,6 +162,7 @@ void Vector::setTypes(const std::vector<Type *> &types)
 	assert(vec_type == nullptr);
 	if(types.size() == 1)
 		vec_type = types[0];
+	setStorage();
 }
 bool Vector::sameType(const Class_base *cls) const
 {
@@ -180,6 +172,129 @@ bool Vector::sameType(const Class_base *cls) const
 	return (clsname.startsWith(cls->class_name.getQualifiedName(getSystemState()).raw_buf()));
 }
 
+void Vector::setStorage()
+{
+	assert(size()==0);
+	if (vec_type == nullptr)
+		storage = STORAGE_ATOM;
+	else if (vec_type == Class<Integer>::getClass(getSystemState()))
+		storage = STORAGE_INT;
+	else if (vec_type == Class<UInteger>::getClass(getSystemState()))
+		storage = STORAGE_UINT;
+	else if (vec_type == Class<Number>::getClass(getSystemState()))
+		storage = STORAGE_NUMBER;
+	else
+		storage = STORAGE_ATOM;
+}
+
+void Vector::resizeStorage(uint32_t len)
+{
+	switch (storage)
+	{
+		case STORAGE_INT:
+		case STORAGE_UINT:
+			vec_int.resize(len,0);
+			break;
+		case STORAGE_NUMBER:
+			vec_number.resize(len,0);
+			break;
+		default:
+			vec.resize(len, getDefaultValue());
+			break;
+	}
+}
+
+void Vector::clearStorage()
+{
+	for(unsigned int i=0;i<vec.size();i++)
+	{
+		ASObject* obj = asAtomHandler::getObject(vec[i]);
+		vec[i]=asAtomHandler::invalidAtom;
+		if (obj)
+			obj->removeStoredMember();
+	}
+	vec.clear();
+	vec_int.clear();
+	vec_number.clear();
+}
+
+void Vector::appendElements(Vector* src)
+{
+	if (storage != STORAGE_ATOM && storage == src->storage)
+	{
+		if (storage == STORAGE_NUMBER)
+			vec_number.insert(vec_number.end(),src->vec_number.begin(),src->vec_number.end());
+		else
+			vec_int.insert(vec_int.end(),src->vec_int.begin(),src->vec_int.end());
+		return;
+	}
+	uint32_t count = src->size();
+	for(uint32_t i=0;i<count;i++)
+	{
+		asAtom o=asAtomHandler::invalidAtom;
+		src->getAtomAt(o,i,getInstanceWorker());
+		if (storage != STORAGE_ATOM)
+		{
+			pushRaw(o);
+			ASATOM_DECREF(o);
+			continue;
+		}
+		if (asAtomHandler::isValid(o))
+			vec_type->coerceForTemplate(getInstanceWorker(),o);
+		ASObject* obj = asAtomHandler::getObject(o);
+		if (obj)
+			obj->addStoredMember();
+		vec.push_back(o);
+	}
+}
+
+bool Vector::storeAtom(uint32_t index, asAtom& o, bool* alreadyset)
+{
+	if (storage != STORAGE_ATOM)
+	{
+		if(index < size())
+			setRaw(index,o);
+		else if(!fixed && index == size())
+			pushRaw(o);
+		else
+			return false;
+		// the value has been copied into the unboxed storage
+		if (alreadyset)
+			*alreadyset = true;
+		else
+			ASATOM_DECREF(o);
+		return true;
+	}
+	if(index < vec.size())
+	{
+		if (vec[index].uintval == o.uintval)
+		{
+			if (alreadyset)
+				*alreadyset = true;
+		}
+		else
+		{
+			ASObject* obj = asAtomHandler::getObject(vec[index]);
+			if (obj)
+				obj->removeStoredMember();
+			obj = asAtomHandler::getObject(o);
+			if (obj)
+				obj->addStoredMember();
+			vec[index] = o;
+		}
+	}
+	else if(!fixed && index == vec.size())
+	{
+		ASObject* obj = asAtomHandler::getObject(o);
+		if (obj)
+			obj->addStoredMember();
+		vec.push_back(o);
+	}
+	else
+		return false;
+	return true;
+}
+
 void Vector::generator(asAtom& ret, ASWorker* wrk, asAtom &o_class, asAtom* args, const unsigned int argslen)
 {
 	assert_and_throw(argslen == 1);
@@ -196,9 +311,15 @@ void Vector::generator(asAtom& ret, ASWorker* wrk, asAtom &o_class, asAtom* args
 		Vector* res = asAtomHandler::as<Vector>(ret);
 
 		Array* a = asAtomHandler::as<Array>(args[0]);
+		res->reserve(a->size());
 		for(unsigned int i=0;i<a->size();++i)
 		{
 			asAtom o = a->at(i);
+			if (res->storage != STORAGE_ATOM)
+			{
+				res->pushRaw(o);
+				continue;
+			}
 			//Convert the elements of the array to the type of this vector
 			if (!type->coerce(wrk,o))
 				ASATOM_INCREF(o);
@@ -226,11 +347,20 @@ void Vector::generator(asAtom& ret, ASWorker* wrk, asAtom &o_class, asAtom* args
 			//create object without calling _constructor
 			asAtomHandler::as<TemplatedClass<Vector>>(o_class)->getInstance(wrk,ret,false,nullptr,0);
 			res = asAtomHandler::as<Vector>(ret);
-			for(auto i = arg->vec.begin(); i != arg->vec.end(); ++i)
+			res->reserve(arg->size());
+			for(uint32_t i = 0; i < arg->size(); ++i)
 			{
-				asAtom o = *i;
-				if (!type->coerce(wrk,o))
-					ASATOM_INCREF(o);
+				asAtom o=asAtomHandler::invalidAtom;
+				arg->getAtomAt(o,i,wrk);
+				if (res->storage != STORAGE_ATOM)
+				{
+					res->pushRaw(o);
+					ASATOM_DECREF(o);
+					continue;
+				}
+				asAtom v = o;
+				if (type->coerce(wrk,o))
+					ASATOM_DECREF(v);
 				ASObject* obj = asAtomHandler::getObject(o);
 				if (obj)
 					obj->addStoredMember();
@@ -254,7 +384,7 @@ ASFUNCTIONBODY_ATOM(Vector,_constructor)
 	Vector* th=asAtomHandler::as<Vector>(obj);
 	assert(th->vec_type);
 	th->fixed = fixed;
-	th->vec.resize(len, th->getDefaultValue());
+	th->resizeStorage(len);
 }
 
 ASFUNCTIONBODY_ATOM(Vector,_concat)
@@ -263,58 +393,22 @@ ASFUNCTIONBODY_ATOM(Vector,_concat)
 	th->getClass()->getInstance(wrk,ret,true,nullptr,0);
 	Vector* res = asAtomHandler::as<Vector>(ret);
 	// copy values into new Vector
-	res->vec.resize(th->size(), th->getDefaultValue());
-	auto it=th->vec.begin();
-	uint32_t index = 0;
-	for(;it != th->vec.end();++it)
-	{
-		res->vec[index]=*it;
-		ASObject* obj = asAtomHandler::getObject(*it);
-		if (obj)
-		{
-			obj->incRef();
-			obj->addStoredMember();
-		}
-		index++;
-	}
+	res->appendElements(th);
 	//Insert the arguments in the vector
 	int pos = wrk->getSystemState()->getSwfVersion() < 11 ? argslen-1 : 0;
 	for(unsigned int i=0;i<argslen;i++)
 	{
 		if (asAtomHandler::is<Vector>(args[pos]))
-		{
-			Vector* arg=asAtomHandler::as<Vector>(args[pos]);
-			res->vec.resize(index+arg->size(), th->getDefaultValue());
-			auto it=arg->vec.begin();
-			for(;it != arg->vec.end();++it)
-			{
-				if (asAtomHandler::isValid(*it))
-				{
-					res->vec[index]= *it;
-					th->vec_type->coerceForTemplate(th->getInstanceWorker(),res->vec[index]);
-					ASObject* obj = asAtomHandler::getObject(*it);
-					if (obj)
-					{
-						obj->incRef();
-						obj->addStoredMember();
-					}
-				}
-				index++;
-			}
-		}
+			res->appendElements(asAtomHandler::as<Vector>(args[pos]));
 		else
 		{
 			asAtom v = args[pos];
 			if (!th->vec_type->coerce(th->getInstanceWorker(),v))
 				ASATOM_INCREF(v);
-			ASObject* obj = asAtomHandler::getObject(v);
-			if (obj)
-				obj->addStoredMember();
-			res->vec[index] = v;
-			index++;
+			res->storeAtom(res->size(),v,nullptr);
 		}
 		pos += (wrk->getSystemState()->getSwfVersion() < 11 ?-1 : 1);
-	}	
+	}
 }
 
 ASFUNCTIONBODY_ATOM(Vector,filter)
@@ -330,7 +424,7 @@ ASFUNCTIONBODY_ATOM(Vector,filter)
 		return;
 	}
 	Vector* th=asAtomHandler::as<Vector>(obj);
-	  
+
 	asAtom f = args[0];
 	asAtom params[3];
 	th->getClass()->getInstance(wrk,ret,true,nullptr,0);
@@ -340,7 +434,9 @@ ASFUNCTIONBODY_ATOM(Vector,filter)
 
 	for(unsigned int i=0;i<th->size();i++)
 	{
-		params[0] = th->vec[i];
+		asAtom v=asAtomHandler::invalidAtom;
+		th->getAtomAt(v,i,wrk);
+		params[0] = v;
 		params[1] = asAtomHandler::fromUInt(i);
 		params[2] = asAtomHandler::fromObject(th);
 
@@ -356,16 +452,12 @@ ASFUNCTIONBODY_ATOM(Vector,filter)
 		{
 			if(asAtomHandler::Boolean_concrete(funcRet))
 			{
-				ASObject* obj = asAtomHandler::getObject(th->vec[i]);
-				if (obj)
-				{
-					obj->incRef();
-					obj->addStoredMember();
-				}
-				res->vec.push_back(th->vec[i]);
+				res->storeAtom(res->size(),v,nullptr);
+				v=asAtomHandler::invalidAtom;
 			}
 			ASATOM_DECREF(funcRet);
 		}
+		ASATOM_DECREF(v);
 	}
 }
 
@@ -388,7 +480,9 @@ ASFUNCTIONBODY_ATOM(Vector, some)
 
 	for(unsigned int i=0; i < th->size(); i++)
 	{
-		params[0] = th->vec[i];
+		asAtom v=asAtomHandler::invalidAtom;
+		th->getAtomAt(v,i,wrk);
+		params[0] = v;
 		params[1] = asAtomHandler::fromUInt(i);
 		params[2] = asAtomHandler::fromObject(th);
 
@@ -400,6 +494,7 @@ ASFUNCTIONBODY_ATOM(Vector, some)
 		{
 			asAtomHandler::callFunction(f,wrk,ret,args[1], params, 3,false);
 		}
+		ASATOM_DECREF(v);
 		if(asAtomHandler::isValid(ret))
 		{
 			if(asAtomHandler::Boolean_concrete(ret))
@@ -431,8 +526,10 @@ ASFUNCTIONBODY_ATOM(Vector, every)
 
 	for(unsigned int i=0; i < th->size(); i++)
 	{
-		if (asAtomHandler::isValid(th->vec[i]))
-			params[0] = th->vec[i];
+		asAtom v=asAtomHandler::invalidAtom;
+		th->getAtomAt(v,i,wrk);
+		if (asAtomHandler::isValid(v))
+			params[0] = v;
 		else
 			params[0] = asAtomHandler::nullAtom;
 		params[1] = asAtomHandler::fromUInt(i);
@@ -446,11 +543,13 @@ ASFUNCTIONBODY_ATOM(Vector, every)
 		{
 			if (asAtomHandler::isUndefined(args[1]) || asAtomHandler::isNull(args[1]))
 			{
+				ASATOM_DECREF(v);
 				createError<TypeError>(wrk,kCallOfNonFunctionError, asAtomHandler::toString(ret,wrk));
 				return;
 			}
 			asAtomHandler::callFunction(f,wrk,ret,args[1], params, 3,false);
 		}
+		ASATOM_DECREF(v);
 		if (wrk->currentCallContext->exceptionthrown)
 			return;
 		if(asAtomHandler::isValid(ret))
@@ -478,15 +577,127 @@ void Vector::append(asAtom &o)
 		createError<RangeError>(getInstanceWorker(),kVectorFixedError);
 		return;
 	}
+	if (storage != STORAGE_ATOM)
+	{
+		pushRaw(o);
+		ASATOM_DECREF(o);
+		return;
+	}
 	asAtom v = o;
-	if (vec_type->coerce(getInstanceWorker(),v))
+	if (vec_type->coerce(getInstanceWorker(),o))
 		ASATOM_DECREF(v);
-	ASObject* obj = asAtomHandler::getObject(v);
+	ASObject* obj = asAtomHandler::getObject(o);
 	if (obj)
 		obj->addStoredMember();
 	vec.push_back(o);
 }
 
+void Vector::appendInt(int32_t v)
+{
+	if (storage == STORAGE_INT || storage == STORAGE_UINT)
+	{
+		if (fixed)
+			createError<RangeError>(getInstanceWorker(),kVectorFixedError);
+		else
+			vec_int.push_back(v);
+		return;
+	}
+	asAtom a = asAtomHandler::invalidAtom;
+	asAtomHandler::setInt(a,getInstanceWorker(),v);
+	append(a);
+}
+
+void Vector::appendUInt(uint32_t v)
+{
+	if (storage == STORAGE_INT || storage == STORAGE_UINT)
+	{
+		if (fixed)
+			createError<RangeError>(getInstanceWorker(),kVectorFixedError);
+		else
+			vec_int.push_back((int32_t)v);
+		return;
+	}
+	asAtom a = asAtomHandler::invalidAtom;
+	asAtomHandler::setUInt(a,getInstanceWorker(),v);
+	append(a);
+}
+
+void Vector::appendNumber(number_t v)
+{
+	if (storage == STORAGE_NUMBER)
+	{
+		if (fixed)
+			createError<RangeError>(getInstanceWorker(),kVectorFixedError);
+		else
+			vec_number.push_back(v);
+		return;
+	}
+	asAtom a = asAtomHandler::invalidAtom;
+	asAtomHandler::setNumber(a,getInstanceWorker(),v);
+	append(a);
+}
+
+void Vector::reserve(uint32_t len)
+{
+	switch (storage)
+	{
+		case STORAGE_INT:
+		case STORAGE_UINT:
+			vec_int.reserve(len);
+			break;
+		case STORAGE_NUMBER:
+			vec_number.reserve(len);
+			break;
+		default:
+			vec.reserve(len);
+			break;
+	}
+}
+
+void Vector::setNumber(uint32_t index, number_t v)
+{
+	if (index >= size())
+		return;
+	switch (storage)
+	{
+		case STORAGE_INT:
+		case STORAGE_UINT:
+			vec_int[index]=Number::toInt(v);
+			break;
+		case STORAGE_NUMBER:
+			vec_number[index]=v;
+			break;
+		default:
+		{
+			asAtom a = asAtomHandler::invalidAtom;
+			asAtomHandler::setNumber(a,getInstanceWorker(),v);
+			set(index,a);
+			break;
+		}
+	}
+}
+
+int32_t Vector::atInt(uint32_t index) const
+{
+	switch (storage)
+	{
+		case STORAGE_INT:
+		case STORAGE_UINT:
+			return vec_int.at(index);
+		case STORAGE_NUMBER:
+			return Number::toInt(vec_number.at(index));
+		default:
+			return asAtomHandler::toInt(vec.at(index));
+	}
+}
+
+asAtom Vector::at(unsigned int index) const
+{
+	// unboxed elements have no atom to borrow, they are read with getAtomAt() or atNumber/atInt/atUInt
+	assert(storage == STORAGE_ATOM);
+	return vec.at(index);
+}
+
 void Vector::remove(ASObject *o)
 {
 	for (auto it = vec.begin(); it != vec.end(); it++)
@@ -525,7 +736,7 @@ ASObject *Vector::describeType(ASWorker* wrk) const
 	//LOG(LOG_INFO,"describeType:"<< Class<XML>::getInstanceS(getInstanceWorker(),root)->toXMLString_internal());
 
 	return XML::createFromNode(wrk,root);
-	
+
 }
 
 ASFUNCTIONBODY_ATOM(Vector,push)
@@ -538,6 +749,11 @@ ASFUNCTIONBODY_ATOM(Vector,push)
 	}
 	for(size_t i = 0; i < argslen; ++i)
 	{
+		if (th->storage != STORAGE_ATOM)
+		{
+			th->pushRaw(args[i]);
+			continue;
+		}
 		//The proprietary player violates the specification and allows elements of any type to be pushed;
 		//they are converted to the vec_type
 		asAtom v = args[i];
@@ -548,7 +764,7 @@ ASFUNCTIONBODY_ATOM(Vector,push)
 			obj->addStoredMember();
 		th->vec.push_back(v);
 	}
-	asAtomHandler::setUInt(ret,wrk,(uint32_t)th->vec.size());
+	asAtomHandler::setUInt(ret,wrk,th->size());
 }
 
 ASFUNCTIONBODY_ATOM(Vector,_pop)
@@ -566,6 +782,12 @@ ASFUNCTIONBODY_ATOM(Vector,_pop)
 		th->vec_type->coerce(th->getInstanceWorker(),ret);
 		return;
 	}
+	if (th->storage != STORAGE_ATOM)
+	{
+		th->getAtomAt(ret,size-1,wrk);
+		th->resizeStorage(size-1);
+		return;
+	}
 	ret = th->vec[size-1];
 	ASObject* ob = asAtomHandler::getObject(ret);
 	if (ob)
@@ -578,7 +800,7 @@ ASFUNCTIONBODY_ATOM(Vector,_pop)
 
 ASFUNCTIONBODY_ATOM(Vector,getLength)
 {
-	asAtomHandler::setUInt(ret,wrk,(uint32_t)asAtomHandler::as<Vector>(obj)->vec.size());
+	asAtomHandler::setUInt(ret,wrk,asAtomHandler::as<Vector>(obj)->size());
 }
 
 ASFUNCTIONBODY_ATOM(Vector,setLength)
@@ -600,7 +822,7 @@ ASFUNCTIONBODY_ATOM(Vector,setLength)
 				ob->removeStoredMember();
 		}
 	}
-	th->vec.resize(len, th->getDefaultValue());
+	th->resizeStorage(len);
 }
 
 ASFUNCTIONBODY_ATOM(Vector,getFixed)
@@ -635,7 +857,9 @@ ASFUNCTIONBODY_ATOM(Vector,forEach)
 
 	for(unsigned int i=0; i < th->size(); i++)
 	{
-		params[0] = th->vec[i];
+		asAtom v=asAtomHandler::invalidAtom;
+		th->getAtomAt(v,i,wrk);
+		params[0] = v;
 		params[1] = asAtomHandler::fromUInt(i);
 		params[2] = asAtomHandler::fromObject(th);
 
@@ -649,6 +873,7 @@ ASFUNCTIONBODY_ATOM(Vector,forEach)
 			asAtomHandler::callFunction(f,wrk,funcret,args[1], params, 3,false);
 		}
 		ASATOM_DECREF(funcret);
+		ASATOM_DECREF(v);
 	}
 }
 
@@ -656,16 +881,18 @@ ASFUNCTIONBODY_ATOM(Vector, _reverse)
 {
 	Vector* th = asAtomHandler::as<Vector>(obj);
 
-	std::vector<asAtom> tmp = std::vector<asAtom>(th->vec.begin(),th->vec.end());
-	uint32_t size = th->size();
-	th->vec.clear();
-	th->vec.resize(size, th->getDefaultValue());
-	std::vector<asAtom>::iterator it=tmp.begin();
-	uint32_t index = size-1;
-	for(;it != tmp.end();++it)
- 	{
-		th->vec[index]=*it;
-		index--;
+	switch (th->storage)
+	{
+		case STORAGE_INT:
+		case STORAGE_UINT:
+			std::reverse(th->vec_int.begin(),th->vec_int.end());
+			break;
+		case STORAGE_NUMBER:
+			std::reverse(th->vec_number.begin(),th->vec_number.end());
+			break;
+		default:
+			std::reverse(th->vec.begin(),th->vec.end());
+			break;
 	}
 	th->incRef();
 	ret = asAtomHandler::fromObject(th);
@@ -678,7 +905,7 @@ ASFUNCTIONBODY_ATOM(Vector,lastIndexOf)
 	int32_t res=-1;
 	asAtom arg0=args[0];
 
-	if(th->vec.size() == 0)
+	if(th->size() == 0)
 	{
 		asAtomHandler::setInt(ret,wrk,(int32_t)-1);
 		return;
@@ -710,6 +937,25 @@ ASFUNCTIONBODY_ATOM(Vector,lastIndexOf)
 				i = j;
 		}
 	}
+	if (th->storage != STORAGE_ATOM)
+	{
+		// strict equality between numbers only depends on the numeric value
+		if (asAtomHandler::isNumeric(arg0))
+		{
+			number_t n = asAtomHandler::toNumber(arg0);
+			do
+			{
+				if (th->atNumber(i) == n)
+				{
+					res=i;
+					break;
+				}
+			}
+			while(i--);
+		}
+		asAtomHandler::setInt(ret,wrk,res);
+		return;
+	}
 	do
 	{
 		if (asAtomHandler::isEqualStrict(th->vec[i],wrk,arg0))
@@ -737,6 +983,20 @@ ASFUNCTIONBODY_ATOM(Vector,shift)
 		th->vec_type->coerce(th->getInstanceWorker(),ret);
 		return;
 	}
+	switch (th->storage)
+	{
+		case STORAGE_INT:
+		case STORAGE_UINT:
+			th->getAtomAt(ret,0,wrk);
+			th->vec_int.erase(th->vec_int.begin());
+			return;
+		case STORAGE_NUMBER:
+			th->getAtomAt(ret,0,wrk);
+			th->vec_number.erase(th->vec_number.begin());
+			return;
+		default:
+			break;
+	}
 	if(asAtomHandler::isValid(th->vec[0]))
 		ret=th->vec[0];
 	else
@@ -803,9 +1063,23 @@ ASFUNCTIONBODY_ATOM(Vector,slice)
 	endIndex=th->capIndex(endIndex);
 	th->getClass()->getInstance(wrk,ret,true,nullptr,0);
 	Vector* res= asAtomHandler::as<Vector>(ret);
+	switch (th->storage)
+	{
+		case STORAGE_INT:
+		case STORAGE_UINT:
+			if (endIndex > startIndex)
+				res->vec_int.assign(th->vec_int.begin()+startIndex,th->vec_int.begin()+endIndex);
+			return;
+		case STORAGE_NUMBER:
+			if (endIndex > startIndex)
+				res->vec_number.assign(th->vec_number.begin()+startIndex,th->vec_number.begin()+endIndex);
+			return;
+		default:
+			break;
+	}
 	res->vec.resize(endIndex-startIndex, th->getDefaultValue());
 	int j = 0;
-	for(int i=startIndex; i<endIndex; i++) 
+	for(int i=startIndex; i<endIndex; i++)
 	{
 		if (asAtomHandler::isValid(th->vec[i]))
 		{
@@ -820,6 +1094,14 @@ ASFUNCTIONBODY_ATOM(Vector,slice)
 	}
 }
 
+template<class T, class A>
+static void spliceRaw(std::vector<T,A>& src, std::vector<T,A>& removed, int startIndex, int deleteCount, std::vector<T>& inserted)
+{
+	removed.assign(src.begin()+startIndex,src.begin()+startIndex+deleteCount);
+	src.erase(src.begin()+startIndex,src.begin()+startIndex+deleteCount);
+	src.insert(src.begin()+startIndex,inserted.begin(),inserted.end());
+}
+
 ASFUNCTIONBODY_ATOM(Vector,splice)
 {
 	Vector* th=asAtomHandler::as<Vector>(obj);
@@ -843,6 +1125,29 @@ ASFUNCTIONBODY_ATOM(Vector,splice)
 	if((startIndex+deleteCount)>totalSize)
 		deleteCount=totalSize-startIndex;
 
+	switch (th->storage)
+	{
+		case STORAGE_INT:
+		case STORAGE_UINT:
+		{
+			std::vector<int32_t> inserted;
+			for(unsigned int i=2;i<argslen;i++)
+				inserted.push_back(th->storage == STORAGE_INT ? asAtomHandler::toInt(args[i]) : (int32_t)asAtomHandler::toUInt(args[i]));
+			spliceRaw(th->vec_int,res->vec_int,startIndex,deleteCount,inserted);
+			return;
+		}
+		case STORAGE_NUMBER:
+		{
+			std::vector<number_t> inserted;
+			for(unsigned int i=2;i<argslen;i++)
+				inserted.push_back(asAtomHandler::toNumber(args[i]));
+			spliceRaw(th->vec_number,res->vec_number,startIndex,deleteCount,inserted);
+			return;
+		}
+		default:
+			break;
+	}
+
 	res->vec.resize(deleteCount, th->getDefaultValue());
 	if(deleteCount)
 	{
@@ -870,7 +1175,7 @@ ASFUNCTIONBODY_ATOM(Vector,splice)
 	}
 	th->vec.resize(startIndex, th->getDefaultValue());
 
-	
+
 	//Insert requested values starting at startIndex
 	for(unsigned int i=2;i<argslen;i++)
 	{
@@ -893,15 +1198,18 @@ ASFUNCTIONBODY_ATOM(Vector,splice)
 ASFUNCTIONBODY_ATOM(Vector,join)
 {
 	Vector* th=asAtomHandler::as<Vector>(obj);
-	
+
 	tiny_string del = ",";
 	if (argslen == 1)
 		  del=asAtomHandler::toString(args[0],wrk);
 	string res;
 	for(uint32_t i=0;i<th->size();i++)
 	{
-		if (asAtomHandler::isValid(th->vec[i]))
-			res+=asAtomHandler::toString(th->vec[i],wrk).raw_buf();
+		asAtom v=asAtomHandler::invalidAtom;
+		th->getAtomAt(v,i,wrk);
+		if (asAtomHandler::isValid(v))
+			res+=asAtomHandler::toString(v,wrk).raw_buf();
+		ASATOM_DECREF(v);
 		if(i!=th->size()-1)
 			res+=del.raw_buf();
 	}
@@ -921,6 +1229,24 @@ ASFUNCTIONBODY_ATOM(Vector,indexOf)
 		i = asAtomHandler::toInt(args[1]);
 	}
 
+	if (th->storage != STORAGE_ATOM)
+	{
+		// strict equality between numbers only depends on the numeric value
+		if (asAtomHandler::isNumeric(arg0))
+		{
+			number_t n = asAtomHandler::toNumber(arg0);
+			for(;i<th->size();i++)
+			{
+				if(th->atNumber(i) == n)
+				{
+					res=i;
+					break;
+				}
+			}
+		}
+		asAtomHandler::setInt(ret,wrk,res);
+		return;
+	}
 	for(;i<th->size();i++)
 	{
 		if(asAtomHandler::isEqualStrict(th->vec[i],wrk,arg0))
@@ -1158,7 +1484,7 @@ ASFUNCTIONBODY_ATOM(Vector,_sort)
 		return;
 	}
 	Vector* th=static_cast<Vector*>(asAtomHandler::getObject(obj));
-	
+
 	asAtom comp=asAtomHandler::invalidAtom;
 	bool isNumeric=false;
 	bool isCaseInsensitive=false;
@@ -1180,13 +1506,48 @@ ASFUNCTIONBODY_ATOM(Vector,_sort)
 		if(options&(~(Array::NUMERIC|Array::CASEINSENSITIVE|Array::DESCENDING)))
 			throw UnsupportedException("Vector::sort not completely implemented");
 	}
-	std::vector<asAtom> tmp = vector<asAtom>(th->vec.size());
-	int i = 0;
-	for(auto it=th->vec.begin();it != th->vec.end();++it)
+	if (th->storage != STORAGE_ATOM && isNumeric && asAtomHandler::isInvalid(comp))
 	{
-		tmp[i++]= *it;
+		// numeric sort of unboxed values doesn't need any conversions
+		switch (th->storage)
+		{
+			case STORAGE_INT:
+				if (isDescending)
+					sort(th->vec_int.begin(),th->vec_int.end(),std::greater<int32_t>());
+				else
+					sort(th->vec_int.begin(),th->vec_int.end());
+				break;
+			case STORAGE_UINT:
+				if (isDescending)
+					sort(th->vec_int.begin(),th->vec_int.end(),[](int32_t a, int32_t b) { return (uint32_t)a > (uint32_t)b; });
+				else
+					sort(th->vec_int.begin(),th->vec_int.end(),[](int32_t a, int32_t b) { return (uint32_t)a < (uint32_t)b; });
+				break;
+			default:
+				for (auto it=th->vec_number.begin(); it != th->vec_number.end(); ++it)
+				{
+					if (std::isnan(*it))
+						throw RunTimeException("Cannot sort non number with Array.NUMERIC option");
+				}
+				if (isDescending)
+					sort(th->vec_number.begin(),th->vec_number.end(),std::greater<number_t>());
+				else
+					sort(th->vec_number.begin(),th->vec_number.end());
+				break;
+		}
+		ASATOM_INCREF(obj);
+		ret = obj;
+		return;
 	}
-	
+	std::vector<asAtom> tmp = vector<asAtom>(th->size());
+	for(uint32_t i=0;i<th->size();i++)
+	{
+		if (th->storage != STORAGE_ATOM)
+			th->getAtomAt(tmp[i],i,wrk);
+		else
+			tmp[i]= th->vec[i];
+	}
+
 	if(asAtomHandler::isValid(comp))
 	{
 		sortComparatorWrapper c(comp);
@@ -1195,10 +1556,21 @@ ASFUNCTIONBODY_ATOM(Vector,_sort)
 	else
 		sort(tmp.begin(),tmp.end(),sortComparatorDefault(isNumeric,isCaseInsensitive,isDescending));
 
-	th->vec.clear();
-	for(auto ittmp=tmp.begin();ittmp != tmp.end();++ittmp)
+	if (th->storage != STORAGE_ATOM)
 	{
-		th->vec.push_back(*ittmp);
+		for(uint32_t i=0;i<tmp.size();i++)
+		{
+			th->setRaw(i,tmp[i]);
+			ASATOM_DECREF(tmp[i]);
+		}
+	}
+	else
+	{
+		th->vec.clear();
+		for(auto ittmp=tmp.begin();ittmp != tmp.end();++ittmp)
+		{
+			th->vec.push_back(*ittmp);
+		}
 	}
 	ASATOM_INCREF(obj);
 	ret = obj;
@@ -1214,24 +1586,42 @@ ASFUNCTIONBODY_ATOM(Vector,unshift)
 	}
 	if (argslen > 0)
 	{
-		uint32_t s = th->size();
-		th->vec.resize(th->size()+argslen, th->getDefaultValue());
-		for(uint32_t i=s;i> 0;i--)
-		{
-			th->vec[(i-1)+argslen]=th->vec[i-1];
-			th->vec[i-1] = th->getDefaultValue();
-		}
-		
-		for(uint32_t i=0;i<argslen;i++)
+		switch (th->storage)
 		{
-			th->vec[i] = args[i];
-			if (!th->vec_type->coerce(th->getInstanceWorker(),th->vec[i]))
-				ASATOM_INCREF(th->vec[i]);
-			ASObject* obj = asAtomHandler::getObject(th->vec[i]);
-			if (obj)
+			case STORAGE_INT:
+			case STORAGE_UINT:
+				th->vec_int.insert(th->vec_int.begin(),argslen,0);
+				for(uint32_t i=0;i<argslen;i++)
+					th->setRaw(i,args[i]);
+				break;
+			case STORAGE_NUMBER:
+				th->vec_number.insert(th->vec_number.begin(),argslen,0);
+				for(uint32_t i=0;i<argslen;i++)
+					th->setRaw(i,args[i]);
+				break;
+			default:
 			{
-				obj->incRef();
-				obj->addStoredMember();
+				uint32_t s = th->size();
+				th->vec.resize(th->size()+argslen, th->getDefaultValue());
+				for(uint32_t i=s;i> 0;i--)
+				{
+					th->vec[(i-1)+argslen]=th->vec[i-1];
+					th->vec[i-1] = th->getDefaultValue();
+				}
+
+				for(uint32_t i=0;i<argslen;i++)
+				{
+					th->vec[i] = args[i];
+					if (!th->vec_type->coerce(th->getInstanceWorker(),th->vec[i]))
+						ASATOM_INCREF(th->vec[i]);
+					ASObject* obj = asAtomHandler::getObject(th->vec[i]);
+					if (obj)
+					{
+						obj->incRef();
+						obj->addStoredMember();
+					}
+				}
+				break;
 			}
 		}
 	}
@@ -1242,7 +1632,7 @@ ASFUNCTIONBODY_ATOM(Vector,_map)
 {
 	Vector* th=asAtomHandler::as<Vector>(obj);
 	asAtom thisObject=asAtomHandler::invalidAtom;
-	
+
 	if (argslen >= 1 && !asAtomHandler::is<IFunction>(args[0]))
 	{
 		createError<TypeError>(wrk,kCheckTypeFailedError, asAtomHandler::toObject(args[0],wrk)->getClassName(), "Function");
@@ -1253,16 +1643,24 @@ ASFUNCTIONBODY_ATOM(Vector,_map)
 	ARG_CHECK(ARG_UNPACK(func)(thisObject,asAtomHandler::nullAtom));
 	th->getClass()->getInstance(wrk,ret,true,nullptr,0);
 	Vector* res= asAtomHandler::as<Vector>(ret);
+	res->reserve(th->size());
 
 	for(uint32_t i=0;i<th->size();i++)
 	{
 		asAtom funcArgs[3];
-		funcArgs[0]=th->vec[i];
+		th->getAtomAt(funcArgs[0],i,wrk);
 		funcArgs[1]=asAtomHandler::fromUInt(i);
 		funcArgs[2]=asAtomHandler::fromObject(th);
 		asAtom funcRet=asAtomHandler::invalidAtom;
 		asAtomHandler::callFunction(func,wrk,funcRet,thisObject, funcArgs, 3,false);
+		ASATOM_DECREF(funcArgs[0]);
 		assert_and_throw(asAtomHandler::isValid(funcRet));
+		if (res->storage != STORAGE_ATOM)
+		{
+			res->pushRaw(funcRet);
+			ASATOM_DECREF(funcRet);
+			continue;
+		}
 		ASObject* obj = asAtomHandler::getObject(funcRet);
 		if (obj)
 			obj->addStoredMember();
@@ -1276,9 +1674,17 @@ ASFUNCTIONBODY_ATOM(Vector,_toString)
 {
 	tiny_string res;
 	Vector* th = asAtomHandler::as<Vector>(obj);
-	for(size_t i=0; i < th->vec.size(); ++i)
+	uint32_t size = th->size();
+	for(size_t i=0; i < size; ++i)
 	{
-		if (asAtomHandler::isValid(th->vec[i]))
+		if (th->storage != STORAGE_ATOM)
+		{
+			asAtom v=asAtomHandler::invalidAtom;
+			th->getAtomAt(v,i,wrk);
+			res += asAtomHandler::toString(v,wrk);
+			ASATOM_DECREF(v);
+		}
+		else if (asAtomHandler::isValid(th->vec[i]))
 			res += asAtomHandler::toString(th->vec[i],wrk);
 		else
 		{
@@ -1288,7 +1694,7 @@ ASFUNCTIONBODY_ATOM(Vector,_toString)
 			res += asAtomHandler::toString(natom,wrk);
 		}
 
-		if(i!=th->vec.size()-1)
+		if(i!=size-1)
 			res += ',';
 	}
 	ret = asAtomHandler::fromObject(abstract_s(wrk,res));
@@ -1306,20 +1712,34 @@ ASFUNCTIONBODY_ATOM(Vector,insertAt)
 	asAtom o=asAtomHandler::invalidAtom;
 	ARG_CHECK(ARG_UNPACK(index)(o));
 
-	if (index < 0 && th->vec.size() >= (uint32_t)(-index))
-		index = th->vec.size()+(index);
+	uint32_t size = th->size();
+	if (index < 0 && size >= (uint32_t)(-index))
+		index = size+(index);
 	if (index < 0)
 		index = 0;
+	if ((uint32_t)index > size)
+		index = size;
+	switch (th->storage)
+	{
+		case STORAGE_INT:
+		case STORAGE_UINT:
+			th->vec_int.insert(th->vec_int.begin()+index,0);
+			th->setRaw(index,o);
+			return;
+		case STORAGE_NUMBER:
+			th->vec_number.insert(th->vec_number.begin()+index,0);
+			th->setRaw(index,o);
+			return;
+		default:
+			break;
+	}
 	ASObject* ob = asAtomHandler::getObject(o);
 	if (ob)
 	{
 		ob->incRef();
 		ob->addStoredMember();
 	}
-	if ((uint32_t)index >= th->vec.size())
-		th->vec.push_back(o);
-	else
-		th->vec.insert(th->vec.begin()+index,o);
+	th->vec.insert(th->vec.begin()+index,o);
 }
 
 ASFUNCTIONBODY_ATOM(Vector,removeAt)
@@ -1332,23 +1752,38 @@ ASFUNCTIONBODY_ATOM(Vector,removeAt)
 	}
 	int32_t index;
 	ARG_CHECK(ARG_UNPACK(index));
+	uint32_t size = th->size();
 	if (index < 0)
-		index = th->vec.size()+index;
+		index = size+index;
 	if (index < 0)
 		index = 0;
-	if ((uint32_t)index < th->vec.size())
+	if ((uint32_t)index >= size)
 	{
-		ret = th->vec[index];
-		ASObject* ob = asAtomHandler::getObject(ret);
-		th->vec.erase(th->vec.begin()+index);
-		if (ob)
-		{
-			ob->incRef(); // for result
-			ob->removeStoredMember();
-		}
-	}
-	else
 		createError<RangeError>(wrk,kOutOfRangeError);
+		return;
+	}
+	switch (th->storage)
+	{
+		case STORAGE_INT:
+		case STORAGE_UINT:
+			th->getAtomAt(ret,index,wrk);
+			th->vec_int.erase(th->vec_int.begin()+index);
+			return;
+		case STORAGE_NUMBER:
+			th->getAtomAt(ret,index,wrk);
+			th->vec_number.erase(th->vec_number.begin()+index);
+			return;
+		default:
+			break;
+	}
+	ret = th->vec[index];
+	ASObject* ob = asAtomHandler::getObject(ret);
+	th->vec.erase(th->vec.begin()+index);
+	if (ob)
+	{
+		ob->incRef(); // for result
+		ob->removeStoredMember();
+	}
 }
 
 bool Vector::hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype, ASWorker* wrk)
@@ -1363,7 +1798,7 @@ bool Vector::hasPropertyByMultiname(const multiname& name, bool considerDynamic,
 	if(!Vector::isValidMultiname(getSystemState(),name,index))
 		return ASObject::hasPropertyByMultiname(name, considerDynamic, considerPrototype,wrk);
 
-	if(index < vec.size())
+	if(index < size())
 		return true;
 	else
 		return false;
@@ -1384,32 +1819,32 @@ GET_VARIABLE_RESULT Vector::getVariableByMultiname(asAtom& ret, const multiname&
 
 	unsigned int index=0;
 	bool isNumber =false;
-	if(!Vector::isValidMultiname(getSystemState(),name,index,&isNumber) || index > vec.size())
+	if(!Vector::isValidMultiname(getSystemState(),name,index,&isNumber) || index > size())
 	{
 		switch(name.name_type) 
 		{
 			case multiname::NAME_NUMBER:
 				if (getSystemState()->getSwfVersion() >= 11 
 						|| (uint32_t(name.name_d) == name.name_d && name.name_d < UINT32_MAX))
-					createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(vec.size()));
+					createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(size()));
 				else
 					createError<ReferenceError>(getInstanceWorker(),kReadSealedError, name.normalizedName(getSystemState()), this->getClass()->getQualifiedClassName());
 				return GET_VARIABLE_RESULT::GETVAR_NORMAL;
 			case multiname::NAME_INT:
 				if (getSystemState()->getSwfVersion() >= 11
-						|| name.name_i >= (int32_t)vec.size())
-					createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(vec.size()));
+						|| name.name_i >= (int32_t)size())
+					createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(size()));
 				else
 					createError<ReferenceError>(getInstanceWorker(),kReadSealedError, name.normalizedName(getSystemState()), this->getClass()->getQualifiedClassName());
 				return GET_VARIABLE_RESULT::GETVAR_NORMAL;
 			case multiname::NAME_UINT:
-				createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(vec.size()));
+				createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(size()));
 				return GET_VARIABLE_RESULT::GETVAR_NORMAL;
 			case multiname::NAME_STRING:
 				if (isNumber)
 				{
 					if (getSystemState()->getSwfVersion() >= 11 )
-						createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(vec.size()));
+						createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(size()));
 					else
 						createError<ReferenceError>(getInstanceWorker(),kReadSealedError, name.normalizedName(getSystemState()), this->getClass()->getQualifiedClassName());
 					return GET_VARIABLE_RESULT::GETVAR_NORMAL;
@@ -1424,17 +1859,27 @@ GET_VARIABLE_RESULT Vector::getVariableByMultiname(asAtom& ret, const multiname&
 			createError<ReferenceError>(getInstanceWorker(),kReadSealedError, name.normalizedName(getSystemState()), this->getClass()->getQualifiedClassName());
 		return res;
 	}
-	if(index < vec.size())
+	if(index < size())
 	{
-		ret = vec[index];
-		if (!(opt & NO_INCREF))
-			ASATOM_INCREF(ret);
+		if (storage != STORAGE_ATOM)
+		{
+			getAtomAt(ret,index,wrk);
+			// unboxed Numbers are returned as new objects, callers that don't take a reference have to release them
+			if ((opt & NO_INCREF) && asAtomHandler::isObject(ret))
+				return GET_VARIABLE_RESULT::GETVAR_ISNEWOBJECT;
+		}
+		else
+		{
+			ret = vec[index];
+			if (!(opt & NO_INCREF))
+				ASATOM_INCREF(ret);
+		}
 	}
 	else
 	{
 		createError<RangeError>(getInstanceWorker(),kOutOfRangeError,
 				       Integer::toString(index),
-				       Integer::toString(vec.size()));
+				       Integer::toString(size()));
 	}
 	return GET_VARIABLE_RESULT::GETVAR_NORMAL;
 }
@@ -1442,9 +1887,19 @@ GET_VARIABLE_RESULT Vector::getVariableByInteger(asAtom &ret, int index, GET_VAR
 {
 	if (index >=0 && uint32_t(index) < size())
 	{
-		ret = vec[index];
-		if (!(opt & NO_INCREF))
-			ASATOM_INCREF(ret);
+		if (storage != STORAGE_ATOM)
+		{
+			getAtomAt(ret,index,wrk);
+			// unboxed Numbers are returned as new objects, callers that don't take a reference have to release them
+			if ((opt & NO_INCREF) && asAtomHandler::isObject(ret))
+				return GET_VARIABLE_RESULT::GETVAR_ISNEWOBJECT;
+		}
+		else
+		{
+			ret = vec[index];
+			if (!(opt & NO_INCREF))
+				ASATOM_INCREF(ret);
+		}
 		return GET_VARIABLE_RESULT::GETVAR_NORMAL;
 	}
 	else
@@ -1463,20 +1918,20 @@ multiname *Vector::setVariableByMultiname(multiname& name, asAtom& o, CONST_ALLO
 		{
 			case multiname::NAME_NUMBER:
 				if (getSystemState()->getSwfVersion() >= 11 
-						|| (this->fixed && ((int32_t(name.name_d) != name.name_d) || name.name_d >= (int32_t)vec.size() || name.name_d < 0)))
-					createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(vec.size()));
+						|| (this->fixed && ((int32_t(name.name_d) != name.name_d) || name.name_d >= (int32_t)size() || name.name_d < 0)))
+					createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(size()));
 				else
 					createError<ReferenceError>(getInstanceWorker(),kWriteSealedError, name.normalizedName(getSystemState()), this->getClass()->getQualifiedClassName());
 				return nullptr;
 			case multiname::NAME_INT:
 				if (getSystemState()->getSwfVersion() >= 11
-						|| (this->fixed && (name.name_i >= (int32_t)vec.size() || name.name_i < 0)))
-					createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(vec.size()));
+						|| (this->fixed && (name.name_i >= (int32_t)size() || name.name_i < 0)))
+					createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(size()));
 				else
 					createError<ReferenceError>(getInstanceWorker(),kWriteSealedError, name.normalizedName(getSystemState()), this->getClass()->getQualifiedClassName());
 				return nullptr;
 			case multiname::NAME_UINT:
-				createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(vec.size()));
+				createError<RangeError>(getInstanceWorker(),kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(size()));
 				return nullptr;
 			default:
 				break;
@@ -1490,40 +1945,15 @@ multiname *Vector::setVariableByMultiname(multiname& name, asAtom& o, CONST_ALLO
 		return ASObject::setVariableByMultiname(name, o, allowConst,alreadyset,wrk);
 	}
 	asAtom v = o;
-	if (this->vec_type->coerce(getInstanceWorker(), o))
+	if (storage == STORAGE_ATOM && this->vec_type->coerce(getInstanceWorker(), o))
 		ASATOM_DECREF(v);
-	if(index < vec.size())
-	{
-		if (vec[index].uintval == o.uintval)
-		{
-			if (alreadyset)
-				*alreadyset = true;
-		}
-		else
-		{
-			ASObject* obj = asAtomHandler::getObject(vec[index]);
-			if (obj)
-				obj->removeStoredMember();
-			obj = asAtomHandler::getObject(o);
-			if (obj)
-				obj->addStoredMember();
-			vec[index] = o;
-		}
-	}
-	else if(!fixed && index == vec.size())
-	{
-		ASObject* obj = asAtomHandler::getObject(o);
-		if (obj)
-			obj->addStoredMember();
-		vec.push_back(o);
-	}
-	else
+	if (!storeAtom(index,o,alreadyset))
 	{
 		/* Spec says: one may not set a value with an index more than
 		 * one beyond the current final index. */
 		createError<RangeError>(getInstanceWorker(),kOutOfRangeError,
 				       Integer::toString(index),
-				       Integer::toString(vec.size()));
+				       Integer::toString(size()));
 	}
 	return nullptr;
 }
@@ -1537,37 +1967,15 @@ void Vector::setVariableByInteger(int index, asAtom &o, ASObject::CONST_ALLOWED_
 	}
 	*alreadyset = false;
 	asAtom v = o;
-	if (this->vec_type->coerce(getInstanceWorker(), o))
+	if (storage == STORAGE_ATOM && this->vec_type->coerce(getInstanceWorker(), o))
 		ASATOM_DECREF(v);
-	if(size_t(index) < vec.size())
-	{
-		if (vec[index].uintval != o.uintval)
-		{
-			ASObject* obj = asAtomHandler::getObject(vec[index]);
-			if (obj)
-				obj->removeStoredMember();
-			obj = asAtomHandler::getObject(o);
-			if (obj)
-				obj->addStoredMember();
-			vec[index] = o;
-		}
-		else
-			*alreadyset=true;
-	}
-	else if(!fixed && size_t(index) == vec.size())
-	{
-		ASObject* obj = asAtomHandler::getObject(o);
-		if (obj)
-			obj->addStoredMember();
-		vec.push_back(o);
-	}
-	else
+	if (!storeAtom(index,o,alreadyset))
 	{
 		/* Spec says: one may not set a value with an index more than
 		 * one beyond the current final index. */
 		createError<RangeError>(getInstanceWorker(),kOutOfRangeError,
 				       Integer::toString(index),
-				       Integer::toString(vec.size()));
+				       Integer::toString(size()));
 	}
 }
 
@@ -1577,25 +1985,28 @@ void Vector::throwRangeError(int index)
 	 * one beyond the current final index. */
 	createError<RangeError>(getInstanceWorker(),kOutOfRangeError,
 				   Integer::toString(index),
-				   Integer::toString(vec.size()));
+				   Integer::toString(size()));
 }
 
 tiny_string Vector::toString()
 {
 	//TODO: test
 	tiny_string t;
-	for(size_t i = 0; i < vec.size(); ++i)
+	for(size_t i = 0; i < size(); ++i)
 	{
 		if( i )
 			t += ",";
-		t += asAtomHandler::toString(vec[i],getInstanceWorker());
+		asAtom v=asAtomHandler::invalidAtom;
+		getAtomAt(v,i,getInstanceWorker());
+		t += asAtomHandler::toString(v,getInstanceWorker());
+		ASATOM_DECREF(v);
 	}
 	return t;
 }
 
 uint32_t Vector::nextNameIndex(uint32_t cur_index)
 {
-	if(cur_index < vec.size())
+	if(cur_index < size())
 		return cur_index+1;
 	else
 		return 0;
@@ -1603,7 +2014,7 @@ uint32_t Vector::nextNameIndex(uint32_t cur_index)
 
 void Vector::nextName(asAtom& ret,uint32_t index)
 {
-	if(index<=vec.size())
+	if(index<=size())
 		asAtomHandler::setUInt(ret,this->getInstanceWorker(),index-1);
 	else
 		throw RunTimeException("Vector::nextName out of bounds");
@@ -1611,11 +2022,8 @@ void Vector::nextName(asAtom& ret,uint32_t index)
 
 void Vector::nextValue(asAtom& ret,uint32_t index)
 {
-	if(index<=vec.size())
-	{
-		ASATOM_INCREF(vec[index-1]);
-		ret = vec[index-1];
-	}
+	if(index<=size())
+		getAtomAt(ret,index-1,getInstanceWorker());
 	else
 		throw RunTimeException("Vector::nextValue out of bounds");
 }
@@ -1629,7 +2037,7 @@ bool Vector::ensureLength(uint32_t len)
 			createError<RangeError>(getInstanceWorker(),kVectorFixedError);
 			return false;
 		}
-		vec.resize(len, getDefaultValue());
+		resizeStorage(len);
 	}
 	return true;
 }
@@ -1646,28 +2054,31 @@ bool Vector::isValidMultiname(SystemState* sys,const multiname& name, uint32_t&
 	return validIndex;
 }
 
-tiny_string Vector::toJSON(std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces, const tiny_string &filter)
+void Vector::toJSON(std::string& out, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces, const tiny_string &filter)
 {
-	bool ok;
-	tiny_string res = call_toJSON(ok,path,replacer,spaces,filter);
-	if (ok)
-		return res;
+	if (call_toJSON(out,path,replacer,spaces,filter))
+		return;
 	// check for cylic reference
 	if (std::find(path.begin(),path.end(), this) != path.end())
 	{
 		createError<TypeError>(getInstanceWorker(),kJSONCyclicStructure);
-		return res;
+		return;
 	}
 
 	path.push_back(this);
-	res += "[";
+	out += '[';
 	bool bfirst = true;
-	tiny_string newline = (spaces.empty() ? "" : "\n");
 	asAtom closure = asAtomHandler::getClosureAtom(replacer, asAtomHandler::nullAtom);
-	for (unsigned int i =0;  i < vec.size(); i++)
-	{
-		tiny_string subres;
-		asAtom o = vec[i];
+	for (unsigned int i =0;  i < size(); i++)
+	{
+		// elements that produce no output are removed together with their separator
+		size_t mark = out.size();
+		if (!bfirst)
+			out += ',';
+		JSON::writeIndent(out,spaces);
+		size_t start = out.size();
+		asAtom o=asAtomHandler::invalidAtom;
+		getAtomAt(o,i,getInstanceWorker());
 		if (asAtomHandler::isValid(replacer))
 		{
 			asAtom params[2];
@@ -1678,45 +2089,27 @@ tiny_string Vector::toJSON(std::vector<ASObject *> &path, asAtom replacer, const
 			asAtomHandler::callFunction(replacer,getInstanceWorker(),funcret,closure, params, 2,false);
 			if (asAtomHandler::isValid(funcret))
 			{
-				subres = asAtomHandler::toObject(funcret,getInstanceWorker())->toJSON(path,asAtomHandler::invalidAtom,spaces,filter);
+				JSON::writeAtom(out,funcret,path,asAtomHandler::invalidAtom,spaces,filter,getInstanceWorker());
 				ASATOM_DECREF(funcret);
 			}
 		}
 		else
-		{
-			bool newobj = !asAtomHandler::isObject(o); // member is not a pointer to an ASObject, so toObject() will create a temporary ASObject that has to be decreffed after usage
-			subres = asAtomHandler::toObject(o,getInstanceWorker())->toJSON(path,replacer,spaces,filter);
-			if (newobj)
-				ASATOM_DECREF(o);
-		}
-		if (!subres.empty())
-		{
-			if (!bfirst)
-				res += ",";
-			res += newline+spaces;
-			
+			JSON::writeAtom(out,o,path,replacer,spaces,filter,getInstanceWorker());
+		ASATOM_DECREF(o);
+		if (out.size() == start)
+			out.resize(mark);
+		else
 			bfirst = false;
-			res += subres;
-		}
 	}
 	if (!bfirst)
-		res += newline+spaces.substr_bytes(0,spaces.numBytes()/2);
-	res += "]";
+		JSON::writeIndent(out,spaces.substr_bytes(0,spaces.numBytes()/2));
+	out += ']';
 	path.pop_back();
-	return res;
-}
-
-asAtom Vector::at(unsigned int index, asAtom defaultValue) const
-{
-	if (index < vec.size())
-		return vec.at(index);
-	else
-		return defaultValue;
 }
 
-void Vector::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
+void Vector::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
 {
 	if (out->getObjectEncoding() == OBJECT_ENCODING::AMF0)
 	{
@@ -1756,6 +2149,18 @@ void Vector::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMa
 		}
 		for(uint32_t i=0;i<count;i++)
 		{
+			switch (storage)
+			{
+				case STORAGE_INT:
+				case STORAGE_UINT:
+					out->writeUnsignedInt(out->endianIn((uint32_t)vec_int[i]));
+					continue;
+				case STORAGE_NUMBER:
+					out->serializeDouble(vec_number[i]);
+					continue;
+				default:
+					break;
+			}
 			if (asAtomHandler::isInvalid(vec[i]))
 			{
 				//TODO should we write a null_marker here?
@@ -233,9 +233,16 @@ public:
 
 class Vector: public ASObject
 {
+	// Vectors of int, uint and Number keep their elements unboxed,
+	// all other element types are stored as atoms in vec
+	enum VECTOR_STORAGE { STORAGE_ATOM=0, STORAGE_INT, STORAGE_UINT, STORAGE_NUMBER };
 	Type* vec_type;
 	bool fixed;
+	VECTOR_STORAGE storage;
 	std::vector<asAtom, reporter_allocator<asAtom>> vec;
+	// used for int and uint elements, uint values are stored by their bit pattern
+	std::vector<int32_t, reporter_allocator<int32_t>> vec_int;
+	std::vector<number_t, reporter_allocator<number_t>> vec_number;
 	int capIndex(int i) const;
 	class sortComparatorDefault
 	{
@@ -248,6 +255,44 @@ class Vector: public ASObject
 		bool operator()(const asAtom& d1, const asAtom& d2);
 	};
 	asAtom getDefaultValue();
+	void setStorage();
+	void resizeStorage(uint32_t len);
+	void clearStorage();
+	// appends all elements of src, coercing them to vec_type
+	void appendElements(Vector* src);
+	// converts o into the unboxed storage, o is not consumed
+	FORCE_INLINE void setRaw(uint32_t index, asAtom& o)
+	{
+		switch (storage)
+		{
+			case STORAGE_INT:
+				vec_int[index]=asAtomHandler::toInt(o);
+				break;
+			case STORAGE_UINT:
+				vec_int[index]=(int32_t)asAtomHandler::toUInt(o);
+				break;
+			default:
+				vec_number[index]=asAtomHandler::toNumber(o);
+				break;
+		}
+	}
+	FORCE_INLINE void pushRaw(asAtom& o)
+	{
+		switch (storage)
+		{
+			case STORAGE_INT:
+				vec_int.push_back(asAtomHandler::toInt(o));
+				break;
+			case STORAGE_UINT:
+				vec_int.push_back((int32_t)asAtomHandler::toUInt(o));
+				break;
+			default:
+				vec_number.push_back(asAtomHandler::toNumber(o));
+				break;
+		}
+	}
+	// stores o (already coerced) at index or appends it if index==size(), consumes o
+	bool storeAtom(uint32_t index, asAtom& o, bool* alreadyset);
 public:
 	class sortComparatorWrapper
 	{
@@ -283,6 +328,18 @@ public:
 			return;
 		}
 		*alreadyset=false;
+		if (storage != STORAGE_ATOM)
+		{
+			// the value is converted into the unboxed storage, so the caller keeps ownership of o
+			*alreadyset=true;
+			if(size_t(index) < size())
+				setRaw(index,o);
+			else if(!fixed && size_t(index) == size())
+				pushRaw(o);
+			else
+				throwRangeError(index);
+			return;
+		}
 		if(size_t(index) < vec.size())
 		{
 			if (vec[index].uintval != o.uintval)
@@ -315,16 +372,44 @@ public:
 	bool hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype, ASWorker* wrk) override;
 	GET_VARIABLE_RESULT getVariableByMultiname(asAtom& ret, const multiname& name, GET_VARIABLE_OPTION opt, ASWorker* wrk) override;
 	GET_VARIABLE_RESULT getVariableByInteger(asAtom& ret, int index, GET_VARIABLE_OPTION opt,ASWorker* wrk) override;
+	// ret is set to a new reference
 	FORCE_INLINE void getVariableByIntegerDirect(asAtom& ret, int index, ASWorker* wrk)
 	{
 		if (index >=0 && uint32_t(index) < size())
-			ret = vec[index];
+			getAtomAt(ret,index,wrk);
 		else
 			getVariableByIntegerIntern(ret,index,GET_VARIABLE_OPTION::NONE,wrk);
 	}
+	// sets ret to a new reference to the element at index, index must be valid
+	FORCE_INLINE void getAtomAt(asAtom& ret, uint32_t index, ASWorker* wrk) const
+	{
+		switch (storage)
+		{
+			case STORAGE_INT:
+				ret = asAtomHandler::fromInt(vec_int[index]);
+				break;
+			case STORAGE_UINT:
+				ret = asAtomHandler::fromUInt((uint32_t)vec_int[index]);
+				break;
+			case STORAGE_NUMBER:
+			{
+				number_t d = vec_number[index];
+				// integral values don't need a Number object
+				if (d >= INT32_MIN && d <= INT32_MAX && d == (int32_t)d && (d != 0 || !std::signbit(d)))
+					ret = asAtomHandler::fromInt((int32_t)d);
+				else
+					asAtomHandler::setNumber(ret,wrk,d);
+				break;
+			}
+			default:
+				ret = vec[index];
+				ASATOM_INCREF(ret);
+				break;
+		}
+	}
 	static bool isValidMultiname(SystemState* sys, const multiname& name, uint32_t& index, bool *isNumber = nullptr);
 
-	tiny_string toJSON(std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter) override;
+	void toJSON(std::string& out, std::vector<ASObject *> &path, asAtom replacer, const tiny_string &spaces,const tiny_string& filter) override;
 
 	uint32_t nextNameIndex(uint32_t cur_index) override;
 	void nextName(asAtom &ret, uint32_t index) override;
@@ -332,17 +417,55 @@ public:
 
 	uint32_t size() const
 	{
-		return vec.size();
+		switch (storage)
+		{
+			case STORAGE_INT:
+			case STORAGE_UINT:
+				return vec_int.size();
+			case STORAGE_NUMBER:
+				return vec_number.size();
+			default:
+				return vec.size();
+		}
+	}
+	//Returns a borrowed reference, only valid for Vectors of objects. Numeric Vectors are read with getAtomAt or atNumber/atInt/atUInt
+	asAtom at(unsigned int index) const;
+	number_t atNumber(uint32_t index) const
+	{
+		switch (storage)
+		{
+			case STORAGE_INT:
+				return vec_int.at(index);
+			case STORAGE_UINT:
+				return (uint32_t)vec_int.at(index);
+			case STORAGE_NUMBER:
+				return vec_number.at(index);
+			default:
+				return asAtomHandler::toNumber(vec.at(index));
+		}
 	}
-	asAtom at(unsigned int index) const
+	//Get value at index, or return defaultValue if index is out-of-range
+	number_t atNumber(uint32_t index, number_t defaultValue) const
 	{
-		return vec.at(index);
+		return index < size() ? atNumber(index) : defaultValue;
+	}
+	int32_t atInt(uint32_t index) const;
+	uint32_t atUInt(uint32_t index) const
+	{
+		return (uint32_t)atInt(index);
 	}
 	bool ensureLength(uint32_t len);
+	//Replaces the value at index, takes ownership of v
 	void set(uint32_t index, asAtom v)
 	{
 		if (index < size())
 		{
+			if (storage != STORAGE_ATOM)
+			{
+				setRaw(index,v);
+				ASATOM_DECREF(v);
+				return;
+			}
 			ASObject* obj = asAtomHandler::getObject(vec[index]);
 			if (obj)
 				obj->removeStoredMember();
@@ -352,13 +475,17 @@ public:
 			vec[index] = v;
 		}
 	}
-	//Get value at index, or return defaultValue (a borrowed
-	//reference) if index is out-of-range
-	asAtom at(unsigned int index, asAtom defaultValue) const;
+	//Replaces the value at index without boxing it for Vectors of Number
+	void setNumber(uint32_t index, number_t v);
 
 	//Appends an object to the Vector. o is coerced to vec_type.
 	//Takes ownership of o.
 	void append(asAtom& o);
+	//Unboxed appends for Vectors of int, uint and Number, the value is converted for other element types
+	void appendInt(int32_t v);
+	void appendUInt(uint32_t v);
+	void appendNumber(number_t v);
+	void reserve(uint32_t len);
 	void setFixed(bool v) { fixed = v; }
 	bool isFixed() const { return fixed; }
 	
@@ -396,9 +523,9 @@ public:
 
 	ASObject* describeType(ASWorker* wrk) const override;
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
 };
 
 }
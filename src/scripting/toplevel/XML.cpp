@@ -53,16 +53,16 @@ void setDefaultXMLSettings()
 	prettyPrinting = true;
 }
 
-XML::XML(ASWorker* wrk,Class_base* c):ASObject(wrk,c,T_OBJECT,SUBTYPE_XML),parentNode(nullptr),nodetype((pugi::xml_node_type)0),isAttribute(false),nodenameID(BUILTIN_STRINGS::EMPTY),nodenamespace_uri(BUILTIN_STRINGS::EMPTY),nodenamespace_prefix(BUILTIN_STRINGS::EMPTY),constructed(false)
+XML::XML(ASWorker* wrk,Class_base* c):ASObject(wrk,c,T_OBJECT,SUBTYPE_XML),childrenlist(this),lazytree(false),lazyignorewhitespace(false),lazydefaultns(BUILTIN_STRINGS::EMPTY),pendingnamespace_uri(BUILTIN_STRINGS::EMPTY),pendingnamespace_prefix(BUILTIN_STRINGS::EMPTY),parentNode(nullptr),nodetype((pugi::xml_node_type)0),isAttribute(false),nodenameID(BUILTIN_STRINGS::EMPTY),nodenamespace_uri(BUILTIN_STRINGS::EMPTY),nodenamespace_prefix(BUILTIN_STRINGS::EMPTY),constructed(false)
 {
 }
 
-XML::XML(ASWorker* wrk,Class_base* c, const std::string &str):ASObject(wrk,c,T_OBJECT,SUBTYPE_XML),parentNode(nullptr),nodetype((pugi::xml_node_type)0),isAttribute(false),nodenameID(BUILTIN_STRINGS::EMPTY),nodenamespace_uri(BUILTIN_STRINGS::EMPTY),nodenamespace_prefix(BUILTIN_STRINGS::EMPTY),constructed(false)
+XML::XML(ASWorker* wrk,Class_base* c, const std::string &str):ASObject(wrk,c,T_OBJECT,SUBTYPE_XML),childrenlist(this),lazytree(false),lazyignorewhitespace(false),lazydefaultns(BUILTIN_STRINGS::EMPTY),pendingnamespace_uri(BUILTIN_STRINGS::EMPTY),pendingnamespace_prefix(BUILTIN_STRINGS::EMPTY),parentNode(nullptr),nodetype((pugi::xml_node_type)0),isAttribute(false),nodenameID(BUILTIN_STRINGS::EMPTY),nodenamespace_uri(BUILTIN_STRINGS::EMPTY),nodenamespace_prefix(BUILTIN_STRINGS::EMPTY),constructed(false)
 {
 	createTree(buildFromString(str, getParseMode()),false);
 }
 
-XML::XML(ASWorker* wrk,Class_base* c, const pugi::xml_node& _n, XML* parent, bool fromXMLList):ASObject(wrk,c,T_OBJECT,SUBTYPE_XML),parentNode(0),nodetype((pugi::xml_node_type)0),isAttribute(false),nodenameID(BUILTIN_STRINGS::EMPTY),nodenamespace_uri(BUILTIN_STRINGS::EMPTY),nodenamespace_prefix(BUILTIN_STRINGS::EMPTY),constructed(false)
+XML::XML(ASWorker* wrk,Class_base* c, const pugi::xml_node& _n, XML* parent, bool fromXMLList):ASObject(wrk,c,T_OBJECT,SUBTYPE_XML),childrenlist(this),lazytree(false),lazyignorewhitespace(false),lazydefaultns(BUILTIN_STRINGS::EMPTY),pendingnamespace_uri(BUILTIN_STRINGS::EMPTY),pendingnamespace_prefix(BUILTIN_STRINGS::EMPTY),parentNode(0),nodetype((pugi::xml_node_type)0),isAttribute(false),nodenameID(BUILTIN_STRINGS::EMPTY),nodenamespace_uri(BUILTIN_STRINGS::EMPTY),nodenamespace_prefix(BUILTIN_STRINGS::EMPTY),constructed(false)
 {
 	if (parent)
 		parentNode = parent;
@@ -79,6 +79,9 @@ void XML::finalize()
 bool XML::destruct()
 {
 	xmldoc.reset();
+	lazytree=false;
+	pendingnamespace_uri=BUILTIN_STRINGS::EMPTY;
+	pendingnamespace_prefix=BUILTIN_STRINGS::EMPTY;
 	parentNode=nullptr;
 	nodetype =(pugi::xml_node_type)0;
 	isAttribute = false;
@@ -99,6 +102,8 @@ void XML::prepareShutdown()
 	if (preparedforshutdown)
 		return;
 	ASObject::prepareShutdown();
+	// don't create pending children during shutdown
+	pendingchildren = pugi::xml_node();
 	if (childrenlist)
 		childrenlist->prepareShutdown();
 	if (attributelist)
@@ -1378,6 +1383,44 @@ pugi::xml_node_type XML::getNodeKind() const
 }
 
 
+// checks the parsed document for elements or attributes with the local name localname below root
+static bool pendingSubtreeHasName(const pugi::xml_node& root, const tiny_string& localname, bool isattribute)
+{
+	pugi::xml_node node = root.first_child();
+	while (node && node != root)
+	{
+		if (node.type() == pugi::node_element)
+		{
+			if (isattribute)
+			{
+				for (auto itattr = node.attributes_begin(); itattr != node.attributes_end(); ++itattr)
+				{
+					const char* n = strchr(itattr->name(),':');
+					if (localname == (n ? n+1 : itattr->name()))
+						return true;
+				}
+			}
+			else
+			{
+				const char* n = strchr(node.name(),':');
+				if (localname == (n ? n+1 : node.name()))
+					return true;
+			}
+			if (node.first_child())
+			{
+				node = node.first_child();
+				continue;
+			}
+		}
+		while (node != root && !node.next_sibling())
+			node = node.parent();
+		if (node == root)
+			break;
+		node = node.next_sibling();
+	}
+	return false;
+}
+
 void XML::getDescendantsByQName(const multiname& name, XMLVector& ret) const
 {
 	if (!constructed)
@@ -1409,6 +1452,9 @@ void XML::getDescendantsByQName(const multiname& name, XMLVector& ret) const
 	}
 	if (childrenlist.isNull())
 		return;
+	if (!pendingchildren.empty() && nodenameID!=BUILTIN_STRINGS::EMPTY && nodenameID!=BUILTIN_STRINGS::STRING_WILDCARD
+			&& !pendingSubtreeHasName(pendingchildren,getSystemState()->getStringFromUniqueId(nodenameID),name.isAttribute))
+		return; // no need to create the children if there is no matching node
 	for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
 	{
 		_NR<XML> child= childrenlist->nodes[i];
@@ -2901,9 +2947,9 @@ bool XML::isEqual(ASObject* r)
 	return false;
 }
 
-void XML::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-		    std::map<const ASObject*, uint32_t>& objMap,
-		    std::map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
+void XML::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+		    std::unordered_map<const ASObject*, uint32_t>& objMap,
+		    std::unordered_map<const Class_base*, uint32_t>& traitsMap,ASWorker* wrk)
 {
 	if (out->getObjectEncoding() == OBJECT_ENCODING::AMF0)
 	{
@@ -2941,6 +2987,8 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 		return;
 	pugi::xml_node node = rootnode;
 	bool done = false;
+	uint32_t defaultns = lazytree ? lazydefaultns : getInstanceWorker()->getDefaultXMLNamespaceID();
+	bool ignorews = lazytree ? lazyignorewhitespace : ignoreWhitespace;
 	if (this->childrenlist.isNull() || this->childrenlist->nodes.size() > 0)
 	{
 		this->childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(getInstanceWorker()));
@@ -2955,7 +3003,7 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 			switch (node.type())
 			{
 				case pugi::node_null: // Empty (null) node handle
-					fillNode(this,node);
+					fillNode(this,node,defaultns,ignorews);
 					done = true;
 					break;
 				case pugi::node_document:// A document tree's absolute root
@@ -2965,32 +3013,45 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 				case pugi::node_declaration: // Document declaration, i.e. '<?xml version="1.0"?>'
 				{
 					XML* tmp = Class<XML>::getInstanceSNoArgs(getInstanceWorker());
-					fillNode(tmp,node);
+					fillNode(tmp,node,defaultns,ignorews);
 					if(this->procinstlist.isNull())
 						this->procinstlist = _MR(Class<XMLList>::getInstanceSNoArgs(getInstanceWorker()));
 					this->procinstlist->append(_MNR(tmp));
 					break;
 				}
 				case pugi::node_doctype:// Document type declaration, i.e. '<!DOCTYPE doc>'
-					fillNode(this,node);
+					fillNode(this,node,defaultns,ignorews);
 					break;
 				case pugi::node_pcdata: // Plain character data, i.e. 'text'
 				case pugi::node_cdata: // Character data, i.e. '<![CDATA[text]]>'
-					fillNode(this,node);
+					fillNode(this,node,defaultns,ignorews);
 					done = true;
 					break;
 				case pugi::node_comment: // Comment tag, i.e. '<!-- text -->'
-					fillNode(this,node);
+					fillNode(this,node,defaultns,ignorews);
 					break;
 				case pugi::node_element: // Element tag, i.e. '<node/>'
 				{
-					fillNode(this,node);
-					pugi::xml_node_iterator it=node.begin();
-					while(it!=node.end())
+					fillNode(this,node,defaultns,ignorews);
+					if (xmldoc && node.root() == xmldoc->root() && canCreateChildrenLazily(node))
 					{
-						//LOG(LOG_INFO,"rootchildnode1:"<<it->name()<<" "<<it->value()<<" "<<it->type()<<" "<<parentNode);
-						this->childrenlist->append(_NR<XML>(XML::createFromNode(getInstanceWorker(),*it,this)));
-						it++;
+						// the children are created from the parsed document on first access
+						lazytree = true;
+						lazydefaultns = defaultns;
+						lazyignorewhitespace = ignorews;
+						pendingnamespace_uri = nodenamespace_uri;
+						pendingnamespace_prefix = nodenamespace_prefix;
+						pendingchildren = node;
+					}
+					else
+					{
+						pugi::xml_node_iterator it=node.begin();
+						while(it!=node.end())
+						{
+							//LOG(LOG_INFO,"rootchildnode1:"<<it->name()<<" "<<it->value()<<" "<<it->type()<<" "<<parentNode);
+							this->childrenlist->append(_NR<XML>(XML::createFromNode(getInstanceWorker(),*it,this)));
+							it++;
+						}
 					}
 					done = true;
 					break;
@@ -3024,13 +3085,20 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 			case pugi::node_pcdata: // Plain character data, i.e. 'text'
 			case pugi::node_cdata: // Character data, i.e. '<![CDATA[text]]>'
 			case pugi::node_comment: // Comment tag, i.e. '<!-- text -->'
-				fillNode(this,node);
+				fillNode(this,node,defaultns,ignorews);
 				break;
 			case pugi::node_element: // Element tag, i.e. '<node/>'
 			{
-				fillNode(this,node);
-				pugi::xml_node_iterator it=node.begin();
+				fillNode(this,node,defaultns,ignorews);
+				if (lazytree)
+				{
+					pendingnamespace_uri = nodenamespace_uri;
+					pendingnamespace_prefix = nodenamespace_prefix;
+					pendingchildren = node;
+				}
+				else
 				{
+					pugi::xml_node_iterator it=node.begin();
 					while(it!=node.end())
 					{
 						XML* tmp = XML::createFromNode(getInstanceWorker(),*it,this);
@@ -3047,7 +3115,104 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 	}
 }
 
-void XML::fillNode(XML* node, const pugi::xml_node &srcnode)
+void XML::createPendingChildren()
+{
+	pugi::xml_node node = pendingchildren;
+	pendingchildren = pugi::xml_node();
+	for (pugi::xml_node_iterator it=node.begin(); it!=node.end(); it++)
+	{
+		XML* tmp = Class<XML>::getInstanceSNoArgs(getInstanceWorker());
+		tmp->parentNode = this;
+		tmp->xmldoc = xmldoc;
+		tmp->lazytree = true;
+		tmp->lazydefaultns = lazydefaultns;
+		tmp->lazyignorewhitespace = lazyignorewhitespace;
+		tmp->createTree(*it,false);
+		childrenlist.list->append(_MNR(tmp));
+	}
+}
+
+bool XML::canCreateChildrenLazily(const pugi::xml_node& root)
+{
+	// creating the children later must not raise any errors, so we check that all
+	// element prefixes are bound and that there are no attributes with the same local name
+	std::vector<tiny_string> prefixes;
+	std::vector<uint32_t> prefixcounts;
+	std::vector<tiny_string> attrnames;
+	pugi::xml_node node = root;
+	while (true)
+	{
+		if (node.type() == pugi::node_element)
+		{
+			uint32_t count = 0;
+			attrnames.clear();
+			for (auto itattr = node.attributes_begin(); itattr != node.attributes_end(); ++itattr)
+			{
+				tiny_string aname(itattr->name(),true);
+				if (aname == "xmlns")
+					continue;
+				if (aname.numBytes() >= 6 && aname.startsWith("xmlns:"))
+				{
+					prefixes.push_back(aname.substr_bytes(6,aname.numBytes()-6));
+					count++;
+					continue;
+				}
+				uint32_t pos = aname.find(":");
+				tiny_string localname = pos == tiny_string::npos ? aname : aname.substr_bytes(pos+1,aname.numBytes()-pos-1);
+				if (std::find(attrnames.begin(),attrnames.end(),localname) != attrnames.end())
+					return false;
+				attrnames.push_back(localname);
+			}
+			prefixcounts.push_back(count);
+			tiny_string nodename(node.name(),true);
+			uint32_t pos = nodename.find(":");
+			if (pos != tiny_string::npos)
+			{
+				if (pos == 0)
+					return false;
+				tiny_string prefix = nodename.substr_bytes(0,pos);
+				if (prefix != "xml" && std::find(prefixes.begin(),prefixes.end(),prefix) == prefixes.end())
+					return false;
+			}
+			if (node.first_child())
+			{
+				node = node.first_child();
+				continue;
+			}
+			prefixes.resize(prefixes.size()-prefixcounts.back());
+			prefixcounts.pop_back();
+		}
+		while (node != root && !node.next_sibling())
+		{
+			node = node.parent();
+			prefixes.resize(prefixes.size()-prefixcounts.back());
+			prefixcounts.pop_back();
+		}
+		if (node == root)
+			break;
+		node = node.next_sibling();
+	}
+	return true;
+}
+
+bool XML::findLazyNamespace(SystemState* sys, const pugi::xml_node& srcnode, uint32_t prefix, uint32_t& uri)
+{
+	// the namespaces of the ancestors of a lazily created node may have been modified
+	// since parsing, so the prefix is resolved through the declarations in the parsed document
+	tiny_string attrname = tiny_string("xmlns:")+sys->getStringFromUniqueId(prefix);
+	for (pugi::xml_node n = srcnode; n; n = n.parent())
+	{
+		pugi::xml_attribute attr = n.attribute(attrname.raw_buf());
+		if (attr)
+		{
+			uri = sys->getUniqueStringId(attr.value());
+			return true;
+		}
+	}
+	return false;
+}
+
+void XML::fillNode(XML* node, const pugi::xml_node &srcnode, uint32_t defaultns, bool ignorews)
 {
 	if (node->childrenlist.isNull())
 	{
@@ -3057,11 +3222,18 @@ void XML::fillNode(XML* node, const pugi::xml_node &srcnode)
 	node->nodetype = srcnode.type();
 	node->nodenameID = node->getSystemState()->getUniqueStringId(nodename);
 	node->nodevalue = srcnode.value();
-	if (node->parentNode && node->parentNode->nodenamespace_prefix == BUILTIN_STRINGS::EMPTY)
+	if (node->lazytree && node->parentNode)
+	{
+		if (node->parentNode->pendingnamespace_prefix == BUILTIN_STRINGS::EMPTY)
+			node->nodenamespace_uri = node->parentNode->pendingnamespace_uri;
+		else
+			node->nodenamespace_uri = defaultns;
+	}
+	else if (node->parentNode && node->parentNode->nodenamespace_prefix == BUILTIN_STRINGS::EMPTY)
 		node->nodenamespace_uri = node->parentNode->nodenamespace_uri;
 	else
-		node->nodenamespace_uri = node->getInstanceWorker()->getDefaultXMLNamespaceID();
-	if (ignoreWhitespace && node->nodetype == pugi::node_pcdata)
+		node->nodenamespace_uri = defaultns;
+	if (ignorews && node->nodetype == pugi::node_pcdata)
 		node->nodevalue = node->nodevalue.removeWhitespace();
 	node->attributelist = _MR(Class<XMLList>::getInstanceSNoArgs(node->getInstanceWorker()));
 	pugi::xml_attribute_iterator itattr;
@@ -3098,6 +3270,8 @@ void XML::fillNode(XML* node, const pugi::xml_node &srcnode)
 		node->nodenameID = node->getSystemState()->getUniqueStringId(nodename.substr(pos+1,nodename.end()));
 		if (node->nodenamespace_prefix == BUILTIN_STRINGS::STRING_XML)
 			node->nodenamespace_uri = BUILTIN_STRINGS::STRING_NAMESPACENS;
+		else if (node->lazytree && node->parentNode)
+			namespacefound = findLazyNamespace(node->getSystemState(),srcnode,node->nodenamespace_prefix,node->nodenamespace_uri);
 		else
 		{
 			XML* tmpnode = node;
@@ -3136,7 +3310,7 @@ void XML::fillNode(XML* node, const pugi::xml_node &srcnode)
 		tmp->nodetype = pugi::node_null;
 		tmp->isAttribute = true;
 		tmp->nodenameID = node->getSystemState()->getUniqueStringId(aname);
-		tmp->nodenamespace_uri = node->getInstanceWorker()->getDefaultXMLNamespaceID();
+		tmp->nodenamespace_uri = defaultns;
 		pos = aname.find(":");
 		if (pos != tiny_string::npos)
 		{
@@ -3144,6 +3318,8 @@ void XML::fillNode(XML* node, const pugi::xml_node &srcnode)
 			tmp->nodenameID = node->getSystemState()->getUniqueStringId(aname.substr(pos+1,aname.end()));
 			if (tmp->nodenamespace_prefix == BUILTIN_STRINGS::STRING_XML)
 				tmp->nodenamespace_uri = BUILTIN_STRINGS::STRING_NAMESPACENS;
+			else if (node->lazytree && node->parentNode)
+				findLazyNamespace(node->getSystemState(),srcnode,tmp->nodenamespace_prefix,tmp->nodenamespace_uri);
 			else
 			{
 				XML* tmpnode = node;
@@ -26,14 +26,50 @@ namespace lightspark
 {
 class Namespace;
 class XMLList;
+class XML;
+
+/*
+ * Holds the children of an XML node. If the node was created from a parsed
+ * document, the XML objects for its children are only created on first access.
+ */
+class xmlChildrenList
+{
+friend class XML;
+private:
+	XML* owner;
+	_NR<XMLList> list;
+	inline void createPending() const;
+public:
+	xmlChildrenList(XML* o):owner(o) {}
+	inline XMLList* operator->() const { createPending(); return list.getPtr(); }
+	inline XMLList* getPtr() const { createPending(); return list.getPtr(); }
+	inline operator _NR<XMLList>() const { createPending(); return list; }
+	inline bool isNull() const { return list.isNull(); }
+	explicit operator bool() const { return !list.isNull(); }
+	template<class R> inline xmlChildrenList& operator=(const R& r);
+	inline void reset();
+};
+
 class XML: public ASObject, public XMLBase
 {
 friend class XMLList;
+friend class xmlChildrenList;
 public:
 	typedef std::vector<_NR<XML>> XMLVector;
 	typedef std::vector<_R<Namespace>> NSVector;
 private:
-	_NR<XMLList> childrenlist;
+	xmlChildrenList childrenlist;
+	// element in xmldoc whose children are not yet converted into XML objects
+	pugi::xml_node pendingchildren;
+	// this node is part of a tree that creates its children on first access,
+	// the settings active during parsing are stored to create the children the same way
+	bool lazytree;
+	bool lazyignorewhitespace;
+	uint32_t lazydefaultns;
+	// namespace of this node at the time pendingchildren was set, the children inherit it
+	// even if the namespace of this node is modified before they are created
+	uint32_t pendingnamespace_uri;
+	uint32_t pendingnamespace_prefix;
 	XML* parentNode;
 	pugi::xml_node_type nodetype;
 	bool isAttribute;
@@ -47,7 +83,10 @@ private:
 	NSVector namespacedefs;
 
 	void createTree(const pugi::xml_node &rootnode, bool fromXMLList);
-	static void fillNode(XML* node, const pugi::xml_node &srcnode);
+	void createPendingChildren();
+	static bool canCreateChildrenLazily(const pugi::xml_node& root);
+	static bool findLazyNamespace(SystemState* sys, const pugi::xml_node& srcnode, uint32_t prefix, uint32_t& uri);
+	static void fillNode(XML* node, const pugi::xml_node &srcnode, uint32_t defaultns, bool ignorews);
 	tiny_string toString_priv();
 	const char* nodekindString();
 	
@@ -187,10 +226,28 @@ public:
 	void nextName(asAtom &ret, uint32_t index) override;
 	void nextValue(asAtom &ret, uint32_t index) override;
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap, ASWorker* wrk) override;
 	void dumpTreeObjects(int indent=0);
 };
+
+void xmlChildrenList::createPending() const
+{
+	if (!owner->pendingchildren.empty())
+		owner->createPendingChildren();
+}
+template<class R> xmlChildrenList& xmlChildrenList::operator=(const R& r)
+{
+	// pending children are replaced by the new list
+	owner->pendingchildren = pugi::xml_node();
+	list = r;
+	return *this;
+}
+void xmlChildrenList::reset()
+{
+	owner->pendingchildren = pugi::xml_node();
+	list.reset();
+}
 }
 #endif /* SCRIPTING_TOPLEVEL_XML_H */
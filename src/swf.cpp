@@ -108,49 +108,105 @@ ASWorker* lightspark::getWorker()
 void SystemState::registerFrameListener(DisplayObject* obj)
 {
 	Locker l(mutexFrameListeners);
-	frameListeners.insert(obj);
+	if (frameListenerIndex.insert(make_pair(obj,frameListeners.size())).second)
+		frameListeners.push_back(obj);
 }
 
 void SystemState::unregisterFrameListener(DisplayObject* obj)
 {
 	Locker l(mutexFrameListeners);
-	frameListeners.erase(obj);
+	auto it = frameListenerIndex.find(obj);
+	if (it == frameListenerIndex.end())
+		return;
+	frameListeners[it->second]=nullptr;
+	frameListenerIndex.erase(it);
+	frameListenersRemoved++;
+	if (frameListenersDispatching==0 && frameListenersRemoved*2 > frameListeners.size())
+		compactFrameListeners();
+}
+
+void SystemState::compactFrameListeners()
+{
+	uint32_t n=0;
+	for (uint32_t i = 0; i < frameListeners.size(); i++)
+	{
+		DisplayObject* obj = frameListeners[i];
+		if (!obj)
+			continue;
+		frameListeners[n]=obj;
+		frameListenerIndex[obj]=n;
+		n++;
+	}
+	frameListeners.resize(n);
+	frameListenersRemoved=0;
 }
 
 void SystemState::addBroadcastEvent(const tiny_string& event)
 {
-	Locker l(mutexFrameListeners);
-	if(!frameListeners.empty())
 	{
-		_R<Event> e(Class<Event>::getInstanceS(this->worker,event));
-		auto it=frameListeners.begin();
-		for(;it!=frameListeners.end();it++)
-		{
-			(*it)->incRef();
-			getVm(this)->addEvent(_MR(*it),e);
-		}
+		Locker l(mutexFrameListeners);
+		if(frameListenerIndex.empty())
+			return;
 	}
+	// only one event is added to the queue, the listeners are iterated when it is handled in the vm thread
+	_R<Event> e(Class<Event>::getInstanceS(this->worker,event));
+	getVm(this)->addEvent(NullRef,_MR(new (unaccountedMemory) BroadcastEvent(e)));
 }
 
 void SystemState::handleBroadcastEvent(const tiny_string& event)
 {
-	std::set<DisplayObject*> tmplisteners; // work on copy of framelistners, as the list may change during event handling
 	{
 		Locker l(mutexFrameListeners);
-		for (auto it : frameListeners)
-		{
-			it->incRef();
-			tmplisteners.insert(it);
-		}
+		if(frameListenerIndex.empty())
+			return;
 	}
-	_R<Event> e(Class<Event>::getInstanceS(worker, event));
-	for (auto it : tmplisteners)
-		ABCVm::publicHandleEvent(it, e);
+	dispatchBroadcastEvent(_MR(Class<Event>::getInstanceS(worker, event)));
+}
 
-	for (auto it : tmplisteners)
+void SystemState::dispatchBroadcastEvent(_R<Event> e)
+{
+	// listeners registered during the broadcast don't get the event.
+	// Unregistered listeners are set to nullptr, and the vector is not compacted during the broadcast,
+	// so the indexes stay valid
+	uint32_t count;
 	{
-		it->decRef();
+		Locker l(mutexFrameListeners);
+		count = frameListeners.size();
+		frameListenersDispatching++;
+	}
+	for (uint32_t i = 0; i < count; i++)
+	{
+		DisplayObject* obj;
+		{
+			Locker l(mutexFrameListeners);
+			obj = frameListeners[i];
+			if (!obj)
+				continue;
+			// the listener may be unregistered and destroyed during the event handling
+			obj->incRef();
+		}
+		// an exception in one listener must neither skip the other listeners nor leak the reference
+		bool stop = false;
+		try
+		{
+			ABCVm::publicHandleEvent(obj, e);
+		}
+		catch(LightsparkException& ex)
+		{
+			stop = !currentVm->handleUncaughtException(ex);
+		}
+		catch(ASObject*& ex)
+		{
+			stop = !currentVm->handleUncaughtException(ex);
+		}
+		obj->decRef();
+		if (stop)
+			break;
 	}
+	Locker l(mutexFrameListeners);
+	frameListenersDispatching--;
+	if (frameListenersDispatching==0 && frameListenersRemoved*2 > frameListeners.size())
+		compactFrameListeners();
 }
 
 void SystemState::staticInit()
@@ -194,7 +250,9 @@ static const char* builtinStrings[] = {"any", "void", "prototype", "Function", "
 									   "__proto__","target","flash.events:IEventDispatcher","addEventListener","removeEventListener","dispatchEvent","hasEventListener",
 									   "onConnect","onData","onClose","onSelect",
 									   "add","alpha","darken","difference","erase","hardlight","invert","layer","lighten","multiply","overlay","screen","subtract",
-									   "text"
+									   "text",
+									   "enterFrame","exitFrame","frameConstructed","render",
+									   "toJSON"
 									  };
 
 extern uint32_t asClassCount;
@@ -610,6 +668,8 @@ void SystemState::systemFinalize()
 	parameters.reset();
 	static_SoundMixer_soundTransform.reset();
 	frameListeners.clear();
+	frameListenerIndex.clear();
+	frameListenersRemoved=0;
 	auto it = sharedobjectmap.begin();
 	while (it != sharedobjectmap.end())
 	{
@@ -881,7 +941,7 @@ void SystemState::addEventToBackgroundWorkers(_NR<EventDispatcher> obj, _R<Event
 	for (uint32_t i= 0; i < workerDomain->workerlist->size(); i++)
 	{
 		asAtom w = workerDomain->workerlist->at(i);
-		if (asAtomHandler::is<ASWorker>(w) && !asAtomHandler::as<ASWorker>(w)->isPrimordial && obj->hasEventListener(ev->type))
+		if (asAtomHandler::is<ASWorker>(w) && !asAtomHandler::as<ASWorker>(w)->isPrimordial && obj->hasEventListener(ev->getTypeId()))
 		{
 			asAtomHandler::as<ASWorker>(w)->addEvent(obj,ev);
 		}
@@ -1421,6 +1481,15 @@ void ThreadProfile::accountTime(uint32_t time)
 		data.back().timing+=time;
 }
 
+void ThreadProfile::accountMaxTime(uint32_t time)
+{
+	Locker locker(mutex);
+	if(data.empty() || data.back().index!=tickCount)
+		data.push_back(ProfilingData(tickCount, time));
+	else if(time > data.back().timing)
+		data.back().timing=time;
+}
+
 void ThreadProfile::tick()
 {
 	Locker locker(mutex);
@@ -1597,6 +1666,8 @@ void ParseThread::parseSWFHeader(RootMovieClip *root, UI8 ver)
 			// not reached
 			assert(false);
 		}
+		//Decompress on a separate thread, so that tags can be parsed while the rest of the file is inflated
+		uncompressingFilter = new pipelined_filter(uncompressingFilter,root->getSystemState());
 		f.rdbuf(uncompressingFilter);
 		// the first 8 bytes from the header are always uncompressed (magic bytes + FileLength)
 		root->loaderInfo->setBytesTotal(FileLength-8);
@@ -1662,6 +1733,13 @@ void ParseThread::execute()
 	{
 		LOG(LOG_ERROR,"Stream exception in ParseThread " << e.what());
 	}
+	//Stop the decompression thread now, the caller may release the stream after execute() returns
+	if(uncompressingFilter)
+	{
+		f.rdbuf(backend);
+		delete uncompressingFilter;
+		uncompressingFilter=nullptr;
+	}
 }
 void ParseThread::parseSWF(UI8 ver)
 {
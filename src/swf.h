@@ -110,6 +110,8 @@ private:
 public:
 	ThreadProfile(const RGB& c,uint32_t l,EngineData* _engineData):color(c),len(l),tickCount(0),engineData(_engineData){}
 	void accountTime(uint32_t time);
+	// like accountTime, but keeps the largest value of the tick instead of the sum
+	void accountMaxTime(uint32_t time);
 	void setTag(const std::string& tag);
 	void tick();
 	void plot(uint32_t max, cairo_t *cr);
@@ -199,7 +201,13 @@ private:
 	Mutex profileDataSpinlock;
 
 	Mutex mutexFrameListeners;
-	std::set<DisplayObject*> frameListeners;
+	// frame listeners in the order they were registered.
+	// unregistered listeners are set to nullptr, the vector is compacted when no broadcast is running
+	std::vector<DisplayObject*> frameListeners;
+	std::unordered_map<DisplayObject*,uint32_t> frameListenerIndex;
+	uint32_t frameListenersRemoved=0;
+	uint32_t frameListenersDispatching=0;
+	void compactFrameListeners();
 	/*
 	   The head of the invalidate queue
 	*/
@@ -439,6 +447,8 @@ public:
 	void unregisterFrameListener(DisplayObject* clip);
 	void addBroadcastEvent(const tiny_string& event);
 	void handleBroadcastEvent(const tiny_string& event);
+	// sends e to all frame listeners, must be called from the vm thread
+	void dispatchBroadcastEvent(_R<Event> e);
 
 	//Invalidation queue management
 	void addToInvalidateQueue(_R<DisplayObject> d) override;
@@ -921,34 +921,10 @@ std::istream& lightspark::operator>>(std::istream& s, FILLSTYLE& v)
 	{
 		UI16_SWF bitmapId;
 		s >> bitmapId >> v.Matrix;
-		//Lookup the bitmap in the dictionary
-		if(bitmapId!=65535)
-		{
-			try
-			{
-				const DictionaryTag* dict=getParseThread()->getRootMovie()->applicationDomain->dictionaryLookup(bitmapId);
-				const BitmapTag* b = dynamic_cast<const BitmapTag*>(dict);
-				if(!b)
-				{
-					LOG(LOG_ERROR,"Invalid bitmap ID " << bitmapId);
-					v.bitmap.reset();
-					//throw ParseException("Invalid ID for bitmap");
-				}
-				else
-					v.bitmap = b->getBitmap();
-			}
-			catch(RunTimeException& e)
-			{
-				//Thrown if the bitmapId does not exists in dictionary
-				LOG(LOG_ERROR,"Exception in FillStyle parsing: " << e.what());
-				v.bitmap.reset();
-			}
-		}
-		else
-		{
-			//The bitmap might be invalid, the style should not be used
-			v.bitmap.reset();
-		}
+		// the bitmap is looked up in the dictionary of the DefineShapeTag,
+		// as the shape records may be decoded outside of the parse thread
+		v.bitmapId=bitmapId;
+		v.bitmap.reset();
 	}
 	else
 	{
@@ -1732,12 +1708,12 @@ QName::operator multiname() const
 	return ret;
 }
 
-FILLSTYLE::FILLSTYLE(uint8_t v):Gradient(v,false),FillStyleType(SOLID_FILL),version(v)
+FILLSTYLE::FILLSTYLE(uint8_t v):Gradient(v,false),FillStyleType(SOLID_FILL),version(v),bitmapId(65535)
 {
 }
 
 FILLSTYLE::FILLSTYLE(const FILLSTYLE& r):Matrix(r.Matrix),
-	Gradient(r.Gradient),bitmap(r.bitmap),ShapeBounds(r.ShapeBounds),Color(r.Color),FillStyleType(r.FillStyleType),version(r.version)
+	Gradient(r.Gradient),bitmap(r.bitmap),ShapeBounds(r.ShapeBounds),Color(r.Color),FillStyleType(r.FillStyleType),version(r.version),bitmapId(r.bitmapId)
 {
 }
 
@@ -1754,6 +1730,7 @@ FILLSTYLE& FILLSTYLE::operator=(const FILLSTYLE& r)
 	Color = r.Color;
 	FillStyleType = r.FillStyleType;
 	version = r.version;
+	bitmapId = r.bitmapId;
 	return *this;
 }
 
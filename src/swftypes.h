@@ -54,6 +54,8 @@ enum BUILTIN_STRINGS { EMPTY=0, STRING_WILDCARD='*', ANY=BUILTIN_STRINGS_CHAR_MA
 					   ,STRING_ONCONNECT,STRING_ONDATA,STRING_ONCLOSE,STRING_ONSELECT
 					   ,STRING_ADD,STRING_ALPHA,STRING_DARKEN,STRING_DIFFERENCE,STRING_ERASE,STRING_HARDLIGHT,STRING_INVERT,STRING_LAYER,STRING_LIGHTEN,STRING_MULTIPLY,STRING_OVERLAY,STRING_SCREEN,STRING_SUBTRACT
 					   ,STRING_TEXT
+					   ,STRING_ENTERFRAME,STRING_EXITFRAME,STRING_FRAMECONSTRUCTED,STRING_RENDER
+					   ,STRING_TOJSON
 					   ,LAST_BUILTIN_STRING };
 enum BUILTIN_NAMESPACES { EMPTY_NS=0, AS3_NS };
 
@@ -1070,6 +1072,8 @@ public:
 	RGBA Color;
 	FILL_STYLE_TYPE FillStyleType;
 	uint8_t version;
+	// dictionary id of the bitmap of bitmap fills read from a SWF, the bitmap is resolved by the DefineShapeTag
+	uint16_t bitmapId;
 };
 
 class MORPHFILLSTYLE:public FILLSTYLE
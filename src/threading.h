@@ -24,6 +24,7 @@
 #include <cstdlib>
 #include <cassert>
 #include <vector>
+#include <atomic>
 #include <SDL2/SDL_mutex.h>
 #include <SDL2/SDL_thread.h>
 
@@ -220,6 +221,74 @@ public:
 
 };
 
+/* Lock-free multiple producer single consumer queue.
+ * Producers push without taking a lock, the consumer takes all pending elements at once
+ * in the order they were pushed. Only one thread at a time may call popAll() */
+template<class T>
+class MPSCQueue
+{
+private:
+	class Node
+	{
+	public:
+		T value;
+		Node* next;
+		Node(const T& v):value(v),next(nullptr){}
+	};
+	std::atomic<Node*> head;
+	/* MPSCQueue cannot be copied */
+	MPSCQueue(const MPSCQueue&) = delete;
+	MPSCQueue& operator=(const MPSCQueue&) = delete;
+public:
+	MPSCQueue():head(nullptr){}
+	~MPSCQueue()
+	{
+		Node* n=head.exchange(nullptr);
+		while(n)
+		{
+			Node* next=n->next;
+			delete n;
+			n=next;
+		}
+	}
+	void push(const T& v)
+	{
+		Node* n=new Node(v);
+		Node* oldhead=head.load(std::memory_order_relaxed);
+		do
+		{
+			n->next=oldhead;
+		}
+		while(!head.compare_exchange_weak(oldhead,n));
+	}
+	bool empty() const
+	{
+		return head.load()==nullptr;
+	}
+	// appends all pending elements to the end of out
+	template<class C>
+	void popAll(C& out)
+	{
+		// the elements are linked from newest to oldest, so the list is reversed first
+		Node* n=head.exchange(nullptr);
+		Node* oldest=nullptr;
+		while(n)
+		{
+			Node* next=n->next;
+			n->next=oldest;
+			oldest=n;
+			n=next;
+		}
+		while(oldest)
+		{
+			Node* next=oldest->next;
+			out.push_back(oldest->value);
+			delete oldest;
+			oldest=next;
+		}
+	}
+};
+
 // This class represents the end time when waiting on a conditional
 // variable.
 class CondTime {
@@ -227,8 +296,9 @@ private:
 	gint64 timepoint;
 public:
 	CondTime(long milliseconds);
-	bool operator<(CondTime& c) const;
-	bool operator>(CondTime& c) const;
+	bool operator<(const CondTime& c) const;
+	bool operator>(const CondTime& c) const;
+	bool operator==(const CondTime& c) const { return timepoint==c.timepoint; }
 	bool isInTheFuture() const;
 	void addMilliseconds(long ms);
 	bool wait(Mutex &mutex, Cond& cond);
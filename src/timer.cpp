@@ -28,7 +28,7 @@
 using namespace lightspark;
 using namespace std;
 
-TimerThread::TimerThread(SystemState* s):m_sys(s),stopped(false),joined(false)
+TimerThread::TimerThread(SystemState* s):nextSequence(0),m_sys(s),stopped(false),joined(false)
 {
 	t = SDL_CreateThread(&TimerThread::worker,"TimerThread",this);
 }
@@ -53,8 +53,7 @@ void TimerThread::wait()
 TimerThread::~TimerThread()
 {
 	stop();
-	list<TimingEvent*>::iterator it=pendingEvents.begin();
-	for(;it!=pendingEvents.end();++it)
+	for(auto it=pendingEvents.begin();it!=pendingEvents.end();++it)
 	{
 		if ((*it)->job)
 			(*it)->job->tickFence();
@@ -62,28 +61,90 @@ TimerThread::~TimerThread()
 	}
 }
 
-void TimerThread::insertNewEvent_nolock(TimingEvent* e)
+bool TimerThread::isEarlier(const TimingEvent* a, const TimingEvent* b)
 {
-	list<TimingEvent*>::iterator it=pendingEvents.begin();
-	//If there are no events pending, or this is earlier than the first, signal newEvent
-	if(pendingEvents.empty() || (*it)->wakeUpTime > e->wakeUpTime)
+	if(a->wakeUpTime == b->wakeUpTime)
+		return a->sequence < b->sequence;
+	return a->wakeUpTime < b->wakeUpTime;
+}
+
+void TimerThread::siftUp(uint32_t index)
+{
+	TimingEvent* e=pendingEvents[index];
+	while(index > 0)
 	{
-		pendingEvents.insert(it, e);
-		newEvent.signal();
-		return;
+		uint32_t parent=(index-1)/4;
+		if(!isEarlier(e,pendingEvents[parent]))
+			break;
+		pendingEvents[index]=pendingEvents[parent];
+		pendingEvents[index]->heapIndex=index;
+		index=parent;
 	}
-	++it;
+	pendingEvents[index]=e;
+	e->heapIndex=index;
+}
+
+void TimerThread::siftDown(uint32_t index)
+{
+	TimingEvent* e=pendingEvents[index];
+	uint32_t size=pendingEvents.size();
+	while(true)
+	{
+		uint32_t firstchild=index*4+1;
+		if(firstchild >= size)
+			break;
+		uint32_t lastchild=min(firstchild+4,size);
+		uint32_t earliest=firstchild;
+		for(uint32_t i=firstchild+1;i<lastchild;i++)
+		{
+			if(isEarlier(pendingEvents[i],pendingEvents[earliest]))
+				earliest=i;
+		}
+		if(!isEarlier(pendingEvents[earliest],e))
+			break;
+		pendingEvents[index]=pendingEvents[earliest];
+		pendingEvents[index]->heapIndex=index;
+		index=earliest;
+	}
+	pendingEvents[index]=e;
+	e->heapIndex=index;
+}
+
+void TimerThread::insertNewEvent_nolock(TimingEvent* e)
+{
+	e->sequence=nextSequence++;
+	pendingEvents.push_back(e);
+	siftUp(pendingEvents.size()-1);
+	jobEvents.insert(make_pair(e->job,e));
+	//If this is earlier than all other events, signal newEvent
+	if(e->heapIndex==0)
+		newEvent.signal();
+}
 
-	for(;it!=pendingEvents.end();++it)
+bool TimerThread::removeEvent_nolock(TimingEvent* e)
+{
+	auto range=jobEvents.equal_range(e->job);
+	for(auto it=range.first;it!=range.second;++it)
 	{
-		if((*it)->wakeUpTime > e->wakeUpTime)
+		if(it->second==e)
 		{
-			pendingEvents.insert(it, e);
-			return;
+			jobEvents.erase(it);
+			break;
 		}
 	}
-	//Event has to be inserted after all the others
-	pendingEvents.insert(pendingEvents.end(), e);
+	uint32_t index=e->heapIndex;
+	TimingEvent* last=pendingEvents.back();
+	pendingEvents.pop_back();
+	if(last!=e)
+	{
+		pendingEvents[index]=last;
+		last->heapIndex=index;
+		if(index > 0 && isEarlier(last,pendingEvents[(index-1)/4]))
+			siftUp(index);
+		else
+			siftDown(index);
+	}
+	return index==0;
 }
 
 void TimerThread::insertNewEvent(TimingEvent* e)
@@ -95,9 +156,7 @@ void TimerThread::insertNewEvent(TimingEvent* e)
 //Unsafe debugging routine
 void TimerThread::dumpJobs()
 {
-	list<TimingEvent*>::iterator it=pendingEvents.begin();
-	//Find if the job is in the list
-	for(;it!=pendingEvents.end();++it)
+	for(auto it=pendingEvents.begin();it!=pendingEvents.end();++it)
 		LOG(LOG_INFO, (*it)->job );
 }
 
@@ -109,6 +168,8 @@ void TimerThread::dumpJobs()
  *   2. while executing e->job->tick() (during this time inExectution == e->job)
  * The pendingEvents queue may be altered by another thread with "mutex"
  * An event may be deleted by another thread with "mutex" only if inExectution != jobToDelete
+ * All events that are due are executed one after another without waiting on newEvent in between,
+ * so timers expiring in the same millisecond only cause one wakeup
  */
 int TimerThread::worker(void *d)
 {
@@ -128,16 +189,21 @@ int TimerThread::worker(void *d)
 
 		/* Get expiration of first event */
 		CondTime timing=th->pendingEvents.front()->wakeUpTime;
-		/* Wait for the absolute time or a newEvent signal
-		 * this unlocks the mutex and relocks it before returing
-		 */
-		timing.wait(th->mutex,th->newEvent);
+		if(timing.isInTheFuture())
+		{
+			/* Wait for the absolute time or a newEvent signal
+			 * this unlocks the mutex and relocks it before returing
+			 */
+			timing.wait(th->mutex,th->newEvent);
 
-		if(th->stopped)
-			return 0;
+			if(th->stopped)
+				return 0;
 
-		if(th->pendingEvents.empty())
-			continue;
+			if(th->pendingEvents.empty())
+				continue;
+		}
+		else if(th->stopped)
+			return 0;
 
 		TimingEvent* e=th->pendingEvents.front();
 
@@ -146,7 +212,7 @@ int TimerThread::worker(void *d)
 		if(e->wakeUpTime.isInTheFuture())
 			continue;
 
-		th->pendingEvents.pop_front();
+		th->removeEvent_nolock(e);
 
 		if(e->job->stopMe)
 		{
@@ -210,23 +276,19 @@ void TimerThread::removeJob(ITickJob* job)
 void TimerThread::removeJob_noLock(ITickJob* job)
 {
 
-	/* See if that job is currently pending */
-	list<TimingEvent*>::iterator it=pendingEvents.begin();
-	bool first=true;
-	//Find if the job is in the list
-	for(;it!=pendingEvents.end();++it)
+	/* See if that job is currently pending, if it has multiple events the earliest one is removed */
+	auto range=jobEvents.equal_range(job);
+	if(range.first==range.second)
+		return;
+	TimingEvent* e=range.first->second;
+	for(auto it=range.first;it!=range.second;++it)
 	{
-		if((*it)->job==job)
-			break;
-		first=false;
+		if(isEarlier(it->second,e))
+			e=it->second;
 	}
 
-	if(it==pendingEvents.end())
-		return;
-
 	job->tickFence();
-	TimingEvent* e=*it;
-	pendingEvents.erase(it);
+	bool first=removeEvent_nolock(e);
 	delete e;
 
 	/* the worker is waiting on this job, wake him up */
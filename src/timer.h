@@ -22,7 +22,8 @@
 
 #include "forwards/timer.h"
 #include "compat.h"
-#include <list>
+#include <vector>
+#include <unordered_map>
 #include <ctime>
 #include "threading.h"
 
@@ -38,22 +39,35 @@ private:
 	{
 	public:
 		TimingEvent(ITickJob* _job, bool _isTick, uint32_t _tickTime, uint32_t _waitTime) 
-			: job(_job),wakeUpTime(_isTick ? _tickTime : _waitTime),tickTime(_tickTime),isTick(_isTick) {}
+			: job(_job),wakeUpTime(_isTick ? _tickTime : _waitTime),tickTime(_tickTime),isTick(_isTick),heapIndex(0),sequence(0) {}
 		ITickJob* job;
 		CondTime wakeUpTime;
 		uint32_t tickTime;
 		bool isTick;
+		// position in pendingEvents
+		uint32_t heapIndex;
+		// insertion order, events with the same wakeUpTime are executed in the order they were added
+		uint64_t sequence;
 	};
 	Mutex mutex;
 	Cond newEvent;
 	SDL_Thread* t;
-	std::list<TimingEvent*> pendingEvents;
+	// 4-ary min-heap ordered by wakeUpTime and sequence
+	std::vector<TimingEvent*> pendingEvents;
+	// all pending events of a job, used to find the events to remove without scanning the heap
+	std::unordered_multimap<ITickJob*,TimingEvent*> jobEvents;
+	uint64_t nextSequence;
 	SystemState* m_sys;
 	volatile bool stopped;
 	bool joined;
 	static int worker(void* d);
+	static bool isEarlier(const TimingEvent* a, const TimingEvent* b);
+	void siftUp(uint32_t index);
+	void siftDown(uint32_t index);
 	void insertNewEvent(TimingEvent* e);
 	void insertNewEvent_nolock(TimingEvent* e);
+	// removes e from pendingEvents and jobEvents, returns true if it was the first event
+	bool removeEvent_nolock(TimingEvent* e);
 	void dumpJobs();
 public:
 	TimerThread(SystemState* s);
@@ -19,10 +19,11 @@
 
 #include "tiny_string.h"
 #include "exceptions.h"
+#include <algorithm>
 
 using namespace lightspark;
 
-tiny_string::tiny_string(std::istream& in, int len):buf(_buf_static),stringSize(len+1),type(STATIC)
+tiny_string::tiny_string(std::istream& in, int len):buf(_buf_static),stringSize(len+1),type(STATIC),charindex(nullptr)
 {
 	if(stringSize > STATIC_SIZE)
 		createBuffer(stringSize);
@@ -31,7 +32,7 @@ tiny_string::tiny_string(std::istream& in, int len):buf(_buf_static),stringSize(
 	init();
 }
 
-tiny_string::tiny_string(const char* s,bool copy):_buf_static(),buf(_buf_static),type(READONLY)
+tiny_string::tiny_string(const char* s,bool copy):_buf_static(),buf(_buf_static),type(READONLY),charindex(nullptr)
 {
 	if(copy)
 		makePrivateCopy(s);
@@ -44,8 +45,9 @@ tiny_string::tiny_string(const char* s,bool copy):_buf_static(),buf(_buf_static)
 }
 
 tiny_string::tiny_string(const tiny_string& r):
-	_buf_static(),buf(_buf_static),stringSize(r.stringSize),numchars(r.numchars),type(STATIC),isASCII(r.isASCII),hasNull(r.hasNull),isInteger(r.isInteger)
+	_buf_static(),buf(_buf_static),stringSize(r.stringSize),numchars(r.numchars),type(STATIC),charindex(nullptr),isASCII(r.isASCII),hasNull(r.hasNull),isInteger(r.isInteger)
 {
+	shareCharIndex(r);
 	//Fast path for static read-only strings
 	if(r.type==READONLY)
 	{
@@ -58,7 +60,7 @@ tiny_string::tiny_string(const tiny_string& r):
 	memcpy(buf,r.buf,stringSize);
 }
 
-tiny_string::tiny_string(const std::string& r):_buf_static(),buf(_buf_static),stringSize(r.size()+1),type(STATIC)
+tiny_string::tiny_string(const std::string& r):_buf_static(),buf(_buf_static),stringSize(r.size()+1),type(STATIC),charindex(nullptr)
 {
 	if(stringSize > STATIC_SIZE)
 		createBuffer(stringSize);
@@ -91,6 +93,7 @@ tiny_string& tiny_string::operator=(const tiny_string& s)
 	this->hasNull = s.hasNull;
 	this->isInteger = s.isInteger;
 	this->numchars = s.numchars;
+	shareCharIndex(s);
 	return *this;
 }
 
@@ -138,6 +141,7 @@ tiny_string& tiny_string::operator+=(const char* s)
 
 tiny_string& tiny_string::operator+=(const tiny_string& r)
 {
+	releaseCharIndex();
 	if (this->empty() || this->isInteger)
 		this->isInteger = r.isInteger;
 	if(type==READONLY)
@@ -298,7 +302,7 @@ uint32_t tiny_string::find(const tiny_string& needle, uint32_t start) const
 		const char* p = strstr(buf+start,needle.raw_buf());
 		return (p ? p-buf : npos);
 	}
-	gchar* gp = g_utf8_offset_to_pointer(buf,start);
+	gchar* gp = buf+getBytePosition(start);
 	gchar* found =g_strstr_len(gp,-1,needle.raw_buf());
 	if(found == nullptr)
 		return npos;
@@ -383,6 +387,7 @@ bool tiny_string::getLine(uint32_t& byteindex, tiny_string& line)
 	}
 	//prepare line for new size
 	uint32_t newStringSize=endindex-startindex+1;
+	line.releaseCharIndex();
 	if(line.type==READONLY)
 		line.resetToStatic();
 	if(line.type==STATIC && newStringSize > STATIC_SIZE)
@@ -406,13 +411,13 @@ uint32_t tiny_string::rfind(const tiny_string& needle, uint32_t start) const
 	if(start == npos)
 		bytestart = std::string::npos;
 	else
-		bytestart = g_utf8_offset_to_pointer(buf,start) - buf;
+		bytestart = getBytePosition(start);
 
 	size_t bytepos = std::string(*this).rfind(needle.raw_buf(),bytestart,needle.numBytes());
 	if(bytepos == std::string::npos)
 		return npos;
 	else
-		return g_utf8_pointer_to_offset(buf,buf+bytepos);
+		return bytePosToIndex(bytepos);
 }
 
 void tiny_string::makePrivateCopy(const char* s)
@@ -444,6 +449,7 @@ void tiny_string::resizeBuffer(uint32_t s)
 
 void tiny_string::resetToStatic()
 {
+	releaseCharIndex();
 	if(type==DYNAMIC)
 	{
 		reportMemoryChange(-stringSize);
@@ -457,6 +463,7 @@ void tiny_string::resetToStatic()
 
 void tiny_string::init()
 {
+	releaseCharIndex();
 	numchars = 0;
 	isASCII = true;
 	hasNull = false;
@@ -533,8 +540,8 @@ tiny_string& tiny_string::replace(uint32_t pos1, uint32_t n1, const tiny_string&
 		n1 = numChars()-pos1;
 	if (isASCII)
 		return replace_bytes(pos1, n1, o);
-	uint32_t bytestart = g_utf8_offset_to_pointer(buf,pos1)-buf;
-	uint32_t byteend = g_utf8_offset_to_pointer(buf,pos1+n1)-buf;
+	uint32_t bytestart = getBytePosition(pos1);
+	uint32_t byteend = getBytePosition(pos1+n1);
 	return replace_bytes(bytestart, byteend-bytestart, o);
 }
 
@@ -543,6 +550,7 @@ tiny_string& tiny_string::replace_bytes(uint32_t bytestart, uint32_t bytenum, co
 	uint32_t newlen = this->stringSize+o.numBytes()-bytenum;
 	assert(bytestart+bytenum<stringSize);
 	char* newbuf = new char[newlen];
+	releaseCharIndex();
 	memcpy(newbuf,this->raw_buf(),bytestart);
 	memcpy(newbuf+bytestart,o.raw_buf(),o.numBytes());
 	memcpy(newbuf+bytestart+o.numBytes(),this->raw_buf()+bytestart+bytenum,this->stringSize-(bytestart+bytenum));
@@ -599,8 +607,8 @@ tiny_string tiny_string::substr(uint32_t start, uint32_t len) const
 		len = numChars()-start;
 	if (isASCII)
 		return substr_bytes(start, len);
-	uint32_t bytestart = g_utf8_offset_to_pointer(buf,start) - buf;
-	uint32_t byteend = g_utf8_offset_to_pointer(buf+bytestart,len) - (buf+bytestart);
+	uint32_t bytestart = getBytePosition(start);
+	uint32_t byteend = getBytePosition(start+len) - bytestart;
 	return substr_bytes(bytestart, byteend,byteend-bytestart == len && !this->hasNull);
 }
 
@@ -609,7 +617,7 @@ tiny_string tiny_string::substr(uint32_t start, const CharIterator& end) const
 	if (isASCII)
 		return substr_bytes(start, (end.buf_ptr - buf)-start);
 	assert_and_throw(start < numChars());
-	uint32_t bytestart = g_utf8_offset_to_pointer(buf,start) - buf;
+	uint32_t bytestart = getBytePosition(start);
 	uint32_t byteend = end.buf_ptr - buf;
 	return substr_bytes(bytestart, byteend-bytestart);
 }
@@ -1284,8 +1292,72 @@ uint32_t tiny_string::bytePosToIndex(uint32_t bytepos) const
 		return numChars();
 	if (isASCII)
 		return bytepos;
+	if (numchars < CHARINDEX_MINCHARS)
+		return g_utf8_pointer_to_offset(buf, buf + bytepos);
 
-	return g_utf8_pointer_to_offset(raw_buf(), raw_buf() + bytepos);
+	// find the last sampled character before bytepos and count the characters from there
+	const std::vector<uint32_t>& positions = getCharIndex()->bytepositions;
+	uint32_t sample = std::upper_bound(positions.begin(),positions.end(),bytepos)-positions.begin()-1;
+	return sample*CHARINDEX_INTERVAL + g_utf8_pointer_to_offset(buf+positions[sample], buf + bytepos);
+}
+
+uint32_t tiny_string::getBytePosition(uint32_t charpos) const
+{
+	if (isASCII)
+		return charpos;
+	if (charpos >= numchars)
+		return numBytes();
+	if (numchars < CHARINDEX_MINCHARS)
+		return g_utf8_offset_to_pointer(buf,charpos) - buf;
+
+	const std::vector<uint32_t>& positions = getCharIndex()->bytepositions;
+	uint32_t sample = std::min(uint32_t(charpos/CHARINDEX_INTERVAL),uint32_t(positions.size()-1));
+	return g_utf8_offset_to_pointer(buf+positions[sample],charpos-sample*CHARINDEX_INTERVAL) - buf;
+}
+
+const tiny_string::charIndex* tiny_string::getCharIndex() const
+{
+	charIndex* idx = charindex.load(std::memory_order_acquire);
+	if (idx)
+		return idx;
+	idx = new charIndex();
+	idx->refcount = 1;
+	idx->bytepositions.reserve(numchars/CHARINDEX_INTERVAL+1);
+	const char* p = buf;
+	const char* end = buf+numBytes();
+	uint32_t n = 0;
+	while (p < end)
+	{
+		if (n%CHARINDEX_INTERVAL == 0)
+			idx->bytepositions.push_back(p-buf);
+		p = g_utf8_next_char(p);
+		n++;
+	}
+	if (idx->bytepositions.empty())
+		idx->bytepositions.push_back(0);
+	// the string may be shared between threads, so another thread may have created the index in the meantime
+	charIndex* expected = nullptr;
+	if (!charindex.compare_exchange_strong(expected,idx,std::memory_order_acq_rel))
+	{
+		delete idx;
+		idx = expected;
+	}
+	return idx;
+}
+
+void tiny_string::shareCharIndex(const tiny_string& r)
+{
+	charIndex* idx = r.charindex.load(std::memory_order_acquire);
+	if (idx)
+		idx->refcount++;
+	charindex.store(idx,std::memory_order_release);
+}
+
+void tiny_string::releaseCharIndexIntern()
+{
+	charIndex* idx = charindex.exchange(nullptr,std::memory_order_acq_rel);
+	if (idx && --idx->refcount == 0)
+		delete idx;
 }
 
 CharIterator tiny_string::begin()
@@ -24,6 +24,8 @@
 #include <cstdint>
 #include <ostream>
 #include <list>
+#include <vector>
+#include <atomic>
 /* for utf8 handling */
 #include <glib.h>
 #include "compat.h"
@@ -102,6 +104,25 @@ private:
 	uint32_t stringSize;
 	uint32_t numchars;
 	TYPE type;
+	/* sampled index of the byte positions of every CHARINDEX_INTERVAL-th character.
+	 * It is only built for non-ascii strings with at least CHARINDEX_MINCHARS characters
+	 * and is shared between copies of the string, every modification releases it */
+	#define CHARINDEX_INTERVAL 16
+	#define CHARINDEX_MINCHARS 64
+	struct charIndex
+	{
+		std::atomic<uint32_t> refcount;
+		std::vector<uint32_t> bytepositions;
+	};
+	mutable std::atomic<charIndex*> charindex;
+	const charIndex* getCharIndex() const;
+	void shareCharIndex(const tiny_string& r);
+	void releaseCharIndexIntern();
+	inline void releaseCharIndex()
+	{
+		if (charindex.load(std::memory_order_relaxed))
+			releaseCharIndexIntern();
+	}
 #ifdef MEMORY_USAGE_PROFILING
 	//Implemented in memory_support.cpp
 	DLL_PUBLIC void reportMemoryChange(int32_t change) const;
@@ -122,7 +143,7 @@ private:
 public:
 	static const uint32_t npos = (uint32_t)(-1);
 
-	tiny_string():_buf_static(),buf(_buf_static),stringSize(1),numchars(0),type(STATIC)
+	tiny_string():_buf_static(),buf(_buf_static),stringSize(1),numchars(0),type(STATIC),charindex(nullptr)
 		,isASCII(true),hasNull(false),isInteger(false)
 	{
 		buf[0]=0;
@@ -215,6 +236,7 @@ public:
 
 	FORCE_INLINE void setValue(const char* s,int _numbytes, int _numchars, bool _isASCII, bool _hasNull, bool _isInteger, bool copy)
 	{
+		releaseCharIndex();
 		if(copy)
 		{
 			resetToStatic();
@@ -242,6 +264,7 @@ public:
 	}
 	FORCE_INLINE void setChar(uint32_t c)
 	{
+		releaseCharIndex();
 		if (type != STATIC)
 			resetToStatic();
 		isASCII = c<0x80;
@@ -265,8 +288,11 @@ public:
 	{
 		if (isASCII)
 			return buf[idx];
-		return g_utf8_get_char(g_utf8_offset_to_pointer(buf,idx));
+		return g_utf8_get_char(buf+getBytePosition(idx));
 	}
+	/* returns the byte offset of the utf-8 character at index charpos,
+	 * numBytes() if charpos is beyond the last character */
+	uint32_t getBytePosition(uint32_t charpos) const;
 	/* start is an index of characters.
 	 * returns index of character */
 	uint32_t find(const tiny_string& needle, uint32_t start = 0) const;